@@ -14,12 +14,17 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <time.h>
+#ifdef HAVE_EPOLL_CREATE1
+#include <sys/epoll.h>
+#endif
 #include "knot/common/fdset.h"
 #include "libknot/libknot.h"
+#include "libknot/internal/errcode.h"
 
 /* Workarounds for clock_gettime() not available on some platforms. */
 #ifdef HAVE_CLOCK_GETTIME
@@ -45,10 +50,52 @@ static int fdset_resize(fdset_t *set, unsigned size)
 	MEM_RESIZE(tmp, set->ctx, size * sizeof(void*));
 	MEM_RESIZE(tmp, set->pfd, size * sizeof(struct pollfd));
 	MEM_RESIZE(tmp, set->timeout, size * sizeof(timev_t));
+	MEM_RESIZE(tmp, set->ready, size * sizeof(unsigned));
 	set->size = size;
 	return KNOT_EOK;
 }
 
+#ifdef HAVE_EPOLL_CREATE1
+static uint32_t epoll_events(unsigned events)
+{
+	uint32_t ev = 0;
+	if (events & POLLIN)  ev |= EPOLLIN;
+	if (events & POLLOUT) ev |= EPOLLOUT;
+	return ev;
+}
+
+static unsigned poll_events(uint32_t ev)
+{
+	unsigned events = 0;
+	if (ev & EPOLLIN)  events |= POLLIN;
+	if (ev & EPOLLOUT) events |= POLLOUT;
+	if (ev & EPOLLERR) events |= POLLERR;
+	if (ev & EPOLLHUP) events |= POLLHUP;
+	return events;
+}
+
+/*! \brief Register, update or unregister descriptor at the given index. */
+static int epoll_update(fdset_t *set, int op, unsigned i)
+{
+	if (set->epfd < 0) {
+		set->epfd = epoll_create1(EPOLL_CLOEXEC);
+		if (set->epfd < 0) {
+			return knot_map_errno();
+		}
+	}
+
+	struct epoll_event ev = {
+		.events = epoll_events(set->pfd[i].events),
+		.data.u32 = i
+	};
+	if (epoll_ctl(set->epfd, op, set->pfd[i].fd, &ev) != 0) {
+		return knot_map_errno();
+	}
+
+	return KNOT_EOK;
+}
+#endif
+
 int fdset_init(fdset_t *set, unsigned size)
 {
 	if (set == NULL) {
@@ -56,6 +103,7 @@ int fdset_init(fdset_t *set, unsigned size)
 	}
 
 	memset(set, 0, sizeof(fdset_t));
+	set->epfd = -1;
 	return fdset_resize(set, size);
 }
 
@@ -65,10 +113,15 @@ int fdset_clear(fdset_t* set)
 		return KNOT_EINVAL;
 	}
 
+	if (set->epfd >= 0) {
+		close(set->epfd);
+	}
 	free(set->ctx);
 	free(set->pfd);
 	free(set->timeout);
+	free(set->ready);
 	memset(set, 0, sizeof(fdset_t));
+	set->epfd = -1;
 	return KNOT_EOK;
 }
 
@@ -90,6 +143,14 @@ int fdset_add(fdset_t *set, int fd, unsigned events, void *ctx)
 	set->ctx[i] = ctx;
 	set->timeout[i] = 0;
 
+#ifdef HAVE_EPOLL_CREATE1
+	int ret = epoll_update(set, EPOLL_CTL_ADD, i);
+	if (ret != KNOT_EOK) {
+		--set->n;
+		return ret;
+	}
+#endif
+
 	/* Return index to this descriptor. */
 	return i;
 }
@@ -100,6 +161,13 @@ int fdset_remove(fdset_t *set, unsigned i)
 		return KNOT_EINVAL;
 	}
 
+#ifdef HAVE_EPOLL_CREATE1
+	/* May fail if the descriptor is already closed, it's unregistered then. */
+	if (set->epfd >= 0) {
+		(void)epoll_ctl(set->epfd, EPOLL_CTL_DEL, set->pfd[i].fd, NULL);
+	}
+#endif
+
 	/* Decrement number of elms. */
 	--set->n;
 
@@ -110,11 +178,98 @@ int fdset_remove(fdset_t *set, unsigned i)
 		set->pfd[i] = set->pfd[last];
 		set->timeout[i] = set->timeout[last];
 		set->ctx[i] = set->ctx[last];
+#ifdef HAVE_EPOLL_CREATE1
+		(void)epoll_update(set, EPOLL_CTL_MOD, i);
+#endif
+	}
+
+	/* Drop pending events of the removed fd, follow the moved one. */
+	for (unsigned k = set->next; k < set->nready; ++k) {
+		if (set->ready[k] == i) {
+			set->ready[k] = UINT_MAX;
+		} else if (set->ready[k] == last) {
+			set->ready[k] = i;
+		}
 	}
 
 	return KNOT_EOK;
 }
 
+int fdset_set_events(fdset_t *set, unsigned i, unsigned events)
+{
+	if (set == NULL || i >= set->n) {
+		return KNOT_EINVAL;
+	}
+
+	if (set->pfd[i].events == events) {
+		return KNOT_EOK;
+	}
+
+	set->pfd[i].events = events;
+
+#ifdef HAVE_EPOLL_CREATE1
+	return epoll_update(set, EPOLL_CTL_MOD, i);
+#else
+	return KNOT_EOK;
+#endif
+}
+
+int fdset_wait(fdset_t *set, int timeout)
+{
+	if (set == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	set->nready = 0;
+	set->next = 0;
+
+#ifdef HAVE_EPOLL_CREATE1
+	if (set->epfd < 0) {
+		/* Nothing registered yet. */
+		return poll(NULL, 0, timeout);
+	}
+
+	struct epoll_event ev[FDSET_MAX_EVENTS];
+	int nfds = epoll_wait(set->epfd, ev, FDSET_MAX_EVENTS, timeout);
+	for (int k = 0; k < nfds; ++k) {
+		unsigned i = ev[k].data.u32;
+		if (i < set->n) {
+			set->pfd[i].revents = poll_events(ev[k].events);
+			set->ready[set->nready++] = i;
+		}
+	}
+#else
+	int nfds = poll(set->pfd, set->n, timeout);
+	for (unsigned i = 0; nfds > 0 && i < set->n; ++i) {
+		if (set->pfd[i].revents != 0) {
+			set->ready[set->nready++] = i;
+		}
+	}
+#endif
+	if (nfds < 0) {
+		return knot_map_errno();
+	}
+
+	return set->nready;
+}
+
+int fdset_next(fdset_t *set, unsigned *events)
+{
+	if (set == NULL || events == NULL) {
+		return -1;
+	}
+
+	while (set->next < set->nready) {
+		unsigned i = set->ready[set->next++];
+		if (i < set->n) {
+			*events = set->pfd[i].revents;
+			return i;
+		}
+	}
+
+	return -1;
+}
+
 int fdset_set_watchdog(fdset_t* set, int i, int interval)
 {
 	if (set == NULL || i >= set->n) {
@@ -20,6 +20,9 @@
  *
  * \brief I/O multiplexing with context and timeouts for each fd.
  *
+ * Events are waited for using epoll() where available, poll() otherwise.
+ * Each set entry keeps its pollfd structure up to date in both cases.
+ *
  * \addtogroup common_lib
  * @{
  */
@@ -33,6 +36,8 @@
 
 #define FDSET_INIT_SIZE 256 /* Resize step. */
 
+#define FDSET_MAX_EVENTS 64 /* Maximum events returned by a single epoll wait. */
+
 /*! \brief Set of filedescriptors with associated context and timeouts. */
 typedef struct fdset {
 	unsigned n;          /*!< Active fds. */
@@ -40,6 +45,10 @@ typedef struct fdset {
 	void* *ctx;          /*!< Context for each fd. */
 	struct pollfd *pfd;  /*!< poll state for each fd */
 	time_t *timeout;       /*!< Timeout for each fd (seconds precision). */
+	int epfd;            /*!< Epoll descriptor, -1 if not (yet) used. */
+	unsigned *ready;     /*!< Indexes of fds with pending events. */
+	unsigned nready;     /*!< Number of fds with pending events. */
+	unsigned next;       /*!< Next pending event to be processed. */
 } fdset_t;
 
 /*! \brief Mark-and-sweep state. */
@@ -88,6 +97,45 @@ int fdset_add(fdset_t *set, int fd, unsigned events, void *ctx);
  */
 int fdset_remove(fdset_t *set, unsigned i);
 
+/*!
+ * \brief Change watched events of the file descriptor.
+ *
+ * \param set Target set.
+ * \param i Index of the file descriptor.
+ * \param events New mask of watched events.
+ *
+ * \retval 0 if successful.
+ * \retval <0 on errors.
+ */
+int fdset_set_events(fdset_t *set, unsigned i, unsigned events);
+
+/*!
+ * \brief Wait for events on the watched file descriptors.
+ *
+ * Descriptors with pending events are then retrieved with fdset_next().
+ *
+ * \param set Target set.
+ * \param timeout Timeout in milliseconds, -1 for infinite.
+ *
+ * \retval number of descriptors with pending events.
+ * \retval <0 on errors.
+ */
+int fdset_wait(fdset_t *set, int timeout);
+
+/*!
+ * \brief Get the next descriptor with pending events.
+ *
+ * Removing a descriptor from the set during the processing of events is safe,
+ * events pending on descriptors moved to another index follow them.
+ *
+ * \param set Target set.
+ * \param events Output pending events (POLLIN, POLLOUT, POLLERR, POLLHUP).
+ *
+ * \retval index of the descriptor.
+ * \retval -1 if no more events are pending.
+ */
+int fdset_next(fdset_t *set, unsigned *events);
+
 /*!
  * \brief Set file descriptor watchdog interval.
  *
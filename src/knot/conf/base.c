@@ -21,6 +21,7 @@
 #include <urcu.h>
 
 #include "knot/conf/base.h"
+#include "knot/conf/conf.h"
 #include "knot/conf/confdb.h"
 #include "knot/conf/tools.h"
 #include "knot/common/log.h"
@@ -228,6 +229,46 @@ int conf_clone(
 	return KNOT_EOK;
 }
 
+static void init_cache(
+	conf_t *conf)
+{
+	conf_val_t val = conf_get(conf, C_SRV, C_MAX_UDP_PAYLOAD);
+	conf->cache.srv_max_udp_payload = conf_int(&val);
+
+	val = conf_get(conf, C_SRV, C_RATE_LIMIT_SLIP);
+	conf->cache.srv_rate_limit_slip = conf_int(&val);
+
+	val = conf_get(conf, C_SRV, C_TCP_HSHAKE_TIMEOUT);
+	conf->cache.srv_tcp_hshake_timeout = conf_int(&val);
+
+	val = conf_get(conf, C_SRV, C_TCP_IDLE_TIMEOUT);
+	conf->cache.srv_tcp_idle_timeout = conf_int(&val);
+
+	val = conf_get(conf, C_SRV, C_TCP_REPLY_TIMEOUT);
+	conf->cache.srv_tcp_reply_timeout = conf_int(&val);
+
+	val = conf_get(conf, C_SRV, C_MAX_TCP_CLIENTS);
+	conf->cache.srv_max_tcp_clients = conf_int(&val);
+
+	conf->cache.srv_tcp_threads = conf_tcp_threads(conf);
+
+	val = conf_get(conf, C_SRV, C_ANSWER_CACHE);
+	conf->cache.srv_answer_cache = conf_int(&val);
+
+	// Data are valid until the read transaction is closed.
+	val = conf_get(conf, C_SRV, C_NSID);
+	if (val.code != KNOT_EOK) {
+		if (conf->hostname != NULL) {
+			conf->cache.srv_nsid_data = (uint8_t *)conf->hostname;
+			conf->cache.srv_nsid_len = strlen(conf->hostname);
+		}
+	} else {
+		conf_data(&val);
+		conf->cache.srv_nsid_data = val.data;
+		conf->cache.srv_nsid_len = val.len;
+	}
+}
+
 int conf_post_open(
 	conf_t *conf)
 {
@@ -237,6 +278,8 @@ int conf_post_open(
 
 	conf->hostname = sockaddr_hostname();
 
+	init_cache(conf);
+
 	int ret = conf_activate_modules(conf, NULL, &conf->query_modules,
 	                                &conf->query_plan);
 	if (ret != KNOT_EOK) {
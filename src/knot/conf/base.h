@@ -58,6 +58,21 @@ typedef struct {
 	list_t query_modules;
 	/*! Default query modules plan. */
 	struct query_plan *query_plan;
+
+	/*! Cached server items, valid for the configuration lifetime. */
+	struct {
+		uint16_t srv_max_udp_payload;
+		int srv_rate_limit_slip;
+		int srv_tcp_hshake_timeout;
+		int srv_tcp_idle_timeout;
+		int srv_tcp_reply_timeout;
+		size_t srv_max_tcp_clients;
+		size_t srv_tcp_threads;
+		size_t srv_answer_cache;
+		/*! NSID value (hostname if not set, no NSID if empty). */
+		const uint8_t *srv_nsid_data;
+		size_t srv_nsid_len;
+	} cache;
 } conf_t;
 
 struct conf_previous;
@@ -98,6 +113,9 @@ int conf_clone(
 /*!
  * Processes some additional operations and checks after configuration loading.
  *
+ * Frequently used items are cached in the configuration context so that
+ * the query processing doesn't have to access the database.
+ *
  * \param[in] conf Configuration.
  *
  * \return Error code, KNOT_EOK if success.
@@ -712,18 +712,6 @@ char* conf_zonefile_txn(
 	return get_filename(conf, txn, zone, file);
 }
 
-char* conf_journalfile_txn(
-	conf_t *conf,
-	namedb_txn_t *txn,
-	const knot_dname_t *zone)
-{
-	if (zone == NULL) {
-		return NULL;
-	}
-
-	return get_filename(conf, txn, zone, "%s.db");
-}
-
 size_t conf_udp_threads_txn(
 	conf_t *conf,
 	namedb_txn_t *txn)
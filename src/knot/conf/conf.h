@@ -275,18 +275,6 @@ static inline char* conf_zonefile(
 	return conf_zonefile_txn(conf, &conf->read_txn, zone);
 }
 
-char* conf_journalfile_txn(
-	conf_t *conf,
-	namedb_txn_t *txn,
-	const knot_dname_t *zone
-);
-static inline char* conf_journalfile(
-	conf_t *conf,
-	const knot_dname_t *zone)
-{
-	return conf_journalfile_txn(conf, &conf->read_txn, zone);
-}
-
 size_t conf_udp_threads_txn(
 	conf_t *conf,
 	namedb_txn_t *txn
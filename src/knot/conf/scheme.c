@@ -23,6 +23,7 @@
 #include "knot/conf/tools.h"
 #include "knot/common/log.h"
 #include "knot/ctl/remote.h"
+#include "knot/server/journal.h"
 #include "knot/server/rrl.h"
 #include "knot/updates/acl.h"
 #include "libknot/rrtype/opt.h"
@@ -30,6 +31,7 @@
 
 #include "knot/modules/synth_record.h"
 #include "knot/modules/dnsproxy.h"
+#include "knot/modules/stats.h"
 #ifdef HAVE_ROSEDB
 #include "knot/modules/rosedb.h"
 #endif
@@ -55,6 +57,13 @@ static const lookup_table_t acl_actions[] = {
 	{ 0, NULL }
 };
 
+static const lookup_table_t cpu_affinities[] = {
+	{ CPU_AFFINITY_NONE, "none" },
+	{ CPU_AFFINITY_AUTO, "auto" },
+	{ CPU_AFFINITY_LIST, "list" },
+	{ 0, NULL }
+};
+
 static const lookup_table_t serial_policies[] = {
 	{ SERIAL_POLICY_INCREMENT, "increment" },
 	{ SERIAL_POLICY_UNIXTIME,  "unixtime" },
@@ -80,8 +89,11 @@ static const yp_item_t desc_server[] = {
 	{ C_USER,                YP_TSTR,  YP_VNONE },
 	{ C_PIDFILE,             YP_TSTR,  YP_VSTR = { "knot.pid" } },
 	{ C_UDP_WORKERS,         YP_TINT,  YP_VINT = { 1, 255, YP_NIL } },
+	{ C_UDP_REUSEPORT,       YP_TBOOL, YP_VNONE },
 	{ C_TCP_WORKERS,         YP_TINT,  YP_VINT = { 1, 255, YP_NIL } },
 	{ C_BG_WORKERS,          YP_TINT,  YP_VINT = { 1, 255, YP_NIL } },
+	{ C_CPU_AFFINITY,        YP_TOPT,  YP_VOPT = { cpu_affinities, CPU_AFFINITY_AUTO } },
+	{ C_CPU_LIST,            YP_TINT,  YP_VINT = { 0, 1023, YP_NIL }, YP_FMULTI },
 	{ C_ASYNC_START,         YP_TBOOL, YP_VNONE },
 	{ C_TCP_HSHAKE_TIMEOUT,  YP_TINT,  YP_VINT = { 0, INT32_MAX, 5, YP_STIME } },
 	{ C_TCP_REPLY_TIMEOUT,   YP_TINT,  YP_VINT = { 0, INT32_MAX, 10, YP_STIME } },
@@ -90,9 +102,13 @@ static const yp_item_t desc_server[] = {
 	{ C_MAX_UDP_PAYLOAD,     YP_TINT,  YP_VINT = { KNOT_EDNS_MIN_UDP_PAYLOAD,
 	                                               KNOT_EDNS_MAX_UDP_PAYLOAD,
 	                                               4096, YP_SSIZE } },
+	{ C_ANSWER_CACHE,        YP_TINT,  YP_VINT = { 0, 1048576, 0 } },
 	{ C_RATE_LIMIT,          YP_TINT,  YP_VINT = { 0, INT32_MAX, 0 } },
 	{ C_RATE_LIMIT_SLIP,     YP_TINT,  YP_VINT = { 1, RRL_SLIP_MAX, 1 } },
 	{ C_RATE_LIMIT_TBL_SIZE, YP_TINT,  YP_VINT = { 1, INT32_MAX, 393241 } },
+	{ C_MAX_JOURNAL_DB_SIZE, YP_TINT,  YP_VINT = { JOURNAL_DB_MIN_SIZE, INT64_MAX,
+	                                               JOURNAL_DB_SIZE, YP_SSIZE } },
+	{ C_JOURNAL_COMMIT_DELAY, YP_TINT, YP_VINT = { 0, 1000, 0 } },
 	{ C_LISTEN,              YP_TADDR, YP_VADDR = { 53 }, YP_FMULTI },
 	{ C_COMMENT,             YP_TSTR,  YP_VNONE },
 	{ NULL }
@@ -137,15 +153,21 @@ static const yp_item_t desc_remote[] = {
 	{ C_STORAGE,          YP_TSTR,  YP_VSTR = { STORAGE_DIR } }, \
 	{ C_MASTER,           YP_TREF,  YP_VREF = { C_RMT }, YP_FMULTI, { check_ref } }, \
 	{ C_DDNS_MASTER,      YP_TREF,  YP_VREF = { C_RMT }, YP_FNONE, { check_ref } }, \
+	{ C_DDNS_DELAY,       YP_TINT,  YP_VINT = { 0, INT32_MAX, 0, YP_STIME } }, \
+	{ C_DDNS_BATCH_SIZE,  YP_TINT,  YP_VINT = { 0, INT32_MAX, 0 } }, \
 	{ C_NOTIFY,           YP_TREF,  YP_VREF = { C_RMT }, YP_FMULTI, { check_ref } }, \
 	{ C_ACL,              YP_TREF,  YP_VREF = { C_ACL }, YP_FMULTI, { check_ref } }, \
 	{ C_SEM_CHECKS,       YP_TBOOL, YP_VNONE }, \
 	{ C_DISABLE_ANY,      YP_TBOOL, YP_VNONE }, \
+	{ C_PRECOMPUTE_WIRE,  YP_TBOOL, YP_VNONE }, \
 	{ C_ZONEFILE_SYNC,    YP_TINT,  YP_VINT = { -1, INT32_MAX, 0, YP_STIME } }, \
 	{ C_IXFR_DIFF,        YP_TBOOL, YP_VNONE }, \
 	{ C_MAX_JOURNAL_SIZE, YP_TINT,  YP_VINT = { 0, INT64_MAX, INT64_MAX, YP_SSIZE } }, \
+	{ C_JOURNAL_COMPACT_AGE, YP_TINT, YP_VINT = { 0, INT32_MAX, 0, YP_STIME } }, \
+	{ C_IXFR_CONDENSED,   YP_TBOOL, YP_VNONE }, \
 	{ C_DNSSEC_SIGNING,   YP_TBOOL, YP_VNONE }, \
 	{ C_KASP_DB,          YP_TSTR,  YP_VSTR = { "keys" } }, \
+	{ C_SIGNING_THREADS,  YP_TINT,  YP_VINT = { 1, 256, 1 } }, \
 	{ C_SERIAL_POLICY,    YP_TOPT,  YP_VOPT = { serial_policies, SERIAL_POLICY_INCREMENT } }, \
 	{ C_MODULE,           YP_TDATA, YP_VDATA = { 0, NULL, mod_id_to_bin, mod_id_to_txt }, \
 	                                YP_FMULTI, { check_modref } }, \
@@ -184,6 +206,7 @@ const yp_item_t conf_scheme[] = {
 	{ C_MOD_SYNTH_RECORD, YP_TGRP, YP_VGRP = { scheme_mod_synth_record }, YP_FMULTI,
 	                                         { check_mod_synth_record } },
 	{ C_MOD_DNSPROXY,     YP_TGRP, YP_VGRP = { scheme_mod_dnsproxy }, YP_FMULTI },
+	{ C_MOD_STATS,        YP_TGRP, YP_VGRP = { scheme_mod_stats }, YP_FMULTI },
 #if HAVE_ROSEDB
 	{ C_MOD_ROSEDB,       YP_TGRP, YP_VGRP = { scheme_mod_rosedb }, YP_FMULTI },
 #endif
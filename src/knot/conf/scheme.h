@@ -31,11 +31,16 @@
 #define C_ACTION		"\x06""action"
 #define C_ADDR			"\x07""address"
 #define C_ALG			"\x09""algorithm"
+#define C_ANSWER_CACHE		"\x0C""answer-cache"
 #define C_ANY			"\x03""any"
 #define C_ASYNC_START		"\x0B""async-start"
 #define C_BG_WORKERS		"\x12""background-workers"
 #define C_COMMENT		"\x07""comment"
+#define C_CPU_AFFINITY		"\x0C""cpu-affinity"
+#define C_CPU_LIST		"\x08""cpu-list"
 #define C_CTL			"\x07""control"
+#define C_DDNS_BATCH_SIZE	"\x0F""ddns-batch-size"
+#define C_DDNS_DELAY		"\x0A""ddns-delay"
 #define C_DDNS_MASTER		"\x0B""ddns-master"
 #define C_DENY			"\x04""deny"
 #define C_DISABLE_ANY		"\x0B""disable-any"
@@ -46,11 +51,15 @@
 #define C_IDENT			"\x08""identity"
 #define C_INCL			"\x07""include"
 #define C_IXFR_DIFF		"\x15""ixfr-from-differences"
+#define C_IXFR_CONDENSED	"\x0E""ixfr-condensed"
+#define C_JOURNAL_COMMIT_DELAY	"\x14""journal-commit-delay"
+#define C_JOURNAL_COMPACT_AGE	"\x13""journal-compact-age"
 #define C_KASP_DB		"\x07""kasp-db"
 #define C_KEY			"\x03""key"
 #define C_LISTEN		"\x06""listen"
 #define C_LOG			"\x03""log"
 #define C_MASTER		"\x06""master"
+#define C_MAX_JOURNAL_DB_SIZE	"\x13""max-journal-db-size"
 #define C_MAX_JOURNAL_SIZE	"\x10""max-journal-size"
 #define C_MAX_TCP_CLIENTS	"\x0F""max-tcp-clients"
 #define C_MAX_UDP_PAYLOAD	"\x0F""max-udp-payload"
@@ -58,6 +67,7 @@
 #define C_NOTIFY		"\x06""notify"
 #define C_NSID			"\x04""nsid"
 #define C_PIDFILE		"\x07""pidfile"
+#define C_PRECOMPUTE_WIRE	"\x0F""precompute-wire"
 #define C_RATE_LIMIT		"\x0A""rate-limit"
 #define C_RATE_LIMIT_SLIP	"\x0F""rate-limit-slip"
 #define C_RATE_LIMIT_TBL_SIZE	"\x15""rate-limit-table-size"
@@ -67,6 +77,7 @@
 #define C_SEM_CHECKS		"\x0F""semantic-checks"
 #define C_SERIAL_POLICY		"\x0D""serial-policy"
 #define C_SERVER		"\x06""server"
+#define C_SIGNING_THREADS	"\x0F""signing-threads"
 #define C_SRV			"\x06""server"
 #define C_STORAGE		"\x07""storage"
 #define C_TARGET		"\x06""target"
@@ -75,6 +86,7 @@
 #define C_TCP_REPLY_TIMEOUT	"\x11""tcp-reply-timeout"
 #define C_TCP_WORKERS		"\x0B""tcp-workers"
 #define C_TPL			"\x08""template"
+#define C_UDP_REUSEPORT		"\x0D""udp-reuseport"
 #define C_UDP_WORKERS		"\x0B""udp-workers"
 #define C_USER			"\x04""user"
 #define C_VERSION		"\x07""version"
@@ -82,6 +94,12 @@
 #define C_ZONE			"\x04""zone"
 #define C_ZONEFILE_SYNC		"\x0D""zonefile-sync"
 
+enum {
+	CPU_AFFINITY_NONE = 0,
+	CPU_AFFINITY_AUTO = 1,
+	CPU_AFFINITY_LIST = 2
+};
+
 enum {
 	SERIAL_POLICY_INCREMENT = 1,
 	SERIAL_POLICY_UNIXTIME  = 2
@@ -121,16 +121,34 @@ static void rrset_memsize(zone_estim_t *est, const zs_scanner_t *scanner)
 	}
 }
 
+/*!
+ * \brief Header of the counted allocation, so that freed memory is deducted.
+ *
+ * Two pointer sized items keep the malloc alignment of the returned data.
+ */
+typedef struct {
+	size_t *count;
+	size_t len;
+} estimator_block_t;
+
 void *estimator_malloc(void *ctx, size_t len)
 {
-	size_t *count = (size_t *)ctx;
-	*count += add_overhead(len);
-	return xmalloc(len);
+	estimator_block_t *block = xmalloc(sizeof(estimator_block_t) + len);
+	block->count = (size_t *)ctx;
+	block->len = len;
+	*block->count += add_overhead(len);
+	return block + 1;
 }
 
 void estimator_free(void *p)
 {
-	free(p);
+	if (p == NULL) {
+		return;
+	}
+
+	estimator_block_t *block = (estimator_block_t *)p - 1;
+	*block->count -= add_overhead(block->len);
+	free(block);
 }
 
 static int get_htable_size(void *t, void *d)
@@ -47,6 +47,9 @@ typedef struct zone_estim {
 /*!
  * \brief Size counting malloc wrapper.
  *
+ * The counter holds the size of the memory allocated and not yet freed by
+ * the wrappers, blocks reallocated by the trie are not counted twice.
+ *
  * \param ctx Data for malloc wrapper.
  * \param len Size to allocate.
  *
@@ -58,13 +61,17 @@ void *estimator_malloc(void* ctx, size_t len);
 /*!
  * \brief Size counting free wrapper.
  *
- * \param p Data to free.
+ * \param p Data allocated by estimator_malloc() to free.
  */
 void estimator_free(void *p);
 
 /*!
  * \brief Goes through trie's ahtables and estimates their memory requirements.
  *
+ * \note The qp-trie has no ahtables, all its memory is allocated from the
+ *       trie memory context and counted by the malloc wrapper, so the result
+ *       is zero.
+ *
  * \param table Trie to traverse.
  */
 size_t estimator_trie_htable_memsize(hattrie_t *table);
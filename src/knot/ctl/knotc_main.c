@@ -82,6 +82,7 @@ static int cmd_checkconf(cmd_args_t *args);
 static int cmd_checkzone(cmd_args_t *args);
 static int cmd_memstats(cmd_args_t *args);
 static int cmd_signzone(cmd_args_t *args);
+static int cmd_stats(cmd_args_t *args);
 static int cmd_import(cmd_args_t *args);
 static int cmd_export(cmd_args_t *args);
 
@@ -93,12 +94,13 @@ knot_cmd_t knot_cmd_tbl[] = {
 	{&cmd_refresh,    "refresh",    "[<zone>...]", "Refresh slave zones. Flag '-f' forces retransfer\n"
 	                "                                (zone(s) must be specified)."},
 	{&cmd_flush,      "flush",      "[<zone>...]", "Flush journal and update zone files."},
-	{&cmd_status,     "status",     "",            "Check if server is running."},
+	{&cmd_status,     "status",     "",            "Check if server is running, show zone loading."},
 	{&cmd_zonestatus, "zonestatus", "[<zone>...]", "Show status of configured zones."},
 	{&cmd_checkconf,  "checkconf",  "",            "Check current server configuration."},
 	{&cmd_checkzone,  "checkzone",  "[<zone>...]", "Check zones."},
 	{&cmd_memstats,   "memstats",   "[<zone>...]", "Estimate memory use for zones."},
 	{&cmd_signzone,   "signzone",   "<zone>...",   "Sign zones with available DNSSEC keys."},
+	{&cmd_stats,      "stats",      "[<zone>...]", "Show query statistics of server and zones."},
 	{&cmd_import,     "import",     "<filename>",  "Import configuration database."},
 	{&cmd_export,     "export",     "<filename>",  "Export configuration database."},
 	{NULL, NULL, NULL, NULL}
@@ -568,6 +570,12 @@ static int cmd_signzone(cmd_args_t *args)
 	                  args->argc, args->argv);
 }
 
+static int cmd_stats(cmd_args_t *args)
+{
+	return cmd_remote(args->addr, args->key, "stats", KNOT_RRTYPE_NS,
+	                  args->argc, args->argv);
+}
+
 static int cmd_import(cmd_args_t *args)
 {
 	if (args->argc != 1) {
@@ -737,6 +745,7 @@ static int cmd_memstats(cmd_args_t *args)
 		/* Only size of ahtables inside trie's nodes is missing. */
 		assert(est.htable_size == 0);
 		est.htable_size = estimator_trie_htable_memsize(est.node_table);
+		size_t trie_size = malloc_size;
 
 		/* Cleanup */
 		hattrie_apply_rev(est.node_table, estimator_free_trie_node, NULL);
@@ -746,7 +755,7 @@ static int cmd_memstats(cmd_args_t *args)
 		                   est.node_size +
 		                   est.dname_size +
 		                   est.htable_size +
-		                   malloc_size) * ESTIMATE_MAGIC) / (1024.0 * 1024.0);
+		                   trie_size) * ESTIMATE_MAGIC) / (1024.0 * 1024.0);
 
 		log_zone_info(conf_dname(&id), "%zu RRs, used memory estimation is %zu MB",
 		              est.record_count, (size_t)zone_size);
@@ -26,6 +26,7 @@
 #include "knot/ctl/remote.h"
 #include "knot/dnssec/zone-sign.h"
 #include "knot/dnssec/zone-nsec.h"
+#include "knot/modules/stats.h"
 #include "knot/server/tcp-handler.h"
 #include "knot/zone/timers.h"
 #include "libknot/libknot.h"
@@ -117,6 +118,7 @@ static int remote_c_status(server_t *s, remote_cmdargs_t* a);
 static int remote_c_zonestatus(server_t *s, remote_cmdargs_t* a);
 static int remote_c_flush(server_t *s, remote_cmdargs_t* a);
 static int remote_c_signzone(server_t *s, remote_cmdargs_t* a);
+static int remote_c_stats(server_t *s, remote_cmdargs_t* a);
 
 /*! \brief Table of remote commands. */
 struct remote_cmd remote_cmd_tbl[] = {
@@ -128,6 +130,7 @@ struct remote_cmd remote_cmd_tbl[] = {
 	{ "zonestatus",&remote_c_zonestatus },
 	{ "flush",     &remote_c_flush },
 	{ "signzone",  &remote_c_signzone },
+	{ "stats",     &remote_c_stats },
 	{ NULL,        NULL }
 };
 
@@ -288,10 +291,31 @@ static int remote_c_reload(server_t *s, remote_cmdargs_t* a)
  */
 static int remote_c_status(server_t *s, remote_cmdargs_t* a)
 {
-	UNUSED(s);
-	UNUSED(a);
 	dbg_server("remote: %s\n", __func__);
-	return KNOT_EOK;
+
+	/* Report progress of zone loading. */
+	int running = 0, queued = 0;
+	size_t completed = 0;
+	worker_pool_status(s->loaders, &running, &queued, &completed);
+	size_t pending = running + queued;
+	if (pending == 0) {
+		return KNOT_EOK;
+	}
+
+	char buf[128];
+	int n = snprintf(buf, sizeof(buf), "loading zones, %zu of %zu done\n",
+	                 completed, completed + pending);
+	if (n < 0 || n >= sizeof(buf)) {
+		return KNOT_ESPACE;
+	}
+
+	int ret = cmdargs_assure_avail(a, n);
+	if (ret == KNOT_EOK) {
+		memcpy(a->response + a->response_size, buf, n);
+		a->response_size += n;
+	}
+
+	return ret;
 }
 
 static char *dnssec_info(const zone_t *zone, char *buf, size_t buf_size)
@@ -404,6 +428,93 @@ static int remote_c_zonestatus(server_t *s, remote_cmdargs_t* a)
 	return KNOT_EOK;
 }
 
+/*! \brief Maximum size of printed counters of one statistics module. */
+#define STATS_PRINT_MAX 16384
+
+/*! \brief Print counters of statistics modules from the module list. */
+static int remote_stats_modules(list_t *modules, const char *scope,
+                                remote_cmdargs_t *a)
+{
+	struct query_module *module = NULL;
+	WALK_LIST(module, *modules) {
+		if (!stats_is_module(module)) {
+			continue;
+		}
+
+		char head[512];
+		int n = snprintf(head, sizeof(head), "%s\tmod-stats/%s\n", scope,
+		                 (const char *)module->id->data);
+		if (n < 0 || n >= sizeof(head)) {
+			return KNOT_ESPACE;
+		}
+
+		int ret = cmdargs_assure_avail(a, n + STATS_PRINT_MAX);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+		memcpy(a->response + a->response_size, head, n);
+		a->response_size += n;
+
+		size_t len = STATS_PRINT_MAX;
+		ret = stats_print(module, a->response + a->response_size, &len);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+		a->response_size += len;
+	}
+
+	return KNOT_EOK;
+}
+
+/*! \brief Print counters of zone statistics modules. */
+static int remote_zone_stats(zone_t *zone, remote_cmdargs_t *a)
+{
+	if (zone->query_plan == NULL) {
+		return KNOT_EOK;
+	}
+
+	char *zone_name = knot_dname_to_str_alloc(zone->name);
+	if (zone_name == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	int ret = remote_stats_modules(&zone->query_modules, zone_name, a);
+	free(zone_name);
+
+	return ret;
+}
+
+/*!
+ * \brief Remote command 'stats' handler.
+ *
+ * QNAME: stats
+ * DATA: NONE for server and all zones
+ *       NS RRs with zones in RDATA
+ */
+static int remote_c_stats(server_t *s, remote_cmdargs_t* a)
+{
+	dbg_server("remote: %s\n", __func__);
+
+	int ret = KNOT_EOK;
+
+	rcu_read_lock();
+	if (a->argc == 0) {
+		conf_t *config = conf();
+		if (config->query_plan != NULL) {
+			ret = remote_stats_modules(&config->query_modules,
+			                           "server", a);
+		}
+		if (ret == KNOT_EOK) {
+			knot_zonedb_foreach(s->zone_db, remote_zone_stats, a);
+		}
+	} else {
+		remote_rdata_apply(s, a, remote_zone_stats);
+	}
+	rcu_read_unlock();
+
+	return ret;
+}
+
 /*!
  * \brief Remote command 'refresh' handler.
  *
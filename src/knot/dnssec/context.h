@@ -35,6 +35,8 @@ struct kdnssec_ctx {
 	uint32_t old_serial;
 	uint32_t new_serial;
 	bool rrsig_drop_existing;
+
+	unsigned sign_threads;
 };
 
 typedef struct kdnssec_ctx kdnssec_ctx_t;
@@ -163,6 +163,18 @@ static int copy_signatures(const zone_tree_t *from, zone_tree_t *to)
 	return KNOT_EOK;
 }
 
+/*!
+ * \brief Free newly created NSEC3 node.
+ */
+static void free_nsec3_node(zone_node_t *node)
+{
+	knot_rdataset_t *nsec3 = node_rdataset(node, KNOT_RRTYPE_NSEC3);
+	knot_rdataset_t *rrsig = node_rdataset(node, KNOT_RRTYPE_RRSIG);
+	knot_rdataset_clear(nsec3, NULL);
+	knot_rdataset_clear(rrsig, NULL);
+	node_free(&node, NULL);
+}
+
 /*!
  * \brief Custom NSEC3 tree free function.
  *
@@ -174,13 +186,8 @@ static void free_nsec3_tree(zone_tree_t *nodes)
 	bool sorted = false;
 	hattrie_iter_t *it = hattrie_iter_begin(nodes, sorted);
 	for (/* NOP */; !hattrie_iter_finished(it); hattrie_iter_next(it)) {
-		zone_node_t *node = (zone_node_t *)*hattrie_iter_val(it);
 		// newly allocated NSEC3 nodes
-		knot_rdataset_t *nsec3 = node_rdataset(node, KNOT_RRTYPE_NSEC3);
-		knot_rdataset_t *rrsig = node_rdataset(node, KNOT_RRTYPE_RRSIG);
-		knot_rdataset_clear(nsec3, NULL);
-		knot_rdataset_clear(rrsig, NULL);
-		node_free(&node, NULL);
+		free_nsec3_node((zone_node_t *)*hattrie_iter_val(it));
 	}
 
 	hattrie_iter_free(it);
@@ -588,6 +595,600 @@ static void reset_nodes(const zone_contents_t *zone)
 	assert(ret == KNOT_EOK);
 }
 
+/* - NSEC3 chain fix ------------------------------------------------------- */
+
+/*!
+ * \brief Normal node name affected by a change.
+ */
+typedef struct {
+	knot_dname_t *owner;       /*!< Node owner. */
+	const zone_node_t *node;   /*!< Node in the zone, NULL if deleted. */
+	unsigned empty_children;   /*!< Number of children that became empty. */
+	bool empty;                /*!< NSEC3 should not be generated for node. */
+} affected_name_t;
+
+/*!
+ * \brief Data for incremental NSEC3 chain update.
+ */
+typedef struct {
+	const zone_contents_t *zone;
+	zone_tree_t *new_nodes;    /*!< Created and modified NSEC3 nodes. */
+	zone_tree_t *removed;      /*!< Old NSEC3 nodes to be removed. */
+	zone_node_t **sorted;      /*!< New nodes in canonical order. */
+	size_t sorted_count;
+} nsec3_fix_t;
+
+/*!
+ * \brief Check if the change can be handled by NSEC3 chain fix.
+ *
+ * Changes of delegations and of the NSEC3 records or parameters themselves
+ * may affect arbitrary parts of the chain.
+ */
+static bool nsec3_fix_possible(const zone_contents_t *zone,
+                               const changeset_t *in_ch, uint32_t ttl)
+{
+	const zone_node_t *apex_nsec3 = zone->apex->nsec3_node;
+	if (apex_nsec3 == NULL || !valid_nsec3_node(apex_nsec3)) {
+		return false;
+	}
+
+	const knot_rdataset_t *rrs = node_rdataset(apex_nsec3, KNOT_RRTYPE_NSEC3);
+	if (knot_rdata_ttl(knot_rdataset_at(rrs, 0)) != ttl) {
+		return false;
+	}
+
+	changeset_iter_t itt;
+	if (changeset_iter_all(&itt, in_ch, false) != KNOT_EOK) {
+		return false;
+	}
+
+	bool possible = true;
+	knot_rrset_t rr = changeset_iter_next(&itt);
+	while (possible && !knot_rrset_empty(&rr)) {
+		switch (rr.type) {
+		case KNOT_RRTYPE_NSEC3:
+		case KNOT_RRTYPE_NSEC3PARAM:
+			possible = false;
+			break;
+		case KNOT_RRTYPE_NS:
+			possible = knot_dname_is_equal(rr.owner, zone->apex->owner);
+			break;
+		case KNOT_RRTYPE_RRSIG:
+			possible = knot_rrsig_type_covered(&rr.rrs, 0) != KNOT_RRTYPE_NSEC3;
+			break;
+		default:
+			break;
+		}
+		rr = changeset_iter_next(&itt);
+	}
+	changeset_iter_clear(&itt);
+
+	return possible;
+}
+
+/*! \brief Add name and all its parents up to the apex into the set. */
+static int add_affected_name(hattrie_t *names, const knot_dname_t *owner,
+                             const zone_contents_t *zone)
+{
+	while (knot_dname_is_sub(owner, zone->apex->owner) ||
+	       knot_dname_is_equal(owner, zone->apex->owner)) {
+		value_t *val = hattrie_get(names, (const char *)owner,
+		                           knot_dname_size(owner));
+		if (val == NULL) {
+			return KNOT_ENOMEM;
+		}
+		if (*val != NULL) {
+			// Name and its parents already present.
+			return KNOT_EOK;
+		}
+
+		affected_name_t *name = calloc(1, sizeof(affected_name_t));
+		if (name == NULL) {
+			return KNOT_ENOMEM;
+		}
+		*val = name;
+
+		name->owner = knot_dname_copy(owner, NULL);
+		if (name->owner == NULL) {
+			return KNOT_ENOMEM;
+		}
+		name->node = zone_contents_find_node(zone, owner);
+
+		if (knot_dname_is_equal(owner, zone->apex->owner)) {
+			break;
+		}
+		owner = knot_wire_next_label(owner, NULL);
+	}
+
+	return KNOT_EOK;
+}
+
+/*! \brief Free affected name (trie callback). */
+static int free_affected_name(value_t *val, void *data)
+{
+	UNUSED(data);
+	affected_name_t *name = *val;
+	if (name != NULL) {
+		knot_dname_free(&name->owner, NULL);
+		free(name);
+	}
+
+	return KNOT_EOK;
+}
+
+/*! \brief Sort affected names, the deepest first. */
+static int affected_name_cmp(const void *a, const void *b)
+{
+	const affected_name_t *na = *(const affected_name_t **)a;
+	const affected_name_t *nb = *(const affected_name_t **)b;
+	return knot_dname_labels(nb->owner, NULL) -
+	       knot_dname_labels(na->owner, NULL);
+}
+
+/*!
+ * \brief Collect normal nodes affected by the change, in bottom-up order.
+ */
+static int collect_affected_names(const zone_contents_t *zone,
+                                  const changeset_t *in_ch, hattrie_t *names,
+                                  affected_name_t ***result, size_t *count)
+{
+	changeset_iter_t itt;
+	int ret = changeset_iter_all(&itt, in_ch, false);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	knot_rrset_t rr = changeset_iter_next(&itt);
+	while (!knot_rrset_empty(&rr)) {
+		ret = add_affected_name(names, rr.owner, zone);
+		if (ret != KNOT_EOK) {
+			changeset_iter_clear(&itt);
+			return ret;
+		}
+		rr = changeset_iter_next(&itt);
+	}
+	changeset_iter_clear(&itt);
+
+	*count = hattrie_weight(names);
+	*result = malloc(*count * sizeof(affected_name_t *));
+	if (*result == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	size_t i = 0;
+	hattrie_iter_t *it = hattrie_iter_begin(names, false);
+	for (; !hattrie_iter_finished(it); hattrie_iter_next(it)) {
+		(*result)[i++] = *hattrie_iter_val(it);
+	}
+	hattrie_iter_free(it);
+	assert(i == *count);
+
+	qsort(*result, *count, sizeof(affected_name_t *), affected_name_cmp);
+
+	return KNOT_EOK;
+}
+
+/*!
+ * \brief Decide which affected nodes should have NSEC3 node.
+ *
+ * Same rules as in \a nsec3_mark_empty(), evaluated only for affected
+ * nodes. Nodes not affected by the change are expected not to be empty.
+ */
+static void mark_affected_empty(affected_name_t **names, size_t count,
+                                hattrie_t *set)
+{
+	for (size_t i = 0; i < count; ++i) {
+		affected_name_t *name = names[i];
+		const zone_node_t *node = name->node;
+		if (node == NULL) {
+			name->empty = true;
+			continue;
+		}
+
+		assert(node->children >= name->empty_children);
+		name->empty = (node->children == name->empty_children) &&
+		              knot_nsec_empty_nsec_and_rrsigs_in_node(node);
+		if (!name->empty || node->parent == NULL) {
+			continue;
+		}
+
+		const knot_dname_t *parent = node->parent->owner;
+		value_t *val = hattrie_tryget(set, (const char *)parent,
+		                              knot_dname_size(parent));
+		if (val != NULL) {
+			affected_name_t *parent_name = *val;
+			parent_name->empty_children += 1;
+		}
+	}
+}
+
+/*! \brief Create a modifiable copy of existing NSEC3 node. */
+static zone_node_t *copy_nsec3_node(const zone_node_t *from)
+{
+	zone_node_t *node = node_new(from->owner, NULL);
+	if (node == NULL) {
+		return NULL;
+	}
+
+	node_set_parent(node, from->parent);
+
+	knot_rrset_t nsec3 = node_rrset(from, KNOT_RRTYPE_NSEC3);
+	int ret = node_add_rrset(node, &nsec3, NULL);
+	if (ret != KNOT_EOK) {
+		node_free(&node, NULL);
+		return NULL;
+	}
+
+	return node;
+}
+
+/*! \brief Get NSEC3 node following given node in the old chain. */
+static zone_node_t *old_chain_next(const nsec3_fix_t *fix,
+                                   const zone_node_t *node)
+{
+	const knot_rdataset_t *rrs = node_rdataset(node, KNOT_RRTYPE_NSEC3);
+	uint8_t *hash = NULL;
+	uint8_t hash_size = 0;
+	knot_nsec3_next_hashed(rrs, 0, &hash, &hash_size);
+
+	knot_dname_t *owner = knot_nsec3_hash_to_dname(hash, hash_size,
+	                                               fix->zone->apex->owner);
+	if (owner == NULL) {
+		return NULL;
+	}
+
+	zone_node_t *next = NULL;
+	zone_tree_get(fix->zone->nsec3_nodes, owner, &next);
+	knot_dname_free(&owner, NULL);
+
+	return next;
+}
+
+/*! \brief Check if the old NSEC3 node will be removed. */
+static bool is_removed(const nsec3_fix_t *fix, const zone_node_t *node)
+{
+	zone_node_t *found = NULL;
+	zone_tree_get(fix->removed, node->owner, &found);
+	return found != NULL;
+}
+
+/*!
+ * \brief Find position of the name among sorted new nodes.
+ *
+ * \return Index of the first new node greater or equal to \a owner.
+ */
+static size_t sorted_lower_bound(const nsec3_fix_t *fix,
+                                 const knot_dname_t *owner)
+{
+	size_t lo = 0, hi = fix->sorted_count;
+	while (lo < hi) {
+		size_t mid = (lo + hi) / 2;
+		if (knot_dname_cmp(fix->sorted[mid]->owner, owner) < 0) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	return lo;
+}
+
+/*!
+ * \brief Check if \a a is closer than \a b to \a ref when going in the
+ *        given direction in the circular chain.
+ */
+static bool chain_closer(const knot_dname_t *ref, const knot_dname_t *a,
+                         const knot_dname_t *b, bool forward)
+{
+	int a_cmp = knot_dname_cmp(a, ref);
+	int b_cmp = knot_dname_cmp(b, ref);
+	if (!forward) {
+		a_cmp = -a_cmp;
+		b_cmp = -b_cmp;
+	}
+
+	// Candidates on the other side of the reference are wrapped around.
+	bool a_wrapped = (a_cmp <= 0);
+	bool b_wrapped = (b_cmp <= 0);
+	if (a_wrapped != b_wrapped) {
+		return b_wrapped;
+	}
+
+	int cmp = knot_dname_cmp(a, b);
+	return forward ? cmp < 0 : cmp > 0;
+}
+
+/*!
+ * \brief Find the closest old NSEC3 node before the name, which stays in the
+ *        chain.
+ */
+static zone_node_t *old_chain_prev(const nsec3_fix_t *fix,
+                                   const knot_dname_t *owner)
+{
+	zone_node_t *found = NULL, *prev = NULL;
+	zone_tree_get_less_or_equal(fix->zone->nsec3_nodes, owner, &found, &prev);
+	if (found != NULL) {
+		prev = found->prev;
+	}
+
+	size_t limit = zone_tree_weight(fix->zone->nsec3_nodes);
+	while (prev != NULL && is_removed(fix, prev) && limit-- > 0) {
+		prev = prev->prev;
+	}
+
+	return (prev != NULL && !is_removed(fix, prev)) ? prev : NULL;
+}
+
+/*!
+ * \brief Find the node before the name in the resulting chain.
+ */
+static const zone_node_t *chain_prev(const nsec3_fix_t *fix,
+                                     const knot_dname_t *owner)
+{
+	const zone_node_t *old_prev = old_chain_prev(fix, owner);
+
+	const zone_node_t *new_prev = NULL;
+	if (fix->sorted_count > 0) {
+		size_t pos = sorted_lower_bound(fix, owner);
+		pos = (pos == 0) ? fix->sorted_count - 1 : pos - 1;
+		new_prev = fix->sorted[pos];
+		if (knot_dname_is_equal(new_prev->owner, owner)) {
+			new_prev = NULL;
+		}
+	}
+
+	if (old_prev == NULL || (new_prev != NULL &&
+	    chain_closer(owner, new_prev->owner, old_prev->owner, false))) {
+		return new_prev;
+	}
+
+	return old_prev;
+}
+
+/*!
+ * \brief Find the node after the name in the resulting chain.
+ */
+static const zone_node_t *chain_next(const nsec3_fix_t *fix,
+                                     const zone_node_t *node)
+{
+	// Successor in the old chain
+	zone_node_t *old_node = NULL;
+	zone_tree_get(fix->zone->nsec3_nodes, node->owner, &old_node);
+	if (old_node == NULL) {
+		zone_node_t *found = NULL;
+		zone_tree_get_less_or_equal(fix->zone->nsec3_nodes, node->owner,
+		                            &found, &old_node);
+	}
+
+	const zone_node_t *old_next = old_node ? old_chain_next(fix, old_node) : NULL;
+	size_t limit = zone_tree_weight(fix->zone->nsec3_nodes);
+	while (old_next != NULL && is_removed(fix, old_next) && limit-- > 0) {
+		old_next = old_chain_next(fix, old_next);
+	}
+	if (old_next != NULL && is_removed(fix, old_next)) {
+		old_next = NULL;
+	}
+
+	// Successor among new nodes
+	size_t pos = sorted_lower_bound(fix, node->owner);
+	if (pos < fix->sorted_count &&
+	    knot_dname_is_equal(fix->sorted[pos]->owner, node->owner)) {
+		pos += 1;
+	}
+	const zone_node_t *new_next = fix->sorted[pos % fix->sorted_count];
+
+	if (old_next == NULL || chain_closer(node->owner, new_next->owner,
+	                                     old_next->owner, true)) {
+		return new_next;
+	}
+
+	return old_next;
+}
+
+/*! \brief Insert NSEC3 node for affected name into new or removed nodes. */
+static int fix_affected_name(nsec3_fix_t *fix, const affected_name_t *name,
+                             uint32_t ttl, changeset_t *changeset)
+{
+	const zone_contents_t *zone = fix->zone;
+	const zone_node_t *node = name->node;
+
+	if (node != NULL) {
+		int ret = knot_nsec_changeset_remove(node, changeset);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+		if (node_rrtype_exists(node, KNOT_RRTYPE_NSEC)) {
+			((zone_node_t *)node)->flags |= NODE_FLAGS_REMOVED_NSEC;
+		}
+	}
+
+	knot_dname_t *nsec3_owner = knot_create_nsec3_owner(name->owner,
+	                                                    zone->apex->owner,
+	                                                    &zone->nsec3_params);
+	if (nsec3_owner == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	zone_node_t *old_nsec3 = NULL;
+	zone_tree_get(zone->nsec3_nodes, nsec3_owner, &old_nsec3);
+	knot_dname_free(&nsec3_owner, NULL);
+
+	if (name->empty || (node->flags & NODE_FLAGS_NONAUTH)) {
+		if (old_nsec3 == NULL) {
+			return KNOT_EOK;
+		}
+		return zone_tree_insert(fix->removed, old_nsec3);
+	}
+
+	zone_node_t *new_nsec3 = create_nsec3_node_for_node((zone_node_t *)node,
+	                                                    zone->apex,
+	                                                    &zone->nsec3_params,
+	                                                    ttl);
+	if (new_nsec3 == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	int ret = zone_tree_insert(fix->new_nodes, new_nsec3);
+	if (ret != KNOT_EOK) {
+		free_nsec3_node(new_nsec3);
+	}
+
+	return ret;
+}
+
+/*! \brief Rebuild sorted array of new nodes. */
+static int fix_sort_new_nodes(nsec3_fix_t *fix)
+{
+	free(fix->sorted);
+	fix->sorted_count = zone_tree_weight(fix->new_nodes);
+	fix->sorted = malloc((fix->sorted_count + 1) * sizeof(zone_node_t *));
+	if (fix->sorted == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	size_t i = 0;
+	hattrie_build_index(fix->new_nodes);
+	hattrie_iter_t *it = hattrie_iter_begin(fix->new_nodes, true);
+	for (; !hattrie_iter_finished(it); hattrie_iter_next(it)) {
+		fix->sorted[i++] = *hattrie_iter_val(it);
+	}
+	hattrie_iter_free(it);
+	fix->sorted_count = i;
+
+	return KNOT_EOK;
+}
+
+/*! \brief Add node preceding given name in the chain to new nodes. */
+static int fix_add_predecessor(nsec3_fix_t *fix, const knot_dname_t *owner)
+{
+	const zone_node_t *prev = chain_prev(fix, owner);
+	if (prev == NULL) {
+		return KNOT_EOK;
+	}
+
+	zone_node_t *found = NULL;
+	zone_tree_get(fix->new_nodes, prev->owner, &found);
+	if (found != NULL) {
+		return KNOT_EOK;
+	}
+
+	zone_node_t *copy = copy_nsec3_node(prev);
+	if (copy == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	int ret = zone_tree_insert(fix->new_nodes, copy);
+	if (ret != KNOT_EOK) {
+		free_nsec3_node(copy);
+	}
+
+	return ret;
+}
+
+/*!
+ * \brief Add predecessors of created and removed NSEC3 nodes to new nodes,
+ *        their next hashed owner will change.
+ */
+static int fix_add_predecessors(nsec3_fix_t *fix)
+{
+	int ret = fix_sort_new_nodes(fix);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	// Sorted new nodes are not updated with the added predecessors.
+	size_t count = fix->sorted_count;
+	for (size_t i = 0; i < count; ++i) {
+		const zone_node_t *node = fix->sorted[i];
+		zone_node_t *old = NULL;
+		zone_tree_get(fix->zone->nsec3_nodes, node->owner, &old);
+		if (old != NULL) {
+			continue;
+		}
+
+		ret = fix_add_predecessor(fix, node->owner);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
+	if (zone_tree_is_empty(fix->removed)) {
+		return KNOT_EOK;
+	}
+
+	hattrie_iter_t *it = hattrie_iter_begin(fix->removed, false);
+	for (; !hattrie_iter_finished(it); hattrie_iter_next(it)) {
+		const zone_node_t *node = *hattrie_iter_val(it);
+		ret = fix_add_predecessor(fix, node->owner);
+		if (ret != KNOT_EOK) {
+			break;
+		}
+	}
+	hattrie_iter_free(it);
+
+	return ret;
+}
+
+/*! \brief Remove NSEC3 and its signatures of old NSEC3 node. */
+static int remove_nsec3_node_records(const zone_node_t *node,
+                                     changeset_t *changeset)
+{
+	knot_rrset_t nsec3 = node_rrset(node, KNOT_RRTYPE_NSEC3);
+	int ret = changeset_rem_rrset(changeset, &nsec3);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	knot_rrset_t rrsigs = node_rrset(node, KNOT_RRTYPE_RRSIG);
+	if (knot_rrset_empty(&rrsigs)) {
+		return KNOT_EOK;
+	}
+
+	return changeset_rem_rrset(changeset, &rrsigs);
+}
+
+/*! \brief Store differences between old and fixed NSEC3 nodes. */
+static int fix_store_changes(nsec3_fix_t *fix, changeset_t *changeset)
+{
+	for (size_t i = 0; i < fix->sorted_count; ++i) {
+		zone_node_t *node = fix->sorted[i];
+		zone_node_t *old = NULL;
+		zone_tree_get(fix->zone->nsec3_nodes, node->owner, &old);
+		if (old != NULL && are_nsec3_nodes_equal(old, node)) {
+			continue;
+		}
+
+		if (old != NULL) {
+			int ret = remove_nsec3_node_records(old, changeset);
+			if (ret != KNOT_EOK) {
+				return ret;
+			}
+		}
+
+		knot_rrset_t nsec3 = node_rrset(node, KNOT_RRTYPE_NSEC3);
+		int ret = changeset_add_rrset(changeset, &nsec3);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
+	if (zone_tree_is_empty(fix->removed)) {
+		return KNOT_EOK;
+	}
+
+	int ret = KNOT_EOK;
+	hattrie_iter_t *it = hattrie_iter_begin(fix->removed, false);
+	for (; !hattrie_iter_finished(it); hattrie_iter_next(it)) {
+		ret = remove_nsec3_node_records(*hattrie_iter_val(it), changeset);
+		if (ret != KNOT_EOK) {
+			break;
+		}
+	}
+	hattrie_iter_free(it);
+
+	return ret;
+}
+
 /* - Public API ------------------------------------------------------------- */
 
 /*!
@@ -641,3 +1242,81 @@ int knot_nsec3_create_chain(const zone_contents_t *zone, uint32_t ttl,
 
 	return result;
 }
+
+/*!
+ * \brief Update NSEC3 chain for nodes affected by the change.
+ */
+int knot_nsec3_fix_chain(const zone_contents_t *zone, const changeset_t *in_ch,
+                         uint32_t ttl, changeset_t *changeset)
+{
+	assert(zone);
+	assert(in_ch);
+	assert(changeset);
+
+	if (!nsec3_fix_possible(zone, in_ch, ttl)) {
+		return knot_nsec3_create_chain(zone, ttl, changeset);
+	}
+
+	hattrie_t *names = hattrie_create();
+	nsec3_fix_t fix = {
+		.zone = zone,
+		.new_nodes = zone_tree_create(),
+		.removed = zone_tree_create()
+	};
+	affected_name_t **affected = NULL;
+	size_t affected_count = 0;
+
+	int result = KNOT_ENOMEM;
+	if (names == NULL || fix.new_nodes == NULL || fix.removed == NULL) {
+		goto cleanup;
+	}
+
+	result = collect_affected_names(zone, in_ch, names, &affected,
+	                                &affected_count);
+	if (result != KNOT_EOK) {
+		goto cleanup;
+	}
+
+	mark_affected_empty(affected, affected_count, names);
+
+	for (size_t i = 0; i < affected_count; ++i) {
+		result = fix_affected_name(&fix, affected[i], ttl, changeset);
+		if (result != KNOT_EOK) {
+			goto cleanup;
+		}
+	}
+
+	result = fix_add_predecessors(&fix);
+	if (result != KNOT_EOK) {
+		goto cleanup;
+	}
+
+	result = fix_sort_new_nodes(&fix);
+	if (result != KNOT_EOK) {
+		goto cleanup;
+	}
+
+	for (size_t i = 0; i < fix.sorted_count; ++i) {
+		const zone_node_t *next = chain_next(&fix, fix.sorted[i]);
+		result = connect_nsec3_nodes(fix.sorted[i], (zone_node_t *)next, NULL);
+		if (result != KNOT_EOK) {
+			goto cleanup;
+		}
+	}
+
+	result = fix_store_changes(&fix, changeset);
+
+cleanup:
+	if (names != NULL) {
+		hattrie_apply_rev(names, free_affected_name, NULL);
+		hattrie_free(names);
+	}
+	free(affected);
+	free(fix.sorted);
+	if (fix.new_nodes != NULL) {
+		free_nsec3_tree(fix.new_nodes);
+	}
+	zone_tree_free(&fix.removed);
+
+	return result;
+}
@@ -41,4 +41,21 @@
 int knot_nsec3_create_chain(const zone_contents_t *zone, uint32_t ttl,
                             changeset_t *changeset);
 
+/*!
+ * \brief Updates NSEC3 chain for nodes changed by the incoming changeset.
+ *
+ * Only NSEC3 records of the changed nodes and their predecessors in the chain
+ * are recreated. Falls back to \a knot_nsec3_create_chain() if the change may
+ * affect the chain as a whole (NSEC3 parameters, delegations, TTL).
+ *
+ * \param zone       Zone with the incoming changeset applied.
+ * \param in_ch      Incoming changeset.
+ * \param ttl        TTL for new records.
+ * \param changeset  Changeset to store changes into.
+ *
+ * \return KNOT_E*
+ */
+int knot_nsec3_fix_chain(const zone_contents_t *zone, const changeset_t *in_ch,
+                         uint32_t ttl, changeset_t *changeset);
+
 /*! @} */
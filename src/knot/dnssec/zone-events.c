@@ -78,6 +78,9 @@ static int sign_init(const zone_contents_t *zone, int flags, kdnssec_ctx_t *ctx)
 
 	ctx->rrsig_drop_existing = flags & ZONE_SIGN_DROP_SIGNATURES;
 
+	val = conf_zone_get(conf(), C_SIGNING_THREADS, zone_name);
+	ctx->sign_threads = conf_int(&val);
+
 	// SOA handling
 
 	ctx->old_serial = zone_contents_serial(zone);
@@ -296,9 +299,9 @@ int knot_dnssec_sign_changeset(const zone_contents_t *zone,
 		goto done;
 	}
 
-	result = knot_zone_create_nsec_chain(zone, out_ch, &keyset, &ctx);
+	result = knot_zone_fix_nsec_chain(zone, in_ch, out_ch, &keyset, &ctx);
 	if (result != KNOT_EOK) {
-		log_zone_error(zone_name, "DNSSEC, failed to create NSEC chain (%s)",
+		log_zone_error(zone_name, "DNSSEC, failed to fix NSEC chain (%s)",
 		               knot_strerror(result));
 		goto done;
 	}
@@ -264,12 +264,15 @@ knot_dname_t *knot_nsec3_hash_to_dname(const uint8_t *hash, size_t hash_size,
 }
 
 /*!
- * \brief Create NSEC or NSEC3 chain in the zone.
+ * \brief Create or fix NSEC or NSEC3 chain in the zone.
+ *
+ * NSEC3 chain is only fixed for nodes affected by \a in_ch if it is set.
  */
-int knot_zone_create_nsec_chain(const zone_contents_t *zone,
-                                changeset_t *changeset,
-                                const zone_keyset_t *zone_keys,
-                                const kdnssec_ctx_t *dnssec_ctx)
+static int update_nsec_chain(const zone_contents_t *zone,
+                             const changeset_t *in_ch,
+                             changeset_t *changeset,
+                             const zone_keyset_t *zone_keys,
+                             const kdnssec_ctx_t *dnssec_ctx)
 {
 	if (!zone || !changeset) {
 		return KNOT_EINVAL;
@@ -283,7 +286,9 @@ int knot_zone_create_nsec_chain(const zone_contents_t *zone,
 	int result;
 	bool nsec3_enabled = knot_is_nsec3_enabled(zone);
 
-	if (nsec3_enabled) {
+	if (nsec3_enabled && in_ch != NULL) {
+		result = knot_nsec3_fix_chain(zone, in_ch, nsec_ttl, changeset);
+	} else if (nsec3_enabled) {
 		result = knot_nsec3_create_chain(zone, nsec_ttl, changeset);
 	} else {
 		result = knot_nsec_create_chain(zone, nsec_ttl, changeset);
@@ -305,3 +310,30 @@ int knot_zone_create_nsec_chain(const zone_contents_t *zone,
 	// Sign newly created records right away
 	return knot_zone_sign_nsecs_in_changeset(zone_keys, dnssec_ctx, changeset);
 }
+
+/*!
+ * \brief Create NSEC or NSEC3 chain in the zone.
+ */
+int knot_zone_create_nsec_chain(const zone_contents_t *zone,
+                                changeset_t *changeset,
+                                const zone_keyset_t *zone_keys,
+                                const kdnssec_ctx_t *dnssec_ctx)
+{
+	return update_nsec_chain(zone, NULL, changeset, zone_keys, dnssec_ctx);
+}
+
+/*!
+ * \brief Fix NSEC or NSEC3 chain after a change of the zone.
+ */
+int knot_zone_fix_nsec_chain(const zone_contents_t *zone,
+                             const changeset_t *in_ch,
+                             changeset_t *changeset,
+                             const zone_keyset_t *zone_keys,
+                             const kdnssec_ctx_t *dnssec_ctx)
+{
+	if (!in_ch) {
+		return KNOT_EINVAL;
+	}
+
+	return update_nsec_chain(zone, in_ch, changeset, zone_keys, dnssec_ctx);
+}
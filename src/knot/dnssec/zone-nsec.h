@@ -84,4 +84,24 @@ int knot_zone_create_nsec_chain(const zone_contents_t *zone,
                                 const zone_keyset_t *zone_keys,
                                 const kdnssec_ctx_t *dnssec_ctx);
 
+/*!
+ * \brief Fix NSEC or NSEC3 chain after the zone was changed.
+ *
+ * NSEC3 chain is updated only for the nodes touched by the incoming changeset
+ * when possible. NSEC chain is always recreated.
+ *
+ * \param zone       Zone with the incoming changeset applied.
+ * \param in_ch      Incoming changeset.
+ * \param changeset  Changeset into which the changes will be added.
+ * \param zone_keys  Zone keys used for NSEC(3) creation.
+ * \param policy     DNSSEC signing policy.
+ *
+ * \return Error code, KNOT_EOK if successful.
+ */
+int knot_zone_fix_nsec_chain(const zone_contents_t *zone,
+                             const changeset_t *in_ch,
+                             changeset_t *changeset,
+                             const zone_keyset_t *zone_keys,
+                             const kdnssec_ctx_t *dnssec_ctx);
+
 /*! @} */
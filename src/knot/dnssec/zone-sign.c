@@ -28,6 +28,7 @@
 #include "knot/dnssec/rrset-sign.h"
 #include "knot/dnssec/zone-keys.h"
 #include "knot/dnssec/zone-sign.h"
+#include "knot/server/dthreads.h"
 #include "knot/updates/changesets.h"
 #include "libknot/descriptor.h"
 #include "libknot/dname.h"
@@ -569,6 +570,206 @@ static int sign_node(zone_node_t **node, void *data)
 	return result;
 }
 
+/*! \brief Minimal number of nodes signed by one thread. */
+#define SIGN_NODES_PER_THREAD 1024
+
+/*!
+ * \brief Part of the zone tree signed by one thread.
+ */
+typedef struct sign_range {
+	zone_node_t **nodes;           /*!< First node in the range. */
+	size_t count;                  /*!< Number of nodes in the range. */
+	const zone_keyset_t *src_keys; /*!< Shared zone keys. */
+	zone_keyset_t zone_keys;       /*!< Keys with thread-local signing contexts. */
+	node_sign_args_t args;         /*!< Signing arguments, own changeset. */
+	changeset_t changeset;         /*!< Changes made by the thread. */
+	int result;                    /*!< Signing result. */
+} sign_range_t;
+
+/*! \brief Count nodes (callback function). */
+static int count_node(zone_node_t **node, void *data)
+{
+	UNUSED(node);
+	size_t *count = data;
+	*count += 1;
+	return KNOT_EOK;
+}
+
+/*! \brief Store node into array (callback function). */
+static int collect_node(zone_node_t **node, void *data)
+{
+	zone_node_t ***pos = data;
+	*(*pos)++ = *node;
+	return KNOT_EOK;
+}
+
+/*!
+ * \brief Create copy of zone keys with own signing contexts.
+ */
+static int zone_keys_dup(const zone_keyset_t *src, zone_keyset_t *dst)
+{
+	dst->keys = calloc(src->count, sizeof(zone_key_t));
+	if (dst->keys == NULL) {
+		return KNOT_ENOMEM;
+	}
+	dst->count = src->count;
+
+	for (size_t i = 0; i < src->count; ++i) {
+		dst->keys[i] = src->keys[i];
+		dst->keys[i].ctx = NULL;
+		int r = dnssec_sign_new(&dst->keys[i].ctx, src->keys[i].key);
+		if (r != DNSSEC_EOK) {
+			return r;
+		}
+	}
+
+	return KNOT_EOK;
+}
+
+/*! \brief Sign nodes in the range (thread runnable). */
+static int sign_range_run(dthread_t *thread)
+{
+	sign_range_t *range = thread->data;
+
+	/* Signing contexts are not thread-safe, create own ones. */
+	range->result = zone_keys_dup(range->src_keys, &range->zone_keys);
+	if (range->result != KNOT_EOK) {
+		return KNOT_EOK;
+	}
+
+	for (size_t i = 0; i < range->count; ++i) {
+		range->result = sign_node(&range->nodes[i], &range->args);
+		if (range->result != KNOT_EOK) {
+			break;
+		}
+	}
+
+	return KNOT_EOK;
+}
+
+/*!
+ * \brief Merge changes made by one signing thread.
+ */
+static int merge_range_changes(changeset_t *to, const changeset_t *from)
+{
+	changeset_iter_t itt;
+	changeset_iter_rem(&itt, from, false);
+	knot_rrset_t rrset = changeset_iter_next(&itt);
+	while (!knot_rrset_empty(&rrset)) {
+		int ret = changeset_rem_rrset(to, &rrset);
+		if (ret != KNOT_EOK) {
+			changeset_iter_clear(&itt);
+			return ret;
+		}
+		rrset = changeset_iter_next(&itt);
+	}
+	changeset_iter_clear(&itt);
+
+	changeset_iter_add(&itt, from, false);
+	rrset = changeset_iter_next(&itt);
+	while (!knot_rrset_empty(&rrset)) {
+		int ret = changeset_add_rrset(to, &rrset);
+		if (ret != KNOT_EOK) {
+			changeset_iter_clear(&itt);
+			return ret;
+		}
+		rrset = changeset_iter_next(&itt);
+	}
+	changeset_iter_clear(&itt);
+
+	return KNOT_EOK;
+}
+
+/*!
+ * \brief Update RRSIGs in a given zone tree using multiple threads.
+ *
+ * The nodes are split into continuous ranges, each thread creates its own
+ * signing contexts and signs one range into its own changeset. The changesets
+ * are merged into the resulting one when all the threads are done.
+ */
+static int zone_tree_sign_parallel(zone_tree_t *tree, size_t thread_count,
+                                   const zone_keyset_t *zone_keys,
+                                   const kdnssec_ctx_t *dnssec_ctx,
+                                   changeset_t *changeset,
+                                   uint32_t *expires_at)
+{
+	size_t node_count = 0;
+	zone_tree_apply(tree, count_node, &node_count);
+	zone_node_t **nodes = malloc(node_count * sizeof(zone_node_t *));
+	sign_range_t *ranges = calloc(thread_count, sizeof(sign_range_t));
+	if (nodes == NULL || ranges == NULL) {
+		free(nodes);
+		free(ranges);
+		return KNOT_ENOMEM;
+	}
+
+	zone_node_t **pos = nodes;
+	zone_tree_apply(tree, collect_node, &pos);
+	assert(pos == nodes + node_count);
+
+	int result = KNOT_EOK;
+	size_t offset = 0;
+	for (size_t i = 0; i < thread_count; ++i) {
+		sign_range_t *range = &ranges[i];
+		range->nodes = nodes + offset;
+		range->count = node_count / thread_count +
+		               (i < node_count % thread_count ? 1 : 0);
+		offset += range->count;
+
+		if (result == KNOT_EOK) {
+			result = changeset_init(&range->changeset, changeset->add->apex->owner);
+		}
+
+		range->src_keys = zone_keys;
+		range->args.zone_keys = &range->zone_keys;
+		range->args.dnssec_ctx = dnssec_ctx;
+		range->args.changeset = &range->changeset;
+		range->args.expires_at = dnssec_ctx->now + dnssec_ctx->policy->rrsig_lifetime;
+	}
+
+	dt_unit_t *unit = NULL;
+	if (result == KNOT_EOK) {
+		unit = dt_create(thread_count, sign_range_run, NULL, NULL);
+		if (unit == NULL) {
+			result = KNOT_ENOMEM;
+		}
+	}
+
+	if (result == KNOT_EOK) {
+		for (size_t i = 0; i < thread_count; ++i) {
+			unit->threads[i]->_adata = &ranges[i];
+		}
+
+		dt_start(unit);
+		dt_join(unit);
+		dt_stop(unit);
+		dt_join(unit);
+	}
+	dt_delete(&unit);
+
+	uint32_t expiration = UINT32_MAX;
+	for (size_t i = 0; i < thread_count; ++i) {
+		sign_range_t *range = &ranges[i];
+		if (result == KNOT_EOK) {
+			result = range->result;
+		}
+		if (result == KNOT_EOK) {
+			result = merge_range_changes(changeset, &range->changeset);
+		}
+		expiration = MIN(expiration, range->args.expires_at);
+
+		changeset_clear(&range->changeset);
+		free_zone_keys(&range->zone_keys);
+	}
+
+	*expires_at = expiration;
+
+	free(ranges);
+	free(nodes);
+
+	return result;
+}
+
 /*!
  * \brief Update RRSIGs in a given zone tree by updating changeset.
  *
@@ -590,6 +791,13 @@ static int zone_tree_sign(zone_tree_t *tree,
 	assert(dnssec_ctx);
 	assert(changeset);
 
+	size_t threads = MIN(dnssec_ctx->sign_threads,
+	                     zone_tree_weight(tree) / SIGN_NODES_PER_THREAD);
+	if (threads > 1) {
+		return zone_tree_sign_parallel(tree, threads, zone_keys,
+		                               dnssec_ctx, changeset, expires_at);
+	}
+
 	node_sign_args_t args = {
 		.zone_keys = zone_keys,
 		.dnssec_ctx = dnssec_ctx,
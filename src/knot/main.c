@@ -19,6 +19,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <getopt.h>
 #include <sys/stat.h>
 #include <urcu.h>
@@ -0,0 +1,270 @@
+/*  Copyright (C) 2015 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+
+#include "knot/common/log.h"
+#include "knot/modules/stats.h"
+#include "knot/nameserver/process_query.h"
+#include "libknot/libknot.h"
+
+/* Module configuration scheme. */
+const yp_item_t scheme_mod_stats[] = {
+	{ C_ID,      YP_TSTR, YP_VNONE },
+	{ C_COMMENT, YP_TSTR, YP_VNONE },
+	{ NULL }
+};
+
+/* Defines. */
+#define MODULE_ERR(msg, ...) log_error("module 'stats', " msg, ##__VA_ARGS__)
+
+#define STATS_CACHE_LINE	64
+#define STATS_QTYPES		256	/* Separately counted QTYPEs. */
+#define STATS_RCODES		32	/* Separately counted RCODEs. */
+
+enum stats_proto {
+	STATS_UDP4 = 0,
+	STATS_UDP6,
+	STATS_TCP4,
+	STATS_TCP6,
+	STATS_PROTOS
+};
+
+static const char *proto_names[STATS_PROTOS] = {
+	"udp4", "udp6", "tcp4", "tcp6"
+};
+
+/*! \brief Upper bounds of the response size buckets. */
+static const uint16_t size_bounds[] = {
+	127, 255, 511, 1023, 1231, 1499, 4095, UINT16_MAX
+};
+
+#define STATS_SIZES (sizeof(size_bounds) / sizeof(size_bounds[0]))
+
+/*!
+ * \brief Counters of a single thread.
+ *
+ * Only the owning thread writes the counters, so plain increments are used.
+ * The structure is aligned to the cache line to prevent false sharing.
+ */
+typedef struct {
+	uint64_t queries;
+	uint64_t edns;
+	uint64_t dnssec_ok;
+	uint64_t proto[STATS_PROTOS];
+	uint64_t qtype[STATS_QTYPES + 1];   /*!< Last item for other types. */
+	uint64_t rcode[STATS_RCODES + 1];   /*!< Last item for other codes. */
+	uint64_t resp_size[STATS_SIZES];
+} __attribute__((aligned(STATS_CACHE_LINE))) stats_counters_t;
+
+struct stats {
+	size_t threads;
+	stats_counters_t *counters;
+};
+
+static int stats_count(int state, knot_pkt_t *pkt, struct query_data *qdata, void *ctx)
+{
+	if (pkt == NULL || qdata == NULL || ctx == NULL) {
+		return KNOT_STATE_FAIL;
+	}
+
+	struct stats *stats = ctx;
+	stats_counters_t *c = &stats->counters[qdata->param->thread_id % stats->threads];
+
+	c->queries += 1;
+
+	bool ipv6 = qdata->param->remote->ss_family == AF_INET6;
+	if (qdata->param->proc_flags & NS_QUERY_LIMIT_SIZE) {
+		c->proto[ipv6 ? STATS_UDP6 : STATS_UDP4] += 1;
+	} else {
+		c->proto[ipv6 ? STATS_TCP6 : STATS_TCP4] += 1;
+	}
+
+	const knot_pkt_t *query = qdata->query;
+	if (knot_pkt_has_edns(query)) {
+		c->edns += 1;
+		if (knot_pkt_has_dnssec(query)) {
+			c->dnssec_ok += 1;
+		}
+	}
+
+	uint16_t qtype = knot_pkt_qtype(query);
+	c->qtype[qtype < STATS_QTYPES ? qtype : STATS_QTYPES] += 1;
+
+	uint16_t rcode = qdata->rcode;
+	c->rcode[rcode < STATS_RCODES ? rcode : STATS_RCODES] += 1;
+
+	unsigned bucket = 0;
+	while (pkt->size > size_bounds[bucket]) {
+		bucket += 1;
+	}
+	c->resp_size[bucket] += 1;
+
+	return state;
+}
+
+/*! \brief Sum counters of all threads. */
+static void stats_sum(const struct stats *stats, stats_counters_t *sum)
+{
+	memset(sum, 0, sizeof(*sum));
+
+	/* The counters structure consists of 64-bit items only. */
+	uint64_t *dst = (uint64_t *)sum;
+	const size_t count = sizeof(stats_counters_t) / sizeof(uint64_t);
+	for (size_t i = 0; i < stats->threads; ++i) {
+		const uint64_t *src = (const uint64_t *)&stats->counters[i];
+		for (size_t j = 0; j < count; ++j) {
+			dst[j] += src[j];
+		}
+	}
+}
+
+/*! \brief Append formatted text to the output buffer. */
+static int print(char *buf, size_t max, size_t *len, const char *fmt, ...)
+{
+	va_list args;
+	va_start(args, fmt);
+	int n = vsnprintf(buf + *len, max - *len, fmt, args);
+	va_end(args);
+
+	if (n < 0 || n >= max - *len) {
+		return KNOT_ESPACE;
+	}
+	*len += n;
+
+	return KNOT_EOK;
+}
+
+int stats_print(const struct query_module *module, char *buf, size_t *len)
+{
+	if (module == NULL || buf == NULL || len == NULL || !stats_is_module(module)) {
+		return KNOT_EINVAL;
+	}
+
+	stats_counters_t sum;
+	stats_sum(module->ctx, &sum);
+
+	size_t max = *len;
+	*len = 0;
+
+	int ret = print(buf, max, len, "\tqueries=%"PRIu64" | edns=%"PRIu64
+	                " | dnssec-ok=%"PRIu64, sum.queries, sum.edns,
+	                sum.dnssec_ok);
+	for (unsigned i = 0; i < STATS_PROTOS && ret == KNOT_EOK; ++i) {
+		ret = print(buf, max, len, " | %s=%"PRIu64, proto_names[i],
+		            sum.proto[i]);
+	}
+
+	/* Query types. */
+	if (ret == KNOT_EOK) {
+		ret = print(buf, max, len, "\n\tqtype:");
+	}
+	for (unsigned i = 0; i <= STATS_QTYPES && ret == KNOT_EOK; ++i) {
+		if (sum.qtype[i] == 0) {
+			continue;
+		}
+		char type[32] = "other";
+		if (i < STATS_QTYPES) {
+			knot_rrtype_to_string(i, type, sizeof(type));
+		}
+		ret = print(buf, max, len, " %s=%"PRIu64, type, sum.qtype[i]);
+	}
+
+	/* Response codes. */
+	if (ret == KNOT_EOK) {
+		ret = print(buf, max, len, "\n\trcode:");
+	}
+	for (unsigned i = 0; i <= STATS_RCODES && ret == KNOT_EOK; ++i) {
+		if (sum.rcode[i] == 0) {
+			continue;
+		}
+		lookup_table_t *name = lookup_by_id(knot_rcode_names, i);
+		if (i == STATS_RCODES) {
+			ret = print(buf, max, len, " other=%"PRIu64, sum.rcode[i]);
+		} else if (name != NULL) {
+			ret = print(buf, max, len, " %s=%"PRIu64, name->name,
+			            sum.rcode[i]);
+		} else {
+			ret = print(buf, max, len, " RCODE%u=%"PRIu64, i,
+			            sum.rcode[i]);
+		}
+	}
+
+	/* Response sizes. */
+	if (ret == KNOT_EOK) {
+		ret = print(buf, max, len, "\n\tresponse-size:");
+	}
+	for (unsigned i = 0; i < STATS_SIZES && ret == KNOT_EOK; ++i) {
+		unsigned low = (i == 0) ? 0 : size_bounds[i - 1] + 1;
+		ret = print(buf, max, len, " %u-%u=%"PRIu64, low, size_bounds[i],
+		            sum.resp_size[i]);
+	}
+
+	if (ret == KNOT_EOK) {
+		ret = print(buf, max, len, "\n");
+	}
+
+	return ret;
+}
+
+bool stats_is_module(const struct query_module *module)
+{
+	return module != NULL && module->load == stats_load;
+}
+
+int stats_load(struct query_plan *plan, struct query_module *self)
+{
+	if (plan == NULL || self == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	struct stats *stats = mm_alloc(self->mm, sizeof(struct stats));
+	if (stats == NULL) {
+		MODULE_ERR("not enough memory");
+		return KNOT_ENOMEM;
+	}
+
+	/* One set of counters for each UDP and TCP thread. */
+	stats->threads = conf_udp_threads(self->config) +
+	                 conf_tcp_threads(self->config);
+	if (posix_memalign((void **)&stats->counters, STATS_CACHE_LINE,
+	                   stats->threads * sizeof(stats_counters_t)) != 0) {
+		MODULE_ERR("not enough memory");
+		mm_free(self->mm, stats);
+		return KNOT_ENOMEM;
+	}
+	memset(stats->counters, 0, stats->threads * sizeof(stats_counters_t));
+
+	self->ctx = stats;
+
+	return query_plan_step(plan, QPLAN_END, stats_count, self->ctx);
+}
+
+int stats_unload(struct query_module *self)
+{
+	if (self == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	struct stats *stats = self->ctx;
+	free(stats->counters);
+	mm_free(self->mm, stats);
+	return KNOT_EOK;
+}
@@ -0,0 +1,60 @@
+/*!
+ * \file stats.h
+ *
+ * \brief Query statistics module
+ *
+ * Counts processed queries by protocol, query type, response code, EDNS and
+ * DO bit presence and response size. Each server thread updates its own
+ * cache-line aligned counters, the counters are aggregated only when read.
+ *
+ * Accepted configurations:
+ *  * "mod-stats/<id>" in the default template, server-wide counters
+ *  * "mod-stats/<id>" in a zone, counters of the zone queries
+ *
+ * \addtogroup query_processing
+ * @{
+ */
+/*  Copyright (C) 2015 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "knot/nameserver/query_module.h"
+
+/*! \brief Module scheme. */
+#define C_MOD_STATS "\x09""mod-stats"
+extern const yp_item_t scheme_mod_stats[];
+
+/*! \brief Module interface. */
+int stats_load(struct query_plan *plan, struct query_module *self);
+int stats_unload(struct query_module *self);
+
+/*! \brief Check if the query module is a statistics module instance. */
+bool stats_is_module(const struct query_module *module);
+
+/*!
+ * \brief Print aggregated counters of the module instance.
+ *
+ * \param module  Statistics module instance.
+ * \param buf     Output buffer.
+ * \param len     Output buffer size on input, written length on output.
+ *
+ * \retval KNOT_EOK if success.
+ * \retval KNOT_ESPACE if the buffer is too small.
+ */
+int stats_print(const struct query_module *module, char *buf, size_t *len);
+
+/*! @} */
@@ -0,0 +1,178 @@
+/*  Copyright (C) 2015 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "knot/nameserver/answer_cache.h"
+#include "libknot/internal/trie/murmurhash3.h"
+
+/*! \brief Cached answer. */
+typedef struct {
+	uint64_t zone_gen;
+	uint32_t hash;
+	uint16_t qtype;
+	uint16_t max_size;
+	bool edns;
+	uint8_t edns_version;
+	uint16_t edns_flags;
+	uint8_t qname_size;
+	uint16_t size;                /*!< Answer size, 0 for empty entry. */
+	uint16_t capacity;            /*!< Allocated data size. */
+	uint8_t *data;                /*!< QNAME followed by the answer. */
+} answer_entry_t;
+
+struct answer_cache {
+	size_t mask;
+	answer_entry_t *entries;
+};
+
+static uint32_t key_hash(const answer_cache_key_t *key, size_t qname_size)
+{
+	uint32_t h = hash((const char *)key->qname, qname_size);
+	h ^= (uint32_t)key->qtype << 16 | key->max_size;
+	h ^= (uint32_t)(key->zone_gen * 0x9E3779B1);
+	h ^= (uint32_t)key->edns_flags << 16 | key->edns_version << 8 | key->edns;
+
+	return h;
+}
+
+static bool key_match(const answer_entry_t *entry, const answer_cache_key_t *key,
+                      uint32_t h, size_t qname_size)
+{
+	return entry->size > 0 && entry->hash == h &&
+	       entry->zone_gen == key->zone_gen && entry->qtype == key->qtype &&
+	       entry->max_size == key->max_size && entry->edns == key->edns &&
+	       entry->edns_version == key->edns_version &&
+	       entry->edns_flags == key->edns_flags &&
+	       entry->qname_size == qname_size &&
+	       memcmp(entry->data, key->qname, qname_size) == 0;
+}
+
+static size_t round_size(size_t size)
+{
+	size_t count = 1;
+	while (count < size) {
+		count <<= 1;
+	}
+
+	return count;
+}
+
+answer_cache_t *answer_cache_new(size_t size)
+{
+	if (size == 0) {
+		return NULL;
+	}
+
+	size_t count = round_size(size);
+
+	answer_cache_t *cache = malloc(sizeof(answer_cache_t));
+	if (cache == NULL) {
+		return NULL;
+	}
+
+	cache->mask = count - 1;
+	cache->entries = calloc(count, sizeof(answer_entry_t));
+	if (cache->entries == NULL) {
+		free(cache);
+		return NULL;
+	}
+
+	return cache;
+}
+
+void answer_cache_free(answer_cache_t *cache)
+{
+	if (cache == NULL) {
+		return;
+	}
+
+	for (size_t i = 0; i <= cache->mask; ++i) {
+		free(cache->entries[i].data);
+	}
+	free(cache->entries);
+	free(cache);
+}
+
+size_t answer_cache_size(const answer_cache_t *cache)
+{
+	return (cache == NULL) ? 0 : cache->mask + 1;
+}
+
+answer_cache_t *answer_cache_resize(answer_cache_t *cache, size_t size)
+{
+	if (size > 0 && answer_cache_size(cache) == round_size(size)) {
+		return cache;
+	}
+
+	answer_cache_free(cache);
+	return answer_cache_new(size);
+}
+
+const uint8_t *answer_cache_get(answer_cache_t *cache,
+                                const answer_cache_key_t *key, size_t *size)
+{
+	if (cache == NULL || key == NULL || key->qname == NULL || size == NULL) {
+		return NULL;
+	}
+
+	size_t qname_size = knot_dname_size(key->qname);
+	uint32_t h = key_hash(key, qname_size);
+	const answer_entry_t *entry = &cache->entries[h & cache->mask];
+	if (!key_match(entry, key, h, qname_size)) {
+		return NULL;
+	}
+
+	*size = entry->size;
+	return entry->data + entry->qname_size;
+}
+
+void answer_cache_put(answer_cache_t *cache, const answer_cache_key_t *key,
+                      const uint8_t *wire, size_t size)
+{
+	if (cache == NULL || key == NULL || key->qname == NULL || wire == NULL ||
+	    size == 0 || size > ANSWER_CACHE_MAX_WIRE) {
+		return;
+	}
+
+	size_t qname_size = knot_dname_size(key->qname);
+	uint32_t h = key_hash(key, qname_size);
+	answer_entry_t *entry = &cache->entries[h & cache->mask];
+
+	/* Reuse the entry buffer if large enough. */
+	if (entry->capacity < qname_size + size) {
+		uint8_t *data = realloc(entry->data, qname_size + size);
+		if (data == NULL) {
+			return;
+		}
+		entry->data = data;
+		entry->capacity = qname_size + size;
+	}
+
+	memcpy(entry->data, key->qname, qname_size);
+	memcpy(entry->data + qname_size, wire, size);
+
+	entry->zone_gen = key->zone_gen;
+	entry->hash = h;
+	entry->qtype = key->qtype;
+	entry->max_size = key->max_size;
+	entry->edns = key->edns;
+	entry->edns_version = key->edns_version;
+	entry->edns_flags = key->edns_flags;
+	entry->qname_size = qname_size;
+	entry->size = size;
+}
@@ -0,0 +1,105 @@
+/*!
+ * \file answer_cache.h
+ *
+ * \brief Wire format cache of complete positive answers.
+ *
+ * The cache is meant to be owned by a single server thread, so it doesn't
+ * need any locking. Entries are keyed by the zone generation, so that any
+ * change of the zone contents or zone configuration makes them unreachable.
+ *
+ * \addtogroup query_processing
+ * @{
+ */
+/*  Copyright (C) 2015 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "libknot/dname.h"
+
+/*! \brief Largest response stored in the cache. */
+#define ANSWER_CACHE_MAX_WIRE 4096
+
+/*! \brief Answer cache lookup key. */
+typedef struct {
+	uint64_t zone_gen;           /*!< Generation of the answering zone. */
+	const knot_dname_t *qname;   /*!< Lowercase QNAME. */
+	uint16_t qtype;
+	uint16_t max_size;           /*!< Maximal response size. */
+	bool edns;                   /*!< Query with EDNS. */
+	uint8_t edns_version;        /*!< EDNS version. */
+	uint16_t edns_flags;         /*!< EDNS flags including the DO bit. */
+} answer_cache_key_t;
+
+struct answer_cache;
+typedef struct answer_cache answer_cache_t;
+
+/*!
+ * \brief Create answer cache.
+ *
+ * \param size  Number of cached answers (rounded up to the power of two).
+ *
+ * \return New cache or NULL.
+ */
+answer_cache_t *answer_cache_new(size_t size);
+
+/*! \brief Free answer cache. */
+void answer_cache_free(answer_cache_t *cache);
+
+/*! \brief Get configured number of cached answers. */
+size_t answer_cache_size(const answer_cache_t *cache);
+
+/*!
+ * \brief Resize answer cache.
+ *
+ * The original cache is kept if its size already matches, otherwise it's
+ * freed and a new empty cache is created.
+ *
+ * \param cache  Current cache (may be NULL).
+ * \param size   Requested number of cached answers, 0 disables the cache.
+ *
+ * \return Cache of the requested size or NULL.
+ */
+answer_cache_t *answer_cache_resize(answer_cache_t *cache, size_t size);
+
+/*!
+ * \brief Find cached answer.
+ *
+ * \param cache  Answer cache.
+ * \param key    Lookup key.
+ * \param size   Output answer size.
+ *
+ * \return Answer wire or NULL if not found.
+ */
+const uint8_t *answer_cache_get(answer_cache_t *cache,
+                                const answer_cache_key_t *key, size_t *size);
+
+/*!
+ * \brief Store answer, replacing the entry with colliding key.
+ *
+ * \param cache  Answer cache.
+ * \param key    Answer key.
+ * \param wire   Answer wire.
+ * \param size   Answer size.
+ */
+void answer_cache_put(answer_cache_t *cache, const answer_cache_key_t *key,
+                      const uint8_t *wire, size_t size);
+
+/*! @} */
@@ -283,7 +283,7 @@ static int axfr_answer_init(struct answer_data *data)
 
 	/* Create new zone contents. */
 	zone_t *zone = data->param->zone;
-	zone_contents_t *new_contents = zone_contents_new(zone->name);
+	zone_contents_t *new_contents = zone_contents_new_arena(zone->name);
 	if (new_contents == NULL) {
 		return KNOT_ENOMEM;
 	}
@@ -357,21 +357,34 @@ static int axfr_answer_packet(knot_pkt_t *pkt, struct xfr_proc *proc)
 	/* Init zone creator. */
 	zcreator_t zc = {.z = proc->contents, .master = false, .ret = KNOT_EOK };
 
+	int state = KNOT_STATE_CONSUME;
 	const knot_pktsection_t *answer = knot_pkt_section(pkt, KNOT_ANSWER);
 	const knot_rrset_t *answer_rr = knot_pkt_rr(answer, 0);
 	for (uint16_t i = 0; i < answer->count; ++i) {
-		if (answer_rr[i].type == KNOT_RRTYPE_SOA &&
-		    node_rrtype_exists(zc.z->apex, KNOT_RRTYPE_SOA)) {
-			return KNOT_STATE_DONE;
-		} else {
-			int ret = zcreator_step(&zc, &answer_rr[i]);
-			if (ret != KNOT_EOK) {
+		if (answer_rr[i].type == KNOT_RRTYPE_SOA) {
+			/* Transfer ends with the second SOA, add the RRs kept aside first. */
+			if (zcreator_flush(&zc) != KNOT_EOK) {
 				return KNOT_STATE_FAIL;
 			}
+			if (node_rrtype_exists(zc.z->apex, KNOT_RRTYPE_SOA)) {
+				state = KNOT_STATE_DONE;
+				break;
+			}
 		}
+
+		int ret = zcreator_add(&zc, &answer_rr[i]);
+		if (ret != KNOT_EOK) {
+			knot_rrset_clear(&zc.pending, NULL);
+			return KNOT_STATE_FAIL;
+		}
+	}
+
+	/* RRSets split between messages are merged in the zone. */
+	if (zcreator_flush(&zc) != KNOT_EOK) {
+		return KNOT_STATE_FAIL;
 	}
 
-	return KNOT_STATE_CONSUME;
+	return state;
 }
 
 int axfr_answer_process(knot_pkt_t *pkt, struct answer_data *adata)
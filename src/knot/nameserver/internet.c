@@ -188,11 +188,9 @@ static int put_answer(knot_pkt_t *pkt, uint16_t type, struct query_data *qdata)
 	int ret = KNOT_EOK;
 	switch (type) {
 	case KNOT_RRTYPE_ANY: /* Append all RRSets. */ {
-		conf_val_t val = conf_zone_get(conf(), C_DISABLE_ANY,
-		                               qdata->zone->name);
 		/* If ANY not allowed, set TC bit. */
 		if ((qdata->param->proc_flags & NS_QUERY_LIMIT_ANY) &&
-		    conf_bool(&val)) {
+		    qdata->zone->cache.disable_any) {
 			dbg_ns("%s: ANY/UDP disabled for this zone TC=1\n", __func__);
 			knot_wire_set_tc(pkt->wire);
 			return KNOT_ESPACE;
@@ -288,6 +286,10 @@ static int put_additional(knot_pkt_t *pkt, const knot_rrset_t *rr,
 	const zone_node_t *node = NULL;
 
 	/* All RRs should have additional node cached or NULL. */
+	if (rr->additional == NULL) {
+		return KNOT_EOK;
+	}
+
 	uint16_t rr_rdata_count = rr->rrs.rr_count;
 	for (uint16_t i = 0; i < rr_rdata_count; i++) {
 		hint = knot_pkt_compr_hint(info, KNOT_COMPR_HINT_RDATA + i);
@@ -165,6 +165,26 @@ static int ixfr_process_changeset(knot_pkt_t *pkt, const void *item,
 
 #undef IXFR_SAFE_PUT
 
+/*! \brief Merge the changesets into the first one. */
+static int ixfr_condense(list_t *chgsets)
+{
+	changeset_t *first = HEAD(*chgsets);
+	changeset_t *chs = NULL, *nxt = NULL;
+	WALK_LIST_DELSAFE(chs, nxt, *chgsets) {
+		if (chs == first) {
+			continue;
+		}
+		int ret = changeset_merge(first, chs);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+		rem_node(&chs->n);
+		changeset_free(chs);
+	}
+
+	return KNOT_EOK;
+}
+
 /*! \brief Loads IXFRs from journal. */
 static int ixfr_load_chsets(list_t *chgsets, const zone_t *zone,
                             const knot_rrset_t *their_soa)
@@ -180,11 +200,15 @@ static int ixfr_load_chsets(list_t *chgsets, const zone_t *zone,
 		return KNOT_EUPTODATE;
 	}
 
-	char *path = conf_journalfile(conf(), zone->name);
-	pthread_mutex_lock((pthread_mutex_t *)&zone->journal_lock);
-	ret = journal_load_changesets(path, zone, chgsets, serial_from, serial_to);
-	pthread_mutex_unlock((pthread_mutex_t *)&zone->journal_lock);
-	free(path);
+	/* Journal readers don't block each other nor the writers. */
+	ret = journal_load_changesets(zone->journal_db, zone->name, chgsets,
+	                              serial_from, serial_to);
+
+	/* Send a single difference sequence if configured. */
+	conf_val_t val = conf_zone_get(conf(), C_IXFR_CONDENSED, zone->name);
+	if (ret == KNOT_EOK && conf_bool(&val)) {
+		ret = ixfr_condense(chgsets);
+	}
 
 	if (ret != KNOT_EOK) {
 		changesets_free(chgsets);
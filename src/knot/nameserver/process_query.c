@@ -3,6 +3,7 @@
 
 #include "dnssec/tsig.h"
 #include "knot/nameserver/process_query.h"
+#include "knot/nameserver/answer_cache.h"
 #include "knot/nameserver/query_module.h"
 #include "knot/nameserver/chaos.h"
 #include "knot/nameserver/internet.h"
@@ -220,9 +221,8 @@ static int answer_edns_init(const knot_pkt_t *query, knot_pkt_t *resp,
 	}
 
 	/* Initialize OPT record. */
-	conf_val_t val = conf_get(conf(), C_SRV, C_MAX_UDP_PAYLOAD);
-	int ret = knot_edns_init(&qdata->opt_rr, conf_int(&val), 0,
-	                     KNOT_EDNS_VERSION, qdata->mm);
+	int ret = knot_edns_init(&qdata->opt_rr, conf()->cache.srv_max_udp_payload,
+	                         0, KNOT_EDNS_VERSION, qdata->mm);
 	if (ret != KNOT_EOK) {
 		return ret;
 	}
@@ -238,27 +238,14 @@ static int answer_edns_init(const knot_pkt_t *query, knot_pkt_t *resp,
 	}
 
 	/* Append NSID if requested and available. */
-	val = conf_get(conf(), C_SRV, C_NSID);
-	if (knot_edns_has_nsid(query->opt_rr)) {
-		conf_data(&val);
-		if (val.code != KNOT_EOK) {
-			ret = knot_edns_add_option(&qdata->opt_rr,
-			                           KNOT_EDNS_OPTION_NSID,
-			                           strlen(conf()->hostname),
-			                           (uint8_t *)conf()->hostname,
-			                           qdata->mm);
-			if (ret != KNOT_EOK) {
-				return ret;
-			}
-		} else if (val.len > 0) {
-			ret = knot_edns_add_option(&qdata->opt_rr,
-			                           KNOT_EDNS_OPTION_NSID,
-			                           val.len,
-			                           val.data,
-			                           qdata->mm);
-			if (ret != KNOT_EOK) {
-				return ret;
-			}
+	if (knot_edns_has_nsid(query->opt_rr) && conf()->cache.srv_nsid_len > 0) {
+		ret = knot_edns_add_option(&qdata->opt_rr,
+		                           KNOT_EDNS_OPTION_NSID,
+		                           conf()->cache.srv_nsid_len,
+		                           conf()->cache.srv_nsid_data,
+		                           qdata->mm);
+		if (ret != KNOT_EOK) {
+			return ret;
 		}
 	}
 
@@ -334,14 +321,15 @@ static int prepare_answer(const knot_pkt_t *query, knot_pkt_t *resp, knot_layer_
 	if (has_limit) {
 		resp->max_size = KNOT_WIRE_MIN_PKTSIZE;
 		if (knot_pkt_has_edns(query)) {
-			conf_val_t val = conf_get(conf(), C_SRV, C_MAX_UDP_PAYLOAD);
 			uint16_t client = knot_edns_get_payload(query->opt_rr);
-			uint16_t server = conf_int(&val);
+			uint16_t server = conf()->cache.srv_max_udp_payload;
 			uint16_t transfer = MIN(client, server);
 			resp->max_size = MAX(resp->max_size, transfer);
 		}
 	} else {
+		/* Large answers and transfers, compress against all names. */
 		resp->max_size = KNOT_WIRE_MAX_PKTSIZE;
+		ret = knot_pkt_use_compr_table(resp);
 	}
 
 	return ret;
@@ -426,8 +414,7 @@ static int ratelimit_apply(int state, knot_pkt_t *pkt, knot_layer_t *ctx)
 	}
 
 	/* Now it is slip or drop. */
-	conf_val_t val = conf_get(conf(), C_SRV, C_RATE_LIMIT_SLIP);
-	if (rrl_slip_roll(conf_int(&val))) {
+	if (rrl_slip_roll(conf()->cache.srv_rate_limit_slip)) {
 		/* Answer slips. */
 		if (process_query_err(ctx, pkt) != KNOT_EOK) {
 			return KNOT_STATE_FAIL;
@@ -441,6 +428,94 @@ static int ratelimit_apply(int state, knot_pkt_t *pkt, knot_layer_t *ctx)
 	return KNOT_STATE_DONE;
 }
 
+/*!
+ * \brief Prepare answer cache key if the answer may be cached.
+ *
+ * Only regular IN class queries without TSIG and NSID, answered from a zone
+ * without query modules are cached. Also no module may process the query
+ * before the answer is looked up.
+ */
+static bool answer_cache_prepare(const knot_pkt_t *resp, struct query_data *qdata,
+                                 const struct query_plan *plan,
+                                 answer_cache_key_t *key)
+{
+	const knot_pkt_t *query = qdata->query;
+	const zone_t *zone = qdata->zone;
+
+	if (qdata->param->answer_cache == NULL ||
+	    (plan != NULL && !EMPTY_LIST(plan->stage[QPLAN_BEGIN])) ||
+	    qdata->packet_type != KNOT_QUERY_NORMAL ||
+	    knot_pkt_qclass(query) != KNOT_CLASS_IN ||
+	    knot_pkt_has_tsig(query) || knot_pkt_has_nsid(query) ||
+	    zone == NULL || zone->query_plan != NULL) {
+		return false;
+	}
+
+	/* Generation must be read before the zone contents is accessed. */
+	key->zone_gen = zone->generation;
+	__sync_synchronize();
+
+	key->qname = knot_pkt_qname(query);
+	key->qtype = knot_pkt_qtype(query);
+	key->max_size = resp->max_size;
+
+	/* Answers with and without OPT may have the same size limit. */
+	key->edns = knot_pkt_has_edns(query);
+	key->edns_version = key->edns ? knot_edns_get_version(query->opt_rr) : 0;
+	key->edns_flags = key->edns ? knot_rrset_ttl(query->opt_rr) : 0;
+
+	return true;
+}
+
+/*! \brief Copy cached answer into the response, patch message ID and flags. */
+static bool answer_cache_fetch(knot_pkt_t *resp, struct query_data *qdata,
+                               const answer_cache_key_t *key)
+{
+	size_t size = 0;
+	const uint8_t *wire = answer_cache_get(qdata->param->answer_cache, key,
+	                                       &size);
+	if (wire == NULL || size > resp->max_size) {
+		return false;
+	}
+
+	const uint8_t *query_wire = qdata->query->wire;
+	memcpy(resp->wire, wire, size);
+	resp->size = size;
+
+	/* Flags copied from the query. */
+	const uint8_t mask1 = KNOT_WIRE_RD_MASK;
+	const uint8_t mask2 = KNOT_WIRE_CD_MASK | KNOT_WIRE_Z_MASK;
+	knot_wire_set_id(resp->wire, knot_wire_get_id(query_wire));
+	knot_wire_set_flags1(resp->wire,
+	                     (knot_wire_get_flags1(wire) & ~mask1) |
+	                     (knot_wire_get_flags1(query_wire) & mask1));
+	knot_wire_set_flags2(resp->wire,
+	                     (knot_wire_get_flags2(wire) & ~mask2) |
+	                     (knot_wire_get_flags2(query_wire) & mask2));
+
+	/* Restore original QNAME case. */
+	memcpy(resp->wire + KNOT_WIRE_HEADER_SIZE, qdata->orig_qname,
+	       qdata->query->qname_size);
+
+	return true;
+}
+
+/*! \brief Store static positive answer into the answer cache. */
+static void answer_cache_store(const knot_pkt_t *resp, struct query_data *qdata,
+                               const answer_cache_key_t *key)
+{
+	/* Wildcard answers are excluded as rate limiting treats them apart. */
+	if (qdata->rcode != KNOT_RCODE_NOERROR ||
+	    knot_wire_get_ancount(resp->wire) == 0 ||
+	    knot_wire_get_tc(resp->wire) ||
+	    !EMPTY_LIST(qdata->wildcards) ||
+	    qdata->sign.tsig_key.name != NULL) {
+		return;
+	}
+
+	answer_cache_put(qdata->param->answer_cache, key, resp->wire, resp->size);
+}
+
 static int process_query_out(knot_layer_t *ctx, knot_pkt_t *pkt)
 {
 	assert(pkt && ctx);
@@ -471,6 +546,14 @@ static int process_query_out(knot_layer_t *ctx, knot_pkt_t *pkt)
 		goto finish;
 	}
 
+	/* Look for the answer in the answer cache. */
+	answer_cache_key_t cache_key;
+	bool cacheable = answer_cache_prepare(pkt, qdata, plan, &cache_key);
+	if (cacheable && answer_cache_fetch(pkt, qdata, &cache_key)) {
+		next_state = KNOT_STATE_DONE;
+		goto finish_cached;
+	}
+
 	/* Before query processing code. */
 	if (plan) {
 		WALK_LIST(step, plan->stage[QPLAN_BEGIN]) {
@@ -521,6 +604,10 @@ static int process_query_out(knot_layer_t *ctx, knot_pkt_t *pkt)
 		}
 	}
 
+	if (cacheable && next_state == KNOT_STATE_DONE) {
+		answer_cache_store(pkt, qdata, &cache_key);
+	}
+
 finish:
 	/* Default RCODE is SERVFAIL if not specified otherwise. */
 	if (next_state == KNOT_STATE_FAIL && qdata->rcode == KNOT_RCODE_NOERROR) {
@@ -535,6 +622,7 @@ finish:
 	}
 	/* In case of NS_PROC_FAIL, RCODE is set in the error-processing function. */
 
+finish_cached:
 	/* Rate limits (if applicable). */
 	if (qdata->param->proc_flags & NS_QUERY_LIMIT_RATE) {
 		next_state = ratelimit_apply(next_state, pkt, ctx);
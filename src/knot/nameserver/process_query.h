@@ -63,6 +63,7 @@ struct process_query_param {
 	int        socket;
 	const struct sockaddr_storage *remote;
 	unsigned   thread_id;
+	struct answer_cache *answer_cache; /*!< Thread answer cache (optional). */
 };
 
 /*! \brief Query processing intermediate data. */
@@ -20,6 +20,8 @@
 #include <stdio.h>
 #include <unistd.h>
 #include <errno.h>
+#include <dirent.h>
+#include <sched.h>
 #include <urcu.h>
 
 #ifdef HAVE_CAP_NG_H
@@ -161,6 +163,11 @@ static void *thread_ep(void *data)
 
 		// Start runnable if thread is marked Active
 		if ((thread->state == ThreadActive) && (thread->run != 0)) {
+			// Apply placement before runnable allocates its memory
+			if (thread->_cpu_count > 0) {
+				dt_setaffinity(thread, thread->_cpu_id,
+				               thread->_cpu_count);
+			}
 			unlock_thread_rw(thread);
 			dbg_dt("dthreads: [%p] entering runnable\n", thread);
 			_run(thread);
@@ -275,6 +282,7 @@ static void dt_delete_thread(dthread_t **thread)
 	pthread_mutex_destroy(&(thr)->_mx);
 
 	// Free memory
+	free(thr->_cpu_id);
 	free(thr);
 }
 
@@ -672,6 +680,47 @@ int dt_setaffinity(dthread_t *thread, unsigned* cpu_id, size_t cpu_count)
 	return KNOT_EOK;
 }
 
+int dt_unit_setaffinity(dt_unit_t *unit, const unsigned *cpu_id,
+                        size_t cpu_count, bool spread)
+{
+	if (unit == NULL || (cpu_id == NULL && cpu_count > 0)) {
+		return KNOT_EINVAL;
+	}
+
+	int ret = KNOT_EOK;
+	dt_unit_lock(unit);
+	for (int i = 0; i < unit->size; ++i) {
+		dthread_t *thread = unit->threads[i];
+		size_t count = (spread && cpu_count > 0) ? 1 : cpu_count;
+		unsigned *cpus = NULL;
+		if (count > 0) {
+			cpus = malloc(count * sizeof(unsigned));
+			if (cpus == NULL) {
+				ret = KNOT_ENOMEM;
+				break;
+			}
+			if (spread) {
+				cpus[0] = cpu_id[i % cpu_count];
+			} else {
+				memcpy(cpus, cpu_id, count * sizeof(unsigned));
+			}
+		}
+
+		lock_thread_rw(thread);
+		free(thread->_cpu_id);
+		thread->_cpu_id = cpus;
+		thread->_cpu_count = count;
+		// Update running threads immediately
+		if (count > 0 && (thread->state & (ThreadIdle | ThreadActive))) {
+			dt_setaffinity(thread, cpus, count);
+		}
+		unlock_thread_rw(thread);
+	}
+	dt_unit_unlock(unit);
+
+	return ret;
+}
+
 int dt_activate(dthread_t *thread)
 {
 	return dt_update_thread(thread, ThreadActive);
@@ -757,6 +806,190 @@ int dt_online_cpus(void)
 	return ret;
 }
 
+#if defined(__linux__)
+
+#define SYSFS_CPU "/sys/devices/system/cpu"
+
+/*! \brief CPU topology descriptor. */
+struct cpu_info {
+	unsigned id;
+	unsigned rank; /*!< Sort key, 0 for a primary thread on the preferred node. */
+};
+
+/*! \brief Read the first line of a sysfs file. */
+static bool sysfs_read(const char *path, char *buf, size_t len)
+{
+	FILE *fp = fopen(path, "r");
+	if (fp == NULL) {
+		return false;
+	}
+
+	bool ret = (fgets(buf, len, fp) != NULL);
+	fclose(fp);
+
+	return ret;
+}
+
+/*! \brief Parse CPU list in the sysfs format (e.g. "0-3,8,10-11"). */
+static size_t parse_cpu_list(const char *str, unsigned *cpu_id, size_t max)
+{
+	size_t count = 0;
+	while (*str != '\0' && *str != '\n' && count < max) {
+		char *end = NULL;
+		unsigned long from = strtoul(str, &end, 10);
+		if (end == str) {
+			break;
+		}
+		unsigned long to = from;
+		if (*end == '-') {
+			str = end + 1;
+			to = strtoul(str, &end, 10);
+			if (end == str || to < from) {
+				break;
+			}
+		}
+		for (unsigned long i = from; i <= to && count < max; ++i) {
+			cpu_id[count++] = i;
+		}
+		str = (*end == ',') ? end + 1 : end;
+	}
+
+	return count;
+}
+
+/*! \brief Find NUMA node of the CPU (cpuN/nodeM link), -1 if unknown. */
+static int cpu_node(unsigned cpu)
+{
+	char path[64];
+	snprintf(path, sizeof(path), SYSFS_CPU "/cpu%u", cpu);
+	DIR *dir = opendir(path);
+	if (dir == NULL) {
+		return -1;
+	}
+
+	int node = -1;
+	struct dirent *entry = NULL;
+	while ((entry = readdir(dir)) != NULL) {
+		if (sscanf(entry->d_name, "node%d", &node) == 1) {
+			break;
+		}
+		node = -1;
+	}
+	closedir(dir);
+
+	return node;
+}
+
+/*! \brief Return true if the CPU is the first sibling of its core. */
+static bool cpu_primary(unsigned cpu)
+{
+	char path[96];
+	char buf[256];
+	snprintf(path, sizeof(path),
+	         SYSFS_CPU "/cpu%u/topology/thread_siblings_list", cpu);
+	unsigned first = 0;
+	if (!sysfs_read(path, buf, sizeof(buf)) ||
+	    parse_cpu_list(buf, &first, 1) != 1) {
+		return true;
+	}
+
+	return first == cpu;
+}
+
+/*!
+ * \brief Compute sort key of the CPU.
+ *
+ * CPUs on the preferred node go first, first siblings of the cores before
+ * the other hardware threads.
+ */
+static unsigned cpu_rank(unsigned cpu, int pref_node)
+{
+	bool far = (pref_node >= 0 && cpu_node(cpu) != pref_node);
+	bool sibling = !cpu_primary(cpu);
+
+	return (far << 1) | sibling;
+}
+
+static int cpu_info_cmp(const void *a, const void *b)
+{
+	const struct cpu_info *x = a, *y = b;
+
+	if (x->rank != y->rank) {
+		return (x->rank > y->rank) - (x->rank < y->rank);
+	}
+
+	return (x->id > y->id) - (x->id < y->id);
+}
+
+size_t dt_cpu_topology(unsigned *cpu_id, size_t max, int node)
+{
+	if (cpu_id == NULL || max == 0) {
+		return 0;
+	}
+
+	char buf[1024];
+	if (!sysfs_read(SYSFS_CPU "/online", buf, sizeof(buf))) {
+		return 0;
+	}
+
+	/* Only CPUs the process may run on (taskset, cgroup cpusets). */
+	cpu_set_t allowed;
+	CPU_ZERO(&allowed);
+	if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+		return 0;
+	}
+
+	size_t online = parse_cpu_list(buf, cpu_id, max);
+	size_t count = 0;
+	for (size_t i = 0; i < online; ++i) {
+		if (cpu_id[i] < CPU_SETSIZE && CPU_ISSET(cpu_id[i], &allowed)) {
+			cpu_id[count++] = cpu_id[i];
+		}
+	}
+	if (count == 0) {
+		return 0;
+	}
+
+	struct cpu_info *info = malloc(count * sizeof(struct cpu_info));
+	if (info == NULL) {
+		return 0;
+	}
+
+	/* The ordering is computed only on (re)configuration. */
+	for (size_t i = 0; i < count; ++i) {
+		info[i].id = cpu_id[i];
+		info[i].rank = cpu_rank(cpu_id[i], node);
+	}
+
+	qsort(info, count, sizeof(struct cpu_info), cpu_info_cmp);
+	for (size_t i = 0; i < count; ++i) {
+		cpu_id[i] = info[i].id;
+	}
+	free(info);
+
+	return count;
+}
+
+#else
+
+size_t dt_cpu_topology(unsigned *cpu_id, size_t max, int node)
+{
+	if (cpu_id == NULL) {
+		return 0;
+	}
+
+	/* No topology information, sequential order. */
+	int online = dt_online_cpus();
+	size_t count = 0;
+	for (int i = 0; i < online && count < max; ++i) {
+		cpu_id[count++] = i;
+	}
+
+	return count;
+}
+
+#endif /* __linux__ */
+
 int dt_optimal_size(void)
 {
 	int ret = dt_online_cpus();
@@ -39,6 +39,8 @@
 #pragma once
 
 #include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
 
 #define DEFAULT_THR_COUNT 2  /*!< Default thread count. */
 
@@ -85,6 +87,8 @@ typedef struct dthread {
 	pthread_t           _thr; /*!< Thread */
 	pthread_attr_t     _attr; /*!< Thread attributes */
 	pthread_mutex_t      _mx; /*!< Thread state change lock. */
+	unsigned        *_cpu_id; /*!< CPUs the thread is placed on. */
+	size_t        _cpu_count; /*!< Number of CPUs, 0 for no placement. */
 } dthread_t;
 
 /*!
@@ -189,6 +193,26 @@ int dt_stop(dt_unit_t *unit);
  */
 int dt_setaffinity(dthread_t *thread, unsigned* cpu_id, size_t cpu_count);
 
+/*!
+ * \brief Set CPU placement of threads in the unit.
+ *
+ * With \a spread, i-th thread is placed on cpu_id[i % cpu_count], otherwise
+ * each thread may run on any of the given CPUs. Placement is applied
+ * immediately to running threads and always before the runnable is entered,
+ * so memory allocated by the runnable is local to the CPU (first-touch).
+ *
+ * \param unit Target unit instance.
+ * \param cpu_id Array of CPU IDs, NULL to clear the placement.
+ * \param cpu_count Number of CPUs in the array.
+ * \param spread Place each thread on a single CPU.
+ *
+ * \retval KNOT_EOK on success.
+ * \retval KNOT_EINVAL on invalid parameters.
+ * \retval KNOT_ENOMEM if out of memory.
+ */
+int dt_unit_setaffinity(dt_unit_t *unit, const unsigned *cpu_id,
+                        size_t cpu_count, bool spread);
+
 /*!
  * \brief Wake up thread from idle state.
  *
@@ -240,6 +264,28 @@ int dt_compact(dt_unit_t *unit);
  */
 int dt_online_cpus(void);
 
+/*!
+ * \brief Return online CPUs ordered for thread placement.
+ *
+ * CPUs of the preferred NUMA node go first. Within a node, the first
+ * hardware thread of each physical core precedes the core siblings,
+ * so the leading CPUs don't share execution units.
+ *
+ * Only CPUs in the affinity mask of the calling thread are listed, so the
+ * placement respects taskset and cgroup cpuset restrictions.
+ *
+ * \note Topology is read from sysfs on Linux, other systems get the CPUs
+ *       in sequential order.
+ *
+ * \param cpu_id Output array of CPU IDs.
+ * \param max Array capacity.
+ * \param node Preferred NUMA node or -1 for no preference.
+ *
+ * \return Number of CPUs stored, 0 if the topology is unavailable or none
+ *         of the online CPUs is allowed (threads should not be pinned).
+ */
+size_t dt_cpu_topology(unsigned *cpu_id, size_t max, int node);
+
 /*!
  * \brief Return optimal number of threads for instance.
  *
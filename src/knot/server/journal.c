@@ -17,739 +17,166 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
-#include <unistd.h>
-#include <fcntl.h>
-#include <inttypes.h>
-#include <sys/stat.h>
-#include <sys/mman.h>
 #include <assert.h>
+#include <pthread.h>
+#include <time.h>
 
 #include "knot/common/debug.h"
 #include "knot/server/journal.h"
 #include "knot/server/serialization.h"
 #include "libknot/libknot.h"
 #include "libknot/rrtype/soa.h"
+#include "libknot/internal/mem.h"
+#include "libknot/internal/utils.h"
+#include "libknot/internal/namedb/namedb_lmdb.h"
 
-/*! \brief Infinite file size limit. */
+/*! \brief Infinite journal size limit. */
 #define FSLIMIT_INF (~((size_t)0))
 
-/*! \brief Next node. */
-#define jnode_next(j, i) (((i) + 1) % (j)->max_nodes)
+/*! \brief Maximum key size, zone name and serial. */
+#define KEY_MAXLEN (KNOT_DNAME_MAXLEN + sizeof(uint32_t))
 
-/*! \brief Previous node. */
-#define jnode_prev(j, i) (((i) == 0) ? (j)->max_nodes - 1 : (i) - 1)
+/*! \brief Entry header, the ending serial and the time of store. */
+#define ENTRY_HSIZE (2 * sizeof(uint32_t))
 
-/*! \bref Starting node data position. */
-#define jnode_base_pos(max_nodes) (JOURNAL_HSIZE + (max_nodes + 1) * sizeof(journal_node_t))
+/*! \brief Serialized metadata size. */
+#define META_SIZE (4 * sizeof(uint32_t) + sizeof(uint64_t))
 
-static const uint32_t CRC_PLACEHOLDER = 0;
+/*! \brief Zone journal metadata. */
+typedef struct {
+	uint32_t first;  /*!< Starting serial of the oldest changeset. */
+	uint32_t last;   /*!< Ending serial of the newest changeset. */
+	uint32_t synced; /*!< Zone file serial, changesets from here are dirty. */
+	uint32_t count;  /*!< Number of stored changesets. */
+	uint64_t size;   /*!< Total size of the stored changesets. */
+} journal_meta_t;
 
-static inline int sfread(void *dst, size_t len, int fd)
+/*! \brief Make metadata key (serial NULL) or changeset key. */
+static namedb_val_t make_key(uint8_t *buf, const knot_dname_t *zone,
+                             const uint32_t *serial)
 {
-	return read(fd, dst, len) == len;
-}
-
-static inline int sfwrite(const void *src, size_t len, int fd)
-{
-	return write(fd, src, len) == len;
-}
-
-/*! \brief Equality compare function. */
-static inline int journal_cmp_eq(uint64_t k1, uint64_t k2)
-{
-	if (k1 > k2) return 1;
-	if (k1 < k2) return -1;
-	return 0;
-}
-
-/*! \brief Return 'serial_from' part of the key. */
-static inline uint32_t journal_key_from(uint64_t k)
-{
-	/*      64    32       0
-	 * key = [TO   |   FROM]
-	 * Need: Least significant 32 bits.
-	 */
-	return (uint32_t)(k & ((uint64_t)0x00000000ffffffff));
-}
-
-/*----------------------------------------------------------------------------*/
-
-/*! \brief Compare function to match entries with starting serial. */
-static inline int journal_key_from_cmp(uint64_t k, uint64_t from)
-{
-	/*      64    32       0
-	 * key = [TO   |   FROM]
-	 * Need: Least significant 32 bits.
-	 */
-	return ((uint64_t)journal_key_from(k)) - from;
-}
-
-/*! \brief Make key for journal from serials. */
-static inline uint64_t ixfrdb_key_make(uint32_t from, uint32_t to)
-{
-	/*      64    32       0
-	 * key = [TO   |   FROM]
-	 */
-	return (((uint64_t)to) << ((uint64_t)32)) | ((uint64_t)from);
-}
-
-/*! \brief Create new journal. */
-static int journal_create_file(const char *fn, uint16_t max_nodes)
-{
-	if (fn == NULL) {
-		return KNOT_EINVAL;
+	size_t len = knot_dname_size(zone);
+	memcpy(buf, zone, len);
+	if (serial != NULL) {
+		wire_write_u32(buf + len, *serial);
+		len += sizeof(uint32_t);
 	}
 
-	/* File lock. */
-	struct flock fl = { .l_type = F_WRLCK, .l_whence = SEEK_SET,
-	                    .l_start = 0, .l_len = 0, .l_pid = getpid() };
-
-	/* Create journal file. */
-	int fd = open(fn, O_RDWR|O_CREAT|O_TRUNC, S_IRUSR|S_IWUSR|S_IRGRP|S_IWGRP);
-	if (fd < 0) {
-		dbg_journal("journal: failed to create file '%s'\n", fn);
-		return knot_map_errno();
-	}
-
-	/* Lock. */
-	if (fcntl(fd, F_SETLKW, &fl) == -1) {
-		close(fd);
-		remove(fn);
-		return KNOT_ERROR;
-	}
-
-	/* Create journal header. */
-	dbg_journal("journal: creating header\n");
-	const char magic[MAGIC_LENGTH] = JOURNAL_MAGIC;
-	if (!sfwrite(magic, MAGIC_LENGTH, fd)) {
-		close(fd);
-		remove(fn);
-		return KNOT_ERROR;
-	}
-
-	if (!sfwrite(&CRC_PLACEHOLDER, sizeof(CRC_PLACEHOLDER), fd)) {
-		close(fd);
-		remove(fn);
-		return KNOT_ERROR;
-	}
-	if (!sfwrite(&max_nodes, sizeof(uint16_t), fd)) {
-		close(fd);
-		remove(fn);
-		return KNOT_ERROR;
-	}
-
-	/* Create node queue head + tail.
-	 * qhead points to least recent node
-	 * qtail points to next free node
-	 * qhead == qtail means empty queue
-	 */
-	uint16_t zval = 0;
-	if (!sfwrite(&zval, sizeof(uint16_t), fd)) {
-		close(fd);
-		remove(fn);
-		return KNOT_ERROR;
-	}
-
-	if (!sfwrite(&zval, sizeof(uint16_t), fd)) {
-		close(fd);
-		remove(fn);
-		return KNOT_ERROR;
-	}
-
-	dbg_journal_verb("journal: creating free segment descriptor\n");
-
-	/* Create free segment descriptor. */
-	journal_node_t jn;
-	memset(&jn, 0, sizeof(journal_node_t));
-	jn.id = 0;
-	jn.flags = JOURNAL_VALID;
-	jn.pos = jnode_base_pos(max_nodes);
-	jn.len = 0;
-	if (!sfwrite(&jn, sizeof(journal_node_t), fd)) {
-		close(fd);
-		remove(fn);
-		return KNOT_ERROR;
-	}
-
-	/* Create nodes. */
-	dbg_journal("journal: creating node table, size=%u\n", max_nodes);
-	memset(&jn, 0, sizeof(journal_node_t));
-	for(uint16_t i = 0; i < max_nodes; ++i) {
-		if (!sfwrite(&jn, sizeof(journal_node_t), fd)) {
-			close(fd);
-			if (remove(fn) < 0) {
-				dbg_journal("journal: failed to remove journal file after error\n");
-			}
-			return KNOT_ERROR;
-		}
-	}
-
-	/* Unlock and close. */
-	close(fd);
-
-	/* Journal file created. */
-	dbg_journal("journal: file '%s' initialized\n", fn);
-	return KNOT_EOK;
+	namedb_val_t key = { .data = buf, .len = len };
+	return key;
 }
 
-/*! \brief Open journal file for r/w (returns error if not exists). */
-static int journal_open_file(journal_t *j)
+static int meta_read(namedb_txn_t *txn, const knot_dname_t *zone,
+                     journal_meta_t *meta)
 {
-	assert(j != NULL);
-
-	int ret = KNOT_EOK;
-	j->fd = open(j->path, O_RDWR);
-	dbg_journal_verb("journal: open_file '%s'\n", j->path);
-	if (j->fd < 0) {
-		if (errno != ENOENT) {
-			return knot_map_errno();
-		}
+	uint8_t buf[KEY_MAXLEN];
+	namedb_val_t key = make_key(buf, zone, NULL);
+	namedb_val_t val;
 
-		/* Create new journal file and open if not exists. */
-		ret = journal_create_file(j->path, JOURNAL_NCOUNT);
-		if(ret == KNOT_EOK) {
-			return journal_open_file(j);
-		}
-		return ret;
-	}
-
-	/* File lock. */
-	struct flock lock = { .l_type = F_WRLCK, .l_whence = SEEK_SET,
-	                      .l_start  = 0, .l_len = 0, .l_pid = 0 };
-	/* Attempt to lock. */
-	dbg_journal_verb("journal: locking journal %s\n", j->path);
-	ret = fcntl(j->fd, F_SETLKW, &lock);
-	if (ret < 0) {
-		return knot_map_errno();
-	}
-
-	/* Read magic bytes. */
-	dbg_journal("journal: reading magic bytes\n");
-	const char magic_req[MAGIC_LENGTH] = JOURNAL_MAGIC;
-	char magic[MAGIC_LENGTH];
-	if (!sfread(magic, MAGIC_LENGTH, j->fd)) {
-		dbg_journal_verb("journal: cannot read magic bytes\n");
-		goto open_file_error;
-	}
-	if (memcmp(magic, magic_req, MAGIC_LENGTH) != 0) {
-		log_warning("journal '%s', version too old, purging", j->path);
-		close(j->fd);
-		j->fd = -1;
-		ret = journal_create_file(j->path, JOURNAL_NCOUNT);
-		if(ret == KNOT_EOK) {
-			return journal_open_file(j);
-		}
+	memset(meta, 0, sizeof(*meta));
+	int ret = namedb_lmdb_api()->find(txn, &key, &val, 0);
+	if (ret != KNOT_EOK) {
 		return ret;
 	}
 
-	/* Skip CRC */
-	if (lseek(j->fd, MAGIC_LENGTH + sizeof(CRC_PLACEHOLDER), SEEK_SET) < 0) {
-		goto open_file_error;
-	}
-
-	/* Get journal file size. */
-	struct stat st;
-	if (fstat(j->fd, &st) < 0) {
-		dbg_journal_verb("journal: cannot get journal fsize\n");
-		goto open_file_error;
-	}
-
-	/* Set file size. */
-	j->fsize = st.st_size;
-
-	/* Read maximum number of entries. */
-	if (!sfread(&j->max_nodes, sizeof(uint16_t), j->fd)) {
-		dbg_journal_verb("journal: cannot read max_nodes\n");
-		goto open_file_error;
-	}
-
-	/* Check max_nodes, but this is riddiculous. */
-	if (j->max_nodes == 0) {
-		dbg_journal_verb("journal: invalid max_nodes\n");
-		goto open_file_error;
-	}
-
-	/* Check minimum fsize limit. */
-	size_t fslimit_min = jnode_base_pos(j->max_nodes) + 1024; /* At least 1K block */
-	if (j->fslimit < fslimit_min) {
-		log_error("journal '%s', filesize limit smaller than '%zu'", j->path, fslimit_min);
-		goto open_file_error;
-	}
-
-	/* Allocate nodes. */
-	const size_t node_len = sizeof(journal_node_t);
-	j->nodes = malloc(j->max_nodes * node_len);
-	if (j->nodes == NULL) {
-		dbg_journal_verb("journal: can't allocate nodes\n");
-		goto open_file_error;
-	} else {
-		memset(j->nodes, 0, j->max_nodes * node_len);
-	}
-
-	/* Load node queue state. */
-	j->qhead = j->qtail = 0;
-	if (!sfread(&j->qhead, sizeof(uint16_t), j->fd)) {
-		dbg_journal_verb("journal: cannot read qhead\n");
-		goto open_file_error;
-	}
-
-	/* Load queue tail. */
-	if (!sfread(&j->qtail, sizeof(uint16_t), j->fd)) {
-		dbg_journal_verb("journal: cannot read qtail\n");
-		goto open_file_error;
-	}
-
-	/* Check head + tail */
-	if (j->qtail >= j->max_nodes || j->qhead >= j->max_nodes) {
-		dbg_journal_verb("journal: queue pointers corrupted\n");
-		goto open_file_error;
-	}
-
-	/* Load empty segment descriptor. */
-	if (!sfread(&j->free, node_len, j->fd)) {
-		dbg_journal_verb("journal: cannot read free segment ptr\n");
-		goto open_file_error;
-	}
-
-	/* Read journal descriptors table. */
-	if (!sfread(j->nodes, j->max_nodes * node_len, j->fd)) {
-		dbg_journal_verb("journal: cannot read node table\n");
-		goto open_file_error;
-	}
-
-	dbg_journal("journal: opened journal size=%u, queue=<%u, %u>, fd=%d\n",
-	            j->max_nodes, j->qhead, j->qtail, j->fd);
-
-	/* Save file lock and return. */
-	return KNOT_EOK;
-
-	/* Unlock and close file and return error. */
-open_file_error:
-	free(j->nodes);
-	j->nodes = NULL;
-	close(j->fd);
-	j->fd = -1;
-	return KNOT_ERROR;
-}
-
-/*! \brief Close journal file. */
-static int journal_close_file(journal_t *journal)
-{
-	/* Check journal. */
-	if (journal == NULL) {
-		return KNOT_EINVAL;
-	}
-
-	/* Close file. */
-	if (journal->fd > 0) {
-		close(journal->fd);
-		journal->fd = -1;
-	}
-
-	/* Free nodes. */
-	free(journal->nodes);
-	journal->nodes = NULL;
-
-	return KNOT_EOK;
-}
-
-/*!  \brief Sync node state to permanent storage. */
-static int journal_update(journal_t *journal, journal_node_t *n)
-{
-	if (journal == NULL || n == NULL) {
-		return KNOT_EINVAL;
-	}
-
-	/* Calculate node offset. */
-	const size_t node_len = sizeof(journal_node_t);
-	size_t i = n - journal->nodes;
-	assert(i < journal->max_nodes);
-
-	/* Calculate node position in permanent storage. */
-	long jn_fpos = JOURNAL_HSIZE + (i + 1) * node_len;
-
-	dbg_journal("journal: syncing journal node=%zu id=%llu flags=0x%x\n",
-		      i, (unsigned long long)n->id, n->flags);
-
-	/* Write back. */
-	int seek_ret = lseek(journal->fd, jn_fpos, SEEK_SET);
-	if (seek_ret < 0 || !sfwrite(n, node_len, journal->fd)) {
-		dbg_journal("journal: failed to writeback node=%llu to %ld\n",
-		            (unsigned long long)n->id, jn_fpos);
-		return KNOT_ERROR;
+	if (val.len != META_SIZE) {
+		return KNOT_EMALF;
 	}
 
-	return KNOT_EOK;
-}
-
-int journal_write_in(journal_t *j, journal_node_t **rn, uint64_t id, size_t len)
-{
-	const size_t node_len = sizeof(journal_node_t);
-	*rn = NULL;
-
-	dbg_journal("journal: will write id=%llu, node=%u, size=%zu, fsize=%zu\n",
-	            (unsigned long long)id, j->qtail, len, j->fsize);
-
-	/* Count rewinds. */
-	bool already_rewound = false;
-
-	/* Evict occupied nodes if necessary. */
-	while (j->free.len < len || jnode_next(j, j->qtail) == j->qhead) {
-
-		/* Increase free segment if on the end of file. */
-		bool is_empty = (j->qtail == j->qhead);
-		journal_node_t *head = j->nodes + j->qhead;
-		journal_node_t *last = j->nodes + jnode_prev(j, j->qtail);
-		if (is_empty || (head->pos <= last->pos && j->free.pos > last->pos)) {
-
-			dbg_journal_verb("journal: * is last node\n");
-
-			/* Grow journal file until the size limit. */
-			if(j->free.pos + len < j->fslimit  && jnode_next(j, j->qtail) != j->qhead) {
-				size_t diff = len - j->free.len;
-				dbg_journal("journal: * growing by +%zu, pos=%u, "
-				            "new fsize=%zu\n",
-				            diff, j->free.pos,
-				            j->fsize + diff);
-				j->fsize += diff; /* Appending increases file size. */
-				j->free.len += diff;
-				continue;
-
-			} else if (!already_rewound) {
-				/*  Rewind if resize is needed, but the limit is reached. */
-				j->free.pos = jnode_base_pos(j->max_nodes);
-				j->free.len = 0;
-				if (!is_empty) {
-					j->free.len = head->pos - j->free.pos;
-				}
-				dbg_journal_verb("journal: * fslimit/nodelimit reached, "
-				                 "rewinding to %u\n",
-				                 j->free.pos);
-				already_rewound = true;
-			} else {
-				/* Already rewound, but couldn't collect enough free space. */
-				return KNOT_ESPACE;
-			}
-
-			/* Continue until enough free space is collected. */
-			continue;
-		}
+	const uint8_t *pos = val.data;
+	meta->first  = wire_read_u32(pos);
+	meta->last   = wire_read_u32(pos + 4);
+	meta->synced = wire_read_u32(pos + 8);
+	meta->count  = wire_read_u32(pos + 12);
+	meta->size   = wire_read_u64(pos + 16);
 
-		/* Check if it has been synced to disk. */
-		if ((head->flags & JOURNAL_DIRTY) && (head->flags & JOURNAL_VALID)) {
-			return KNOT_EBUSY;
-		}
-
-		/* Write back evicted node. */
-		head->flags = JOURNAL_FREE;
-		int seek_ret = lseek(j->fd, JOURNAL_HSIZE + (j->qhead + 1) * node_len, SEEK_SET);
-		if (seek_ret < 0 || !sfwrite(head, node_len, j->fd)) {
-			return KNOT_ERROR;
-		}
-
-		dbg_journal("journal: * evicted node=%u, growing by +%u\n",
-			      j->qhead, head->len);
-
-		/* Write back query state. */
-		j->qhead = (j->qhead + 1) % j->max_nodes;
-		uint16_t qstate[2] = {j->qhead, j->qtail};
-		seek_ret = lseek(j->fd, JOURNAL_HSIZE - 2 * sizeof(uint16_t), SEEK_SET);
-		if (seek_ret < 0 || !sfwrite(qstate, 2 * sizeof(uint16_t), j->fd)) {
-			return KNOT_ERROR;
-		}
-
-		/* Increase free segment. */
-		j->free.len += head->len;
-	}
-
-	/* Invalidate tail node and write back. */
-	journal_node_t *n = j->nodes + j->qtail;
-	n->id = id;
-	n->pos = j->free.pos;
-	n->len = len;
-	n->flags = JOURNAL_FREE;
-	journal_update(j, n);
-	*rn = n;
 	return KNOT_EOK;
 }
 
-int journal_write_out(journal_t *journal, journal_node_t *n)
+static int meta_write(namedb_txn_t *txn, const knot_dname_t *zone,
+                      const journal_meta_t *meta)
 {
-	/* Mark node as valid and write back. */
-	uint16_t jnext = (journal->qtail + 1) % journal->max_nodes;
-	size_t size = n->len;
-	const size_t node_len = sizeof(journal_node_t);
-	n->flags = JOURNAL_VALID | journal->bflags;
-	journal_update(journal, n);
-
-	/* Mark used space. */
-	journal->free.pos += size;
-	journal->free.len -= size;
-
-	dbg_journal("journal: finishing node=%u id=%llu flags=0x%x, "
-	            "data=<%u, %u> free=<%u, %u>\n",
-	            journal->qtail, (unsigned long long)n->id,
-	            n->flags, n->pos, n->pos + n->len,
-	            journal->free.pos,
-	            journal->free.pos + journal->free.len);
-
-	/* Write back free segment state. */
-	int seek_ret = lseek(journal->fd, JOURNAL_HSIZE, SEEK_SET);
-	if (seek_ret < 0 || !sfwrite(&journal->free, node_len, journal->fd)) {
-		/* Node is marked valid and failed to shrink free space,
-		 * node will be overwritten on the next write. Return error.
-		 */
-		dbg_journal("journal: failed to write back "
-		            "free segment descriptor\n");
-		return KNOT_ERROR;
-	}
-
-	/* Node write successful. */
-	journal->qtail = jnext;
-
-	/* Write back queue state, not essential as it may be recovered.
-	 * qhead - lowest valid node identifier (least recent)
-	 * qtail - highest valid node identifier (most recently used)
-	 */
-	uint16_t qstate[2] = {journal->qhead, journal->qtail};
-	seek_ret = lseek(journal->fd, JOURNAL_HSIZE - 2 * sizeof(uint16_t), SEEK_SET);
-	if (seek_ret < 0 || !sfwrite(qstate, 2 * sizeof(uint16_t), journal->fd)) {
-		dbg_journal("journal: failed to write back queue state\n");
-		return KNOT_ERROR;
-	}
-
-	return KNOT_EOK;
+	uint8_t buf[KEY_MAXLEN];
+	namedb_val_t key = make_key(buf, zone, NULL);
+
+	uint8_t data[META_SIZE];
+	wire_write_u32(data,      meta->first);
+	wire_write_u32(data + 4,  meta->last);
+	wire_write_u32(data + 8,  meta->synced);
+	wire_write_u32(data + 12, meta->count);
+	wire_write_u64(data + 16, meta->size);
+	namedb_val_t val = { .data = data, .len = sizeof(data) };
+
+	return namedb_lmdb_api()->insert(txn, &key, &val, 0);
 }
 
-journal_t* journal_open(const char *path, size_t fslimit)
+/*! \brief Remove the changeset starting with given serial. */
+static int entry_remove(namedb_txn_t *txn, const knot_dname_t *zone,
+                        uint32_t serial, uint32_t *serial_to, size_t *size)
 {
-	if (path == NULL) {
-		return NULL;
-	}
-
-	journal_t *j = malloc(sizeof(journal_t));
-	if (j == NULL) {
-		return NULL;
-	}
+	const namedb_api_t *db_api = namedb_lmdb_api();
 
-	memset(j, 0, sizeof(journal_t));
-	j->bflags = JOURNAL_DIRTY;
-	j->fd = -1;
-
-	/* Set file size. */
-	if (fslimit == 0) {
-		j->fslimit = FSLIMIT_INF;
-	} else {
-		j->fslimit = fslimit;
-	}
+	uint8_t buf[KEY_MAXLEN];
+	namedb_val_t key = make_key(buf, zone, &serial);
+	namedb_val_t val;
 
-	/* Copy path. */
-	j->path = strdup(path);
-	if (j->path == NULL) {
-		free(j);
-		return NULL;
-	}
-
-	/* Open journal file. */
-	int ret = journal_open_file(j);
+	int ret = db_api->find(txn, &key, &val, 0);
 	if (ret != KNOT_EOK) {
-		journal_close(j);
-		return NULL;
+		return ret;
 	}
-
-	return j;
-}
-
-/*!
- * \brief Entry identifier compare function.
- *
- * \retval -n if k1 < k2
- * \retval +n if k1 > k2
- * \retval  0 if k1 == k2
- */
-typedef int (*journal_cmp_t)(uint64_t k1, uint64_t k2);
-
-static int journal_fetch(journal_t *journal, uint64_t id,
-		  journal_cmp_t cf, journal_node_t** dst)
-{
-	if (journal == NULL || dst == NULL) {
-		return KNOT_EINVAL;
+	if (val.len < ENTRY_HSIZE) {
+		return KNOT_EMALF;
 	}
 
-	/*! \todo Organize journal descriptors in btree? */
-	size_t i = jnode_prev(journal, journal->qtail);
-	size_t endp = jnode_prev(journal, journal->qhead);
-	for(; i != endp; i = jnode_prev(journal, i)) {
-		journal_node_t *n = journal->nodes + i;
-
-		/* Skip invalid nodes. */
-		if (!(n->flags & JOURNAL_VALID)) {
-			continue;
-		}
-
-		if (cf(n->id, id) == 0) {
-			*dst = journal->nodes + i;
-			return KNOT_EOK;
-		}
-	}
+	*serial_to = wire_read_u32(val.data);
+	*size = val.len;
 
-	return KNOT_ENOENT;
+	return db_api->del(txn, &key);
 }
 
-static int journal_read_node(journal_t *journal, journal_node_t *n, char *dst)
+/*! \brief Remove the oldest changeset. */
+static int evict_first(namedb_txn_t *txn, const knot_dname_t *zone,
+                       journal_meta_t *meta)
 {
-	dbg_journal("journal: reading node with id=%"PRIu64", data=<%u, %u>, flags=0x%hx\n",
-	            n->id, n->pos, n->pos + n->len, n->flags);
-
-	/* Check valid flag. */
-	if (!(n->flags & JOURNAL_VALID)) {
-		dbg_journal("journal: node with id=%llu is invalid "
-		            "(flags=0x%hx)\n", (unsigned long long)n->id, n->flags);
-		return KNOT_EINVAL;
+	uint32_t serial_to = 0;
+	size_t size = 0;
+	int ret = entry_remove(txn, zone, meta->first, &serial_to, &size);
+	if (ret != KNOT_EOK) {
+		return ret;
 	}
 
-	/* Seek journal node. */
-	int seek_ret = lseek(journal->fd, n->pos, SEEK_SET);
+	dbg_journal("journal: evicted %u -> %u, size=%zu\n",
+	            meta->first, serial_to, size);
 
-	/* Read journal node content. */
-	if (seek_ret < 0 || !sfread(dst, n->len, journal->fd)) {
-		return KNOT_ERROR;
-	}
+	meta->first = serial_to;
+	meta->count -= 1;
+	meta->size -= size;
 
 	return KNOT_EOK;
 }
 
-int journal_map(journal_t *journal, uint64_t id, char **dst, size_t size, bool rdonly)
+/*! \brief Remove the whole changeset chain of the zone. */
+static int drop_chain(namedb_txn_t *txn, const knot_dname_t *zone,
+                      journal_meta_t *meta)
 {
-	if (journal == NULL || dst == NULL) {
-		return KNOT_EINVAL;
-	}
-
-	/* Check if entry exists. */
-	journal_node_t *n = NULL;
-	int ret = journal_fetch(journal, id, journal_cmp_eq, &n);
-
-	/* Return if read-only, invalidate if rewritten to avoid duplicates. */
-	if (rdonly) {
-		if (ret != KNOT_EOK) {
-			return ret;
-		}
-	} else {
-		/* Prepare journal write. */
-		ret = journal_write_in(journal, &n, id, size);
+	while (meta->count > 0) {
+		int ret = evict_first(txn, zone, meta);
 		if (ret != KNOT_EOK) {
 			return ret;
 		}
-
-		/* Reserve data in permanent storage. */
-		/*! \todo This is only needed when inflating journal file. */
-		if (lseek(journal->fd, n->pos, SEEK_SET) < 0) {
-			return KNOT_ERROR;
-		}
-		char nbuf[4096] = {0};
-		size_t wb = sizeof(nbuf);
-		while (size > 0) {
-			if (size < sizeof(nbuf)) {
-				wb = size;
-			}
-			if (!sfwrite(nbuf, wb, journal->fd)) {
-				return KNOT_ERROR;
-			}
-			size -= wb;
-		}
-	}
-
-	/* Align offset to page size (required). */
-	const size_t ps = sysconf(_SC_PAGESIZE);
-	off_t ps_delta = (n->pos % ps);
-	off_t off = n->pos - ps_delta;
-
-	/* Map file region. */
-	*dst = mmap(NULL, n->len + ps_delta, PROT_READ | PROT_WRITE, MAP_SHARED,
-	            journal->fd, off);
-	if (*dst == ((void*)-1)) {
-		dbg_journal("journal: couldn't mmap() fd=%d <%u,%u> %d\n",
-		            journal->fd, n->pos, n->pos+n->len, errno);
-		return KNOT_ERROR;
-	}
-
-	/* Advise usage of memory. */
-#ifdef HAVE_MADVISE
-	madvise(*dst, n->len + ps_delta, MADV_SEQUENTIAL);
-#endif
-	/* Correct dst pointer to alignment. */
-	*dst += ps_delta;
-
-	return KNOT_EOK;
-}
-
-int journal_unmap(journal_t *journal, uint64_t id, void *ptr, int finalize)
-{
-	if (journal == NULL || ptr == NULL) {
-		return KNOT_EINVAL;
-	}
-
-	/* Mapped node is on tail. */
-	/* @todo: This is hack to allow read-only correct unmap. */
-	int ret = KNOT_EOK;
-	journal_node_t *n = journal->nodes + journal->qtail;
-	if (!finalize) {
-		ret = journal_fetch(journal, id, journal_cmp_eq, &n);
-		if (ret != KNOT_EOK) {
-			return KNOT_ENOENT;
-		}
-	}
-	if(n->id != id) {
-		dbg_journal("journal: failed to find mmap node with id=%llu\n",
-		            (unsigned long long)id);
-		return KNOT_ENOENT;
-	}
-
-	/* Realign memory. */
-	const size_t ps = sysconf(_SC_PAGESIZE);
-	off_t ps_delta = (n->pos % ps);
-	ptr = ((char*)ptr - ps_delta);
-
-	/* Unmap memory. */
-	if (munmap(ptr, n->len + ps_delta) != 0) {
-		dbg_journal("journal: couldn't munmap() fd=%d <%u,%u> %d\n",
-		            journal->fd, n->pos, n->pos+n->len, errno);
-		return KNOT_ERROR;
 	}
 
-	/* Finalize. */
-	if (finalize) {
-		ret = journal_write_out(journal, n);
-	}
-	return ret;
-}
-
-int journal_close(journal_t *journal)
-{
-	/* Check journal. */
-	if (journal == NULL) {
-		return KNOT_EINVAL;
-	}
-
-	/* Close file. */
-	journal_close_file(journal);
-
-	/* Free allocated resources. */
-	free(journal->path);
-	free(journal);
-
 	return KNOT_EOK;
 }
 
-bool journal_exists(const char *path)
+static bool entry_exists(namedb_txn_t *txn, const knot_dname_t *zone,
+                         uint32_t serial)
 {
-	if (path == NULL) {
-		return false;
-	}
+	uint8_t buf[KEY_MAXLEN];
+	namedb_val_t key = make_key(buf, zone, &serial);
+	namedb_val_t val;
 
-	/* Check journal file existence. */
-	struct stat st;
-	return stat(path, &st) == 0;
+	return namedb_lmdb_api()->find(txn, &key, &val, 0) == KNOT_EOK;
 }
 
 /*! \brief No doc here. Moved from zones.h (@mvavrusa) */
@@ -887,219 +314,632 @@ static int serialize_and_store_chgset(const changeset_t *chs,
 	return KNOT_EOK;
 }
 
-static int changeset_pack(const changeset_t *chs, journal_t *j)
+/*! \brief Store the changeset under its starting serial. */
+static int entry_write(namedb_txn_t *txn, const knot_dname_t *zone,
+                       const changeset_t *chs, size_t entry_size, uint32_t stored)
+{
+	uint32_t serial_from = knot_soa_serial(&chs->soa_from->rrs);
+	uint32_t serial_to = knot_soa_serial(&chs->soa_to->rrs);
+
+	/* Reserve space for the journal entry. */
+	uint8_t buf[KEY_MAXLEN];
+	namedb_val_t key = make_key(buf, zone, &serial_from);
+	namedb_val_t val = { .data = NULL, .len = ENTRY_HSIZE + entry_size };
+	int ret = namedb_lmdb_api()->insert(txn, &key, &val, 0);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	/* Serialize changeset directly into the database. */
+	wire_write_u32(val.data, serial_to);
+	wire_write_u32((uint8_t *)val.data + sizeof(uint32_t), stored);
+	return serialize_and_store_chgset(chs, (char *)val.data + ENTRY_HSIZE,
+	                                  entry_size);
+}
+
+/*! \brief Read the header of the changeset starting with given serial. */
+static int entry_header(namedb_txn_t *txn, const knot_dname_t *zone,
+                        uint32_t serial, uint32_t *serial_to, uint32_t *stored)
+{
+	uint8_t buf[KEY_MAXLEN];
+	namedb_val_t key = make_key(buf, zone, &serial);
+	namedb_val_t val;
+
+	int ret = namedb_lmdb_api()->find(txn, &key, &val, 0);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+	if (val.len < ENTRY_HSIZE) {
+		return KNOT_EMALF;
+	}
+
+	*serial_to = wire_read_u32(val.data);
+	*stored = wire_read_u32((uint8_t *)val.data + sizeof(uint32_t));
+
+	return KNOT_EOK;
+}
+
+/*! \brief Append the changeset to the zone changeset chain. */
+static int changeset_pack(namedb_txn_t *txn, const knot_dname_t *zone,
+                          journal_meta_t *meta, const changeset_t *chs,
+                          size_t size_limit)
 {
 	assert(chs != NULL);
-	assert(j != NULL);
 
-	uint64_t k = ixfrdb_key_make(knot_soa_serial(&chs->soa_from->rrs),
-	                             knot_soa_serial(&chs->soa_to->rrs));
+	uint32_t serial_from = knot_soa_serial(&chs->soa_from->rrs);
+	uint32_t serial_to = knot_soa_serial(&chs->soa_to->rrs);
 
 	/* Count the size of the entire changeset in serialized form. */
 	size_t entry_size = 0;
-
 	int ret = changeset_binary_size(chs, &entry_size);
 	assert(ret == KNOT_EOK);
+	if (ENTRY_HSIZE + entry_size > size_limit) {
+		return KNOT_ESPACE;
+	}
 
-	/* Reserve space for the journal entry. */
-	char *journal_entry = NULL;
-	ret = journal_map(j, k, &journal_entry, entry_size, false);
+	/* Start a new chain if the changeset doesn't follow the stored one.
+	 * Only a chain synced to the zone file may be dropped, otherwise the
+	 * zone must be flushed first. */
+	if (meta->count > 0 &&
+	    (serial_from != meta->last || entry_exists(txn, zone, serial_from))) {
+		if (meta->synced != meta->last) {
+			return KNOT_EBUSY;
+		}
+		dbg_journal("journal: discontinuity %u -> %u, dropping history\n",
+		            meta->last, serial_from);
+		ret = drop_chain(txn, zone, meta);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+	if (meta->count == 0) {
+		meta->first = serial_from;
+		meta->last = serial_from;
+		meta->synced = serial_from;
+		meta->size = 0;
+	}
+
+	/* Evict synced changesets until the new one fits. */
+	while (meta->count > 0 &&
+	       (meta->size + ENTRY_HSIZE + entry_size > size_limit ||
+	        meta->count >= JOURNAL_NCOUNT)) {
+		if (meta->first == meta->synced) {
+			return KNOT_EBUSY;
+		}
+		ret = evict_first(txn, zone, meta);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
+	ret = entry_write(txn, zone, chs, entry_size, time(NULL));
 	if (ret != KNOT_EOK) {
 		return ret;
 	}
 
-	assert(journal_entry != NULL);
+	meta->last = serial_to;
+	meta->count += 1;
+	meta->size += ENTRY_HSIZE + entry_size;
 
-	/* Serialize changeset, saving it bit by bit. */
-	ret = serialize_and_store_chgset(chs, journal_entry, entry_size);
-	/* Unmap the journal entry.
-	 * If successfuly written changeset to journal, validate the entry. */
-	int unmap_ret = journal_unmap(j, k, journal_entry, ret == KNOT_EOK);
-	if (ret == KNOT_EOK && unmap_ret != KNOT_EOK) {
-		ret = unmap_ret; /* Propagate the result. */
+	return KNOT_EOK;
+}
+
+/*! \brief Read and unpack the changeset starting with given serial. */
+static int load_changeset(namedb_txn_t *txn, const knot_dname_t *zone,
+                          uint32_t serial, uint32_t *serial_to, list_t *chgs)
+{
+	uint8_t buf[KEY_MAXLEN];
+	namedb_val_t key = make_key(buf, zone, &serial);
+	namedb_val_t val;
+
+	int ret = namedb_lmdb_api()->find(txn, &key, &val, 0);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+	if (val.len <= ENTRY_HSIZE) {
+		return KNOT_EMALF;
+	}
+
+	changeset_t *ch = changeset_new(zone);
+	if (ch == NULL) {
+		return KNOT_ENOMEM;
 	}
 
+	/* Unpack directly from the mapped entry, it's valid until the end
+	 * of the transaction. */
+	ch->data = (uint8_t *)val.data + ENTRY_HSIZE;
+	ch->size = val.len - ENTRY_HSIZE;
+	ret = changesets_unpack(ch);
+	ch->data = NULL;
+	ch->size = 0;
+
+	/* Insert into changeset list. */
+	add_tail(chgs, &ch->n);
+
+	*serial_to = wire_read_u32(val.data);
 	return ret;
 }
 
-/*! \brief Helper for iterating journal (this is temporary until #80) */
-typedef int (*journal_apply_t)(journal_t *, journal_node_t *, const zone_t *, list_t *);
-static int journal_walk(const char *fn, uint32_t from, uint32_t to,
-                        journal_apply_t cb, const zone_t *zone, list_t *chgs)
+/*! \brief Pending store of changesets of a single zone. */
+struct store_req {
+	node_t n;
+	const knot_dname_t *zone;
+	list_t *src;               /*!< Changesets to store, or */
+	const changeset_t *change; /*!< a single changeset. */
+	size_t size_limit;
+	int ret;
+	bool done;
+};
+
+struct journal_db {
+	namedb_t *db;
+	pthread_mutex_t lock;
+	pthread_cond_t done; /*!< Signalled when a batch is written. */
+	list_t queue;        /*!< Requests waiting for the next batch. */
+	bool writing;        /*!< A batch is being written. */
+	unsigned delay;      /*!< Batch gathering window in milliseconds. */
+};
+
+/*! \brief Write the request changesets into the transaction. */
+static int store_req_write(namedb_txn_t *txn, struct store_req *req)
 {
-	/* Open journal for reading. */
-	journal_t *journal = journal_open(fn, FSLIMIT_INF);
-	if (journal == NULL) {
-		return KNOT_ENOMEM;
+	size_t size_limit = req->size_limit;
+	if (size_limit == 0) {
+		size_limit = FSLIMIT_INF;
 	}
 
-	/* Read entries from starting serial until finished. */
-	uint32_t found_to = from;
-	journal_node_t *n = 0;
-	int ret = journal_fetch(journal, from, journal_key_from_cmp, &n);
+	journal_meta_t meta;
+	int ret = meta_read(txn, req->zone, &meta);
+	if (ret != KNOT_EOK && ret != KNOT_ENOENT) {
+		return ret;
+	}
+
+	/* Store all or nothing. */
+	if (req->src != NULL) {
+		changeset_t *chs = NULL;
+		WALK_LIST(chs, *req->src) {
+			ret = changeset_pack(txn, req->zone, &meta, chs, size_limit);
+			if (ret != KNOT_EOK) {
+				return ret;
+			}
+		}
+	} else {
+		ret = changeset_pack(txn, req->zone, &meta, req->change, size_limit);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
+	return meta_write(txn, req->zone, &meta);
+}
+
+/*! \brief Write the request in a transaction of its own. */
+static int store_req_single(namedb_t *db, struct store_req *req)
+{
+	const namedb_api_t *db_api = namedb_lmdb_api();
+
+	namedb_txn_t txn;
+	int ret = db_api->txn_begin(db, &txn, 0);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	ret = store_req_write(&txn, req);
 	if (ret != KNOT_EOK) {
-		goto finish;
+		db_api->txn_abort(&txn);
+		return ret;
 	}
 
-	size_t i = n - journal->nodes;
-	assert(i < journal->max_nodes);
+	return db_api->txn_commit(&txn);
+}
 
-	for (; i != journal->qtail; i = jnode_next(journal, i)) {
-		journal_node_t *n = journal->nodes + i;
+/*!
+ * \brief Write a batch of requests in a single durable transaction.
+ *
+ * Each request runs in a nested transaction, so a failed request doesn't
+ * affect the others. Without nested transactions (e.g. with a writable
+ * memory map) the requests are written one by one.
+ */
+static void write_batch(namedb_t *db, list_t *batch)
+{
+	const namedb_api_t *db_api = namedb_lmdb_api();
+	struct store_req *req = NULL;
 
-		/* Skip invalid nodes. */
-		if (!(n->flags & JOURNAL_VALID)) {
-			continue;
+	namedb_txn_t txn;
+	int ret = db_api->txn_begin(db, &txn, 0);
+	if (ret != KNOT_EOK) {
+		WALK_LIST(req, *batch) {
+			req->ret = ret;
 		}
+		return;
+	}
 
-		/* Check for history end. */
-		if (to == found_to) {
+	WALK_LIST(req, *batch) {
+		namedb_txn_t nested;
+		ret = namedb_lmdb_txn_begin_nested(&txn, &nested);
+		if (ret != KNOT_EOK) {
 			break;
 		}
 
-		/* Callback. */
-		ret = cb(journal, n, zone, chgs);
-		if (ret != KNOT_EOK) {
-			break;
+		req->ret = store_req_write(&nested, req);
+		if (req->ret == KNOT_EOK) {
+			req->ret = db_api->txn_commit(&nested);
+		} else {
+			db_api->txn_abort(&nested);
 		}
 	}
 
-finish:
-	/* Close journal. */
-	journal_close(journal);
-	return ret;
+	if (ret != KNOT_EOK) {
+		db_api->txn_abort(&txn);
+		WALK_LIST(req, *batch) {
+			req->ret = store_req_single(db, req);
+		}
+		return;
+	}
+
+	/* The only disk flush for the whole batch. */
+	ret = db_api->txn_commit(&txn);
+	if (ret != KNOT_EOK) {
+		WALK_LIST(req, *batch) {
+			if (req->ret == KNOT_EOK) {
+				req->ret = ret;
+			}
+		}
+	}
 }
 
-static int load_changeset(journal_t *journal, journal_node_t *n, const zone_t *zone, list_t *chgs)
+/*!
+ * \brief Store changesets using group commit.
+ *
+ * The request is queued, the first waiting thread becomes the writer and
+ * writes all queued requests at once. Every caller returns after the batch
+ * with its request is durable.
+ */
+static int store_grouped(journal_db_t *db, struct store_req *req)
 {
-	changeset_t *ch = changeset_new(zone->name);
-	if (ch == NULL) {
+	pthread_mutex_lock(&db->lock);
+	add_tail(&db->queue, &req->n);
+
+	while (!req->done) {
+		if (db->writing) {
+			pthread_cond_wait(&db->done, &db->lock);
+			continue;
+		}
+
+		/* Let other zones join the batch. */
+		db->writing = true;
+		if (db->delay > 0) {
+			pthread_mutex_unlock(&db->lock);
+			struct timespec delay = {
+				.tv_sec = db->delay / 1000,
+				.tv_nsec = (db->delay % 1000) * 1000000
+			};
+			nanosleep(&delay, NULL);
+			pthread_mutex_lock(&db->lock);
+		}
+
+		list_t batch;
+		init_list(&batch);
+		add_tail_list(&batch, &db->queue);
+		init_list(&db->queue);
+		pthread_mutex_unlock(&db->lock);
+
+		write_batch(db->db, &batch);
+
+		/* Waiting requests are released after the lock is dropped. */
+		pthread_mutex_lock(&db->lock);
+		struct store_req *done = NULL;
+		WALK_LIST(done, batch) {
+			done->done = true;
+		}
+		db->writing = false;
+		pthread_cond_broadcast(&db->done);
+	}
+
+	pthread_mutex_unlock(&db->lock);
+	return req->ret;
+}
+
+int journal_db_open(const char *storage, size_t mapsize, journal_db_t **db)
+{
+	if (storage == NULL || db == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	journal_db_t *jdb = malloc(sizeof(journal_db_t));
+	if (jdb == NULL) {
 		return KNOT_ENOMEM;
 	}
+	memset(jdb, 0, sizeof(journal_db_t));
 
-	/* Initialize changeset. */
-	ch->data = malloc(n->len);
-	if (!ch->data) {
+	struct namedb_lmdb_opts opts = NAMEDB_LMDB_OPTS_INITIALIZER;
+	opts.mapsize = mapsize;
+	opts.path = sprintf_alloc("%s/journal", storage);
+	if (opts.path == NULL) {
+		free(jdb);
 		return KNOT_ENOMEM;
 	}
 
-	/* Read journal entry. */
-	int ret = journal_read_node(journal, n, (char*)ch->data);
+	int ret = namedb_lmdb_api()->init(&jdb->db, NULL, &opts);
+	free((char *)opts.path);
 	if (ret != KNOT_EOK) {
+		free(jdb);
 		return ret;
 	}
 
-	/* Update changeset binary size. */
-	ch->size = n->len;
-
-	/* Insert into changeset list. */
-	add_tail(chgs, &ch->n);
+	pthread_mutex_init(&jdb->lock, NULL);
+	pthread_cond_init(&jdb->done, NULL);
+	init_list(&jdb->queue);
 
+	*db = jdb;
 	return KNOT_EOK;
 }
 
-int journal_load_changesets(const char *path, const zone_t *zone, list_t *dst,
-                            uint32_t from, uint32_t to)
+void journal_db_close(journal_db_t *db)
+{
+	if (db == NULL) {
+		return;
+	}
+
+	namedb_lmdb_api()->deinit(db->db);
+	pthread_cond_destroy(&db->done);
+	pthread_mutex_destroy(&db->lock);
+	free(db);
+}
+
+void journal_db_set_delay(journal_db_t *db, unsigned delay)
 {
-	int ret = journal_walk(path, from, to, &load_changeset, zone, dst);
+	if (db == NULL) {
+		return;
+	}
+
+	pthread_mutex_lock(&db->lock);
+	db->delay = delay;
+	pthread_mutex_unlock(&db->lock);
+}
+
+bool journal_exists(journal_db_t *db, const knot_dname_t *zone)
+{
+	if (db == NULL || zone == NULL) {
+		return false;
+	}
+
+	const namedb_api_t *db_api = namedb_lmdb_api();
+
+	namedb_txn_t txn;
+	if (db_api->txn_begin(db->db, &txn, NAMEDB_RDONLY) != KNOT_EOK) {
+		return false;
+	}
+
+	journal_meta_t meta;
+	int ret = meta_read(&txn, zone, &meta);
+	db_api->txn_abort(&txn);
+
+	return ret == KNOT_EOK;
+}
+
+int journal_load_changesets(journal_db_t *db, const knot_dname_t *zone,
+                            list_t *dst, uint32_t from, uint32_t to)
+{
+	if (zone == NULL || dst == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	/* No journal, no history. */
+	if (db == NULL) {
+		return KNOT_ENOENT;
+	}
+
+	const namedb_api_t *db_api = namedb_lmdb_api();
+
+	namedb_txn_t txn;
+	int ret = db_api->txn_begin(db->db, &txn, NAMEDB_RDONLY);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+	journal_meta_t meta;
+	ret = meta_read(&txn, zone, &meta);
 	if (ret != KNOT_EOK) {
+		db_api->txn_abort(&txn);
 		return ret;
 	}
 
-	/* Unpack binary data. */
-	assert(dst != NULL);
-	/*
-	 * Parses changesets from the binary format stored in chgsets->data
-	 * into the changeset_t structures.
-	 */
-	changeset_t* chs = NULL;
-	WALK_LIST(chs, *dst) {
-		ret = changesets_unpack(chs);
+	/* Follow the chain until the end serial, the count bounds
+	 * the walk in case the serials wrapped around. */
+	uint32_t found_to = from;
+	for (uint32_t i = 0; i < meta.count && found_to != to; ++i) {
+		ret = load_changeset(&txn, zone, found_to, &found_to, dst);
 		if (ret != KNOT_EOK) {
-			return ret;
+			break;
 		}
 	}
+	db_api->txn_abort(&txn);
+
+	/* Absence of further entries only ends the history. */
+	if (ret != KNOT_EOK && (ret != KNOT_ENOENT || EMPTY_LIST(*dst))) {
+		return ret;
+	}
+
+	if (EMPTY_LIST(*dst)) {
+		return KNOT_ENOENT;
+	}
 
 	/* Check for complete history. */
-	changeset_t *last = TAIL(*dst);
-	if (to != knot_soa_serial(&last->soa_to->rrs)) {
+	if (to != found_to) {
 		return KNOT_ERANGE;
 	}
 
 	return KNOT_EOK;
 }
 
-int journal_store_changesets(list_t *src, const char *path, size_t size_limit)
+int journal_store_changesets(journal_db_t *db, const knot_dname_t *zone,
+                             list_t *src, size_t size_limit)
 {
-	if (src == NULL || path == NULL) {
+	if (db == NULL || zone == NULL || src == NULL) {
 		return KNOT_EINVAL;
 	}
 
-	/* Open journal for reading. */
-	int ret = KNOT_EOK;
-	journal_t *journal = journal_open(path, size_limit);
-	if (journal == NULL) {
-		return KNOT_ENOMEM;
-	}
+	struct store_req req = {
+		.zone = zone,
+		.src = src,
+		.size_limit = size_limit
+	};
 
-	/* Begin writing to journal. */
-	changeset_t *chs = NULL;
-	WALK_LIST(chs, *src) {
-		ret = changeset_pack(chs, journal);
-		if (ret != KNOT_EOK) {
-			break;
-		}
+	return store_grouped(db, &req);
+}
+
+int journal_store_changeset(journal_db_t *db, const knot_dname_t *zone,
+                            changeset_t *change, size_t size_limit)
+{
+	if (db == NULL || zone == NULL || change == NULL) {
+		return KNOT_EINVAL;
 	}
 
-	journal_close(journal);
-	return ret;
+	struct store_req req = {
+		.zone = zone,
+		.change = change,
+		.size_limit = size_limit
+	};
+
+	return store_grouped(db, &req);
 }
 
-int journal_store_changeset(changeset_t *change, const char *path, size_t size_limit)
+int journal_mark_synced(journal_db_t *db, const knot_dname_t *zone)
 {
-	if (change == NULL || path == NULL) {
+	if (db == NULL || zone == NULL) {
 		return KNOT_EINVAL;
 	}
 
-	/* Open journal for reading. */
-	journal_t *journal = journal_open(path, size_limit);
-	if (journal == NULL) {
-		return KNOT_ENOMEM;
+	const namedb_api_t *db_api = namedb_lmdb_api();
+
+	namedb_txn_t txn;
+	int ret = db_api->txn_begin(db->db, &txn, 0);
+	if (ret != KNOT_EOK) {
+		return ret;
 	}
 
-	int ret = changeset_pack(change, journal);
+	journal_meta_t meta;
+	ret = meta_read(&txn, zone, &meta);
+	if (ret != KNOT_EOK) {
+		db_api->txn_abort(&txn);
+		return (ret == KNOT_ENOENT) ? KNOT_EOK : ret;
+	}
 
-	journal_close(journal);
-	return ret;
+	meta.synced = meta.last;
+	ret = meta_write(&txn, zone, &meta);
+	if (ret != KNOT_EOK) {
+		db_api->txn_abort(&txn);
+		return ret;
+	}
+
+	return db_api->txn_commit(&txn);
 }
 
-static void mark_synced(journal_t *journal, journal_node_t *node)
+int journal_compact(journal_db_t *db, const knot_dname_t *zone, uint32_t age,
+                    size_t *merged)
 {
-	/* Check for dirty bit (not synced to permanent storage). */
-	if (node->flags & JOURNAL_DIRTY) {
-		/* Remove dirty bit. */
-		node->flags = node->flags & ~JOURNAL_DIRTY;
-		journal_update(journal, node);
+	if (db == NULL || zone == NULL || merged == NULL) {
+		return KNOT_EINVAL;
 	}
-}
 
-int journal_mark_synced(const char *path)
-{
-	if (!journal_exists(path)) {
+	*merged = 0;
+
+	const namedb_api_t *db_api = namedb_lmdb_api();
+
+	namedb_txn_t txn;
+	int ret = db_api->txn_begin(db->db, &txn, 0);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	journal_meta_t meta;
+	ret = meta_read(&txn, zone, &meta);
+	if (ret != KNOT_EOK) {
+		db_api->txn_abort(&txn);
+		return (ret == KNOT_ENOENT) ? KNOT_EOK : ret;
+	}
+
+	/* Count the old changesets, dirty changesets are kept intact so that
+	 * the zone file serial still starts a changeset. */
+	uint64_t now = time(NULL);
+	uint32_t serial = meta.first;
+	uint32_t newest = 0;
+	uint32_t count = 0;
+	while (count < meta.count && serial != meta.synced) {
+		uint32_t serial_to = 0, stored = 0;
+		ret = entry_header(&txn, zone, serial, &serial_to, &stored);
+		if (ret != KNOT_EOK) {
+			db_api->txn_abort(&txn);
+			return ret;
+		}
+		if ((uint64_t)stored + age > now) {
+			break;
+		}
+		newest = stored;
+		serial = serial_to;
+		count += 1;
+	}
+
+	if (count < 2) {
+		db_api->txn_abort(&txn);
 		return KNOT_EOK;
 	}
 
-	journal_t *journal = journal_open(path, FSLIMIT_INF);
-	if (journal == NULL) {
-		return KNOT_ENOMEM;
+	/* Merge the changesets into the oldest one. */
+	list_t chgs;
+	init_list(&chgs);
+	serial = meta.first;
+	for (uint32_t i = 0; i < count && ret == KNOT_EOK; ++i) {
+		ret = load_changeset(&txn, zone, serial, &serial, &chgs);
 	}
 
-	size_t i = journal->qhead;
-	for(; i != journal->qtail; i = jnode_next(journal, i)) {
-		mark_synced(journal, journal->nodes + i);
+	changeset_t *first = HEAD(chgs);
+	changeset_t *chs = NULL;
+	WALK_LIST(chs, chgs) {
+		if (ret != KNOT_EOK) {
+			break;
+		}
+		if (chs != first) {
+			ret = changeset_merge(first, chs);
+		}
 	}
 
-	journal_close(journal);
+	/* Replace the merged changesets with the result. */
+	serial = meta.first;
+	for (uint32_t i = 0; i < count && ret == KNOT_EOK; ++i) {
+		size_t size = 0;
+		ret = entry_remove(&txn, zone, serial, &serial, &size);
+		meta.size -= size;
+	}
 
-	return KNOT_EOK;
+	size_t entry_size = 0;
+	if (ret == KNOT_EOK) {
+		ret = changeset_binary_size(first, &entry_size);
+	}
+	if (ret == KNOT_EOK) {
+		ret = entry_write(&txn, zone, first, entry_size, newest);
+	}
+	changesets_free(&chgs);
+	if (ret != KNOT_EOK) {
+		db_api->txn_abort(&txn);
+		return ret;
+	}
+
+	dbg_journal("journal: compacted %u changesets %u -> %u, size=%zu\n",
+	            count, meta.first, serial, ENTRY_HSIZE + entry_size);
+
+	meta.count -= count - 1;
+	meta.size += ENTRY_HSIZE + entry_size;
+	ret = meta_write(&txn, zone, &meta);
+	if (ret != KNOT_EOK) {
+		db_api->txn_abort(&txn);
+		return ret;
+	}
+
+	ret = db_api->txn_commit(&txn);
+	if (ret == KNOT_EOK) {
+		*merged = count;
+	}
+
+	return ret;
 }
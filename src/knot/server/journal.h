@@ -18,22 +18,32 @@
  *
  * \author Marek Vavrusa <marek.vavrusa@nic.cz>
  *
- * \brief Journal for storing transactions on permanent storage.
+ * \brief Journal for storing changesets on permanent storage.
  *
- * Journal stores entries on a permanent storage.
- * Each written entry is guaranteed to persist until
- * the maximum file size or node count is reached.
- * Entries are removed from the least recent.
+ * Changesets of all zones are stored in a single server-wide database.
+ * Each zone keeps a continuous chain of changesets, every changeset is
+ * stored under the zone name and its starting serial, the chain is followed
+ * using the ending serials. A small record under the plain zone name holds
+ * the chain boundaries and the point up to which the zone file is synced.
  *
- * Journal file structure
+ * Database layout
  * <pre>
- *  uint16_t node_count
- *  uint16_t node_queue_head
- *  uint16_t node_queue_tail
- *  journal_entry_t free_segment
- *  node_count *journal_entry_t
- *  ...data...
+ *  zone name                -> first serial, last serial, synced serial,
+ *                              entry count, total size
+ *  zone name, serial from   -> serial to, time of store, serialized changeset
  * </pre>
+ *
+ * Each store is atomic, either all the given changesets are stored or none.
+ * Stores of different zones arriving at the same time are grouped into
+ * a single write transaction, so they share one disk flush (group commit).
+ * Readers do not block writers.
+ *
+ * Entries are removed from the least recent, entries not yet synced to
+ * the zone file are never removed. Old synced entries may be compacted,
+ * i.e. replaced with a single entry with the same effect. A changeset
+ * which doesn't continue the stored chain replaces the whole chain, which
+ * must be synced as well.
+ *
  * \addtogroup utils
  * @{
  */
@@ -41,167 +51,146 @@
 #pragma once
 
 #include <stdint.h>
-#include <fcntl.h>
-#include <pthread.h>
 #include <stdbool.h>
 #include "knot/updates/changesets.h"
-#include "knot/zone/zone.h"
 
-/*!
- * \brief Journal entry flags.
+/*
+ * Journal defaults and constants.
  */
-typedef enum journal_flag_t {
-	JOURNAL_NULL  = 0 << 0, /*!< Invalid journal entry. */
-	JOURNAL_FREE  = 1 << 0, /*!< Free journal entry. */
-	JOURNAL_VALID = 1 << 1, /*!< Valid journal entry. */
-	JOURNAL_DIRTY = 1 << 2  /*!< Journal entry cannot be evicted. */
-} journal_flag_t;
+#define JOURNAL_NCOUNT 1024 /*!< Maximum number of changesets per zone. */
+#define JOURNAL_DB_MIN_SIZE (1024 * 1024) /*!< Minimum database size. */
+/*! \brief Default database size, limited by the address space. */
+#define JOURNAL_DB_SIZE (sizeof(void *) > 4 ? (INT64_C(20) << 30) : (INT64_C(512) << 20))
 
-/*!
- * \brief Journal node structure.
- *
- * Each node represents journal entry and points
- * to position of the data in the permanent storage.
- */
-typedef struct journal_node
-{
-	uint64_t id;    /*!< Node ID. */
-	uint16_t flags; /*!< Node flags. */
-	uint16_t next;  /*!< UNUSED */
-	uint32_t pos;   /*!< Position in journal file. */
-	uint32_t len;   /*!< Entry data length. */
-} journal_node_t;
+struct journal_db;
+typedef struct journal_db journal_db_t;
 
 /*!
- * \brief Journal structure.
+ * \brief Open journal database. Required for all other operations.
  *
- * Journal organizes entries as nodes.
- * Nodes are stored in-memory for fast lookup and also
- * backed by a permanent storage.
- * Each journal has a fixed number of nodes.
+ * \param[in]  storage  Path to storage directory.
+ * \param[in]  mapsize  Maximum size of the database.
+ * \param[out] db       Opened database.
  *
+ * \retval KNOT_EOK on success.
+ * \return < KNOT_EOK on error.
  */
-typedef struct journal
-{
-	int fd;
-	char *path;             /*!< Path to journal file. */
-	uint16_t tmark;         /*!< Transaction start mark. */
-	uint16_t max_nodes;     /*!< Number of nodes. */
-	uint16_t qhead;         /*!< Node queue head. */
-	uint16_t qtail;         /*!< Node queue tail. */
-	uint16_t bflags;        /*!< Initial flags for each written node. */
-	size_t fsize;           /*!< Journal file size. */
-	size_t fslimit;         /*!< File size limit. */
-	journal_node_t free;    /*!< Free segment. */
-	journal_node_t *nodes;  /*!< Array of nodes. */
-} journal_t;
-
-/*
- * Journal defaults and constants.
- */
-#define JOURNAL_NCOUNT 1024 /*!< Default node count. */
-#define JOURNAL_MAGIC {'k', 'n', 'o', 't', '1', '5', '2'}
-#define MAGIC_LENGTH 7
-/* HEADER = magic, crc, max_entries, qhead, qtail */
-#define JOURNAL_HSIZE (MAGIC_LENGTH + sizeof(uint32_t) + sizeof(uint16_t) * 3)
+int journal_db_open(const char *storage, size_t mapsize, journal_db_t **db);
 
 /*!
- * \brief Open journal.
+ * \brief Close journal database.
  *
- * \param path Journal file name.
- * \param fslimit File size limit (0 for no limit).
- *
- * \retval new journal instance if successful.
- * \retval NULL on error.
+ * \param db  Journal database.
  */
-journal_t* journal_open(const char *path, size_t fslimit);
+void journal_db_close(journal_db_t *db);
 
 /*!
- * \brief Map journal entry for read/write.
- *
- * \warning New nodes shouldn't be created until the entry is unmapped.
+ * \brief Set the group commit window.
  *
- * \param journal Associated journal.
- * \param id Entry identifier.
- * \param dst Will contain mapped memory.
- * \param rdonly If read only.
+ * A store waits for the given time before writing, so that stores of other
+ * zones may join its transaction.
  *
- * \retval KNOT_EOK if successful.
- * \retval KNOT_ESPACE if entry too big.
- * \retval KNOT_ERROR on I/O error.
+ * \param db     Journal database.
+ * \param delay  Window in milliseconds, 0 to write immediately.
  */
-int journal_map(journal_t *journal, uint64_t id, char **dst, size_t size, bool rdonly);
+void journal_db_set_delay(journal_db_t *db, unsigned delay);
 
 /*!
- * \brief Finalize mapped journal entry.
+ * \brief Check if the zone has a journal.
  *
- * \param journal Associated journal.
- * \param id Entry identifier.
- * \param ptr Mapped memory.
- * \param finalize Set to true to finalize node or False to discard it.
+ * \param db    Journal database.
+ * \param zone  Zone name.
  *
- * \retval KNOT_EOK if successful.
- * \retval KNOT_ENOENT if the entry cannot be found.
- * \retval KNOT_ERROR on I/O error.
+ * \return true or false
  */
-int journal_unmap(journal_t *journal, uint64_t id, void *ptr, int finalize);
+bool journal_exists(journal_db_t *db, const knot_dname_t *zone);
 
 /*!
- * \brief Close journal file.
+ * \brief Load changesets from journal.
  *
- * \param journal Associated journal.
+ * \param db    Journal database.
+ * \param zone  Zone name.
+ * \param dst   Store changesets here.
+ * \param from  Start serial.
+ * \param to    End serial.
  *
  * \retval KNOT_EOK on success.
- * \retval KNOT_EINVAL on invalid parameter.
+ * \retval KNOT_ENOENT if there is no entry starting with the given serial.
+ * \retval KNOT_ERANGE if the history ends before the end serial.
+ * \return < KNOT_EOK on error.
  */
-int journal_close(journal_t *journal);
+int journal_load_changesets(journal_db_t *db, const knot_dname_t *zone,
+                            list_t *dst, uint32_t from, uint32_t to);
 
 /*!
- * \brief Check if the journal file is used or not.
+ * \brief Store changesets in journal.
  *
- * \param path Journal file.
+ * \param db          Journal database.
+ * \param zone        Zone name.
+ * \param src         Changesets to store.
+ * \param size_limit  Zone journal size limit extracted from configuration.
  *
- * \return true or false
+ * The call returns after the changesets are durably stored. If a changeset
+ * doesn't continue the stored history, the history is dropped.
+ *
+ * \retval KNOT_EOK on success.
+ * \retval KNOT_EBUSY when journal is full and cannot be shrunk, or when
+ *                    the history to be dropped isn't synced to the zone file.
+ * \retval KNOT_ESPACE when the changesets cannot fit the journal.
+ * \return < KNOT_EOK on other errors.
  */
-bool journal_exists(const char *path);
+int journal_store_changesets(journal_db_t *db, const knot_dname_t *zone,
+                             list_t *src, size_t size_limit);
 
 /*!
- * \brief Load changesets from journal.
+ * \brief Store a single changeset in journal.
  *
- * \param path Path to journal file.
- * \param zone Corresponding zone.
- * \param dst Store changesets here.
- * \param from Start serial.
- * \param to End serial.
+ * Same as journal_store_changesets() with a list of one changeset.
+ *
+ * \param db          Journal database.
+ * \param zone        Zone name.
+ * \param change      Changeset to store.
+ * \param size_limit  Zone journal size limit extracted from configuration.
  *
  * \retval KNOT_EOK on success.
- * \retval KNOT_ERANGE if given entry was not found.
- * \return < KNOT_EOK on error.
+ * \retval KNOT_EBUSY when journal is full and cannot be shrunk, or when
+ *                    the history to be dropped isn't synced to the zone file.
+ * \retval KNOT_ESPACE when the changeset cannot fit the journal.
+ * \return < KNOT_EOK on other errors.
  */
-int journal_load_changesets(const char *path, const struct zone *zone, list_t *dst,
-                            uint32_t from, uint32_t to);
+int journal_store_changeset(journal_db_t *db, const knot_dname_t *zone,
+                            changeset_t *change, size_t size_limit);
 
 /*!
- * \brief Store changesets in journal.
+ * \brief Mark all stored changesets as synced to the zone file.
+ *
+ * Synced changesets may be removed when the journal is full.
  *
- * \param src Changesets to store.
- * \param path Path to journal file.
- * \param size_limit Size limit extracted from configuration.
+ * \param db    Journal database.
+ * \param zone  Zone name.
  *
  * \retval KNOT_EOK on success.
- * \retval KNOT_EBUSY when journal is full.
- * \return < KNOT_EOK on other errors.
+ * \return < KNOT_EOK on error.
  */
-int journal_store_changesets(list_t *src, const char *path, size_t size_limit);
-int journal_store_changeset(changeset_t *change, const char *path, size_t size_limit);
+int journal_mark_synced(journal_db_t *db, const knot_dname_t *zone);
 
-/*! \brief Function for unmarking dirty nodes. */
 /*!
- * \brief Function for unmarking dirty nodes.
- * \param path Path to journal file.
- * \retval KNOT_ENOMEM if journal could not be opened.
+ * \brief Merge old changesets into a single one.
+ *
+ * Consecutive changesets from the oldest one, stored at least \a age
+ * seconds ago and already synced to the zone file, are replaced with one
+ * changeset. Changes cancelling each other are dropped. History starting
+ * in the middle of the merged changesets is lost.
+ *
+ * \param db      Journal database.
+ * \param zone    Zone name.
+ * \param age     Minimal age of the merged changesets in seconds.
+ * \param merged  Number of the merged changesets, 0 if none.
+ *
  * \retval KNOT_EOK on success.
+ * \return < KNOT_EOK on error.
  */
-int journal_mark_synced(const char *path);
+int journal_compact(journal_db_t *db, const knot_dname_t *zone, uint32_t age,
+                    size_t *merged);
 
 /*! @} */
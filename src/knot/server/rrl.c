@@ -14,6 +14,7 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <sched.h>
 #include <time.h>
 #include <unistd.h>
 #include <sys/types.h>
@@ -27,8 +28,10 @@
 #include "libknot/libknot.h"
 #include "libknot/internal/trie/murmurhash3.h"
 
-/* Hopscotch defines. */
-#define HOP_LEN (sizeof(unsigned)*8)
+/* Lookup window and claim retries. */
+#define RRL_PROBE_LEN 16
+#define RRL_PROBE_RETRIES 4
+#define RRL_KEY_BUSY UINT64_MAX /* Bucket claimed, key not published yet. */
 /* Limits */
 #define RRL_CLSBLK_MAXLEN (4 + 8 + 1 + 256)
 /* CIDR block prefix lengths for v4/v6 */
@@ -200,88 +203,100 @@ static int rrl_classify(char *dst, size_t maxlen, const struct sockaddr_storage
 
 	/* Seed. */
 	if (blklen + sizeof(seed) > maxlen) return KNOT_ESPACE;
-	if (memcpy(dst + blklen, (void*)&seed, sizeof(seed)) == 0) {
-		blklen += sizeof(seed);
-	}
+	memcpy(dst + blklen, (void*)&seed, sizeof(seed));
+	blklen += sizeof(seed);
 
 	return blklen;
 }
 
-static int bucket_free(rrl_item_t *b, uint32_t now) {
-	return b->cls == CLS_NULL || (b->time + 1 < now);
-}
+/* Bucket state packing. */
+#define STATE_TIME(s)   ((uint32_t)((s) >> 32))
+#define STATE_NTOK(s)   ((uint16_t)((s) >> 16))
+#define STATE_FLAGS(s)  ((uint8_t)((s) >> 8))
+#define STATE(time, ntok, flags) \
+	(((uint64_t)(time) << 32) | ((uint64_t)(ntok) << 16) | ((uint64_t)(flags) << 8))
 
-static int bucket_match(rrl_item_t *b, rrl_item_t *m)
+static inline uint64_t load64(const uint64_t *ptr)
 {
-	return b->cls    == m->cls &&
-	       b->netblk == m->netblk &&
-	       b->qname  == m->qname;
+	return __sync_fetch_and_add((uint64_t *)ptr, 0);
 }
 
-static int find_free(rrl_table_t *t, unsigned i, uint32_t now)
+static inline bool cas64(uint64_t *ptr, uint64_t old, uint64_t new)
 {
-	rrl_item_t *np = t->arr + t->size;
-	rrl_item_t *b = NULL;
-	for (b = t->arr + i; b != np; ++b) {
-		if (bucket_free(b, now)) {
-			return b - (t->arr + i);
-		}
-	}
-	np = t->arr + i;
-	for (b = t->arr; b != np; ++b) {
-		if (bucket_free(b, now)) {
-			return (b - t->arr) + (t->size - i);
-		}
-	}
+	return __sync_bool_compare_and_swap(ptr, old, new);
+}
 
-	/* this happens if table is full... force vacate current elm */
-	dbg_rrl("%s: out of free buckets, freeing bucket %u\n", __func__, i);
-	return i;
+static inline bool bucket_free(uint64_t key, uint64_t state, uint32_t now)
+{
+	return key == 0 || (key != RRL_KEY_BUSY && STATE_TIME(state) + 1 < now);
 }
 
-static inline unsigned find_match(rrl_table_t *t, uint32_t id, rrl_item_t *m)
+/*!
+ * \brief Claim the bucket and publish its key after the initial state.
+ *
+ * The key is replaced with a sentinel first, so that no thread matches the
+ * bucket until its state is reinitialized.
+ */
+static bool bucket_claim(rrl_item_t *b, uint64_t old_key, uint64_t key,
+                         uint64_t init)
 {
-	unsigned f = 0;
-	unsigned d = 0;
-	unsigned match = t->arr[id].hop;
-	while (match != 0) {
-		d = __builtin_ctz(match);
-		f = (id + d) % t->size;
-		if (bucket_match(t->arr + f, m)) {
-			return d;
-		} else {
-			match &= ~(1<<d); /* clear potential match */
-		}
+	if (old_key == RRL_KEY_BUSY || !cas64(&b->key, old_key, RRL_KEY_BUSY)) {
+		return false;
 	}
 
-	return HOP_LEN + 1;
+	__sync_lock_test_and_set(&b->state, init);
+
+	/* Fails only if the table was reseeded meanwhile. */
+	return cas64(&b->key, RRL_KEY_BUSY, key);
 }
 
-static inline unsigned reduce_dist(rrl_table_t *t, unsigned id, unsigned d, unsigned *f)
+/*!
+ * \brief Find matching bucket or claim a free one in <id, id + RRL_PROBE_LEN).
+ *
+ * \return Bucket or NULL if the window is full.
+ */
+static rrl_item_t *find_bucket(rrl_table_t *t, uint32_t id, uint64_t key,
+                               uint64_t init, uint32_t now)
 {
-	unsigned rd = HOP_LEN - 1;
-	while (rd > 0) {
-		unsigned s = (t->size + *f - rd) % t->size; /* bucket to be vacated */
-		unsigned o = __builtin_ctz(t->arr[s].hop); /* offset of first valid bucket */
-		if (t->arr[s].hop != 0 && o < rd) {        /* only offsets in <s, f> are interesting */
-			unsigned e = (s + o) % t->size;    /* this item will be displaced to [f] */
-			unsigned keep_hop = t->arr[*f].hop; /* unpredictable padding */
-			memcpy(t->arr + *f, t->arr + e, sizeof(rrl_item_t));
-			t->arr[*f].hop = keep_hop;
-			t->arr[e].cls = CLS_NULL;
-			t->arr[s].hop &= ~(1<<o);
-			t->arr[s].hop |= 1<<rd;
-			*f = e;
-			return d - (rd - o);
+	unsigned retry = 0;
+	while (retry < RRL_PROBE_RETRIES) {
+		rrl_item_t *free_b = NULL;
+		uint64_t free_key = 0;
+		bool busy = false;
+		for (unsigned d = 0; d < RRL_PROBE_LEN; ++d) {
+			rrl_item_t *b = t->arr + (id + d) % t->size;
+			uint64_t b_key = load64(&b->key);
+			if (b_key == key) {
+				return b;
+			}
+			if (b_key == RRL_KEY_BUSY) {
+				busy = true;
+			} else if (free_b == NULL &&
+			           bucket_free(b_key, load64(&b->state), now)) {
+				free_b = b;
+				free_key = b_key;
+			}
 		}
-		--rd;
+
+		/* The key being published may be ours, wait for it. */
+		if (busy) {
+			sched_yield();
+			continue;
+		}
+
+		if (free_b == NULL) {
+			return NULL;
+		}
+
+		/* Claim the bucket, rescan if another thread was faster. */
+		if (bucket_claim(free_b, free_key, key, init)) {
+			return free_b;
+		}
+		++retry;
 	}
 
-	assert(rd == 0); /* this happens with p=1/fact(HOP_LEN) */
-	*f = id;
-	d = 0; /* force vacate initial element */
-	dbg_rrl("%s: no potential relocation, freeing bucket %u\n", __func__, id);
-	return d;
+	dbg_rrl("%s: contention on bucket %u\n", __func__, id);
+	return NULL;
 }
 
 static void rrl_log_state(const struct sockaddr_storage *ss, uint16_t flags, uint8_t cls)
@@ -330,44 +345,8 @@ uint32_t rrl_rate(rrl_table_t *rrl)
 	return rrl->rate;
 }
 
-int rrl_setlocks(rrl_table_t *rrl, unsigned granularity)
-{
-	if (!rrl) return KNOT_EINVAL;
-	assert(!rrl->lk); /* Cannot change while locks are used. */
-	assert(granularity <= rrl->size / 10); /* Due to int. division err. */
-
-	if (pthread_mutex_init(&rrl->ll, NULL) < 0) {
-		return KNOT_ENOMEM;
-	}
-
-	/* Alloc new locks. */
-	rrl->lk = malloc(granularity * sizeof(pthread_mutex_t));
-	if (!rrl->lk) return KNOT_ENOMEM;
-	memset(rrl->lk, 0, granularity * sizeof(pthread_mutex_t));
-
-	/* Initialize. */
-	for (size_t i = 0; i < granularity; ++i) {
-		if (pthread_mutex_init(rrl->lk + i, NULL) < 0) break;
-		++rrl->lk_count;
-	}
-
-	/* Incomplete initialization */
-	if (rrl->lk_count != granularity) {
-		for (size_t i = 0; i < rrl->lk_count; ++i) {
-			pthread_mutex_destroy(rrl->lk + i);
-		}
-		free(rrl->lk);
-		rrl->lk_count = 0;
-		dbg_rrl("%s: failed to init locks\n", __func__);
-		return KNOT_ERROR;
-	}
-
-	dbg_rrl("%s: set granularity to '%u'\n", __func__, granularity);
-	return KNOT_EOK;
-}
-
 rrl_item_t* rrl_hash(rrl_table_t *t, const struct sockaddr_storage *a, rrl_req_t *p,
-                     const zone_t *zone, uint32_t stamp, int *lock)
+                     const zone_t *zone, uint32_t stamp)
 {
 	char buf[RRL_CLSBLK_MAXLEN];
 	int len = rrl_classify(buf, sizeof(buf), a, p, zone, t->seed);
@@ -375,57 +354,30 @@ rrl_item_t* rrl_hash(rrl_table_t *t, const struct sockaddr_storage *a, rrl_req_t
 		return NULL;
 	}
 
+	/* Key extends the bucket position with a hash using different seed. */
 	uint32_t id = hash(buf, len) % t->size;
-
-	/* Lock for lookup. */
-	pthread_mutex_lock(&t->ll);
-
-	/* Find an exact match in <id, id + HOP_LEN). */
-	uint16_t *qname = (uint16_t*)(buf + sizeof(uint8_t) + sizeof(uint64_t));
-	rrl_item_t match = {
-	        0, *((uint64_t*)(buf + 1)), t->rate,    /* hop, netblk, ntok */
-	        buf[0], RRL_BF_NULL,                    /* cls, flags */
-	        hash((char*)(qname + 1), *qname), stamp /* qname, time*/
-	};
-
-	unsigned d = find_match(t, id, &match);
-	if (d > HOP_LEN) { /* not an exact match, find free element [f] */
-		d = find_free(t, id, stamp);
+	uint32_t seed = ~t->seed;
+	memcpy(buf + len - sizeof(seed), &seed, sizeof(seed));
+	uint64_t key = ((uint64_t)id << 32) | hash(buf, len);
+	if (key == 0 || key == RRL_KEY_BUSY) {
+		key = 1;
 	}
 
-	/* Reduce distance to fit <id, id + HOP_LEN) */
-	unsigned f = (id + d) % t->size;
-	while (d >= HOP_LEN) {
-		d = reduce_dist(t, id, d, &f);
+	uint64_t init = STATE(stamp, t->rate, RRL_BF_NULL);
+	rrl_item_t *b = find_bucket(t, id, key, init, stamp);
+	if (b != NULL) {
+		dbg_rrl("%s: classified pkt as '%u' bucket=%p\n", __func__, id, b);
+		return b;
 	}
 
-	/* Assign granular lock and unlock lookup. */
-	*lock = f % t->lk_count;
-	rrl_lock(t, *lock);
-	pthread_mutex_unlock(&t->ll);
-
-	/* found free elm 'k' which is in <id, id + HOP_LEN) */
-	t->arr[id].hop |= (1 << d);
-	rrl_item_t* b = t->arr + f;
-	assert(f == (id+d) % t->size);
-	dbg_rrl("%s: classified pkt as %4x '%u+%u' bucket=%p \n", __func__, f, id, d, b);
-
-	/* Inspect bucket state. */
-	unsigned hop = b->hop;
-	if (b->cls == CLS_NULL) {
-		memcpy(b, &match, sizeof(rrl_item_t));
-		b->hop = hop;
-	}
-	/* Check for collisions. */
-	if (!bucket_match(b, &match)) {
-		dbg_rrl("%s: collision in bucket '%4x'\n", __func__, id);
-		if (!(b->flags & RRL_BF_SSTART)) {
-			memcpy(b, &match, sizeof(rrl_item_t));
-			b->hop = hop;
-			b->ntok = t->rate + t->rate / RRL_SSTART;
-			b->flags |= RRL_BF_SSTART;
-			dbg_rrl("%s: bucket '%4x' slow-start\n", __func__, id);
-		}
+	/* Collision, reset the home bucket into slow-start if not already. */
+	b = t->arr + id;
+	dbg_rrl("%s: collision in bucket '%4x'\n", __func__, id);
+	uint64_t b_key = load64(&b->key);
+	uint16_t ntok = t->rate + t->rate / RRL_SSTART;
+	if (!(STATE_FLAGS(load64(&b->state)) & RRL_BF_SSTART) &&
+	    bucket_claim(b, b_key, key, STATE(stamp, ntok, RRL_BF_SSTART))) {
+		dbg_rrl("%s: bucket '%4x' slow-start\n", __func__, id);
 	}
 
 	return b;
@@ -433,64 +385,79 @@ rrl_item_t* rrl_hash(rrl_table_t *t, const struct sockaddr_storage *a, rrl_req_t
 
 int rrl_query(rrl_table_t *rrl, const struct sockaddr_storage *a, rrl_req_t *req,
               const zone_t *zone)
+{
+	return rrl_query_at(rrl, a, req, zone, time(NULL));
+}
+
+int rrl_query_at(rrl_table_t *rrl, const struct sockaddr_storage *a,
+                 rrl_req_t *req, const zone_t *zone, uint32_t now)
 {
 	if (!rrl || !req || !a) return KNOT_EINVAL;
 
 	/* Calculate hash and fetch */
-	int ret = KNOT_EOK;
-	int lock = -1;
-	uint32_t now = time(NULL);
-	rrl_item_t *b = rrl_hash(rrl, a, req, zone, now, &lock);
+	rrl_item_t *b = rrl_hash(rrl, a, req, zone, now);
 	if (!b) {
 		dbg_rrl("%s: failed to compute bucket from packet\n", __func__);
-		if (lock > -1) rrl_unlock(rrl, lock);
 		return KNOT_ERROR;
 	}
 
-	/* Calculate rate for dT */
-	uint32_t dt = now - b->time;
-	if (dt > RRL_CAPACITY) {
-		dt = RRL_CAPACITY;
-	}
-	/* Visit bucket. */
-	b->time = now;
-	dbg_rrl("%s: bucket=0x%x tokens=%hu flags=%x dt=%u\n",
-	        __func__, (unsigned)(b - rrl->arr), b->ntok, b->flags, dt);
-	if (dt > 0) { /* Window moved. */
-
-		/* Check state change. */
-		if ((b->ntok > 0 || dt > 1) && (b->flags & RRL_BF_ELIMIT)) {
-			b->flags &= ~RRL_BF_ELIMIT;
-			rrl_log_state(a, b->flags, b->cls);
+	/* Update the bucket state, retry if changed meanwhile. */
+	int ret = KNOT_EOK;
+	uint64_t old_state, new_state;
+	uint8_t old_flags, flags;
+	do {
+		old_state = load64(&b->state);
+		uint32_t time = STATE_TIME(old_state);
+		uint32_t ntok = STATE_NTOK(old_state);
+		old_flags = flags = STATE_FLAGS(old_state);
+
+		/* Calculate rate for dT */
+		uint32_t dt = (now > time) ? now - time : 0;
+		if (dt > RRL_CAPACITY) {
+			dt = RRL_CAPACITY;
+		}
+		/* Visit bucket. */
+		if (now > time) {
+			time = now;
+		}
+		dbg_rrl("%s: bucket=0x%x tokens=%u flags=%x dt=%u\n",
+		        __func__, (unsigned)(b - rrl->arr), ntok, flags, dt);
+		if (dt > 0) { /* Window moved. */
+
+			/* Check state change. */
+			if ((ntok > 0 || dt > 1) && (flags & RRL_BF_ELIMIT)) {
+				flags &= ~RRL_BF_ELIMIT;
+			}
+
+			/* Add new tokens. */
+			flags &= ~RRL_BF_SSTART; /* Slow-start finished. */
+			ntok += rrl->rate * dt;
+			if (ntok > RRL_CAPACITY * rrl->rate) {
+				ntok = RRL_CAPACITY * rrl->rate;
+			}
 		}
 
-		/* Add new tokens. */
-		uint32_t dn = rrl->rate * dt;
-		if (b->flags & RRL_BF_SSTART) { /* Bucket in slow-start. */
-			b->flags &= ~RRL_BF_SSTART;
-			dbg_rrl("%s: bucket '0x%x' slow-start finished\n",
-			        __func__, (unsigned)(b - rrl->arr));
+		/* Last item taken. */
+		if (ntok == 1 && !(flags & RRL_BF_ELIMIT)) {
+			flags |= RRL_BF_ELIMIT;
 		}
-		b->ntok += dn;
-		if (b->ntok > RRL_CAPACITY * rrl->rate) {
-			b->ntok = RRL_CAPACITY * rrl->rate;
+
+		/* Decay current bucket. */
+		if (ntok > 0) {
+			--ntok;
+			ret = KNOT_EOK;
+		} else {
+			ret = KNOT_ELIMIT;
 		}
-	}
 
-	/* Last item taken. */
-	if (b->ntok == 1 && !(b->flags & RRL_BF_ELIMIT)) {
-		b->flags |= RRL_BF_ELIMIT;
-		rrl_log_state(a, b->flags, b->cls);
-	}
+		new_state = STATE(time, ntok, flags);
+	} while (new_state != old_state && !cas64(&b->state, old_state, new_state));
 
-	/* Decay current bucket. */
-	if (b->ntok > 0) {
-		--b->ntok;
-	} else if (b->ntok == 0) {
-		ret = KNOT_ELIMIT;
+	/* Log state change. */
+	if ((old_flags ^ flags) & RRL_BF_ELIMIT) {
+		rrl_log_state(a, flags, rrl_clsid(req));
 	}
 
-	if (lock > -1) rrl_unlock(rrl, lock);
 	return ret;
 }
 
@@ -508,11 +475,6 @@ int rrl_destroy(rrl_table_t *rrl)
 {
 	if (rrl) {
 		dbg_rrl("%s: freeing table %p\n", __func__, rrl);
-		if (rrl->lk_count > 0) pthread_mutex_destroy(&rrl->ll);
-		for (size_t i = 0; i < rrl->lk_count; ++i) {
-			pthread_mutex_destroy(rrl->lk + i);
-		}
-		free(rrl->lk);
 	}
 
 	free(rrl);
@@ -521,44 +483,12 @@ int rrl_destroy(rrl_table_t *rrl)
 
 int rrl_reseed(rrl_table_t *rrl)
 {
-	/* Lock entire table. */
-	if (rrl->lk_count > 0) {
-		pthread_mutex_lock(&rrl->ll);
-		for (unsigned i = 0; i < rrl->lk_count; ++i) {
-			rrl_lock(rrl, i);
-		}
-	}
-
-	memset(rrl->arr, 0, rrl->size * sizeof(rrl_item_t));
 	rrl->seed = dnssec_random_uint32_t();
-	dbg_rrl("%s: reseed to '%u'\n", __func__, rrl->seed);
-
-	if (rrl->lk_count > 0) {
-		for (unsigned i = 0; i < rrl->lk_count; ++i) {
-			rrl_unlock(rrl, i);
-		}
-		pthread_mutex_unlock(&rrl->ll);
+	for (size_t i = 0; i < rrl->size; ++i) {
+		__sync_lock_test_and_set(&rrl->arr[i].key, 0);
+		__sync_lock_test_and_set(&rrl->arr[i].state, 0);
 	}
+	dbg_rrl("%s: reseed to '%u'\n", __func__, rrl->seed);
 
 	return KNOT_EOK;
 }
-
-int rrl_lock(rrl_table_t *t, int lk_id)
-{
-	assert(lk_id > -1);
-	dbg_rrl_verb("%s: locking id '%d'\n", __func__, lk_id);
-	if (pthread_mutex_lock(t->lk + lk_id) != 0) {
-		return KNOT_ERROR;
-	}
-	return KNOT_EOK;
-}
-
-int rrl_unlock(rrl_table_t *t, int lk_id)
-{
-	assert(lk_id > -1);
-	dbg_rrl_verb("%s: unlocking id '%d'\n", __func__, lk_id);
-	if (pthread_mutex_unlock(t->lk + lk_id)!= 0) {
-		return KNOT_ERROR;
-	}
-	return KNOT_EOK;
-}
@@ -26,14 +26,13 @@
 
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
-#include <pthread.h>
 #include "libknot/internal/sockaddr.h"
 #include "libknot/packet/pkt.h"
 
 /* Defaults */
 #define RRL_SLIP_MAX 100
-#define RRL_LOCK_GRANULARITY 32 /* Last digit granularity */
 
 /*! \brief RRL flags. */
 enum {
@@ -45,15 +44,15 @@ struct zone;
 
 /*!
  * \brief RRL hash bucket.
+ *
+ * Both items are only accessed atomically. The key identifies the bucket
+ * class, address prefix and imputed QNAME, the state packs the timestamp,
+ * available tokens and bucket flags, so that it can be updated with a single
+ * compare-and-swap.
  */
 typedef struct rrl_item {
-	unsigned hop;        /* Hop bitmap. */
-	uint64_t netblk;     /* Prefix associated. */
-	uint16_t ntok;       /* Tokens available */
-	uint8_t  cls;        /* Bucket class */
-	uint8_t  flags;      /* Flags */
-	uint32_t qname;      /* imputed(QNAME) hash */
-	uint32_t time;       /* Timestamp */
+	uint64_t key;        /* Bucket key, 0 for an empty bucket. */
+	uint64_t state;      /* Timestamp, tokens and flags. */
 } rrl_item_t;
 
 /*!
@@ -64,16 +63,14 @@ typedef struct rrl_item {
  * When a bucket is in a slow-start mode, it cannot reset again for the time
  * period.
  *
- * To avoid lock contention, N locks are created and distributed amongst buckets.
- * As of now lock K for bucket N is calculated as K = N % (num_buckets).
+ * The table is lock-free. A bucket is looked up in a short window of buckets
+ * following its hash position, free or expired buckets are claimed with
+ * a compare-and-swap of the key and tokens are taken with a compare-and-swap
+ * of the state.
  */
-
 typedef struct rrl_table {
 	uint32_t rate;       /* Configured RRL limit */
 	uint32_t seed;       /* Pseudorandom seed for hashing. */
-	pthread_mutex_t ll;
-	pthread_mutex_t *lk;      /* Table locks. */
-	unsigned lk_count;   /* Table lock count (granularity). */
 	size_t size;         /* Number of buckets */
 	rrl_item_t arr[];    /* Buckets */
 } rrl_table_t;
@@ -113,16 +110,6 @@ uint32_t rrl_rate(rrl_table_t *rrl);
  */
 uint32_t rrl_setrate(rrl_table_t *rrl, uint32_t rate);
 
-/*!
- * \brief Set N distributed locks for the RRL table.
- *
- * \param rrl RRL table.
- * \param granularity Number of created locks.
- * \retval KNOT_EOK
- * \retval KNOT_EINVAL
- */
-int rrl_setlocks(rrl_table_t *rrl, unsigned granularity);
-
 /*!
  * \brief Get bucket for current combination of parameters.
  * \param t RRL table.
@@ -130,11 +117,10 @@ int rrl_setlocks(rrl_table_t *rrl, unsigned granularity);
  * \param p RRL request.
  * \param zone Relate zone.
  * \param stamp Timestamp (current time).
- * \param lock Held lock.
  * \return assigned bucket
  */
 rrl_item_t* rrl_hash(rrl_table_t *t, const struct sockaddr_storage *a, rrl_req_t *p,
-                     const struct zone *zone, uint32_t stamp, int* lock);
+                     const struct zone *zone, uint32_t stamp);
 
 /*!
  * \brief Query the RRL table for accept or deny, when the rate limit is reached.
@@ -149,6 +135,14 @@ rrl_item_t* rrl_hash(rrl_table_t *t, const struct sockaddr_storage *a, rrl_req_t
 int rrl_query(rrl_table_t *rrl, const struct sockaddr_storage *a, rrl_req_t *req,
               const struct zone *zone);
 
+/*!
+ * \brief Query the RRL table at the given time, see rrl_query().
+ *
+ * \param stamp Timestamp (current time).
+ */
+int rrl_query_at(rrl_table_t *rrl, const struct sockaddr_storage *a,
+                 rrl_req_t *req, const struct zone *zone, uint32_t stamp);
+
 /*!
  * \brief Roll a dice whether answer slips or not.
  * \param n_slip Number represents every Nth answer that is slipped.
@@ -165,27 +159,13 @@ int rrl_destroy(rrl_table_t *rrl);
 
 /*!
  * \brief Reseed RRL table secret.
+ *
+ * \note Buckets are cleared one by one, concurrent queries may still
+ *       see some buckets of the previous seed.
+ *
  * \param rrl RRL table.
  * \return KNOT_EOK
  */
 int rrl_reseed(rrl_table_t *rrl);
 
-/*!
- * \brief Lock specified element lock.
- * \param rrl RRL table.
- * \param lk_id Specified lock.
- * \retval KNOT_EOK
- * \retval KNOT_ERROR
- */
-int rrl_lock(rrl_table_t *rrl, int lk_id);
-
-/*!
- * \brief Unlock specified element lock.
- * \param rrl RRL table.
- * \param lk_id Specified lock.
- * \retval KNOT_EOK
- * \retval KNOT_ERROR
- */
-int rrl_unlock(rrl_table_t *rrl, int lk_id);
-
 /*! @} */
@@ -21,11 +21,15 @@
 #include <stdlib.h>
 #include <sys/stat.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <assert.h>
+#include <ifaddrs.h>
 
 #include "libknot/errcode.h"
 #include "knot/common/debug.h"
 #include "knot/common/trim.h"
+#include "libknot/internal/macros.h"
+#include "knot/server/journal.h"
 #include "knot/server/server.h"
 #include "knot/server/udp-handler.h"
 #include "knot/server/tcp-handler.h"
@@ -34,6 +38,9 @@
 #include "knot/zone/timers.h"
 #include "knot/zone/zonedb-load.h"
 
+/*! \brief Maximum number of CPUs considered for thread placement. */
+#define MAX_CPUS 1024
+
 /*! \brief Minimal send/receive buffer sizes. */
 enum {
 	UDP_MIN_RCVSIZE = 4096,
@@ -77,14 +84,17 @@ static int evsched_run(dthread_t *thread)
 /*! \brief Unbind and dispose given interface. */
 static void server_remove_iface(iface_t *iface)
 {
-	/* Free UDP handler. */
-	if (iface->fd[IO_UDP] > -1) {
-		close(iface->fd[IO_UDP]);
+	/* Free UDP handlers. */
+	for (unsigned i = 0; i < iface->fd_udp_count; ++i) {
+		if (iface->fd_udp[i] > -1) {
+			close(iface->fd_udp[i]);
+		}
 	}
+	free(iface->fd_udp);
 
 	/* Free TCP handler. */
-	if (iface->fd[IO_TCP] > -1) {
-		close(iface->fd[IO_TCP]);
+	if (iface->fd_tcp > -1) {
+		close(iface->fd_tcp);
 	}
 
 	/* Free interface. */
@@ -118,18 +128,33 @@ static bool enlarge_net_buffers(int sock, int min_recvsize, int min_sndsize)
 	       setsockopt_min(sock, SO_SNDBUF, min_sndsize);
 }
 
+/*! \brief Close first 'count' UDP sockets of the interface. */
+static void close_udp_sockets(iface_t *iface, unsigned count)
+{
+	for (unsigned i = 0; i < count; ++i) {
+		close(iface->fd_udp[i]);
+	}
+	free(iface->fd_udp);
+	iface->fd_udp = NULL;
+	iface->fd_udp_count = 0;
+}
+
 /*!
  * \brief Initialize new interface from config value.
  *
- * Both TCP and UDP sockets will be created for the interface.
+ * Both TCP and UDP sockets will be created for the interface. If more than
+ * one UDP socket is requested, each of them is bound with SO_REUSEPORT so
+ * the kernel distributes incoming datagrams among them.
  *
  * \param new_if Allocated memory for the interface.
- * \param cfg_if Interface template from config.
+ * \param addr Interface address.
+ * \param udp_count Number of UDP sockets to bind (one per UDP thread).
  *
  * \retval 0 if successful (EOK).
  * \retval <0 on errors (EACCES, EINVAL, ENOMEM, EADDRINUSE).
  */
-static int server_init_iface(iface_t *new_if, struct sockaddr_storage *addr)
+static int server_init_iface(iface_t *new_if, struct sockaddr_storage *addr,
+                             unsigned udp_count)
 {
 	/* Initialize interface. */
 	int ret = 0;
@@ -140,35 +165,60 @@ static int server_init_iface(iface_t *new_if, struct sockaddr_storage *addr)
 	char addr_str[SOCKADDR_STRLEN] = { 0 };
 	sockaddr_tostr(addr_str, sizeof(addr_str), addr);
 
-	/* Create bound UDP socket. */
-	int bind_flags = 0;
-	int sock = net_bound_socket(SOCK_DGRAM, addr, bind_flags);
-	if (sock == KNOT_EADDRNOTAVAIL) {
-		bind_flags |= NET_BIND_NONLOCAL;
-		sock = net_bound_socket(SOCK_DGRAM, addr, bind_flags);
-		if (sock >= 0) {
-			log_warning("address '%s' is not available", addr_str);
-		}
+	new_if->fd_udp = malloc(udp_count * sizeof(int));
+	if (new_if->fd_udp == NULL) {
+		return KNOT_ENOMEM;
 	}
 
-	if (sock < 0) {
-		log_error("cannot bind address '%s' (%s)", addr_str, knot_strerror(sock));
-		return sock;
-	}
+	/* Create bound UDP sockets. */
+	int bind_flags = (udp_count > 1) ? NET_BIND_MULTIPLE : 0;
+	for (unsigned i = 0; i < udp_count; ++i) {
+		int sock = net_bound_socket(SOCK_DGRAM, addr, bind_flags);
 
-	if (!enlarge_net_buffers(sock, UDP_MIN_RCVSIZE, UDP_MIN_SNDSIZE)) {
-		log_warning("failed to set network buffer sizes for UDP");
-	}
+		/* Fall back to the sockets bound so far, at least one. */
+		if (sock == KNOT_ENOTSUP) {
+			log_warning("SO_REUSEPORT is not supported, "
+			            "UDP workers will share sockets");
+			bind_flags &= ~NET_BIND_MULTIPLE;
+			if (i > 0) {
+				udp_count = i;
+				break;
+			}
+			udp_count = 1;
+			sock = net_bound_socket(SOCK_DGRAM, addr, bind_flags);
+		}
 
-	/* Set UDP as non-blocking. */
-	fcntl(sock, F_SETFL, O_NONBLOCK);
+		if (sock == KNOT_EADDRNOTAVAIL) {
+			bind_flags |= NET_BIND_NONLOCAL;
+			sock = net_bound_socket(SOCK_DGRAM, addr, bind_flags);
+			if (sock >= 0) {
+				log_warning("address '%s' is not available", addr_str);
+			}
+		}
 
-	new_if->fd[IO_UDP] = sock;
+		if (sock < 0) {
+			log_error("cannot bind address '%s' (%s)", addr_str,
+			          knot_strerror(sock));
+			close_udp_sockets(new_if, i);
+			return sock;
+		}
+
+		if (!enlarge_net_buffers(sock, UDP_MIN_RCVSIZE, UDP_MIN_SNDSIZE)) {
+			log_warning("failed to set network buffer sizes for UDP");
+		}
+
+		/* Set UDP as non-blocking. */
+		fcntl(sock, F_SETFL, O_NONBLOCK);
+
+		new_if->fd_udp[i] = sock;
+	}
+	new_if->fd_udp_count = udp_count;
 
 	/* Create bound TCP socket. */
-	sock = net_bound_socket(SOCK_STREAM, addr, bind_flags);
+	bind_flags &= ~NET_BIND_MULTIPLE;
+	int sock = net_bound_socket(SOCK_STREAM, addr, bind_flags);
 	if (sock < 0) {
-		close(new_if->fd[IO_UDP]);
+		close_udp_sockets(new_if, new_if->fd_udp_count);
 		return sock;
 	}
 
@@ -176,21 +226,21 @@ static int server_init_iface(iface_t *new_if, struct sockaddr_storage *addr)
 		log_warning("failed to set network buffer sizes for TCP");
 	}
 
-	new_if->fd[IO_TCP] = sock;
+	new_if->fd_tcp = sock;
 
 	/* Listen for incoming connections. */
 	ret = listen(sock, TCP_BACKLOG_SIZE);
 	if (ret < 0) {
-		close(new_if->fd[IO_UDP]);
-		close(new_if->fd[IO_TCP]);
+		close_udp_sockets(new_if, new_if->fd_udp_count);
+		close(new_if->fd_tcp);
 		log_error("failed to listen on TCP interface '%s'", addr_str);
 		return KNOT_ERROR;
 	}
 
 	/* accept() must not block */
 	if (fcntl(sock, F_SETFL, O_NONBLOCK) < 0) {
-		close(new_if->fd[IO_UDP]);
-		close(new_if->fd[IO_TCP]);
+		close_udp_sockets(new_if, new_if->fd_udp_count);
+		close(new_if->fd_tcp);
 		log_error("failed to listen on '%s' in non-blocking mode",
 			  addr_str);
 		return KNOT_ERROR;
@@ -241,6 +291,10 @@ static int reconfigure_sockets(conf_t *conf, server_t *s)
 		list_dup(&s->ifaces->u, &s->ifaces->l, sizeof(iface_t));
 	}
 
+	/* Bind a UDP socket per UDP thread if requested. */
+	conf_val_t val = conf_get(conf, C_SRV, C_UDP_REUSEPORT);
+	unsigned udp_count = conf_bool(&val) ? conf_udp_threads(conf) : 1;
+
 	/* Update bound interfaces. */
 	conf_val_t listen_val = conf_get(conf, C_SRV, C_LISTEN);
 	conf_val_t rundir_val = conf_get(conf, C_SRV, C_RUNDIR);
@@ -264,6 +318,14 @@ static int reconfigure_sockets(conf_t *conf, server_t *s)
 		/* Found already bound interface. */
 		if (found_match) {
 			rem_node((node_t *)m);
+			/*! \note Sockets are not rebound, threads over the
+			 *        socket count share them (see iface_udp_fd()). */
+			if (m->fd_udp_count != udp_count) {
+				char addr_str[SOCKADDR_STRLEN] = { 0 };
+				sockaddr_tostr(addr_str, sizeof(addr_str), &addr);
+				log_notice("interface '%s', changed number of UDP "
+				           "sockets requires restart", addr_str);
+			}
 		} else {
 			char addr_str[SOCKADDR_STRLEN] = { 0 };
 			sockaddr_tostr(addr_str, sizeof(addr_str), &addr);
@@ -271,7 +333,7 @@ static int reconfigure_sockets(conf_t *conf, server_t *s)
 
 			/* Create new interface. */
 			m = malloc(sizeof(iface_t));
-			if (server_init_iface(m, &addr) < 0) {
+			if (server_init_iface(m, &addr, udp_count) < 0) {
 				free(m);
 				m = 0;
 			}
@@ -349,6 +411,15 @@ int server_init(server_t *server, int bg_workers)
 		return KNOT_ENOMEM;
 	}
 
+	/* Zone files are loaded using all CPUs. */
+	server->loaders = worker_pool_create(dt_optimal_size());
+	if (server->loaders == NULL) {
+		worker_pool_destroy(server->workers);
+		dt_delete(&server->iosched);
+		evsched_deinit(&server->sched);
+		return KNOT_ENOMEM;
+	}
+
 	return KNOT_EOK;
 }
 
@@ -369,6 +440,7 @@ void server_deinit(server_t *server)
 	}
 
 	/* Free threads and event handlers. */
+	worker_pool_destroy(server->loaders);
 	worker_pool_destroy(server->workers);
 	dt_delete(&server->iosched);
 
@@ -384,6 +456,9 @@ void server_deinit(server_t *server)
 	/* Close persistent timers database. */
 	close_timers_db(server->timers_db);
 
+	/* Close journal database. */
+	journal_db_close(server->journal_db);
+
 	/* Clear the structure. */
 	memset(server, 0, sizeof(server_t));
 }
@@ -444,9 +519,11 @@ int server_start(server_t *s, bool async)
 
 	/* Start workers. */
 	worker_pool_start(s->workers);
+	worker_pool_start(s->loaders);
 
 	/* Wait for enqueued events if not asynchronous. */
 	if (!async) {
+		worker_pool_wait(s->loaders);
 		worker_pool_wait(s->workers);
 	}
 
@@ -472,6 +549,7 @@ void server_wait(server_t *s)
 	}
 
 	dt_join(s->iosched);
+	worker_pool_join(s->loaders);
 	worker_pool_join(s->workers);
 
 	if (s->tu_size == 0) {
@@ -541,6 +619,7 @@ void server_stop(server_t *server)
 	dt_stop(server->iosched);
 
 	/* Interrupt background workers. */
+	worker_pool_stop(server->loaders);
 	worker_pool_stop(server->workers);
 
 	/* Clear 'running' flag. */
@@ -592,6 +671,137 @@ static int reconfigure_threads(conf_t *conf, server_t *server)
 	return ret;
 }
 
+/*! \brief Find NUMA node of the network device with given address. */
+static int iface_numa_node(const struct sockaddr_storage *addr)
+{
+	int node = -1;
+#if defined(__linux__)
+	struct ifaddrs *ifaddr = NULL;
+	if (getifaddrs(&ifaddr) != 0) {
+		return -1;
+	}
+
+	for (struct ifaddrs *ifa = ifaddr; ifa != NULL; ifa = ifa->ifa_next) {
+		if (ifa->ifa_addr == NULL ||
+		    ifa->ifa_addr->sa_family != addr->ss_family) {
+			continue;
+		}
+
+		/* Compare addresses only. */
+		struct sockaddr_storage ss;
+		memset(&ss, 0, sizeof(ss));
+		memcpy(&ss, ifa->ifa_addr, sockaddr_len(ifa->ifa_addr));
+		sockaddr_port_set(&ss, sockaddr_port(addr));
+		if (sockaddr_cmp(&ss, addr) != 0) {
+			continue;
+		}
+
+		char path[128];
+		snprintf(path, sizeof(path), "/sys/class/net/%s/device/numa_node",
+		         ifa->ifa_name);
+		FILE *fp = fopen(path, "r");
+		if (fp != NULL) {
+			if (fscanf(fp, "%d", &node) != 1) {
+				node = -1;
+			}
+			fclose(fp);
+		}
+		break;
+	}
+
+	freeifaddrs(ifaddr);
+#endif
+	return node;
+}
+
+/*! \brief Find NUMA node local to the first listening device with known node. */
+static int listen_numa_node(conf_t *conf)
+{
+	conf_val_t listen_val = conf_get(conf, C_SRV, C_LISTEN);
+	while (listen_val.code == KNOT_EOK) {
+		struct sockaddr_storage addr = conf_addr(&listen_val, NULL);
+		int node = iface_numa_node(&addr);
+		if (node >= 0) {
+			return node;
+		}
+		conf_val_next(&listen_val);
+	}
+
+	return -1;
+}
+
+/*!
+ * \brief Place query processing and background threads on CPUs.
+ *
+ * UDP workers are spread one per CPU (preferring distinct physical cores
+ * close to the NIC in the 'auto' mode), TCP workers, background workers
+ * and the event scheduler run on the remaining CPUs, if there are any.
+ */
+static int reconfigure_affinity(conf_t *conf, server_t *server)
+{
+	unsigned *all = malloc(2 * MAX_CPUS * sizeof(unsigned));
+	if (all == NULL) {
+		return KNOT_ENOMEM;
+	}
+	unsigned *udp = all + MAX_CPUS;
+
+	conf_val_t val = conf_get(conf, C_SRV, C_CPU_AFFINITY);
+	unsigned mode = conf_opt(&val);
+
+	size_t all_count = 0, udp_count = 0;
+	switch (mode) {
+	case CPU_AFFINITY_AUTO:
+		all_count = dt_cpu_topology(all, MAX_CPUS, listen_numa_node(conf));
+		/* Nothing to place on a single CPU. */
+		if (all_count > 1) {
+			udp_count = MIN(all_count, server->handler[IO_UDP].unit->size);
+		}
+		memcpy(udp, all, udp_count * sizeof(unsigned));
+		break;
+	case CPU_AFFINITY_LIST:
+		all_count = dt_cpu_topology(all, MAX_CPUS, -1);
+		val = conf_get(conf, C_SRV, C_CPU_LIST);
+		while (val.code == KNOT_EOK && udp_count < MAX_CPUS) {
+			udp[udp_count++] = conf_int(&val);
+			conf_val_next(&val);
+		}
+		break;
+	default:
+		all_count = dt_cpu_topology(all, MAX_CPUS, -1);
+		break;
+	}
+
+	/* Remove CPUs used by UDP workers unless there would be none left. */
+	size_t rest_count = 0;
+	for (size_t i = 0; i < all_count; ++i) {
+		bool used = false;
+		for (size_t j = 0; j < udp_count; ++j) {
+			used = used || (udp[j] == all[i]);
+		}
+		if (!used) {
+			all[rest_count++] = all[i];
+		}
+	}
+	if (rest_count == 0) {
+		rest_count = dt_cpu_topology(all, MAX_CPUS, -1);
+	}
+
+	if (udp_count > 0) {
+		log_info("CPU affinity, UDP workers on %zu CPUs, "
+		         "other threads on %zu CPUs", udp_count, rest_count);
+		dt_unit_setaffinity(server->handler[IO_UDP].unit, udp, udp_count, true);
+	} else {
+		dt_unit_setaffinity(server->handler[IO_UDP].unit, all, rest_count, false);
+	}
+	dt_unit_setaffinity(server->handler[IO_TCP].unit, all, rest_count, false);
+	dt_unit_setaffinity(server->iosched, all, rest_count, false);
+	worker_pool_setaffinity(server->workers, all, rest_count);
+
+	free(all);
+
+	return KNOT_EOK;
+}
+
 static int reconfigure_rate_limits(conf_t *conf, server_t *server)
 {
 	conf_val_t val = conf_get(conf, C_SRV, C_RATE_LIMIT);
@@ -603,8 +813,6 @@ static int reconfigure_rate_limits(conf_t *conf, server_t *server)
 		server->rrl = rrl_create(conf_int(&val));
 		if (!server->rrl) {
 			log_error("failed to initialize rate limiting table");
-		} else {
-			rrl_setlocks(server->rrl, RRL_LOCK_GRANULARITY);
 		}
 	}
 	if (server->rrl) {
@@ -657,6 +865,12 @@ int server_reconfigure(conf_t *conf, void *data)
 		return ret;
 	}
 
+	/* Update thread placement. */
+	if ((ret = reconfigure_affinity(conf, server)) < 0) {
+		log_error("failed to reconfigure CPU affinity");
+		return ret;
+	}
+
 	return ret;
 }
 
@@ -675,6 +889,27 @@ static void reopen_timers_database(conf_t *conf, server_t *server)
 	}
 }
 
+static void open_journal_database(conf_t *conf, server_t *server)
+{
+	/* The database is shared with running queries, open it only once. */
+	if (server->journal_db == NULL) {
+		conf_val_t val = conf_get(conf, C_SRV, C_MAX_JOURNAL_DB_SIZE);
+		size_t mapsize = MIN(conf_int(&val), SIZE_MAX);
+
+		val = conf_default_get(conf, C_STORAGE);
+		char *storage = conf_abs_path(&val, NULL);
+		int ret = journal_db_open(storage, mapsize, &server->journal_db);
+		free(storage);
+		if (ret != KNOT_EOK) {
+			log_error("cannot open journal DB (%s)", knot_strerror(ret));
+			return;
+		}
+	}
+
+	conf_val_t val = conf_get(conf, C_SRV, C_JOURNAL_COMMIT_DELAY);
+	journal_db_set_delay(server->journal_db, conf_int(&val));
+}
+
 int server_update_zones(conf_t *conf, void *data)
 {
 	server_t *server = (server_t *)data;
@@ -685,18 +920,23 @@ int server_update_zones(conf_t *conf, void *data)
 	}
 
 	/* Suspend workers, clear wating events, finish running events. */
+	worker_pool_suspend(server->loaders);
 	worker_pool_suspend(server->workers);
+	worker_pool_clear(server->loaders);
 	worker_pool_clear(server->workers);
+	worker_pool_wait(server->loaders);
 	worker_pool_wait(server->workers);
 
 	/* Reload zone database and free old zones. */
 	reopen_timers_database(conf, server);
+	open_journal_database(conf, server);
 	int ret = zonedb_reload(conf, server);
 
 	/* Trim extra heap. */
 	mem_trim();
 
 	/* Resume workers and allow events on new zones. */
+	worker_pool_resume(server->loaders);
 	worker_pool_resume(server->workers);
 	if (server->zone_db) {
 		knot_zonedb_foreach(server->zone_db, zone_events_start);
@@ -705,7 +945,7 @@ int server_update_zones(conf_t *conf, void *data)
 	return ret;
 }
 
-ref_t *server_set_ifaces(server_t *s, fdset_t *fds, int type)
+ref_t *server_set_ifaces(server_t *s, fdset_t *fds, int type, unsigned thread_id)
 {
 	iface_t *i = NULL;
 
@@ -713,7 +953,8 @@ ref_t *server_set_ifaces(server_t *s, fdset_t *fds, int type)
 	fdset_clear(fds);
 	if (s->ifaces) {
 		WALK_LIST(i, s->ifaces->l) {
-			fdset_add(fds, i->fd[type], POLLIN, NULL);
+			int fd = (type == IO_UDP) ? iface_udp_fd(i, thread_id) : i->fd_tcp;
+			fdset_add(fds, fd, POLLIN, NULL);
 		}
 
 	}
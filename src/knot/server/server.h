@@ -67,7 +67,9 @@ typedef enum {
  */
 typedef struct iface {
 	struct node n;
-	int fd[2];
+	int fd_tcp;               /*!< Listening TCP socket. */
+	int *fd_udp;              /*!< Bound UDP sockets. */
+	unsigned fd_udp_count;    /*!< Number of UDP sockets (1 or per-thread). */
 	struct sockaddr_storage addr;
 } iface_t;
 
@@ -97,6 +99,7 @@ typedef struct server {
 	/*! \brief Zone database. */
 	knot_zonedb_t *zone_db;
 	namedb_t *timers_db;
+	journal_db_t *journal_db;
 
 	/*! \brief I/O handlers. */
 	unsigned tu_size;
@@ -105,6 +108,9 @@ typedef struct server {
 	/*! \brief Background jobs. */
 	worker_pool_t *workers;
 
+	/*! \brief Zone file loading. */
+	worker_pool_t *loaders;
+
 	/*! \brief Event scheduler. */
 	dt_unit_t *iosched;
 	evsched_t sched;
@@ -189,13 +195,27 @@ int server_reconfigure(conf_t *conf, void *data);
  */
 int server_update_zones(conf_t *conf, void *data);
 
+/*!
+ * \brief Return UDP socket of the interface assigned to given UDP thread.
+ *
+ * \param iface Interface.
+ * \param thread_id UDP thread identifier (index in the UDP unit).
+ *
+ * \return socket descriptor
+ */
+static inline int iface_udp_fd(const iface_t *iface, unsigned thread_id)
+{
+	return iface->fd_udp[thread_id % iface->fd_udp_count];
+}
+
 /*!
  * \brief Update fdsets from current interfaces list.
  * \param s Server.
  * \param fds Filedescriptor set.
  * \param type I/O type (UDP/TCP).
+ * \param thread_id Thread identifier (used for per-thread UDP sockets).
  * \return new interface list
  */
-ref_t *server_set_ifaces(server_t *s, fdset_t *fds, int type);
+ref_t *server_set_ifaces(server_t *s, fdset_t *fds, int type, unsigned thread_id);
 
 /*! @} */
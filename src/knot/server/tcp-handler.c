@@ -37,142 +37,516 @@
 #include "knot/common/debug.h"
 #include "knot/common/fdset.h"
 #include "knot/common/time.h"
+#include "knot/nameserver/answer_cache.h"
 #include "knot/nameserver/process_query.h"
 #include "libknot/internal/mempool.h"
 #include "libknot/internal/macros.h"
 #include "libknot/internal/net.h"
 #include "libknot/internal/sockaddr.h"
+#include "libknot/internal/utils.h"
 #include "libknot/processing/overlay.h"
 
 /*! \brief TCP context data. */
 typedef struct tcp_context {
-	struct knot_overlay overlay;/*!< Query processing overlay. */
 	server_t *server;           /*!< Name server structure. */
-	struct iovec iov[2];        /*!< TX/RX buffers. */
 	unsigned client_threshold;  /*!< Index of first TCP client. */
 	timev_t last_poll_time;     /*!< Time of the last socket poll. */
 	timev_t throttle_end;       /*!< End of accept() throttling. */
 	fdset_t set;                /*!< Set of server/client sockets. */
 	unsigned thread_id;         /*!< Thread identifier. */
+	answer_cache_t *answer_cache;/*!< Thread answer cache. */
+	unsigned max_per_set;       /*!< Maximum number of clients per thread. */
+	int hshake_timeout;         /*!< Resolved handshake timeout. */
+	int idle_timeout;           /*!< Resolved idle timeout. */
+	int reply_timeout;          /*!< Resolved reply timeout. */
 } tcp_context_t;
 
+/*!
+ * \brief Message being answered on a TCP connection.
+ *
+ * The context is kept by the connection after the message is answered and
+ * reused for the next one, the packets and the processing overlay are only
+ * reset in between.
+ */
+typedef struct tcp_query {
+	node_t n;
+	struct knot_overlay overlay;  /*!< Processing of the message. */
+	mm_ctx_t mm;                  /*!< Memory of the message processing. */
+	knot_pkt_t *query;            /*!< Answered message. */
+	knot_pkt_t *ans;              /*!< Answer packet. */
+	int state;                    /*!< Processing state. */
+} tcp_query_t;
+
+/*!
+ * \brief TCP connection state.
+ *
+ * Client sockets are non-blocking, the connection keeps partially received
+ * messages, unsent data and the processing state of the messages being
+ * answered, so that the answering may be resumed in a later event.
+ */
+typedef struct tcp_conn {
+	struct sockaddr_storage addr;      /*!< Peer address. */
+	struct process_query_param param;  /*!< Query processing parameter. */
+	list_t queries;                    /*!< Messages being answered. */
+	unsigned nqueries;                 /*!< Number of messages being answered. */
+	list_t spare;                      /*!< Reusable processing contexts. */
+	unsigned nspare;                   /*!< Number of reusable contexts. */
+	uint8_t *rx;                       /*!< Received data. */
+	size_t rx_size;                    /*!< Receive buffer size. */
+	size_t rx_len;                     /*!< Received data length. */
+	uint8_t *tx;                       /*!< Unsent data. */
+	size_t tx_size;                    /*!< Send buffer size. */
+	size_t tx_len;                     /*!< Unsent data length. */
+	bool closing;                      /*!< Client closed its sending side. */
+} tcp_conn_t;
+
 /*
  * Forward decls.
  */
 #define TCP_THROTTLE_LO 0 /*!< Minimum recovery time on errors. */
 #define TCP_THROTTLE_HI 2 /*!< Maximum recovery time on errors. */
+#define TCP_RX_INIT 512   /*!< Initial size of the connection receive buffer. */
+#define TCP_PIPELINE_MAX 16 /*!< Messages answered in parallel on a connection. */
+#define TCP_ROUNDS_MAX 8  /*!< Answering rounds for a connection per event. */
+#define TCP_SPARE_MAX 4   /*!< Reusable processing contexts per connection. */
+#define TCP_QUERY_MM_MAX (16 * MM_DEFAULT_BLKSIZE) /*!< Processing memory kept for reuse. */
 
 /*! \brief Calculate TCP throttle time (random). */
 static inline int tcp_throttle() {
 	return TCP_THROTTLE_LO + (dnssec_random_uint16_t() % TCP_THROTTLE_HI);
 }
 
+/*! \brief Create reusable processing context of a connection message. */
+static tcp_query_t *tcp_query_create(tcp_conn_t *conn)
+{
+	tcp_query_t *q = malloc(sizeof(tcp_query_t));
+	if (q == NULL) {
+		return NULL;
+	}
+	memset(q, 0, sizeof(tcp_query_t));
+
+	/* Packets outlive the processing memory, which is flushed when large. */
+	q->query = knot_pkt_new(NULL, TCP_RX_INIT, NULL);
+	q->ans = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, NULL);
+	if (q->query == NULL || q->ans == NULL) {
+		knot_pkt_free(&q->query);
+		knot_pkt_free(&q->ans);
+		free(q);
+		return NULL;
+	}
+
+	/* Initialize processing overlay. */
+	mm_ctx_mempool(&q->mm, MM_DEFAULT_BLKSIZE);
+	knot_overlay_init(&q->overlay, &q->mm);
+	knot_overlay_add(&q->overlay, NS_PROC_QUERY, &conn->param);
+
+	return q;
+}
+
+/*! \brief Free the processing context. */
+static void tcp_query_destroy(tcp_query_t *q)
+{
+	knot_overlay_finish(&q->overlay);
+	knot_overlay_deinit(&q->overlay);
+	knot_pkt_free(&q->query);
+	knot_pkt_free(&q->ans);
+	mp_delete(q->mm.ctx);
+	free(q);
+}
+
+/*! \brief Reset the packet for a new message, keeping its buffers. */
+static void tcp_pkt_reset(knot_pkt_t *pkt, size_t max_size)
+{
+	knot_pkt_clear(pkt);
+	pkt->max_size = max_size;
+	pkt->reserved = 0;
+}
+
+/*! \brief Start answering of a received message. */
+static int tcp_query_new(tcp_conn_t *conn, const uint8_t *msg, size_t msglen)
+{
+	/* Reuse spare context if available. */
+	tcp_query_t *q = NULL;
+	if (conn->nspare > 0) {
+		q = HEAD(conn->spare);
+		rem_node(&q->n);
+		conn->nspare -= 1;
+	} else {
+		q = tcp_query_create(conn);
+		if (q == NULL) {
+			return KNOT_ENOMEM;
+		}
+	}
+
+	/* Grow the query buffer if needed. */
+	if (msglen > q->query->max_size) {
+		knot_pkt_t *query = knot_pkt_new(NULL, msglen, NULL);
+		if (query == NULL) {
+			tcp_query_destroy(q);
+			return KNOT_ENOMEM;
+		}
+		knot_pkt_free(&q->query);
+		q->query = query;
+	}
+
+	/* Copy the message out of the receive buffer. */
+	tcp_pkt_reset(q->query, q->query->max_size);
+	memcpy(q->query->wire, msg, msglen);
+	q->query->size = msglen;
+	tcp_pkt_reset(q->ans, KNOT_WIRE_MAX_PKTSIZE);
+
+	/* Input packet. */
+	(void) knot_pkt_parse(q->query, KNOT_PF_LAZY);
+	q->state = knot_overlay_consume(&q->overlay, q->query);
+
+	add_tail(&conn->queries, &q->n);
+	conn->nqueries += 1;
+
+	return KNOT_EOK;
+}
+
+/*! \brief Finish processing of the answered message, keep the context for reuse. */
+static void tcp_query_free(tcp_conn_t *conn, tcp_query_t *q)
+{
+	rem_node(&q->n);
+	conn->nqueries -= 1;
+
+	if (conn->nspare >= TCP_SPARE_MAX) {
+		tcp_query_destroy(q);
+		return;
+	}
+
+	/* Release the processing memory if it grew too much (e.g. transfers). */
+	if (mp_total_size(q->mm.ctx) > TCP_QUERY_MM_MAX) {
+		knot_overlay_finish(&q->overlay);
+		knot_overlay_deinit(&q->overlay);
+		mp_delete(q->mm.ctx);
+		mm_ctx_mempool(&q->mm, MM_DEFAULT_BLKSIZE);
+		knot_overlay_init(&q->overlay, &q->mm);
+		knot_overlay_add(&q->overlay, NS_PROC_QUERY, &conn->param);
+	} else {
+		knot_overlay_reset(&q->overlay);
+	}
+
+	add_head(&conn->spare, &q->n);
+	conn->nspare += 1;
+}
+
+static tcp_conn_t *tcp_conn_new(tcp_context_t *tcp, int fd,
+                                const struct sockaddr_storage *addr)
+{
+	tcp_conn_t *conn = malloc(sizeof(tcp_conn_t));
+	if (conn == NULL) {
+		return NULL;
+	}
+
+	memset(conn, 0, sizeof(tcp_conn_t));
+	memcpy(&conn->addr, addr, sizeof(conn->addr));
+	init_list(&conn->queries);
+	init_list(&conn->spare);
+
+	conn->rx_size = TCP_RX_INIT;
+	conn->rx = malloc(conn->rx_size);
+	if (conn->rx == NULL) {
+		free(conn);
+		return NULL;
+	}
+
+	conn->param.socket = fd;
+	conn->param.remote = &conn->addr;
+	conn->param.server = tcp->server;
+	conn->param.thread_id = tcp->thread_id;
+	conn->param.answer_cache = tcp->answer_cache;
+
+	return conn;
+}
+
+static void tcp_conn_free(tcp_conn_t *conn)
+{
+	if (conn == NULL) {
+		return;
+	}
+
+	tcp_query_t *q = NULL, *next = NULL;
+	WALK_LIST_DELSAFE(q, next, conn->queries) {
+		tcp_query_destroy(q);
+	}
+	WALK_LIST_DELSAFE(q, next, conn->spare) {
+		tcp_query_destroy(q);
+	}
+	free(conn->rx);
+	free(conn->tx);
+	free(conn);
+}
+
+/*! \brief Close the connection at the given index. */
+static void tcp_conn_close(fdset_t *set, unsigned i)
+{
+	int fd = set->pfd[i].fd;
+	tcp_conn_t *conn = set->ctx[i];
+	fdset_remove(set, i);
+	close(fd);
+	tcp_conn_free(conn);
+}
+
 /*! \brief Sweep TCP connection. */
 static enum fdset_sweep_state tcp_sweep(fdset_t *set, int i, void *data)
 {
 	UNUSED(data);
 	assert(set && i < set->n && i >= 0);
 	int fd = set->pfd[i].fd;
+	tcp_conn_t *conn = set->ctx[i];
 
 	/* Best-effort, name and shame. */
-	struct sockaddr_storage ss;
-	socklen_t len = sizeof(struct sockaddr_storage);
-	if (getpeername(fd, (struct sockaddr*)&ss, &len) == 0) {
+	if (conn != NULL) {
 		char addr_str[SOCKADDR_STRLEN] = {0};
-		sockaddr_tostr(addr_str, sizeof(addr_str), &ss);
+		sockaddr_tostr(addr_str, sizeof(addr_str), &conn->addr);
 		log_notice("TCP, terminated inactive client, address '%s'", addr_str);
 	}
 
 	close(fd);
+	tcp_conn_free(conn);
 
 	return FDSET_SWEEP;
 }
 
 /*!
- * \brief TCP event handler function.
+ * \brief Send gathered data or the part of it which fits into the socket buffer.
+ *
+ * The rest of the data is kept in the connection send buffer.
  */
-static int tcp_handle(tcp_context_t *tcp, int fd,
-                      struct iovec *rx, struct iovec *tx)
+static int tcp_conn_send(tcp_conn_t *conn, int fd, struct iovec *iov, int iovcnt)
 {
-	/* Create query processing parameter. */
-	struct sockaddr_storage ss;
-	memset(&ss, 0, sizeof(struct sockaddr_storage));
-	struct process_query_param param = {0};
-	param.socket = fd;
-	param.remote = &ss;
-	param.server = tcp->server;
-	param.thread_id = tcp->thread_id;
-	rx->iov_len = KNOT_WIRE_MAX_PKTSIZE;
-	tx->iov_len = KNOT_WIRE_MAX_PKTSIZE;
-
-	/* Receive peer name. */
-	socklen_t addrlen = sizeof(struct sockaddr_storage);
-	if (getpeername(fd, (struct sockaddr *)&ss, &addrlen) < 0) {
-		;
-	}
-
-	/* Timeout. */
-	rcu_read_lock();
-	conf_val_t val = conf_get(conf(), C_SRV, C_TCP_REPLY_TIMEOUT);
-	int64_t max_conn_reply = conf_int(&val);
-	rcu_read_unlock();
-	struct timeval tmout = { max_conn_reply, 0 };
-
-	/* Receive data. */
-	struct timeval recv_tmout = tmout;
-	int ret = tcp_recv_msg(fd, rx->iov_base, rx->iov_len, &recv_tmout);
-	if (ret <= 0) {
-		dbg_net("tcp: client on fd=%d disconnected\n", fd);
-		if (ret == KNOT_EAGAIN) {
-			char addr_str[SOCKADDR_STRLEN] = {0};
-			sockaddr_tostr(addr_str, sizeof(addr_str), &ss);
-			log_warning("TCP, connection timed out, address '%s'",
-			            addr_str);
+	assert(conn->tx_len == 0);
+
+	size_t total = 0;
+	for (int i = 0; i < iovcnt; ++i) {
+		total += iov[i].iov_len;
+	}
+
+	ssize_t sent = writev(fd, iov, iovcnt);
+	if (sent < 0) {
+		if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+			return KNOT_ECONN;
 		}
-		return KNOT_ECONNREFUSED;
-	} else {
-		rx->iov_len = ret;
+		sent = 0;
+	}
+	if (sent == total) {
+		return KNOT_EOK;
 	}
 
-	/* Create packets. */
-	mm_ctx_t *mm = tcp->overlay.mm;
-	knot_pkt_t *ans = knot_pkt_new(tx->iov_base, tx->iov_len, mm);
-	knot_pkt_t *query = knot_pkt_new(rx->iov_base, rx->iov_len, mm);
+	/* Keep the unsent rest. */
+	if (conn->tx_size < total - sent) {
+		uint8_t *tx = realloc(conn->tx, total - sent);
+		if (tx == NULL) {
+			return KNOT_ENOMEM;
+		}
+		conn->tx = tx;
+		conn->tx_size = total - sent;
+	}
+	for (int i = 0; i < iovcnt; ++i) {
+		if (sent >= iov[i].iov_len) {
+			sent -= iov[i].iov_len;
+			continue;
+		}
+		size_t len = iov[i].iov_len - sent;
+		memcpy(conn->tx + conn->tx_len, (uint8_t *)iov[i].iov_base + sent, len);
+		conn->tx_len += len;
+		sent = 0;
+	}
 
-	/* Initialize processing overlay. */
-	knot_overlay_init(&tcp->overlay, mm);
-	knot_overlay_add(&tcp->overlay, NS_PROC_QUERY, &param);
+	return KNOT_EAGAIN;
+}
 
-	/* Input packet. */
-	(void) knot_pkt_parse(query, 0);
-	int state = knot_overlay_consume(&tcp->overlay, query);
-
-	/* Resolve until NOOP or finished. */
-	ret = KNOT_EOK;
-	while (state & (KNOT_STATE_PRODUCE|KNOT_STATE_FAIL)) {
-		state = knot_overlay_produce(&tcp->overlay, ans);
-
-		/* Send, if response generation passed and wasn't ignored. */
-		if (ans->size > 0 && !(state & (KNOT_STATE_FAIL|KNOT_STATE_NOOP))) {
-			struct timeval send_tmout = tmout;
-			if (tcp_send_msg(fd, ans->wire, ans->size, &send_tmout) != ans->size) {
-				ret = KNOT_ECONNREFUSED;
+/*! \brief Send out the unsent data. */
+static int tcp_conn_flush(tcp_conn_t *conn, int fd)
+{
+	if (conn->tx_len == 0) {
+		return KNOT_EOK;
+	}
+
+	ssize_t sent = send(fd, conn->tx, conn->tx_len, 0);
+	if (sent < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+			return KNOT_EAGAIN;
+		}
+		return KNOT_ECONN;
+	}
+
+	conn->tx_len -= sent;
+	memmove(conn->tx, conn->tx + sent, conn->tx_len);
+
+	return (conn->tx_len == 0) ? KNOT_EOK : KNOT_EAGAIN;
+}
+
+/*!
+ * \brief Produce one answer packet of each message being answered.
+ *
+ * Answers are written with a single gathered write, so short answers are
+ * interleaved with long-running transfers and may be sent out of order.
+ *
+ * \param answered  Set to true if any message was completely answered.
+ *
+ * \retval KNOT_EOK if all answers were sent.
+ * \retval KNOT_EAGAIN if the socket buffer is full.
+ * \retval KNOT_E* if the connection should be closed.
+ */
+static int tcp_conn_round(tcp_conn_t *conn, int fd, bool *answered)
+{
+	uint16_t pktsize[TCP_PIPELINE_MAX];
+	struct iovec iov[2 * TCP_PIPELINE_MAX];
+	int iovcnt = 0;
+
+	tcp_query_t *q = NULL;
+	WALK_LIST(q, conn->queries) {
+		/* Resolve until NOOP or finished. */
+		knot_pkt_t *ans = q->ans;
+		while (q->state & (KNOT_STATE_PRODUCE|KNOT_STATE_FAIL)) {
+			q->state = knot_overlay_produce(&q->overlay, ans);
+
+			/* Send, if response generation passed and wasn't ignored. */
+			if (ans->size > 0 && !(q->state & (KNOT_STATE_FAIL|KNOT_STATE_NOOP))) {
+				pktsize[iovcnt / 2] = htons(ans->size);
+				iov[iovcnt].iov_base = &pktsize[iovcnt / 2];
+				iov[iovcnt].iov_len = sizeof(uint16_t);
+				iov[iovcnt + 1].iov_base = ans->wire;
+				iov[iovcnt + 1].iov_len = ans->size;
+				iovcnt += 2;
 				break;
 			}
 		}
 	}
 
-	/* Reset after processing. */
-	knot_overlay_finish(&tcp->overlay);
-	knot_overlay_deinit(&tcp->overlay);
+	int ret = KNOT_EOK;
+	if (iovcnt > 0) {
+		ret = tcp_conn_send(conn, fd, iov, iovcnt);
+	}
 
-	/* Cleanup. */
-	knot_pkt_free(&query);
-	knot_pkt_free(&ans);
+	/* Release answered messages, the answers were sent or copied. */
+	tcp_query_t *next = NULL;
+	WALK_LIST_DELSAFE(q, next, conn->queries) {
+		if (!(q->state & (KNOT_STATE_PRODUCE|KNOT_STATE_FAIL))) {
+			tcp_query_free(conn, q);
+			*answered = true;
+		}
+	}
 
 	return ret;
 }
 
+/*! \brief Length of the complete message at the buffer start, 0 if none. */
+static size_t tcp_conn_msglen(const tcp_conn_t *conn)
+{
+	if (conn->rx_len < sizeof(uint16_t)) {
+		return 0;
+	}
+
+	size_t msglen = wire_read_u16(conn->rx);
+	if (conn->rx_len < sizeof(uint16_t) + msglen) {
+		return 0;
+	}
+
+	return msglen;
+}
+
+/*! \brief Start answering of the received complete messages. */
+static int tcp_conn_parse(tcp_conn_t *conn)
+{
+	size_t off = 0;
+	while (conn->nqueries < TCP_PIPELINE_MAX &&
+	       conn->rx_len - off >= sizeof(uint16_t)) {
+		size_t msglen = wire_read_u16(conn->rx + off);
+		if (conn->rx_len - off < sizeof(uint16_t) + msglen) {
+			break;
+		}
+
+		int ret = tcp_query_new(conn, conn->rx + off + sizeof(uint16_t),
+		                        msglen);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+		off += sizeof(uint16_t) + msglen;
+	}
+
+	/* Drop the consumed messages. */
+	conn->rx_len -= off;
+	memmove(conn->rx, conn->rx + off, conn->rx_len);
+
+	return KNOT_EOK;
+}
+
+/*!
+ * \brief Continue answering of the connection messages.
+ *
+ * Answers received messages in rounds until the socket buffer is full,
+ * the round limit is reached or no more complete messages are available.
+ */
+static int tcp_conn_process(tcp_conn_t *conn, int fd, bool *answered)
+{
+	int ret = tcp_conn_flush(conn, fd);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	for (unsigned round = 0; round < TCP_ROUNDS_MAX; ++round) {
+		ret = tcp_conn_parse(conn);
+		if (ret != KNOT_EOK || conn->nqueries == 0) {
+			return ret;
+		}
+
+		ret = tcp_conn_round(conn, fd, answered);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
+	return (conn->nqueries > 0 || tcp_conn_msglen(conn) > 0) ? KNOT_EAGAIN : KNOT_EOK;
+}
+
+/*! \brief Receive available data into the connection buffer. */
+static int tcp_conn_recv(tcp_conn_t *conn, int fd)
+{
+	/* Make room for the whole message if the length is known. */
+	if (conn->rx_len >= sizeof(uint16_t)) {
+		size_t need = sizeof(uint16_t) + wire_read_u16(conn->rx);
+		if (need > conn->rx_size) {
+			uint8_t *rx = realloc(conn->rx, need);
+			if (rx == NULL) {
+				return KNOT_ENOMEM;
+			}
+			conn->rx = rx;
+			conn->rx_size = need;
+		}
+	}
+
+	if (conn->rx_len == conn->rx_size) {
+		return KNOT_EOK;
+	}
+
+	ssize_t ret = recv(fd, conn->rx + conn->rx_len,
+	                   conn->rx_size - conn->rx_len, 0);
+	if (ret == 0) {
+		/* Half-closed, the received messages are still answered. */
+		dbg_net("tcp: client on fd=%d finished sending\n", fd);
+		conn->closing = true;
+		return KNOT_EOK;
+	} else if (ret < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+			return KNOT_EOK;
+		}
+		return KNOT_ECONN;
+	}
+
+	conn->rx_len += ret;
+
+	/* Empty message is not valid. */
+	if (conn->rx_len >= sizeof(uint16_t) && wire_read_u16(conn->rx) == 0) {
+		return KNOT_EMALF;
+	}
+
+	return KNOT_EOK;
+}
+
 int tcp_accept(int fd)
 {
 	/* Accept incoming connection. */
@@ -191,8 +565,7 @@ int tcp_accept(int fd)
 #ifdef SO_RCVTIMEO
 		struct timeval tv;
 		rcu_read_lock();
-		conf_val_t val = conf_get(conf(), C_SRV, C_TCP_IDLE_TIMEOUT);
-		tv.tv_sec = conf_int(&val);
+		tv.tv_sec = conf()->cache.srv_tcp_idle_timeout;
 		rcu_read_unlock();
 		tv.tv_usec = 0;
 		if (setsockopt(incoming, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) < 0) {
@@ -209,101 +582,141 @@ static int tcp_event_accept(tcp_context_t *tcp, unsigned i)
 {
 	/* Accept client. */
 	int fd = tcp->set.pfd[i].fd;
-	int client = tcp_accept(fd);
-	if (client >= 0) {
-		/* Assign to fdset. */
-		int next_id = fdset_add(&tcp->set, client, POLLIN, NULL);
-		if (next_id < 0) {
-			close(client);
-			return next_id; /* Contains errno. */
+	struct sockaddr_storage addr;
+	socklen_t addrlen = sizeof(addr);
+	memset(&addr, 0, sizeof(addr));
+	int client = accept(fd, (struct sockaddr *)&addr, &addrlen);
+	if (client < 0) {
+		if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK) {
+			return KNOT_EBUSY;
 		}
+		return KNOT_ERROR;
+	}
 
-		/* Update watchdog timer. */
-		rcu_read_lock();
-		conf_val_t val = conf_get(conf(), C_SRV, C_TCP_HSHAKE_TIMEOUT);
-		fdset_set_watchdog(&tcp->set, next_id, conf_int(&val));
-		rcu_read_unlock();
+	dbg_net("tcp: accepted connection fd=%d\n", client);
+	if (fcntl(client, F_SETFL, O_NONBLOCK) < 0) {
+		close(client);
+		return KNOT_ERROR;
+	}
 
-		return KNOT_EOK;
+	tcp_conn_t *conn = tcp_conn_new(tcp, client, &addr);
+	if (conn == NULL) {
+		close(client);
+		return KNOT_ENOMEM;
 	}
 
-	return client;
+	/* Assign to fdset. */
+	int next_id = fdset_add(&tcp->set, client, POLLIN, conn);
+	if (next_id < 0) {
+		close(client);
+		tcp_conn_free(conn);
+		return next_id; /* Contains errno. */
+	}
+
+	/* Update watchdog timer. */
+	fdset_set_watchdog(&tcp->set, next_id, tcp->hshake_timeout);
+
+	return KNOT_EOK;
 }
 
-static int tcp_event_serve(tcp_context_t *tcp, unsigned i)
+static int tcp_event_serve(tcp_context_t *tcp, unsigned i, unsigned events)
 {
 	int fd = tcp->set.pfd[i].fd;
-	int ret = tcp_handle(tcp, fd, &tcp->iov[0], &tcp->iov[1]);
+	tcp_conn_t *conn = tcp->set.ctx[i];
+	bool had_output = (conn->tx_len > 0);
 
-	/* Flush per-query memory. */
-	mp_flush(tcp->overlay.mm->ctx);
+	/* Receive only if the client accepts answers and not too busy. */
+	int ret = KNOT_EOK;
+	if ((events & POLLIN) && !conn->closing && conn->tx_len == 0 &&
+	    conn->nqueries < TCP_PIPELINE_MAX) {
+		ret = tcp_conn_recv(conn, fd);
+	}
 
+	bool answered = false;
 	if (ret == KNOT_EOK) {
+		ret = tcp_conn_process(conn, fd, &answered);
+	}
+
+	if (ret == KNOT_EAGAIN) {
+		/* Answers not finished, wait until the socket is writable. */
+		unsigned watch = POLLOUT;
+		if (!conn->closing && conn->tx_len == 0 &&
+		    conn->nqueries < TCP_PIPELINE_MAX) {
+			watch |= POLLIN;
+		}
+		fdset_set_events(&tcp->set, i, watch);
+		if (conn->tx_len > 0 && !had_output) {
+			fdset_set_watchdog(&tcp->set, i, tcp->reply_timeout);
+		}
+		return KNOT_EOK;
+	} else if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	/* Everything answered and sent, close the half-closed connection. */
+	if (conn->closing) {
+		return KNOT_ECONNREFUSED;
+	}
+
+	fdset_set_events(&tcp->set, i, POLLIN);
+	if (answered) {
 		/* Update socket activity timer. */
-		rcu_read_lock();
-		conf_val_t val = conf_get(conf(), C_SRV, C_TCP_IDLE_TIMEOUT);
-		fdset_set_watchdog(&tcp->set, i, conf_int(&val));
-		rcu_read_unlock();
+		fdset_set_watchdog(&tcp->set, i, tcp->idle_timeout);
 	}
 
-	return ret;
+	return KNOT_EOK;
 }
 
 static int tcp_wait_for_events(tcp_context_t *tcp)
 {
 	/* Wait for events. */
 	fdset_t *set = &tcp->set;
-	int nfds = poll(set->pfd, set->n, TCP_SWEEP_INTERVAL * 1000);
+	int nfds = fdset_wait(set, TCP_SWEEP_INTERVAL * 1000);
 
 	/* Mark the time of last poll call. */
 	time_now(&tcp->last_poll_time);
 	bool is_throttled = (tcp->last_poll_time.tv_sec < tcp->throttle_end.tv_sec);
 	if (!is_throttled) {
-		/* Configuration limit, infer maximal pool size. */
-		rcu_read_lock();
-		conf_val_t val = conf_get(conf(), C_SRV, C_MAX_TCP_CLIENTS);
-		unsigned max_per_set = MAX(conf_int(&val) / conf_tcp_threads(conf()), 1);
-		rcu_read_unlock();
 		/* Subtract master sockets check limits. */
-		is_throttled = (set->n - tcp->client_threshold) >= max_per_set;
+		is_throttled = (set->n - tcp->client_threshold) >= tcp->max_per_set;
 	}
 
 	/* Process events. */
-	unsigned i = 0;
-	while (nfds > 0 && i < set->n) {
+	int i = 0;
+	unsigned events = 0;
+	while ((i = fdset_next(set, &events)) >= 0) {
 		bool should_close = false;
-		int fd = set->pfd[i].fd;
-		if (set->pfd[i].revents & (POLLERR|POLLHUP|POLLNVAL)) {
-			should_close = (i >= tcp->client_threshold);
-			--nfds;
-		} else if (set->pfd[i].revents & (POLLIN)) {
+		if (i < tcp->client_threshold) {
 			/* Master sockets */
-			if (i < tcp->client_threshold) {
-				if (!is_throttled && tcp_event_accept(tcp, i) == KNOT_EBUSY) {
-					time_now(&tcp->throttle_end);
-					tcp->throttle_end.tv_sec += tcp_throttle();
-				}
-			/* Client sockets */
-			} else {
-				if (tcp_event_serve(tcp, i) != KNOT_EOK) {
-					should_close = true;
-				}
+			if ((events & POLLIN) && !is_throttled &&
+			    tcp_event_accept(tcp, i) == KNOT_EBUSY) {
+				time_now(&tcp->throttle_end);
+				tcp->throttle_end.tv_sec += tcp_throttle();
 			}
-			--nfds;
+		} else if (events & (POLLIN|POLLOUT)) {
+			/* Client sockets */
+			should_close = (tcp_event_serve(tcp, i, events) != KNOT_EOK);
+		} else if (events & (POLLERR|POLLHUP|POLLNVAL)) {
+			should_close = true;
 		}
 
 		/* Evaluate */
 		if (should_close) {
-			fdset_remove(set, i);
-			close(fd);
-		} else {
-			++i;
+			tcp_conn_close(set, i);
 		}
 	}
 
 	return nfds;
 }
 
+/*! \brief Close all client connections. */
+static void tcp_close_clients(tcp_context_t *tcp)
+{
+	while (tcp->set.n > tcp->client_threshold) {
+		tcp_conn_close(&tcp->set, tcp->set.n - 1);
+	}
+}
+
 int tcp_master(dthread_t *thread)
 {
 	if (!thread || !thread->data) {
@@ -313,34 +726,18 @@ int tcp_master(dthread_t *thread)
 	iohandler_t *handler = (iohandler_t *)thread->data;
 	unsigned *iostate = &handler->thread_state[dt_get_id(thread)];
 
-	int ret = KNOT_EOK;
 	ref_t *ref = NULL;
 	tcp_context_t tcp;
 	memset(&tcp, 0, sizeof(tcp_context_t));
 
-	/* Create big enough memory cushion. */
-	mm_ctx_t mm;
-	mm_ctx_mempool(&mm, 16 * MM_DEFAULT_BLKSIZE);
-
 	/* Create TCP answering context. */
 	tcp.server = handler->server;
 	tcp.thread_id = handler->thread_id[dt_get_id(thread)];
-	tcp.overlay.mm = &mm;
 
 	/* Prepare structures for bound sockets. */
 	conf_val_t val = conf_get(conf(), C_SRV, C_LISTEN);
 	fdset_init(&tcp.set, conf_val_count(&val) + CONF_XFERS);
 
-	/* Create iovec abstraction. */
-	for (unsigned i = 0; i < 2; ++i) {
-		tcp.iov[i].iov_len = KNOT_WIRE_MAX_PKTSIZE;
-		tcp.iov[i].iov_base = malloc(tcp.iov[i].iov_len);
-		if (tcp.iov[i].iov_base == NULL) {
-			ret = KNOT_ENOMEM;
-			goto finish;
-		}
-	}
-
 	/* Initialize sweep interval. */
 	timev_t next_sweep = {0};
 	time_now(&next_sweep);
@@ -353,17 +750,27 @@ int tcp_master(dthread_t *thread)
 			*iostate &= ~ServerReload;
 
 			/* Cancel client connections. */
-			for (unsigned i = tcp.client_threshold; i < tcp.set.n; ++i) {
-				close(tcp.set.pfd[i].fd);
-			}
+			tcp_close_clients(&tcp);
 
 			ref_release(ref);
-			ref = server_set_ifaces(handler->server, &tcp.set, IO_TCP);
+			ref = server_set_ifaces(handler->server, &tcp.set, IO_TCP,
+			                        dt_get_id(thread));
 			if (tcp.set.n == 0) {
 				break; /* Terminate on zero interfaces. */
 			}
 
 			tcp.client_threshold = tcp.set.n;
+
+			/* Resolve configuration used by the connections. */
+			rcu_read_lock();
+			tcp.answer_cache = answer_cache_resize(tcp.answer_cache,
+			                                       conf()->cache.srv_answer_cache);
+			tcp.max_per_set = MAX(conf()->cache.srv_max_tcp_clients /
+			                      conf()->cache.srv_tcp_threads, 1);
+			tcp.hshake_timeout = conf()->cache.srv_tcp_hshake_timeout;
+			tcp.idle_timeout = conf()->cache.srv_tcp_idle_timeout;
+			tcp.reply_timeout = conf()->cache.srv_tcp_reply_timeout;
+			rcu_read_unlock();
 		}
 
 		/* Check for cancellation. */
@@ -382,12 +789,10 @@ int tcp_master(dthread_t *thread)
 		}
 	}
 
-finish:
-	free(tcp.iov[0].iov_base);
-	free(tcp.iov[1].iov_base);
-	mp_delete(mm.ctx);
+	tcp_close_clients(&tcp);
 	fdset_clear(&tcp.set);
 	ref_release(ref);
+	answer_cache_free(tcp.answer_cache);
 
-	return ret;
+	return KNOT_EOK;
 }
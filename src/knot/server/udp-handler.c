@@ -39,6 +39,7 @@
 
 #include "knot/server/udp-handler.h"
 #include "knot/server/server.h"
+#include "knot/nameserver/answer_cache.h"
 #include "libknot/internal/sockaddr.h"
 #include "libknot/internal/mempattern.h"
 #include "libknot/internal/mempool.h"
@@ -58,6 +59,7 @@ typedef struct udp_context {
 	struct knot_overlay overlay; /*!< Query processing overlay. */
 	server_t *server;            /*!< Name server structure. */
 	unsigned thread_id;          /*!< Thread identifier. */
+	answer_cache_t *answer_cache;/*!< Thread answer cache. */
 } udp_context_t;
 
 /* FD_COPY macro compat. */
@@ -118,6 +120,7 @@ void udp_handle(udp_context_t *udp, int fd, struct sockaddr_storage *ss,
 	param.socket = fd;
 	param.server = udp->server;
 	param.thread_id = udp->thread_id;
+	param.answer_cache = udp->answer_cache;
 
 	/* Rate limit is applied? */
 	if (unlikely(udp->server->rrl != NULL) && udp->server->rrl->rate > 0) {
@@ -134,7 +137,7 @@ void udp_handle(udp_context_t *udp, int fd, struct sockaddr_storage *ss,
 	knot_overlay_add(&udp->overlay, NS_PROC_QUERY, &param);
 
 	/* Input packet. */
-	(void) knot_pkt_parse(query, 0);
+	(void) knot_pkt_parse(query, KNOT_PF_LAZY);
 	int state = knot_overlay_consume(&udp->overlay, query);
 
 	/* Process answer. */
@@ -448,8 +451,9 @@ static void forget_ifaces(ifacelist_t *ifaces, fd_set *set, int maxfd)
 	FD_ZERO(set);
 }
 
-/*! \brief Add interface sockets to the watched fdset. */
-static int track_ifaces(ifacelist_t *ifaces, fd_set *set, int *maxfd, int *minfd)
+/*! \brief Add interface sockets assigned to the thread to the watched fdset. */
+static int track_ifaces(ifacelist_t *ifaces, fd_set *set, int *maxfd, int *minfd,
+                        unsigned thread_id)
 {
 	FD_ZERO(set);
 	*maxfd = -1;
@@ -461,7 +465,7 @@ static int track_ifaces(ifacelist_t *ifaces, fd_set *set, int *maxfd, int *minfd
 
 	iface_t *iface = NULL;
 	WALK_LIST(iface, ifaces->l) {
-		int fd = iface->fd[IO_UDP];
+		int fd = iface_udp_fd(iface, thread_id);
 		*maxfd = MAX(fd, *maxfd);
 		*minfd = MIN(fd, *minfd);
 		FD_SET(fd, set);
@@ -472,12 +476,6 @@ static int track_ifaces(ifacelist_t *ifaces, fd_set *set, int *maxfd, int *minfd
 
 int udp_master(dthread_t *thread)
 {
-	unsigned cpu = dt_online_cpus();
-	if (cpu > 1) {
-		unsigned cpu_mask = (dt_get_id(thread) % cpu);
-		dt_setaffinity(thread, &cpu_mask, 1);
-	}
-
 	/* Drop all capabilities on all workers. */
 #ifdef HAVE_CAP_NG_H
         if (capng_have_capability(CAPNG_EFFECTIVE, CAP_SETPCAP)) {
@@ -522,9 +520,11 @@ int udp_master(dthread_t *thread)
 			udp.thread_id = handler->thread_id[thr_id];
 
 			rcu_read_lock();
+			udp.answer_cache = answer_cache_resize(udp.answer_cache,
+			                                       conf()->cache.srv_answer_cache);
 			forget_ifaces(ref, &fds, maxfd);
 			ref = handler->server->ifaces;
-			track_ifaces(ref, &fds, &maxfd, &minfd);
+			track_ifaces(ref, &fds, &maxfd, &minfd, thr_id);
 			rcu_read_unlock();
 		}
 
@@ -557,6 +557,7 @@ int udp_master(dthread_t *thread)
 
 	_udp_deinit(rq);
 	forget_ifaces(ref, &fds, maxfd);
+	answer_cache_free(udp.answer_cache);
 	mp_delete(mm.ctx);
 	return KNOT_EOK;
 }
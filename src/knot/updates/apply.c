@@ -23,6 +23,7 @@
 #include "libknot/libknot.h"
 #include "libknot/internal/lists.h"
 #include "libknot/internal/macros.h"
+#include "libknot/packet/rrset-wire.h"
 
 /* --------------------------- Update cleanup ------------------------------- */
 
@@ -42,14 +43,10 @@ static void rrs_list_clear(list_t *l, mm_ctx_t *mm)
 	};
 }
 
-/*! \brief Frees additional data from single node */
+/*! \brief Frees additional data and wire images from single node */
 static int free_additional(zone_node_t **node, void *data)
 {
 	UNUSED(data);
-	if ((*node)->flags & NODE_FLAGS_NONAUTH) {
-		// non-auth nodes have no additionals.
-		return KNOT_EOK;
-	}
 
 	for (uint16_t i = 0; i < (*node)->rrset_count; ++i) {
 		struct rr_data *data = &(*node)->rrs[i];
@@ -57,11 +54,23 @@ static int free_additional(zone_node_t **node, void *data)
 			free(data->additional);
 			data->additional = NULL;
 		}
+		knot_rrset_image_free(&data->image, NULL);
 	}
 
 	return KNOT_EOK;
 }
 
+/*! \brief Frees additional data of the removed RRSet, copied from the old node. */
+static void free_rrset_additional(zone_node_t *node, uint16_t type)
+{
+	for (uint16_t i = 0; i < node->rrset_count; ++i) {
+		if (node->rrs[i].type == type) {
+			free(node->rrs[i].additional);
+			node->rrs[i].additional = NULL;
+		}
+	}
+}
+
 /* ------------------------- Empty node cleanup ----------------------------- */
 
 /*! \brief Clears wildcard child if set in parent node. */
@@ -90,7 +99,7 @@ static void delete_empty_node(zone_tree_t *tree, zone_node_t *node)
 		zone_node_t *removed_node = NULL;
 		zone_tree_remove(tree, node->owner, &removed_node);
 		UNUSED(removed_node);
-		node_free(&node, NULL);
+		node_free(&node, zone_arena_heap_mm());
 	}
 }
 
@@ -118,8 +127,9 @@ static int replace_rdataset_with_copy(zone_node_t *node, uint16_t type)
 
 	memcpy(copy, rrs->data, knot_rdataset_size(rrs));
 
-	// Store new data into node RRS.
+	// Store new data into node RRS, the image of old data is not valid.
 	rrs->data = copy;
+	knot_rrset_image_free(&data->image, NULL);
 
 	return KNOT_EOK;
 }
@@ -194,8 +204,8 @@ static bool rrset_is_nsec3rel(const knot_rrset_t *rr)
 }
 
 /*! \brief Removes single RR from zone contents. */
-static int remove_rr(zone_tree_t *tree, zone_node_t *node,
-                     const knot_rrset_t *rr, changeset_t *chset)
+static int remove_rr(zone_node_t *node, const knot_rrset_t *rr,
+                     changeset_t *chset)
 {
 	knot_rrset_t removed_rrset = node_rrset(node, rr->type);
 	knot_rdata_t *old_data = removed_rrset.rrs.data;
@@ -228,11 +238,9 @@ static int remove_rr(zone_tree_t *tree, zone_node_t *node,
 		}
 	} else {
 		// RRSet is empty now, remove it from node, all data freed.
+		// Empty node is deleted after all changes are applied.
+		free_rrset_additional(node, rr->type);
 		node_remove_rdataset(node, rr->type);
-		// If node is empty now, delete it from zone tree.
-		if (node->rrset_count == 0) {
-			delete_empty_node(tree, node);
-		}
 	}
 
 	return KNOT_EOK;
@@ -254,9 +262,7 @@ static int apply_remove(zone_contents_t *contents, changeset_t *chset)
 			continue;
 		}
 
-		zone_tree_t *tree = rrset_is_nsec3rel(&rr) ?
-		                    contents->nsec3_nodes : contents->nodes;
-		int ret = remove_rr(tree, node, &rr, chset);
+		int ret = remove_rr(node, &rr, chset);
 		if (ret != KNOT_EOK) {
 			changeset_iter_clear(&itt);
 			return ret;
@@ -291,7 +297,7 @@ static int add_rr(const zone_contents_t *zone, zone_node_t *node,
 	}
 
 	// Insert new RR to RRSet, data will be copied.
-	int ret = node_add_rrset(node, rr, NULL);
+	int ret = node_add_rrset(node, rr, zone_arena_heap_mm());
 	if (ret == KNOT_EOK || ret == KNOT_ETTL) {
 		// RR added, store for possible rollback.
 		knot_rdataset_t *rrs = node_rdataset(node, rr->type);
@@ -346,7 +352,7 @@ static int apply_add(zone_contents_t *contents, changeset_t *chset,
 static int apply_replace_soa(zone_contents_t *contents, changeset_t *chset)
 {
 	assert(chset->soa_from && chset->soa_to);
-	int ret = remove_rr(contents->nodes, contents->apex, chset->soa_from, chset);
+	int ret = remove_rr(contents->apex, chset->soa_from, chset);
 	if (ret != KNOT_EOK) {
 		return ret;
 	}
@@ -385,6 +391,49 @@ static int apply_single(zone_contents_t *contents, changeset_t *chset,
 	return apply_replace_soa(contents, chset);
 }
 
+/*!
+ * \brief Deletes nodes emptied by the changeset and stores changed owners.
+ *
+ * Nodes are deleted only after all changesets are applied, so that a node
+ * removed and added again keeps its place and the pointers to it. Owners are
+ * stored only if \a owners is set.
+ */
+static int finalize_single(zone_contents_t *contents, const changeset_t *chset,
+                           list_t *owners, list_t *nsec3_owners)
+{
+	changeset_iter_t itt;
+	int ret = changeset_iter_all(&itt, chset, false);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	knot_rrset_t rr = changeset_iter_next(&itt);
+	while (!knot_rrset_empty(&rr)) {
+		const bool nsec3 = rrset_is_nsec3rel(&rr);
+		zone_node_t *node = zone_contents_find_node_for_rr(contents, &rr);
+		if (node != NULL) {
+			delete_empty_node(nsec3 ? contents->nsec3_nodes :
+			                          contents->nodes, node);
+		}
+
+		if (owners != NULL &&
+		    ptrlist_add(nsec3 ? nsec3_owners : owners, rr.owner, NULL) == NULL) {
+			changeset_iter_clear(&itt);
+			return KNOT_ENOMEM;
+		}
+
+		rr = changeset_iter_next(&itt);
+	}
+	changeset_iter_clear(&itt);
+
+	if (owners != NULL &&
+	    ptrlist_add(owners, chset->soa_to->owner, NULL) == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	return KNOT_EOK;
+}
+
 /* --------------------- Zone copy and finalization ------------------------- */
 
 /*! \brief Creates a shallow zone contents copy. */
@@ -414,18 +463,26 @@ static int prepare_zone_copy(zone_contents_t *old_contents,
 	return KNOT_EOK;
 }
 
-/*! \brief Removes empty nodes from updated zone a does zone adjusting. */
+/*!
+ * \brief Does zone adjusting of the updated zone.
+ *
+ * If \a old_contents is set, the updated copy was created from it and only
+ * nodes around the changed \a owners and \a nsec3_owners are adjusted.
+ */
 static int finalize_updated_zone(zone_contents_t *contents_copy,
-                                 bool set_nsec3_names)
+                                 const zone_contents_t *old_contents,
+                                 const list_t *owners,
+                                 const list_t *nsec3_owners)
 {
 	if (contents_copy == NULL) {
 		return KNOT_EINVAL;
 	}
 
-	if (set_nsec3_names) {
-		return zone_contents_adjust_full(contents_copy, NULL, NULL);
+	if (old_contents != NULL) {
+		return zone_contents_adjust_update(contents_copy, old_contents,
+		                                   owners, nsec3_owners);
 	} else {
-		return zone_contents_adjust_pointers(contents_copy);
+		return zone_contents_adjust_full(contents_copy, NULL, NULL);
 	}
 }
 
@@ -463,7 +520,22 @@ int apply_changesets(zone_t *zone, list_t *chsets, zone_contents_t **new_content
 
 	assert(contents_copy->apex != NULL);
 
-	ret = finalize_updated_zone(contents_copy, true);
+	list_t owners, nsec3_owners;
+	init_list(&owners);
+	init_list(&nsec3_owners);
+	WALK_LIST(set, *chsets) {
+		ret = finalize_single(contents_copy, set, &owners, &nsec3_owners);
+		if (ret != KNOT_EOK) {
+			break;
+		}
+	}
+
+	if (ret == KNOT_EOK) {
+		ret = finalize_updated_zone(contents_copy, old_contents,
+		                            &owners, &nsec3_owners);
+	}
+	ptrlist_free(&owners, NULL);
+	ptrlist_free(&nsec3_owners, NULL);
 	if (ret != KNOT_EOK) {
 		updates_rollback(chsets);
 		update_free_zone(&contents_copy);
@@ -499,7 +571,16 @@ int apply_changeset(zone_t *zone, changeset_t *change, zone_contents_t **new_con
 		return ret;
 	}
 
-	ret = finalize_updated_zone(contents_copy, true);
+	list_t owners, nsec3_owners;
+	init_list(&owners);
+	init_list(&nsec3_owners);
+	ret = finalize_single(contents_copy, change, &owners, &nsec3_owners);
+	if (ret == KNOT_EOK) {
+		ret = finalize_updated_zone(contents_copy, old_contents,
+		                            &owners, &nsec3_owners);
+	}
+	ptrlist_free(&owners, NULL);
+	ptrlist_free(&nsec3_owners, NULL);
 	if (ret != KNOT_EOK) {
 		update_rollback(change);
 		update_free_zone(&contents_copy);
@@ -527,7 +608,16 @@ int apply_changesets_directly(zone_contents_t *contents, list_t *chsets)
 		}
 	}
 
-	int ret = finalize_updated_zone(contents, true);
+	int ret = KNOT_EOK;
+	WALK_LIST(set, *chsets) {
+		ret = finalize_single(contents, set, NULL, NULL);
+		if (ret != KNOT_EOK) {
+			updates_cleanup(chsets);
+			return ret;
+		}
+	}
+
+	ret = finalize_updated_zone(contents, NULL, NULL, NULL);
 	if (ret != KNOT_EOK) {
 		updates_cleanup(chsets);
 	}
@@ -543,12 +633,15 @@ int apply_changeset_directly(zone_contents_t *contents, changeset_t *ch)
 
 	const bool master = true; // Only DNSSEC changesets are applied directly.
 	int ret = apply_single(contents, ch, master);
+	if (ret == KNOT_EOK) {
+		ret = finalize_single(contents, ch, NULL, NULL);
+	}
 	if (ret != KNOT_EOK) {
 		update_cleanup(ch);
 		return ret;
 	}
 
-	ret = finalize_updated_zone(contents, true);
+	ret = finalize_updated_zone(contents, NULL, NULL, NULL);
 	if (ret != KNOT_EOK) {
 		update_cleanup(ch);
 		return ret;
@@ -560,8 +653,8 @@ int apply_changeset_directly(zone_contents_t *contents, changeset_t *ch)
 void update_cleanup(changeset_t *change)
 {
 	if (change) {
-		// Delete old RR data
-		rrs_list_clear(&change->old_data, NULL);
+		// Delete old RR data, these may be allocated from an arena.
+		rrs_list_clear(&change->old_data, zone_arena_heap_mm());
 		init_list(&change->old_data);
 		// Keep new RR data
 		ptrlist_free(&change->new_data, NULL);
@@ -606,11 +699,9 @@ void updates_rollback(list_t *chgs)
 void update_free_zone(zone_contents_t **contents)
 {
 	zone_tree_apply((*contents)->nodes, free_additional, NULL);
+	zone_tree_apply((*contents)->nsec3_nodes, free_additional, NULL);
 	zone_tree_deep_free(&(*contents)->nodes);
 	zone_tree_deep_free(&(*contents)->nsec3_nodes);
 
-	knot_nsec3param_free(&(*contents)->nsec3_params);
-
-	free(*contents);
-	*contents = NULL;
+	zone_contents_free(contents);
 }
@@ -33,6 +33,49 @@ static int add_rr_to_zone(zone_contents_t *z, const knot_rrset_t *rrset)
 	return ret;
 }
 
+/*!
+ * \brief Removes RRs of the RRSet from a changeset part.
+ *
+ * \param z        Changeset part to remove the RRs from.
+ * \param rr       RRs to cancel out.
+ * \param cmp_ttl  Cancel out only RRs with the same TTL.
+ * \param rest     Output RRs not found in the changeset part.
+ */
+static int cancel_out(zone_contents_t *z, const knot_rrset_t *rr, bool cmp_ttl,
+                      knot_rrset_t *rest)
+{
+	knot_rrset_init(rest, rr->owner, rr->type, rr->rclass);
+
+	zone_node_t *node = zone_contents_find_node_for_rr(z, rr);
+	knot_rdataset_t *rrs = node_rdataset(node, rr->type);
+
+	for (uint16_t i = 0; i < rr->rrs.rr_count; ++i) {
+		knot_rdata_t *rdata = knot_rdataset_at(&rr->rrs, i);
+		if (rrs == NULL || !knot_rdataset_member(rrs, rdata, cmp_ttl)) {
+			int ret = knot_rdataset_add(&rest->rrs, rdata, NULL);
+			if (ret != KNOT_EOK) {
+				knot_rdataset_clear(&rest->rrs, NULL);
+				return ret;
+			}
+			continue;
+		}
+
+		/* Added and removed again (or vice versa), drop both. */
+		knot_rdataset_t cancelled = { .rr_count = 1, .data = rdata };
+		int ret = knot_rdataset_subtract(rrs, &cancelled, &z->mm);
+		if (ret != KNOT_EOK) {
+			knot_rdataset_clear(&rest->rrs, NULL);
+			return ret;
+		}
+		if (rrs->rr_count == 0) {
+			node_remove_rdataset(node, rr->type);
+			rrs = NULL;
+		}
+	}
+
+	return KNOT_EOK;
+}
+
 /*! \brief Cleans up trie iterations. */
 static void cleanup_iter_list(list_t *l)
 {
@@ -221,12 +264,18 @@ int changeset_rem_rrset(changeset_t *ch, const knot_rrset_t *rrset)
 
 int changeset_merge(changeset_t *ch1, const changeset_t *ch2)
 {
+	/* Removals go first, as when the changeset is applied. */
 	changeset_iter_t itt;
-	changeset_iter_add(&itt, ch2, false);
+	changeset_iter_rem(&itt, ch2, false);
 
 	knot_rrset_t rrset = changeset_iter_next(&itt);
 	while (!knot_rrset_empty(&rrset)) {
-		int ret = changeset_add_rrset(ch1, &rrset);
+		knot_rrset_t rest;
+		int ret = cancel_out(ch1->add, &rrset, false, &rest);
+		if (ret == KNOT_EOK && !knot_rrset_empty(&rest)) {
+			ret = changeset_rem_rrset(ch1, &rest);
+		}
+		knot_rdataset_clear(&rest.rrs, NULL);
 		if (ret != KNOT_EOK) {
 			changeset_iter_clear(&itt);
 			return ret;
@@ -235,11 +284,16 @@ int changeset_merge(changeset_t *ch1, const changeset_t *ch2)
 	}
 	changeset_iter_clear(&itt);
 
-	changeset_iter_rem(&itt, ch2, false);
+	changeset_iter_add(&itt, ch2, false);
 
 	rrset = changeset_iter_next(&itt);
 	while (!knot_rrset_empty(&rrset)) {
-		int ret = changeset_rem_rrset(ch1, &rrset);
+		knot_rrset_t rest;
+		int ret = cancel_out(ch1->remove, &rrset, true, &rest);
+		if (ret == KNOT_EOK && !knot_rrset_empty(&rest)) {
+			ret = changeset_add_rrset(ch1, &rest);
+		}
+		knot_rdataset_clear(&rest.rrs, NULL);
 		if (ret != KNOT_EOK) {
 			changeset_iter_clear(&itt);
 			return ret;
@@ -109,7 +109,11 @@ int changeset_add_rrset(changeset_t *ch, const knot_rrset_t *rrset);
 int changeset_rem_rrset(changeset_t *ch, const knot_rrset_t *rrset);
 
 /*!
- * \brief Merges two changesets together. Legacy, to be removed with new zone API.
+ * \brief Merges two changesets together.
+ *
+ * The result has the same effect as applying both changesets in turn.
+ * RRs added by the first changeset and removed by the second one (and vice
+ * versa) cancel each other out.
  *
  * \param ch1  Merge into this changeset.
  * \param ch2  Merge this changeset.
@@ -36,6 +36,7 @@ struct worker_pool {
 	bool terminating;	/*!< Is the pool terminating? .*/
 	bool suspended;		/*!< Is execution temporarily suspended? .*/
 	int running;		/*!< Number of running threads. */
+	size_t completed;	/*!< Number of tasks completed since reset. */
 	worker_queue_t tasks;
 };
 
@@ -79,6 +80,7 @@ static int worker_main(dthread_t *thread)
 		pthread_mutex_lock(&pool->lock);
 
 		pool->running -= 1;
+		pool->completed += 1;
 		pthread_cond_broadcast(&pool->wake);
 	}
 
@@ -136,6 +138,16 @@ void worker_pool_destroy(worker_pool_t *pool)
 	free(pool);
 }
 
+int worker_pool_setaffinity(worker_pool_t *pool, const unsigned *cpu_id,
+                            size_t cpu_count)
+{
+	if (!pool) {
+		return KNOT_EINVAL;
+	}
+
+	return dt_unit_setaffinity(pool->threads, cpu_id, cpu_count, false);
+}
+
 void worker_pool_start(worker_pool_t *pool)
 {
 	if (!pool) {
@@ -227,3 +239,30 @@ void worker_pool_clear(worker_pool_t *pool)
 	worker_queue_init(&pool->tasks);
 	pthread_mutex_unlock(&pool->lock);
 }
+
+void worker_pool_status(worker_pool_t *pool, int *running, int *queued,
+                        size_t *completed)
+{
+	if (!pool) {
+		*running = *queued = 0;
+		*completed = 0;
+		return;
+	}
+
+	pthread_mutex_lock(&pool->lock);
+	*running = pool->running;
+	*queued = list_size(&pool->tasks.list);
+	*completed = pool->completed;
+	pthread_mutex_unlock(&pool->lock);
+}
+
+void worker_pool_reset_completed(worker_pool_t *pool)
+{
+	if (!pool) {
+		return;
+	}
+
+	pthread_mutex_lock(&pool->lock);
+	pool->completed = 0;
+	pthread_mutex_unlock(&pool->lock);
+}
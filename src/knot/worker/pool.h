@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include <stddef.h>
+
 #include "knot/worker/queue.h"
 
 struct worker_pool;
@@ -35,6 +37,12 @@ worker_pool_t *worker_pool_create(unsigned threads);
  */
 void worker_pool_destroy(worker_pool_t *pool);
 
+/*!
+ * \brief Restrict worker threads to given CPUs (empty list clears it).
+ */
+int worker_pool_setaffinity(worker_pool_t *pool, const unsigned *cpu_id,
+                            size_t cpu_count);
+
 /*!
  * \brief Start all threads in the worker pool.
  */
@@ -75,3 +83,14 @@ void worker_pool_assign(worker_pool_t *pool, struct task *task);
  * \brief Clear all tasks enqueued in pool processing queue.
  */
 void worker_pool_clear(worker_pool_t *pool);
+
+/*!
+ * \brief Get the number of running, enqueued, and completed tasks.
+ */
+void worker_pool_status(worker_pool_t *pool, int *running, int *queued,
+                        size_t *completed);
+
+/*!
+ * \brief Reset the number of completed tasks.
+ */
+void worker_pool_reset_completed(worker_pool_t *pool);
@@ -0,0 +1,288 @@
+/*  Copyright (C) 2015 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "knot/zone/arena.h"
+#include "knot/common/ref.h"
+
+/*! \brief Alignment of the arena blocks. */
+#define ARENA_ALIGN 8
+
+/*! \brief Blocks larger than this get a chunk of their own. */
+#define ARENA_LARGE (ZONE_ARENA_CHUNK / 4)
+
+/*! \brief Chunk header, stored at the beginning of each mapping. */
+struct chunk {
+	struct chunk *next;
+	size_t size;
+};
+
+struct zone_arena {
+	ref_t ref;
+	struct chunk *chunks; /*!< Mapped chunks, the current one first. */
+	size_t used;          /*!< Used bytes in the current chunk. */
+	size_t size;          /*!< Total mapped size. */
+};
+
+/*!
+ * \brief Address ranges of all mapped chunks.
+ *
+ * Sorted by the chunk address, used to tell arena blocks from heap blocks.
+ */
+static struct {
+	pthread_rwlock_t lock;
+	struct chunk **chunks;
+	size_t count;
+	size_t capacity;
+} registry = { PTHREAD_RWLOCK_INITIALIZER, NULL, 0, 0 };
+
+/*! \brief Find position of the chunk containing or preceding the address. */
+static size_t registry_pos(const void *ptr)
+{
+	size_t lo = 0, hi = registry.count;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if ((const void *)registry.chunks[mid] <= ptr) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	return lo;
+}
+
+static int registry_add(struct chunk *chunk)
+{
+	pthread_rwlock_wrlock(&registry.lock);
+
+	if (registry.count == registry.capacity) {
+		size_t capacity = registry.capacity ? 2 * registry.capacity : 64;
+		void *chunks = realloc(registry.chunks, capacity * sizeof(struct chunk *));
+		if (chunks == NULL) {
+			pthread_rwlock_unlock(&registry.lock);
+			return -1;
+		}
+		registry.chunks = chunks;
+		registry.capacity = capacity;
+	}
+
+	size_t pos = registry_pos(chunk);
+	memmove(registry.chunks + pos + 1, registry.chunks + pos,
+	        (registry.count - pos) * sizeof(struct chunk *));
+	registry.chunks[pos] = chunk;
+	registry.count += 1;
+
+	pthread_rwlock_unlock(&registry.lock);
+	return 0;
+}
+
+static void registry_remove(struct chunk *chunk)
+{
+	pthread_rwlock_wrlock(&registry.lock);
+
+	size_t pos = registry_pos(chunk);
+	if (pos > 0 && registry.chunks[pos - 1] == chunk) {
+		memmove(registry.chunks + pos - 1, registry.chunks + pos,
+		        (registry.count - pos) * sizeof(struct chunk *));
+		registry.count -= 1;
+	}
+
+	pthread_rwlock_unlock(&registry.lock);
+}
+
+static bool registry_contains(const void *ptr)
+{
+	pthread_rwlock_rdlock(&registry.lock);
+
+	bool found = false;
+	size_t pos = registry_pos(ptr);
+	if (pos > 0) {
+		const struct chunk *chunk = registry.chunks[pos - 1];
+		found = (const uint8_t *)ptr < (const uint8_t *)chunk + chunk->size;
+	}
+
+	pthread_rwlock_unlock(&registry.lock);
+	return found;
+}
+
+static struct chunk *chunk_map(size_t size)
+{
+	void *mem = mmap(NULL, size, PROT_READ | PROT_WRITE,
+	                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (mem == MAP_FAILED) {
+		return NULL;
+	}
+
+	struct chunk *chunk = mem;
+	chunk->next = NULL;
+	chunk->size = size;
+
+	if (registry_add(chunk) != 0) {
+		munmap(mem, size);
+		return NULL;
+	}
+
+	return chunk;
+}
+
+static void chunk_unmap(struct chunk *chunk)
+{
+	registry_remove(chunk);
+	munmap(chunk, chunk->size);
+}
+
+static size_t align(size_t size, size_t to)
+{
+	return (size + to - 1) & ~(to - 1);
+}
+
+#define HEADER_SIZE align(sizeof(struct chunk), ARENA_ALIGN)
+
+/*! \brief Map a chunk of its own for a large block. */
+static void *arena_alloc_large(zone_arena_t *arena, size_t size)
+{
+	size_t page = (size_t)sysconf(_SC_PAGESIZE);
+	struct chunk *chunk = chunk_map(align(HEADER_SIZE + size, page));
+	if (chunk == NULL) {
+		return NULL;
+	}
+
+	/* Keep the current chunk first. */
+	if (arena->chunks != NULL) {
+		chunk->next = arena->chunks->next;
+		arena->chunks->next = chunk;
+	} else {
+		chunk->next = NULL;
+		arena->chunks = chunk;
+		arena->used = chunk->size;
+	}
+	arena->size += chunk->size;
+
+	return (uint8_t *)chunk + HEADER_SIZE;
+}
+
+static void *arena_alloc(void *ctx, size_t size)
+{
+	zone_arena_t *arena = ctx;
+
+	size = align(size, ARENA_ALIGN);
+	if (size > ARENA_LARGE) {
+		return arena_alloc_large(arena, size);
+	}
+
+	struct chunk *chunk = arena->chunks;
+	if (chunk == NULL || arena->used + size > chunk->size) {
+		chunk = chunk_map(ZONE_ARENA_CHUNK);
+		if (chunk == NULL) {
+			return NULL;
+		}
+		chunk->next = arena->chunks;
+		arena->chunks = chunk;
+		arena->used = HEADER_SIZE;
+		arena->size += chunk->size;
+	}
+
+	void *ret = (uint8_t *)chunk + arena->used;
+	arena->used += size;
+
+	return ret;
+}
+
+static void *heap_alloc(void *ctx, size_t size)
+{
+	(void)ctx;
+	return malloc(size);
+}
+
+static void arena_destroy(ref_t *ref)
+{
+	zone_arena_t *arena = (zone_arena_t *)ref;
+
+	struct chunk *chunk = arena->chunks;
+	while (chunk != NULL) {
+		struct chunk *next = chunk->next;
+		chunk_unmap(chunk);
+		chunk = next;
+	}
+
+	free(arena);
+}
+
+zone_arena_t *zone_arena_new(void)
+{
+	zone_arena_t *arena = calloc(1, sizeof(zone_arena_t));
+	if (arena == NULL) {
+		return NULL;
+	}
+
+	ref_init(&arena->ref, arena_destroy);
+	ref_retain(&arena->ref);
+
+	return arena;
+}
+
+zone_arena_t *zone_arena_ref(zone_arena_t *arena)
+{
+	if (arena != NULL) {
+		ref_retain(&arena->ref);
+	}
+
+	return arena;
+}
+
+void zone_arena_unref(zone_arena_t *arena)
+{
+	if (arena != NULL) {
+		ref_release(&arena->ref);
+	}
+}
+
+size_t zone_arena_size(const zone_arena_t *arena)
+{
+	return (arena != NULL) ? arena->size : 0;
+}
+
+void zone_arena_free(void *ptr)
+{
+	if (ptr != NULL && !registry_contains(ptr)) {
+		free(ptr);
+	}
+}
+
+mm_ctx_t *zone_arena_heap_mm(void)
+{
+	static mm_ctx_t heap_mm = { NULL, heap_alloc, zone_arena_free };
+	return &heap_mm;
+}
+
+void zone_arena_mm(zone_arena_t *arena, mm_ctx_t *mm)
+{
+	if (mm == NULL) {
+		return;
+	}
+
+	mm->ctx = arena;
+	mm->alloc = (arena != NULL) ? arena_alloc : heap_alloc;
+	mm->free = zone_arena_free;
+}
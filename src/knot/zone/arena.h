@@ -0,0 +1,85 @@
+/*!
+ * \file arena.h
+ *
+ * \brief Memory arena for zone contents.
+ *
+ * The arena hands out memory from large anonymous mappings using a simple
+ * bump allocator. Individual blocks are never freed, the whole arena is
+ * unmapped at once when the last zone version referencing it goes away.
+ *
+ * Zone data allocated from the arena and from the heap may be mixed in a
+ * single zone version (e.g. nodes changed by an incremental update), so the
+ * free callback of the arena memory context recognizes arena blocks and
+ * passes the rest to free().
+ *
+ * \addtogroup zone
+ * @{
+ */
+/*  Copyright (C) 2015 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+#include "libknot/internal/mempattern.h"
+
+/*! \brief Size of a single arena chunk. */
+#define ZONE_ARENA_CHUNK (4 * 1024 * 1024)
+
+struct zone_arena;
+typedef struct zone_arena zone_arena_t;
+
+/*!
+ * \brief Create new arena, the caller holds the only reference.
+ *
+ * \return New arena or NULL.
+ */
+zone_arena_t *zone_arena_new(void);
+
+/*! \brief Add a reference to the arena. */
+zone_arena_t *zone_arena_ref(zone_arena_t *arena);
+
+/*! \brief Drop a reference, the arena is unmapped with the last one. */
+void zone_arena_unref(zone_arena_t *arena);
+
+/*! \brief Get size of the memory mapped by the arena. */
+size_t zone_arena_size(const zone_arena_t *arena);
+
+/*!
+ * \brief Free memory allocated either from any arena or from the heap.
+ *
+ * Arena blocks are released with the whole arena, so this is a no-op for
+ * them, other blocks are passed to free().
+ */
+void zone_arena_free(void *ptr);
+
+/*!
+ * \brief Initialize memory context for zone contents.
+ *
+ * \param arena  Arena to allocate from, NULL for the heap.
+ * \param mm     Memory context to initialize.
+ */
+void zone_arena_mm(zone_arena_t *arena, mm_ctx_t *mm);
+
+/*!
+ * \brief Get shared memory context allocating from the heap.
+ *
+ * Used for changes of zone data which may live in an arena.
+ */
+mm_ctx_t *zone_arena_heap_mm(void);
+
+/*! @} */
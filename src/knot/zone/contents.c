@@ -22,12 +22,14 @@
 #include "libknot/libknot.h"
 #include "libknot/rrset.h"
 #include "libknot/internal/base32hex.h"
+#include "libknot/internal/tolower.h"
 #include "libknot/descriptor.h"
 #include "libknot/internal/trie/hat-trie.h"
 #include "knot/dnssec/zone-nsec.h"
 #include "knot/dnssec/zone-sign.h"
 #include "knot/zone/zone-tree.h"
 #include "libknot/packet/wire.h"
+#include "libknot/packet/rrset-wire.h"
 #include "libknot/consts.h"
 #include "libknot/rrtype/rrsig.h"
 #include "libknot/rrtype/nsec3.h"
@@ -47,6 +49,8 @@ typedef struct {
 	zone_node_t *first_node;
 	zone_contents_t *zone;
 	zone_node_t *previous_node;
+	const zone_contents_t *old_zone; /*!< Contents the zone was copied from. */
+	bool reuse_nsec3;                /*!< NSEC3 owners of old nodes are valid. */
 } zone_adjust_arg_t;
 
 /*----------------------------------------------------------------------------*/
@@ -105,11 +109,11 @@ static int zone_contents_check_node(
 static int zone_contents_destroy_node_rrsets_from_tree(
 	zone_node_t **tnode, void *data)
 {
-	UNUSED(data);
 	assert(tnode != NULL);
+	mm_ctx_t *mm = data;
 	if (*tnode != NULL) {
-		node_free_rrsets(*tnode, NULL);
-		node_free(tnode, NULL);
+		node_free_rrsets(*tnode, mm);
+		node_free(tnode, mm);
 	}
 
 	return KNOT_EOK;
@@ -140,12 +144,37 @@ static int zone_contents_nsec3_name(const zone_contents_t *zone,
 	return KNOT_EOK;
 }
 
-/*! \brief Link pointers to additional nodes for this RRSet. */
+/*! \brief Find node with glue for given name in the RDATA. */
+static zone_node_t *find_additional(const zone_contents_t *zone,
+                                    const knot_dname_t *dname)
+{
+	const zone_node_t *node = NULL, *encloser = NULL, *prev = NULL;
+
+	/* Try to find node for the dname in the RDATA. */
+	zone_contents_find_dname(zone, dname, &node, &encloser, &prev);
+	if (node == NULL && encloser
+	    && (encloser->flags & NODE_FLAGS_WILDCARD_CHILD)) {
+		/* Find wildcard child in the zone. */
+		node = zone_contents_find_wildcard_child(zone, encloser);
+		assert(node != NULL);
+	}
+
+	return (zone_node_t *)node;
+}
+
+/*!
+ * \brief Link pointers to additional nodes for this RRSet.
+ *
+ * If \a old_data holds the same RDATA from the previous version of the zone,
+ * exact matches are only looked up again in the new tree.
+ *
+ * The array is not kept if there are no additional nodes at all, which is
+ * the case of most delegations to names outside the zone.
+ */
 static int discover_additionals(struct rr_data *rr_data,
+                                const struct rr_data *old_data,
                                 zone_contents_t *zone)
 {
-	const zone_node_t *node = NULL, *encloser = NULL, *prev = NULL;
-	const knot_dname_t *dname = NULL;
 	const knot_rdataset_t *rrs = &rr_data->rrs;
 
 	/* Create new additional nodes. */
@@ -157,28 +186,220 @@ static int discover_additionals(struct rr_data *rr_data,
 	if (rr_data->additional == NULL) {
 		return KNOT_ENOMEM;
 	}
+	bool found = false;
+
+	/* Previous additionals are usable only for unchanged RDATA. */
+	if (old_data != NULL && (old_data->additional == NULL ||
+	    old_data->rrs.data != rrs->data ||
+	    old_data->rrs.rr_count != rrs->rr_count)) {
+		old_data = NULL;
+	}
 
 	for (uint16_t i = 0; i < rdcount; i++) {
+		const knot_dname_t *dname = knot_rdata_name(rrs, i, rr_data->type);
+		zone_node_t *node = NULL;
+
+		/* Exact match in the old zone is still exact if present. */
+		const zone_node_t *old_node = old_data ? old_data->additional[i] : NULL;
+		if (old_node != NULL && knot_dname_is_equal(old_node->owner, dname)) {
+			zone_tree_get(zone->nodes, dname, &node);
+		}
+
+		if (node == NULL) {
+			node = find_additional(zone, dname);
+		}
+
+		rr_data->additional[i] = node;
+		found = found || node != NULL;
+	}
+
+	if (!found) {
+		free(rr_data->additional);
+		rr_data->additional = NULL;
+	}
+
+	return KNOT_EOK;
+}
+
+/*----------------------------------------------------------------------------*/
+
+/*!
+ * \brief Node referring to a name in the zone by an additional record.
+ *
+ * Entries of the referrer index are immutable and shared by zone copies.
+ */
+typedef struct {
+	int refcount;
+	knot_dname_t *target;  /*!< Name in the RDATA. */
+	knot_dname_t *owner;   /*!< Owner of the referring node. */
+} referrer_t;
+
+/*! \brief Maximal length of the referrer index key. */
+#define REFERRER_KEY_MAXLEN (2 * KNOT_DNAME_MAXLEN)
+
+/*!
+ * \brief Builds referrer index key, the target followed by the owner.
+ *
+ * Keys of the targets at or below a domain start with the domain tree key.
+ */
+static size_t referrer_key(uint8_t *key, const knot_dname_t *target,
+                           const knot_dname_t *owner)
+{
+	uint8_t lf[KNOT_DNAME_MAXLEN];
+	knot_dname_lf(lf, target, NULL);
+	memcpy(key, lf + 1, *lf);
+
+	size_t len = *lf;
+	knot_dname_lf(key + len, owner, NULL);
+
+	return len + 1 + key[len];
+}
+
+static referrer_t *referrer_new(const knot_dname_t *target,
+                                const knot_dname_t *owner)
+{
+	size_t target_size = knot_dname_size(target);
+	size_t owner_size = knot_dname_size(owner);
+
+	referrer_t *ref = malloc(sizeof(referrer_t) + target_size + owner_size);
+	if (ref == NULL) {
+		return NULL;
+	}
+
+	ref->refcount = 1;
+	ref->target = (knot_dname_t *)(ref + 1);
+	ref->owner = ref->target + target_size;
+	memcpy(ref->target, target, target_size);
+	memcpy(ref->owner, owner, owner_size);
+
+	return ref;
+}
+
+/*! \brief Shares the index entry with a zone copy (hattrie_dup() callback). */
+static value_t referrer_ref(value_t val)
+{
+	referrer_t *ref = val;
+	__sync_add_and_fetch(&ref->refcount, 1);
+	return val;
+}
+
+/*! \brief Releases the index entry (callback function). */
+static int referrer_unref(value_t *val, void *data)
+{
+	UNUSED(data);
+	referrer_t *ref = *val;
+	if (__sync_sub_and_fetch(&ref->refcount, 1) == 0) {
+		free(ref);
+	}
+
+	return KNOT_EOK;
+}
+
+static void referrers_free(hattrie_t **index)
+{
+	if (*index != NULL) {
+		hattrie_apply_rev(*index, referrer_unref, NULL);
+		hattrie_free(*index);
+		*index = NULL;
+	}
+}
+
+/*!
+ * \brief Adds or removes index entries for the additional records of the node.
+ *
+ * Names outside the zone are not indexed, they never appear in it.
+ */
+static int referrers_update(hattrie_t *index, const zone_node_t *node,
+                            const knot_dname_t *apex, bool add)
+{
+	uint8_t key[REFERRER_KEY_MAXLEN];
 
-		/* Try to find node for the dname in the RDATA. */
-		dname = knot_rdata_name(rrs, i, rr_data->type);
-		zone_contents_find_dname(zone, dname, &node, &encloser, &prev);
-		if (node == NULL && encloser
-		    && (encloser->flags & NODE_FLAGS_WILDCARD_CHILD)) {
-			/* Find wildcard child in the zone. */
-			node = zone_contents_find_wildcard_child(zone,
-			                                              encloser);
-			assert(node != NULL);
+	for (uint16_t i = 0; i < node->rrset_count; ++i) {
+		const struct rr_data *rr_data = &node->rrs[i];
+		if (!knot_rrtype_additional_needed(rr_data->type)) {
+			continue;
 		}
 
-		rr_data->additional[i] = (zone_node_t *)node;
+		for (uint16_t j = 0; j < rr_data->rrs.rr_count; ++j) {
+			const knot_dname_t *target =
+				knot_rdata_name(&rr_data->rrs, j, rr_data->type);
+			if (!knot_dname_in(apex, target)) {
+				continue;
+			}
+
+			size_t len = referrer_key(key, target, node->owner);
+			if (!add) {
+				value_t *val = hattrie_tryget(index, (char *)key, len);
+				if (val != NULL) {
+					referrer_unref(val, NULL);
+					hattrie_del(index, (char *)key, len);
+				}
+				continue;
+			}
+
+			value_t *val = hattrie_get(index, (char *)key, len);
+			if (val == NULL) {
+				return KNOT_ENOMEM;
+			}
+			if (*val == NULL) {
+				*val = referrer_new(target, node->owner);
+				if (*val == NULL) {
+					hattrie_del(index, (char *)key, len);
+					return KNOT_ENOMEM;
+				}
+			}
+		}
 	}
 
 	return KNOT_EOK;
 }
 
+/*! \brief Indexes additional records of the node (callback function). */
+static int index_referrers(zone_node_t **tnode, void *data)
+{
+	zone_contents_t *zone = data;
+	return referrers_update(zone->referrers, *tnode, zone->apex->owner, true);
+}
+
+/*! \brief Builds the index of nodes referring to the names in the zone. */
+static int build_referrers(zone_contents_t *zone)
+{
+	referrers_free(&zone->referrers);
+	zone->referrers = hattrie_create();
+	if (zone->referrers == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	return zone_tree_apply(zone->nodes, index_referrers, zone);
+}
+
 /*----------------------------------------------------------------------------*/
 
+/*! \brief Checks if the node is a previous node of the following ones. */
+static bool prev_candidate(const zone_node_t *node)
+{
+	return !(node->flags & NODE_FLAGS_NONAUTH) && node->rrset_count > 0;
+}
+
+/*! \brief Sets delegation point and non-authoritative flags of the node. */
+static void adjust_flags(zone_node_t *node, const zone_contents_t *zone)
+{
+	// clear Removed NSEC flag so that no relicts remain
+	node->flags &= ~NODE_FLAGS_REMOVED_NSEC;
+
+	// set flags (delegation point, non-authoritative)
+	if (node->parent &&
+	    ((node->parent->flags & NODE_FLAGS_DELEG) ||
+	     node->parent->flags & NODE_FLAGS_NONAUTH)) {
+		node->flags |= NODE_FLAGS_NONAUTH;
+	} else if (node_rrtype_exists(node, KNOT_RRTYPE_NS) && node != zone->apex) {
+		node->flags |= NODE_FLAGS_DELEG;
+	} else {
+		// Default.
+		node->flags = NODE_FLAGS_AUTH;
+	}
+}
+
 static int adjust_pointers(zone_node_t **tnode, void *data)
 {
 	assert(data != NULL);
@@ -191,44 +412,57 @@ static int adjust_pointers(zone_node_t **tnode, void *data)
 		args->first_node = node;
 	}
 
-	// clear Removed NSEC flag so that no relicts remain
-	node->flags &= ~NODE_FLAGS_REMOVED_NSEC;
-
 	// check if this node is not a wildcard child of its parent
 	if (knot_dname_is_wildcard(node->owner)) {
 		assert(node->parent != NULL);
 		node->parent->flags |= NODE_FLAGS_WILDCARD_CHILD;
 	}
 
-	// set flags (delegation point, non-authoritative)
-	if (node->parent &&
-	    ((node->parent->flags & NODE_FLAGS_DELEG) ||
-	     node->parent->flags & NODE_FLAGS_NONAUTH)) {
-		node->flags |= NODE_FLAGS_NONAUTH;
-	} else if (node_rrtype_exists(node, KNOT_RRTYPE_NS) && node != args->zone->apex) {
-		node->flags |= NODE_FLAGS_DELEG;
-	} else {
-		// Default.
-		node->flags = NODE_FLAGS_AUTH;
-	}
+	adjust_flags(node, args->zone);
 
 	// set pointer to previous node
 	node->prev = args->previous_node;
 
 	// update remembered previous pointer only if authoritative
-	if (!(node->flags & NODE_FLAGS_NONAUTH) && node->rrset_count > 0) {
+	if (prev_candidate(node)) {
 		args->previous_node = node;
 	}
 
 	return KNOT_EOK;
 }
 
+/*! \brief Returns node with the same owner from the zone being updated. */
+static const zone_node_t *old_zone_node(const zone_adjust_arg_t *args,
+                                        const zone_node_t *node)
+{
+	if (args->old_zone == NULL) {
+		return NULL;
+	}
+
+	zone_node_t *old_node = NULL;
+	zone_tree_get(args->old_zone->nodes, node->owner, &old_node);
+	return old_node;
+}
+
 static int adjust_nsec3_pointers(zone_node_t **tnode, void *data)
 {
 	assert(data != NULL);
 	assert(tnode != NULL);
 	zone_adjust_arg_t *args = (zone_adjust_arg_t *)data;
 	zone_node_t *node = *tnode;
+
+	// NSEC3 owner depends only on the node owner and NSEC3 parameters
+	if (args->reuse_nsec3) {
+		const zone_node_t *old_node = old_zone_node(args, node);
+		if (old_node != NULL && old_node->nsec3_node != NULL) {
+			zone_node_t *nsec3 = NULL;
+			zone_tree_get(args->zone->nsec3_nodes,
+			              old_node->nsec3_node->owner, &nsec3);
+			node->nsec3_node = nsec3;
+			return KNOT_EOK;
+		}
+	}
+
 	// Connect to NSEC3 node (only if NSEC3 tree is not empty)
 	zone_node_t *nsec3 = NULL;
 	knot_dname_t *nsec3_name = NULL;
@@ -315,12 +549,25 @@ static int adjust_additional(zone_node_t **tnode, void *data)
 	int ret = KNOT_EOK;
 	zone_adjust_arg_t *args = (zone_adjust_arg_t *)data;
 	zone_node_t *node = *tnode;
+	const zone_node_t *old_node = NULL;
+	bool old_looked_up = false;
 
 	/* Lookup additional records for specific nodes. */
 	for(uint16_t i = 0; i < node->rrset_count; ++i) {
 		struct rr_data *rr_data = &node->rrs[i];
 		if (knot_rrtype_additional_needed(rr_data->type)) {
-			ret = discover_additionals(rr_data, args->zone);
+			if (!old_looked_up) {
+				old_node = old_zone_node(args, node);
+				old_looked_up = true;
+			}
+			const struct rr_data *old_data = NULL;
+			for (uint16_t j = 0; old_node && j < old_node->rrset_count; ++j) {
+				if (old_node->rrs[j].type == rr_data->type) {
+					old_data = &old_node->rrs[j];
+					break;
+				}
+			}
+			ret = discover_additionals(rr_data, old_data, args->zone);
 			if (ret != KNOT_EOK) {
 				break;
 			}
@@ -399,7 +646,8 @@ static int knot_zc_nsec3_parameters_match(const knot_rdataset_t *rrs,
 /* API functions                                                              */
 /*----------------------------------------------------------------------------*/
 
-zone_contents_t *zone_contents_new(const knot_dname_t *apex_name)
+static zone_contents_t *contents_new(const knot_dname_t *apex_name,
+                                     zone_arena_t *arena)
 {
 	dbg_zone("%s(%p)\n", __func__, apex_name);
 	if (apex_name == NULL) {
@@ -412,7 +660,9 @@ zone_contents_t *zone_contents_new(const knot_dname_t *apex_name)
 	}
 
 	memset(contents, 0, sizeof(zone_contents_t));
-	contents->apex = node_new(apex_name, NULL);
+	contents->arena = arena;
+	zone_arena_mm(arena, &contents->mm);
+	contents->apex = node_new(apex_name, &contents->mm);
 	if (contents->apex == NULL) {
 		goto cleanup;
 	}
@@ -430,12 +680,33 @@ zone_contents_t *zone_contents_new(const knot_dname_t *apex_name)
 
 cleanup:
 	dbg_zone("%s: failure to initialize contents %p\n", __func__, contents);
+	node_free(&contents->apex, &contents->mm);
 	free(contents->nodes);
 	free(contents->nsec3_nodes);
 	free(contents);
 	return NULL;
 }
 
+zone_contents_t *zone_contents_new(const knot_dname_t *apex_name)
+{
+	return contents_new(apex_name, NULL);
+}
+
+zone_contents_t *zone_contents_new_arena(const knot_dname_t *apex_name)
+{
+	zone_arena_t *arena = zone_arena_new();
+	if (arena == NULL) {
+		return NULL;
+	}
+
+	zone_contents_t *contents = contents_new(apex_name, arena);
+	if (contents == NULL) {
+		zone_arena_unref(arena);
+	}
+
+	return contents;
+}
+
 /*----------------------------------------------------------------------------*/
 
 static zone_node_t *zone_contents_get_node(const zone_contents_t *zone,
@@ -503,7 +774,7 @@ static int zone_contents_add_node(zone_contents_t *zone, zone_node_t *node,
 
 			/* Create a new node. */
 			dbg_zone_detail("Creating new node.\n");
-			next_node = node_new(parent, NULL);
+			next_node = node_new(parent, &zone->mm);
 			if (next_node == NULL) {
 				return KNOT_ENOMEM;
 			}
@@ -512,7 +783,7 @@ static int zone_contents_add_node(zone_contents_t *zone, zone_node_t *node,
 			dbg_zone_detail("Inserting new node to zone tree.\n");
 			ret = zone_tree_insert(zone->nodes, next_node);
 			if (ret != KNOT_EOK) {
-				node_free(&next_node, NULL);
+				node_free(&next_node, &zone->mm);
 				return ret;
 			}
 
@@ -615,73 +886,210 @@ static int insert_rr(zone_contents_t *z,
 		             zone_contents_get_node(z, rr->owner);
 		if (*n == NULL) {
 			// Create new, insert
-			*n = node_new(rr->owner, NULL);
+			*n = node_new(rr->owner, &z->mm);
 			if (*n == NULL) {
 				return KNOT_ENOMEM;
 			}
 			ret = nsec3 ? zone_contents_add_nsec3_node(z, *n) :
 			              zone_contents_add_node(z, *n, true);
 			if (ret != KNOT_EOK) {
-				node_free(n, NULL);
+				node_free(n, &z->mm);
 			}
 		}
 	}
 
-	return node_add_rrset(*n, rr, NULL);
+	return node_add_rrset(*n, rr, &z->mm);
 }
 
-static int recreate_normal_tree(const zone_contents_t *z, zone_contents_t *out)
+/*! \brief Returns copy of the linked node from the new tree. */
+static zone_node_t *link_copy(zone_tree_t *tree, const zone_node_t *link)
+{
+	zone_node_t *node = NULL;
+	if (link != NULL) {
+		zone_tree_get(tree, link->owner, &node);
+	}
+
+	return node;
+}
+
+/*! \brief Node copied with links to additional nodes. */
+typedef struct {
+	const zone_node_t *from;
+	zone_node_t *to;
+} node_pair_t;
+
+/*! \brief Remembers the copied node if it has additional nodes. */
+static int add_additional_pair(node_pair_t **pairs, size_t *count,
+                               size_t *size, const zone_node_t *from,
+                               zone_node_t *to)
+{
+	bool additional = false;
+	for (uint16_t i = 0; i < from->rrset_count; ++i) {
+		additional = additional || from->rrs[i].additional != NULL;
+	}
+	if (!additional) {
+		return KNOT_EOK;
+	}
+
+	if (*count == *size) {
+		size_t new_size = (*size > 0) ? 2 * *size : 64;
+		node_pair_t *new_pairs = realloc(*pairs, new_size * sizeof(node_pair_t));
+		if (new_pairs == NULL) {
+			return KNOT_ENOMEM;
+		}
+		*pairs = new_pairs;
+		*size = new_size;
+	}
+
+	(*pairs)[*count].from = from;
+	(*pairs)[*count].to = to;
+	*count += 1;
+
+	return KNOT_EOK;
+}
+
+/*! \brief Copies additional nodes of the RRSets, linked into the new tree. */
+static int copy_additionals(zone_tree_t *tree, const zone_node_t *from,
+                            zone_node_t *to)
+{
+	for (uint16_t i = 0; i < from->rrset_count; ++i) {
+		zone_node_t **additional = from->rrs[i].additional;
+		if (additional == NULL) {
+			continue;
+		}
+
+		uint16_t count = from->rrs[i].rrs.rr_count;
+		zone_node_t **copy = malloc(count * sizeof(zone_node_t *));
+		if (copy == NULL) {
+			return KNOT_ENOMEM;
+		}
+		for (uint16_t j = 0; j < count; ++j) {
+			copy[j] = link_copy(tree, additional[j]);
+		}
+		to->rrs[i].additional = copy;
+	}
+
+	return KNOT_EOK;
+}
+
+/*! \brief Frees additional nodes and releases wire images of a partial copy. */
+static int free_copied_data(zone_node_t **node, void *data)
+{
+	UNUSED(data);
+	for (uint16_t i = 0; i < (*node)->rrset_count; ++i) {
+		free((*node)->rrs[i].additional);
+		(*node)->rrs[i].additional = NULL;
+		knot_rrset_image_free(&(*node)->rrs[i].image, NULL);
+	}
+
+	return KNOT_EOK;
+}
+
+/*! \brief Shares wire images of the RRSets with the copied node. */
+static void share_images(const zone_node_t *from, zone_node_t *to)
+{
+	for (uint16_t i = 0; i < from->rrset_count; ++i) {
+		to->rrs[i].image = knot_rrset_image_ref(from->rrs[i].image);
+	}
+}
+
+static int recreate_apex(const zone_contents_t *z, zone_contents_t *out)
 {
 	out->nodes = hattrie_dup(z->nodes, NULL);
 	if (out->nodes == NULL) {
 		return KNOT_ENOMEM;
 	}
 
-	// Insert APEX first.
 	zone_node_t *apex_cpy = node_shallow_copy(z->apex, NULL);
 	if (apex_cpy == NULL) {
 		return KNOT_ENOMEM;
 	}
+	share_images(z->apex, apex_cpy);
 
 	// Normal additions need apex ... so we need to insert directly.
 	int ret = zone_tree_insert(out->nodes, apex_cpy);
 	if (ret != KNOT_EOK) {
+		free_copied_data(&apex_cpy, NULL);
 		node_free(&apex_cpy, NULL);
 		return ret;
 	}
 
 	out->apex = apex_cpy;
 
+	return KNOT_EOK;
+}
+
+/*!
+ * \brief Copies the normal nodes after the apex and the NSEC3 nodes are copied.
+ *
+ * Nodes are copied in canonical order, so the links to previous nodes are
+ * set without lookups, using the flags of the adjusted source nodes. NSEC3
+ * links and additional nodes are looked up in the new trees by owner.
+ */
+static int recreate_normal_tree(const zone_contents_t *z, zone_contents_t *out)
+{
 	hattrie_iter_t *itt = hattrie_iter_begin(z->nodes, true);
 	if (itt == NULL) {
 		return KNOT_ENOMEM;
 	}
+
+	node_pair_t *pairs = NULL;
+	size_t pair_count = 0, pair_size = 0;
+	zone_node_t *prev_to = NULL;
+
+	int ret = KNOT_EOK;
 	while (!hattrie_iter_finished(itt)) {
 		const zone_node_t *to_cpy = (zone_node_t *)*hattrie_iter_val(itt);
-		if (to_cpy == z->apex) {
-			// Inserted already.
-			hattrie_iter_next(itt);
-			continue;
-		}
-		zone_node_t *to_add = node_shallow_copy(to_cpy, NULL);
-		if (to_add == NULL) {
-			hattrie_iter_free(itt);
-			return KNOT_ENOMEM;
+		zone_node_t *to_add = out->apex;
+		if (to_cpy != z->apex) {
+			to_add = node_shallow_copy(to_cpy, NULL);
+			if (to_add == NULL) {
+				ret = KNOT_ENOMEM;
+				break;
+			}
+			share_images(to_cpy, to_add);
+
+			ret = zone_contents_add_node(out, to_add, true);
+			if (ret != KNOT_EOK) {
+				free_copied_data(&to_add, NULL);
+				node_free(&to_add, NULL);
+				break;
+			}
+
+			to_add->prev = prev_to;
 		}
 
-		int ret = zone_contents_add_node(out, to_add, true);
+		to_add->nsec3_node = link_copy(out->nsec3_nodes, to_cpy->nsec3_node);
+
+		ret = add_additional_pair(&pairs, &pair_count, &pair_size,
+		                          to_cpy, to_add);
 		if (ret != KNOT_EOK) {
-			node_free(&to_add, NULL);
-			hattrie_iter_free(itt);
-			return ret;
+			break;
 		}
+
+		if (prev_candidate(to_cpy)) {
+			prev_to = to_add;
+		}
+
 		hattrie_iter_next(itt);
 	}
 
 	hattrie_iter_free(itt);
+
+	if (ret == KNOT_EOK) {
+		// The apex links to the last node.
+		out->apex->prev = prev_to;
+
+		// Additional nodes may follow the node in canonical order.
+		for (size_t i = 0; i < pair_count && ret == KNOT_EOK; ++i) {
+			ret = copy_additionals(out->nodes, pairs[i].from, pairs[i].to);
+		}
+	}
+
+	free(pairs);
 	hattrie_build_index(out->nodes);
 
-	return KNOT_EOK;
+	return ret;
 }
 
 static int recreate_nsec3_tree(const zone_contents_t *z, zone_contents_t *out)
@@ -691,10 +1099,14 @@ static int recreate_nsec3_tree(const zone_contents_t *z, zone_contents_t *out)
 		return KNOT_ENOMEM;
 	}
 
-	hattrie_iter_t *itt = hattrie_iter_begin(z->nsec3_nodes, false);
+	hattrie_iter_t *itt = hattrie_iter_begin(z->nsec3_nodes, true);
 	if (itt == NULL) {
 		return KNOT_ENOMEM;
 	}
+
+	zone_node_t *prev_to = NULL;
+	zone_node_t *first = NULL;
+
 	while (!hattrie_iter_finished(itt)) {
 		const zone_node_t *to_cpy = (zone_node_t *)*hattrie_iter_val(itt);
 		zone_node_t *to_add = node_shallow_copy(to_cpy, NULL);
@@ -702,18 +1114,32 @@ static int recreate_nsec3_tree(const zone_contents_t *z, zone_contents_t *out)
 			hattrie_iter_free(itt);
 			return KNOT_ENOMEM;
 		}
+		share_images(to_cpy, to_add);
 		int ret = zone_contents_add_nsec3_node(out, to_add);
 		if (ret != KNOT_EOK) {
 			hattrie_iter_free(itt);
+			free_copied_data(&to_add, NULL);
 			node_free(&to_add, NULL);
 			return ret;
 		}
+
+		if (first == NULL) {
+			first = to_add;
+		}
+		to_add->prev = prev_to;
+		prev_to = to_add;
+
 		hattrie_iter_next(itt);
 	}
 
 	hattrie_iter_free(itt);
 	hattrie_build_index(out->nsec3_nodes);
 
+	// The first node links to the last one.
+	if (first != NULL) {
+		first->prev = prev_to;
+	}
+
 	return KNOT_EOK;
 }
 
@@ -1113,6 +1539,54 @@ int zone_contents_adjust_pointers(zone_contents_t *contents)
 
 /*----------------------------------------------------------------------------*/
 
+static int adjust_full(zone_adjust_arg_t *adjust_arg,
+                       zone_node_t **first_nsec3_node,
+                       zone_node_t **last_nsec3_node)
+{
+	zone_contents_t *zone = adjust_arg->zone;
+
+	// adjust NSEC3 nodes
+
+	int result = zone_contents_adjust_nodes(zone->nsec3_nodes, adjust_arg,
+	                                        zone_contents_adjust_nsec3_node);
+	if (result != KNOT_EOK) {
+		return result;
+	}
+
+	// optional output for NSEC3 nodes
+
+	if (first_nsec3_node) {
+		*first_nsec3_node = adjust_arg->first_node;
+	}
+
+	if (last_nsec3_node) {
+		*last_nsec3_node = adjust_arg->previous_node;
+	}
+
+	// adjust normal nodes
+
+	result = zone_contents_adjust_nodes(zone->nodes, adjust_arg,
+	                                    zone_contents_adjust_normal_node);
+	if (result != KNOT_EOK) {
+		return result;
+	}
+
+	assert(zone->apex == adjust_arg->first_node);
+
+	/* Discover additional records.
+	 * \note This MUST be done after node adjusting because it needs to
+	 *       do full lookup to see through wildcards. */
+
+	result = zone_contents_adjust_nodes(zone->nodes, adjust_arg,
+	                                    adjust_additional);
+	if (result != KNOT_EOK) {
+		return result;
+	}
+
+	/* Referrers of the names changed by later updates are looked up. */
+	return build_referrers(zone);
+}
+
 int zone_contents_adjust_full(zone_contents_t *zone,
                               zone_node_t **first_nsec3_node,
                               zone_node_t **last_nsec3_node)
@@ -1134,40 +1608,555 @@ int zone_contents_adjust_full(zone_contents_t *zone,
 	zone_adjust_arg_t adjust_arg = { 0 };
 	adjust_arg.zone = zone;
 
-	// adjust NSEC3 nodes
+	return adjust_full(&adjust_arg, first_nsec3_node, last_nsec3_node);
+}
 
-	result = zone_contents_adjust_nodes(zone->nsec3_nodes, &adjust_arg,
-	                                 zone_contents_adjust_nsec3_node);
-	if (result != KNOT_EOK) {
-		return result;
+/*----------------------------------------------------------------------------*/
+
+/*! \brief Checks if both zones use the same NSEC3 parameters. */
+static bool nsec3_params_equal(const zone_contents_t *a,
+                               const zone_contents_t *b)
+{
+	const knot_nsec3_params_t *pa = zone_contents_nsec3params(a);
+	const knot_nsec3_params_t *pb = zone_contents_nsec3params(b);
+	if (pa == NULL || pb == NULL) {
+		return pa == pb;
 	}
 
-	// optional output for NSEC3 nodes
+	return pa->algorithm == pb->algorithm &&
+	       pa->iterations == pb->iterations &&
+	       pa->salt_length == pb->salt_length &&
+	       memcmp(pa->salt, pb->salt, pa->salt_length) == 0;
+}
 
-	if (first_nsec3_node) {
-		*first_nsec3_node = adjust_arg.first_node;
+/*! \brief Updates touching more than this part of the zone are adjusted in full. */
+#define ADJUST_UPDATE_RATIO 8
+
+/*! \brief Canonical order of domain names for qsort(). */
+static int name_cmp(const void *a, const void *b)
+{
+	return knot_dname_cmp(*(const knot_dname_t **)a, *(const knot_dname_t **)b);
+}
+
+/*! \brief Pointer order for qsort() and bsearch(). */
+static int ptr_cmp(const void *a, const void *b)
+{
+	uintptr_t x = (uintptr_t)*(void **)a;
+	uintptr_t y = (uintptr_t)*(void **)b;
+	return (x > y) - (x < y);
+}
+
+/*!
+ * \brief Returns the names sorted in canonical order without duplicates.
+ *
+ * With \a parents set, parents of the names up to the apex are included.
+ */
+static int sorted_names(const list_t *list, const knot_dname_t *apex,
+                        bool parents, const knot_dname_t ***names,
+                        size_t *count)
+{
+	int apex_labels = knot_dname_labels(apex, NULL);
+
+	size_t total = 0;
+	ptrnode_t *n = NULL;
+	WALK_LIST(n, *list) {
+		int labels = knot_dname_labels(n->d, NULL) - apex_labels;
+		total += (parents && labels > 0) ? labels + 1 : 1;
 	}
 
-	if (last_nsec3_node) {
-		*last_nsec3_node = adjust_arg.previous_node;
+	const knot_dname_t **out = malloc((total + 1) * sizeof(knot_dname_t *));
+	if (out == NULL) {
+		return KNOT_ENOMEM;
 	}
 
-	// adjust normal nodes
+	size_t i = 0;
+	WALK_LIST(n, *list) {
+		const knot_dname_t *name = n->d;
+		out[i++] = name;
+		int labels = knot_dname_labels(name, NULL) - apex_labels;
+		for (int l = 0; parents && l < labels; ++l) {
+			name = knot_wire_next_label(name, NULL);
+			out[i++] = name;
+		}
+	}
+	assert(i == total);
+
+	qsort(out, total, sizeof(knot_dname_t *), name_cmp);
+
+	size_t unique = 0;
+	for (i = 0; i < total; ++i) {
+		if (unique == 0 || name_cmp(&out[unique - 1], &out[i]) != 0) {
+			out[unique++] = out[i];
+		}
+	}
+
+	*names = out;
+	*count = unique;
+
+	return KNOT_EOK;
+}
+
+/*! \brief Returns the node preceding the name in canonical order. */
+static zone_node_t *tree_prev(zone_tree_t *tree, const knot_dname_t *name)
+{
+	uint8_t lf[KNOT_DNAME_MAXLEN];
+	knot_dname_lf(lf, name, NULL);
+	if (zone_tree_is_empty(tree) || *lf < 2) {
+		return NULL;
+	}
+
+	/* Keys end with a label separator, lesser keys are lesser or equal
+	 * to the key without it. */
+	value_t *val = NULL;
+	hattrie_find_leq(tree, (char *)lf + 1, *lf - 1, &val);
+	return (val != NULL) ? (zone_node_t *)*val : NULL;
+}
+
+/*! \brief Returns the node following the name in canonical order. */
+static zone_node_t *tree_next(zone_tree_t *tree, const knot_dname_t *name)
+{
+	if (zone_tree_is_empty(tree)) {
+		return NULL;
+	}
+
+	uint8_t lf[KNOT_DNAME_MAXLEN];
+	knot_dname_lf(lf, name, NULL);
+
+	value_t *val = NULL;
+	if (hattrie_find_next(tree, (char *)lf + 1, *lf, &val) != 0) {
+		return NULL;
+	}
+	return (zone_node_t *)*val;
+}
+
+/*! \brief Returns the last node in canonical order. */
+static zone_node_t *tree_last(zone_tree_t *tree)
+{
+	if (zone_tree_is_empty(tree)) {
+		return NULL;
+	}
+
+	char key[KNOT_DNAME_MAXLEN];
+	memset(key, 0xff, sizeof(key));
+
+	value_t *val = NULL;
+	hattrie_find_leq(tree, key, sizeof(key), &val);
+	return (val != NULL) ? (zone_node_t *)*val : NULL;
+}
+
+/*!
+ * \brief Links the nodes following the name to the last authoritative node.
+ *
+ * Nodes up to the next authoritative one are linked, the apex is linked
+ * if the name is the last one.
+ */
+static void adjust_next_prev(zone_contents_t *zone, const knot_dname_t *name,
+                             zone_node_t *last)
+{
+	zone_node_t *next = tree_next(zone->nodes, name);
+	while (next != NULL) {
+		next->prev = last;
+		if (prev_candidate(next)) {
+			return;
+		}
+		next = tree_next(zone->nodes, next->owner);
+	}
+
+	zone->apex->prev = last;
+}
+
+/*! \brief Links the changed NSEC3 nodes and their successors. */
+static void adjust_nsec3_changed(zone_contents_t *zone,
+                                 const knot_dname_t **names, size_t count)
+{
+	zone_tree_t *tree = zone->nsec3_nodes;
+	for (size_t i = 0; i < count && !zone_tree_is_empty(tree); ++i) {
+		zone_node_t *node = NULL;
+		zone_tree_get(tree, names[i], &node);
+
+		// The NSEC3 chain is cyclic, NSEC3 owners follow the apex.
+		zone_node_t *prev = tree_prev(tree, names[i]);
+		if (prev == NULL || prev == zone->apex) {
+			prev = tree_last(tree);
+		}
+		if (node != NULL) {
+			node->prev = prev;
+		}
+
+		zone_node_t *next = tree_next(tree, names[i]);
+		if (next == NULL) {
+			next = tree_next(tree, zone->apex->owner);
+		}
+		next->prev = (node != NULL) ? node : prev;
+	}
+}
 
-	result = zone_contents_adjust_nodes(zone->nodes, &adjust_arg,
-	                                 zone_contents_adjust_normal_node);
+/*! \brief Checks if the name is the domain or its subdomain, ignoring case. */
+static bool name_in(const knot_dname_t *domain, int domain_labels,
+                    const knot_dname_t *name, int name_labels)
+{
+	for (int i = domain_labels; i < name_labels; ++i) {
+		name = knot_wire_next_label(name, NULL);
+	}
+	if (name_labels < domain_labels) {
+		return false;
+	}
+
+	while (*name == *domain) {
+		if (*name == '\0') {
+			return true;
+		}
+		for (uint8_t i = 1; i <= *name; ++i) {
+			if (knot_tolower(name[i]) != knot_tolower(domain[i])) {
+				return false;
+			}
+		}
+		name = knot_wire_next_label(name, NULL);
+		domain = knot_wire_next_label(domain, NULL);
+	}
+
+	return false;
+}
+
+/*! \brief Names which appeared in the zone or disappeared from it. */
+typedef struct {
+	zone_contents_t *zone;
+	const knot_dname_t **domains;
+	int *labels;
+	size_t count;
+} adjust_referrers_arg_t;
+
+/*! \brief Looks up additional nodes again if they may be at the changed names. */
+static int adjust_referrers(zone_node_t **tnode, void *data)
+{
+	adjust_referrers_arg_t *args = data;
+	zone_node_t *node = *tnode;
+
+	for (uint16_t i = 0; i < node->rrset_count; ++i) {
+		struct rr_data *rr_data = &node->rrs[i];
+		if (!knot_rrtype_additional_needed(rr_data->type)) {
+			continue;
+		}
+
+		bool changed = false;
+		for (uint16_t j = 0; j < rr_data->rrs.rr_count && !changed; ++j) {
+			const knot_dname_t *name =
+				knot_rdata_name(&rr_data->rrs, j, rr_data->type);
+			int labels = knot_dname_labels(name, NULL);
+			for (size_t k = 0; k < args->count && !changed; ++k) {
+				changed = name_in(args->domains[k], args->labels[k],
+				                  name, labels);
+			}
+		}
+
+		if (changed) {
+			int ret = discover_additionals(rr_data, NULL, args->zone);
+			if (ret != KNOT_EOK) {
+				return ret;
+			}
+		}
+	}
+
+	return KNOT_EOK;
+}
+
+/*! \brief Looks up additional nodes again for the indexed referrers. */
+static int adjust_indexed_referrers(adjust_referrers_arg_t *args)
+{
+	hattrie_t *index = args->zone->referrers;
+	if (hattrie_weight(index) == 0) {
+		return KNOT_EOK;
+	}
+	hattrie_build_index(index);
+
+	uint8_t key[REFERRER_KEY_MAXLEN];
+	for (size_t i = 0; i < args->count; ++i) {
+		uint8_t lf[KNOT_DNAME_MAXLEN];
+		knot_dname_lf(lf, args->domains[i], NULL);
+
+		/* Keys of the names at or below the domain follow its key. */
+		value_t *val = NULL;
+		hattrie_find_next(index, (char *)lf + 1, *lf, &val);
+		while (val != NULL) {
+			referrer_t *ref = *val;
+			size_t len = referrer_key(key, ref->target, ref->owner);
+			if (len < *lf || memcmp(key, lf + 1, *lf) != 0) {
+				break;
+			}
+
+			zone_node_t *node = NULL;
+			zone_tree_get(args->zone->nodes, ref->owner, &node);
+			if (node != NULL) {
+				int ret = adjust_referrers(&node, args);
+				if (ret != KNOT_EOK) {
+					return ret;
+				}
+			}
+
+			if (hattrie_find_next(index, (char *)key, len, &val) != 0) {
+				val = NULL;
+			}
+		}
+	}
+
+	return KNOT_EOK;
+}
+
+/*!
+ * \brief Adjusts nodes of the changed names and their neighbours.
+ *
+ * Sets \a full if the update cannot be adjusted incrementally, that is if
+ * a delegation with children changed or if an NSEC3 node appeared or
+ * disappeared without its normal node.
+ */
+static int adjust_changed(zone_adjust_arg_t *args,
+                          const knot_dname_t **names, size_t count,
+                          const knot_dname_t **nsec3_names, size_t nsec3_count,
+                          bool *full)
+{
+	zone_contents_t *zone = args->zone;
+	zone_tree_t *old_nodes = args->old_zone->nodes;
+	zone_tree_t *old_nsec3_nodes = args->old_zone->nsec3_nodes;
+
+	hattrie_build_index(zone->nodes);
+	if (zone->nsec3_nodes != NULL) {
+		hattrie_build_index(zone->nsec3_nodes);
+	}
+
+	const knot_dname_t **domains = malloc(count * sizeof(knot_dname_t *));
+	int *labels = malloc(count * sizeof(int));
+	zone_node_t **links = malloc(count * sizeof(zone_node_t *));
+	zone_node_t **old_links = malloc(count * sizeof(zone_node_t *));
+	if (domains == NULL || labels == NULL || links == NULL || old_links == NULL) {
+		free(domains);
+		free(labels);
+		free(links);
+		free(old_links);
+		return KNOT_ENOMEM;
+	}
+	size_t domain_count = 0, link_count = 0, old_link_count = 0;
+
+	/* Flags and NSEC3 links, parents go first. */
+	int ret = KNOT_EOK;
+	for (size_t i = 0; i < count && ret == KNOT_EOK && !*full; ++i) {
+		zone_node_t *node = NULL, *old_node = NULL;
+		zone_tree_get(zone->nodes, names[i], &node);
+		zone_tree_get(old_nodes, names[i], &old_node);
+
+		if ((node == NULL) != (old_node == NULL)) {
+			// Wildcards change the names under their parent.
+			const knot_dname_t *domain = names[i];
+			if (knot_dname_is_wildcard(domain)) {
+				domain = knot_wire_next_label(domain, NULL);
+			}
+			domains[domain_count] = domain;
+			labels[domain_count++] = knot_dname_labels(domain, NULL);
+		}
+		if (old_node != NULL && old_node->nsec3_node != NULL) {
+			old_links[old_link_count++] = old_node->nsec3_node;
+		}
+		if (knot_dname_is_wildcard(names[i])) {
+			zone_node_t *parent = NULL;
+			zone_tree_get(zone->nodes, knot_wire_next_label(names[i], NULL),
+			              &parent);
+			if (node != NULL) {
+				parent->flags |= NODE_FLAGS_WILDCARD_CHILD;
+			} else if (parent != NULL) {
+				parent->flags &= ~NODE_FLAGS_WILDCARD_CHILD;
+			}
+		}
+		if (node == NULL) {
+			continue;
+		}
+
+		uint8_t wildcard = node->flags & NODE_FLAGS_WILDCARD_CHILD;
+		adjust_flags(node, zone);
+		node->flags |= wildcard;
+
+		// Children of a changed delegation would need adjusting too.
+		const uint8_t deleg = NODE_FLAGS_DELEG | NODE_FLAGS_NONAUTH;
+		if (old_node != NULL && node->children > 0 &&
+		    (old_node->flags & deleg) != (node->flags & deleg)) {
+			*full = true;
+			break;
+		}
+
+		ret = adjust_nsec3_pointers(&node, args);
+		if (node->nsec3_node != NULL) {
+			links[link_count++] = node->nsec3_node;
+		}
+	}
+
+	/* NSEC3 nodes of unchanged names must stay in place. */
+	qsort(links, link_count, sizeof(zone_node_t *), ptr_cmp);
+	qsort(old_links, old_link_count, sizeof(zone_node_t *), ptr_cmp);
+	for (size_t i = 0; i < nsec3_count && ret == KNOT_EOK && !*full; ++i) {
+		zone_node_t *node = NULL, *old_node = NULL;
+		zone_tree_get(zone->nsec3_nodes, nsec3_names[i], &node);
+		zone_tree_get(old_nsec3_nodes, nsec3_names[i], &old_node);
+		if (node != NULL && old_node == NULL) {
+			*full = !bsearch(&node, links, link_count,
+			                 sizeof(zone_node_t *), ptr_cmp);
+		} else if (node == NULL && old_node != NULL) {
+			*full = !bsearch(&old_node, old_links, old_link_count,
+			                 sizeof(zone_node_t *), ptr_cmp);
+		}
+	}
+
+	free(links);
+	free(old_links);
+
+	if (ret == KNOT_EOK && !*full) {
+		adjust_nsec3_changed(zone, nsec3_names, nsec3_count);
+
+		/* Previous nodes, the changed nodes may link the following ones. */
+		for (size_t i = 0; i < count; ++i) {
+			zone_node_t *node = NULL;
+			zone_tree_get(zone->nodes, names[i], &node);
+
+			zone_node_t *last = zone->apex;
+			if (node != zone->apex) {
+				zone_node_t *prev = tree_prev(zone->nodes, names[i]);
+				assert(prev != NULL);
+				last = prev_candidate(prev) ? prev : prev->prev;
+				if (node != NULL) {
+					node->prev = last;
+					last = prev_candidate(node) ? node : last;
+				}
+			}
+
+			adjust_next_prev(zone, names[i], last);
+		}
+
+		/* Additional nodes, after the tree is linked for lookups. */
+		for (size_t i = 0; i < count && ret == KNOT_EOK; ++i) {
+			zone_node_t *node = NULL;
+			zone_tree_get(zone->nodes, names[i], &node);
+			if (node != NULL) {
+				ret = adjust_additional(&node, args);
+			}
+		}
+	}
+
+	/* Index entries of the changed nodes. */
+	const knot_dname_t *apex = zone->apex->owner;
+	for (size_t i = 0; i < count && ret == KNOT_EOK && !*full; ++i) {
+		zone_node_t *node = NULL, *old_node = NULL;
+		zone_tree_get(zone->nodes, names[i], &node);
+		zone_tree_get(old_nodes, names[i], &old_node);
+		if (old_node != NULL) {
+			ret = referrers_update(zone->referrers, old_node, apex, false);
+		}
+		if (ret == KNOT_EOK && node != NULL) {
+			ret = referrers_update(zone->referrers, node, apex, true);
+		}
+	}
+
+	/* Additional nodes of other names may point at the changed ones. */
+	if (ret == KNOT_EOK && !*full && domain_count > 0) {
+		adjust_referrers_arg_t referrers = {
+			.zone = zone,
+			.domains = domains,
+			.labels = labels,
+			.count = domain_count
+		};
+		ret = adjust_indexed_referrers(&referrers);
+	}
+
+	free(domains);
+	free(labels);
+
+	return ret;
+}
+
+int zone_contents_adjust_update(zone_contents_t *zone,
+                                const zone_contents_t *old_zone,
+                                const list_t *owners,
+                                const list_t *nsec3_owners)
+{
+	if (zone == NULL || old_zone == NULL || owners == NULL ||
+	    nsec3_owners == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	int result = zone_contents_load_nsec3param(zone);
 	if (result != KNOT_EOK) {
+		log_zone_error(zone->apex->owner,
+			       "failed to load NSEC3 parameters (%s)",
+			       knot_strerror(result));
 		return result;
 	}
 
-	assert(zone->apex == adjust_arg.first_node);
+	// adjusting parameters
 
-	/* Discover additional records.
-	 * \note This MUST be done after node adjusting because it needs to
-	 *       do full lookup to see through wildcards. */
+	zone_adjust_arg_t adjust_arg = { 0 };
+	adjust_arg.zone = zone;
+	adjust_arg.old_zone = old_zone;
+	adjust_arg.reuse_nsec3 = nsec3_params_equal(zone, old_zone);
 
-	return zone_contents_adjust_nodes(zone->nodes, &adjust_arg,
-	                                       adjust_additional);
+	const knot_dname_t **names = NULL, **nsec3_names = NULL;
+	size_t count = 0, nsec3_count = 0;
+	result = sorted_names(owners, zone->apex->owner, true, &names, &count);
+	if (result == KNOT_EOK) {
+		result = sorted_names(nsec3_owners, zone->apex->owner, false,
+		                      &nsec3_names, &nsec3_count);
+	}
+
+	// Changed NSEC3 parameters change links of all nodes.
+	size_t weight = zone_tree_weight(zone->nodes) +
+	                zone_tree_weight(zone->nsec3_nodes);
+	bool full = !adjust_arg.reuse_nsec3 || zone->referrers == NULL ||
+	            count + nsec3_count > weight / ADJUST_UPDATE_RATIO;
+	if (result == KNOT_EOK && !full) {
+		result = adjust_changed(&adjust_arg, names, count,
+		                        nsec3_names, nsec3_count, &full);
+	}
+	if (result == KNOT_EOK && full) {
+		result = adjust_full(&adjust_arg, NULL, NULL);
+	}
+
+	free(names);
+	free(nsec3_names);
+
+	return result;
+}
+
+/*----------------------------------------------------------------------------*/
+
+/*! \brief Build wire images of the node RRSets. */
+static int build_images(zone_node_t **tnode, void *data)
+{
+	UNUSED(data);
+	assert(tnode != NULL);
+	zone_node_t *node = *tnode;
+
+	for (uint16_t i = 0; i < node->rrset_count; ++i) {
+		/* Images of changed RDATA are released by the update. */
+		struct rr_data *rr_data = &node->rrs[i];
+		if (rr_data->image != NULL) {
+			continue;
+		}
+
+		/* RRSet without image is written as usual. */
+		knot_rrset_t rrset = node_rrset_at(node, i);
+		rr_data->image = knot_rrset_image_new(&rrset, NULL);
+	}
+
+	return KNOT_EOK;
+}
+
+int zone_contents_build_images(zone_contents_t *contents)
+{
+	if (contents == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	int ret = zone_tree_apply(contents->nodes, build_images, NULL);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	return zone_tree_apply(contents->nsec3_nodes, build_images, NULL);
 }
 
 /*----------------------------------------------------------------------------*/
@@ -1259,23 +2248,32 @@ int zone_contents_shallow_copy(const zone_contents_t *from, zone_contents_t **to
 		return KNOT_ENOMEM;
 	}
 
-	int ret = recreate_normal_tree(from, contents);
+	/* Changed nodes are allocated from the heap. */
+	zone_arena_mm(NULL, &contents->mm);
+
+	/* NSEC3 nodes are copied first, so the normal nodes can link to them. */
+	int ret = recreate_apex(from, contents);
+	if (ret == KNOT_EOK && from->nsec3_nodes) {
+		ret = recreate_nsec3_tree(from, contents);
+	}
+	if (ret == KNOT_EOK) {
+		ret = recreate_normal_tree(from, contents);
+	}
 	if (ret != KNOT_EOK) {
-		zone_tree_free(&contents->nodes);
+		zone_tree_apply(contents->nodes, free_copied_data, NULL);
+		zone_tree_apply(contents->nsec3_nodes, free_copied_data, NULL);
+		zone_tree_deep_free(&contents->nodes);
+		zone_tree_deep_free(&contents->nsec3_nodes);
 		free(contents);
 		return ret;
 	}
 
-	if (from->nsec3_nodes) {
-		ret = recreate_nsec3_tree(from, contents);
-		if (ret != KNOT_EOK) {
-			zone_tree_free(&contents->nodes);
-			zone_tree_free(&contents->nsec3_nodes);
-			free(contents);
-			return ret;
-		}
-	} else {
-		contents->nsec3_nodes = NULL;
+	/* Unchanged RDATA are shared with the source. */
+	contents->arena = zone_arena_ref(from->arena);
+
+	/* Without the referrer index, the copy is adjusted in full. */
+	if (from->referrers != NULL) {
+		contents->referrers = hattrie_dup(from->referrers, referrer_ref);
 	}
 
 	*to = contents;
@@ -1297,7 +2295,9 @@ void zone_contents_free(zone_contents_t **contents)
 	zone_tree_free(&(*contents)->nsec3_nodes);
 
 	knot_nsec3param_free(&(*contents)->nsec3_params);
+	referrers_free(&(*contents)->referrers);
 
+	zone_arena_unref((*contents)->arena);
 	free(*contents);
 	*contents = NULL;
 }
@@ -1315,13 +2315,13 @@ void zone_contents_deep_free(zone_contents_t **contents)
 		zone_tree_apply(
 			(*contents)->nsec3_nodes,
 			zone_contents_destroy_node_rrsets_from_tree,
-			(void*)1);
+			&(*contents)->mm);
 
 		// Delete normal tree
 		zone_tree_apply(
 			(*contents)->nodes,
 			zone_contents_destroy_node_rrsets_from_tree,
-			(void*)1);
+			&(*contents)->mm);
 	}
 
 	zone_contents_free(contents);
@@ -1374,14 +2374,14 @@ zone_node_t *zone_contents_get_node_for_rr(zone_contents_t *zone, const knot_rrs
 
 	if (node == NULL) {
 		int ret = KNOT_EOK;
-		node = node_new(rrset->owner, NULL);
+		node = node_new(rrset->owner, &zone->mm);
 		if (!nsec3) {
 			ret = zone_contents_add_node(zone, node, 1);
 		} else {
 			ret = zone_contents_add_nsec3_node(zone, node);
 		}
 		if (ret != KNOT_EOK) {
-			node_free(&node, NULL);
+			node_free(&node, &zone->mm);
 			return NULL;
 		}
 
@@ -28,6 +28,7 @@
 
 #include "libknot/internal/lists.h"
 #include "libknot/rrtype/nsec3param.h"
+#include "knot/zone/arena.h"
 #include "knot/zone/node.h"
 #include "knot/zone/zone-tree.h"
 
@@ -47,6 +48,11 @@ typedef struct zone_contents {
 	zone_tree_t *nsec3_nodes;
 
 	knot_nsec3_params_t nsec3_params;
+
+	hattrie_t *referrers;    /*!< Names referred to by additional records. */
+
+	mm_ctx_t mm;             /*!< Memory context for nodes and RRSets. */
+	zone_arena_t *arena;     /*!< Arena holding (a part of) the data. */
 } zone_contents_t;
 
 /*!
@@ -58,6 +64,18 @@ typedef int (*zone_contents_apply_cb_t)(zone_node_t *node, void *data);
 
 zone_contents_t *zone_contents_new(const knot_dname_t *apex_name);
 
+/*!
+ * \brief Creates new zone contents allocated from a new arena.
+ *
+ * Meant for complete zone transfers and zone file loading. The arena is
+ * released with the last zone version derived from these contents.
+ *
+ * \param apex_name Zone apex name.
+ *
+ * \return New contents or NULL.
+ */
+zone_contents_t *zone_contents_new_arena(const knot_dname_t *apex_name);
+
 int zone_contents_add_rr(zone_contents_t *z, const knot_rrset_t *rr, zone_node_t **n);
 
 int zone_contents_remove_node(zone_contents_t *contents, const knot_dname_t *owner);
@@ -174,6 +192,39 @@ int zone_contents_adjust_full(zone_contents_t *contents,
                               zone_node_t **first_nsec3_node,
                               zone_node_t **last_nsec3_node);
 
+/*!
+ * \brief Same as zone_contents_adjust_full(), but for contents created from
+ *        \a old_contents by applying a change.
+ *
+ * Only the changed nodes, their parents and neighbours are adjusted, links
+ * of the other nodes are taken over by zone_contents_shallow_copy(). Nodes
+ * referring to added or removed names are found in the referrer index built
+ * by zone_contents_adjust_full() and their additional records are looked up
+ * again. The zone is adjusted in full if the NSEC3 parameters changed, if
+ * a delegation with children changed, or if the update is large.
+ *
+ * \param contents      Updated zone contents to adjust.
+ * \param old_contents  Contents the updated copy was created from.
+ * \param owners        Owners changed by the update (list of ptrnode_t).
+ * \param nsec3_owners  Changed owners of NSEC3 records (list of ptrnode_t).
+ */
+int zone_contents_adjust_update(zone_contents_t *contents,
+                                const zone_contents_t *old_contents,
+                                const list_t *owners,
+                                const list_t *nsec3_owners);
+
+/*!
+ * \brief Creates precomputed wire format of all RRSets in the zone.
+ *
+ * Answers are then written by copying the RR images and compressing only
+ * the owners and compressible RDATA names. Copies made by
+ * zone_contents_shallow_copy() share the images of the source, an update
+ * releases images of the changed RRSets, so only those are created again.
+ *
+ * \param contents  Zone contents.
+ */
+int zone_contents_build_images(zone_contents_t *contents);
+
 /*!
  * \brief Parses the NSEC3PARAM record stored in the zone.
  *
@@ -246,7 +297,10 @@ int zone_contents_nsec3_apply_inorder(zone_contents_t *zone,
  * regular nodes and for NSEC3 nodes, creates new hash table and a new domain
  * table. It also fills these structures with the exact same data as the
  * original zone is - no copying of stored data is done, just pointers are
- * copied.
+ * copied. Previous nodes, NSEC3 nodes and additional records of the copied
+ * nodes point to the copies, so \a from must be adjusted. All the nodes are
+ * copied, the time taken is linear in the zone size, only the referrer index
+ * entries are shared with \a from.
  *
  * \param from Original zone.
  * \param to Copy of the zone.
@@ -294,7 +294,17 @@ bool zone_events_is_scheduled(zone_t *zone, zone_event_type_t type)
 
 void zone_events_enqueue(zone_t *zone, zone_event_type_t type)
 {
-	if (!zone || !valid_event(type)) {
+	if (!zone) {
+		return;
+	}
+
+	zone_events_enqueue_in(zone, type, zone->events.pool);
+}
+
+void zone_events_enqueue_in(zone_t *zone, zone_event_type_t type,
+                            worker_pool_t *pool)
+{
+	if (!zone || !valid_event(type) || !pool) {
 		return;
 	}
 
@@ -306,7 +316,7 @@ void zone_events_enqueue(zone_t *zone, zone_event_type_t type)
 	if (!events->running && !events->frozen) {
 		events->running = true;
 		event_set_time(events, type, ZONE_EVENT_IMMEDIATE);
-		worker_pool_assign(events->pool, &events->task);
+		worker_pool_assign(pool, &events->task);
 		pthread_mutex_unlock(&events->mx);
 		return;
 	}
@@ -101,6 +101,20 @@ void zone_events_deinit(struct zone *zone);
  */
 void zone_events_enqueue(struct zone *zone, zone_event_type_t type);
 
+/*!
+ * \brief Enqueue event type for asynchronous execution in a given pool.
+ *
+ * Like \ref zone_events_enqueue, but the event bypassing the scheduler is
+ * executed by the given worker pool (e.g. zone loaders). Following events
+ * are executed by the server worker pool.
+ *
+ * \param zone  Zone to schedule new event for.
+ * \param type  Type of event.
+ * \param pool  Worker pool to execute the event.
+ */
+void zone_events_enqueue_in(struct zone *zone, zone_event_type_t type,
+                            worker_pool_t *pool);
+
 /*!
  * \brief Schedule new zone event to absolute time.
  *
@@ -510,7 +510,13 @@ int event_flush(zone_t *zone)
 		return KNOT_EOK;
 	}
 
-	return zone_flush_journal(zone);
+	int ret = zone_flush_journal(zone);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	/* Only synced changesets can be compacted. */
+	return zone_compact_journal(zone);
 }
 
 int event_notify(zone_t *zone)
@@ -22,6 +22,7 @@
 #include "libknot/rrset.h"
 #include "libknot/rdataset.h"
 #include "libknot/rrtype/rrsig.h"
+#include "libknot/packet/rrset-wire.h"
 #include "libknot/descriptor.h"
 #include "libknot/internal/mempattern.h"
 
@@ -30,6 +31,7 @@ static void rr_data_clear(struct rr_data *data, mm_ctx_t *mm)
 {
 	knot_rdataset_clear(&data->rrs, mm);
 	free(data->additional);
+	knot_rrset_image_free(&data->image, NULL);
 }
 
 /*! \brief Clears allocated data in RRSet entry. */
@@ -41,6 +43,7 @@ static int rr_data_from(const knot_rrset_t *rrset, struct rr_data *data, mm_ctx_
 	}
 	data->type = rrset->type;
 	data->additional = NULL;
+	data->image = NULL;
 
 	return KNOT_EOK;
 }
@@ -86,18 +89,17 @@ static bool ttl_error(struct rr_data *node_data, const knot_rrset_t *rrset)
 
 zone_node_t *node_new(const knot_dname_t *owner, mm_ctx_t *mm)
 {
-	zone_node_t *ret = mm_alloc(mm, sizeof(zone_node_t));
+	/* The owner is stored right after the node, in the same block. */
+	size_t owner_size = (owner != NULL) ? knot_dname_size(owner) : 0;
+	zone_node_t *ret = mm_alloc(mm, sizeof(zone_node_t) + owner_size);
 	if (ret == NULL) {
 		return NULL;
 	}
 	memset(ret, 0, sizeof(*ret));
 
 	if (owner) {
-		ret->owner = knot_dname_copy(owner, mm);
-		if (ret->owner == NULL) {
-			mm_free(mm, ret);
-			return NULL;
-		}
+		ret->owner = (knot_dname_t *)(ret + 1);
+		memcpy(ret->owner, owner, owner_size);
 	}
 
 	// Node is authoritive by default.
@@ -131,8 +133,6 @@ void node_free(zone_node_t **node, mm_ctx_t *mm)
 		mm_free(mm, (*node)->rrs);
 	}
 
-	knot_dname_free(&(*node)->owner, mm);
-
 	mm_free(mm, *node);
 	*node = NULL;
 }
@@ -162,8 +162,9 @@ zone_node_t *node_shallow_copy(const zone_node_t *src, mm_ctx_t *mm)
 	memcpy(dst->rrs, src->rrs, rrlen);
 
 	for (uint16_t i = 0; i < src->rrset_count; ++i) {
-		// Clear additionals in the copy.
+		// Clear additionals and wire images in the copy.
 		dst->rrs[i].additional = NULL;
+		dst->rrs[i].image = NULL;
 	}
 
 	return dst;
@@ -40,7 +40,7 @@ struct rr_data;
  *        name in a zone.
  */
 typedef struct zone_node {
-	knot_dname_t *owner; /*!< Domain name being the owner of this node. */
+	knot_dname_t *owner; /*!< Owner of this node, stored after the node. */
 	struct zone_node *parent; /*!< Parent node in the name hierarchy. */
 
 	/*! \brief Array with data of RRSets belonging to this node. */
@@ -61,7 +61,8 @@ typedef struct zone_node {
 struct rr_data {
 	uint16_t type; /*!< \brief RR type of data. */
 	knot_rdataset_t rrs; /*!< \brief Data of given type. */
-	zone_node_t **additional; /*!< \brief Additional nodes with glues. */
+	zone_node_t **additional; /*!< \brief Additional nodes with glues or NULL. */
+	struct knot_rrset_image *image; /*!< \brief Precomputed wire format. */
 };
 
 /*! \brief Flags used to mark nodes with some property. */
@@ -227,6 +228,7 @@ static inline knot_rrset_t node_rrset(const zone_node_t *node, uint16_t type)
 			knot_rrset_init(&rrset, node->owner, type, KNOT_CLASS_IN);
 			rrset.rrs = rr_data->rrs;
 			rrset.additional = rr_data->additional;
+			rrset.image = rr_data->image;
 			return rrset;
 		}
 	}
@@ -255,6 +257,7 @@ static inline knot_rrset_t node_rrset_at(const zone_node_t *node, size_t pos)
 	knot_rrset_init(&rrset, node->owner, rr_data->type, KNOT_CLASS_IN);
 	rrset.rrs = rr_data->rrs;
 	rrset.additional = rr_data->additional;
+	rrset.image = rr_data->image;
 	return rrset;
 }
 
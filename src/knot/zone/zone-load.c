@@ -14,7 +14,11 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <pthread.h>
+#include <sys/stat.h>
+
 #include "knot/common/log.h"
+#include "knot/server/dthreads.h"
 #include "knot/server/journal.h"
 #include "knot/zone/zone-diff.h"
 #include "knot/zone/zone-load.h"
@@ -23,6 +27,57 @@
 #include "knot/dnssec/zone-events.h"
 #include "knot/updates/apply.h"
 #include "libknot/libknot.h"
+#include "libknot/internal/macros.h"
+
+/*! \brief Threads of the running parallel zone file loads. */
+static struct {
+	pthread_mutex_t lock;
+	unsigned used;     /*!< Threads used, including the merging threads. */
+	unsigned running;  /*!< Number of running parallel loads. */
+	unsigned expected; /*!< Announced parallel loads not finished yet. */
+} parsers = { PTHREAD_MUTEX_INITIALIZER, 0, 0, 0 };
+
+void zone_load_announce(unsigned count)
+{
+	pthread_mutex_lock(&parsers.lock);
+	parsers.expected = count;
+	pthread_mutex_unlock(&parsers.lock);
+}
+
+/*!
+ * \brief Take a fair share of the CPUs for a parallel load.
+ *
+ * The CPUs are split between the running and announced loads, the share
+ * includes the loading thread which merges the parsed parts. A load
+ * started when no CPU is free parses on its own thread only.
+ */
+static unsigned parsers_acquire(void)
+{
+	unsigned cpus = MAX(dt_online_cpus(), 1);
+
+	pthread_mutex_lock(&parsers.lock);
+	unsigned loads = MAX(parsers.expected, parsers.running + 1);
+	unsigned share = cpus / loads;
+	unsigned idle = (parsers.used < cpus) ? cpus - parsers.used : 0;
+	share = MAX(MIN(share, idle), 1);
+	parsers.used += share;
+	parsers.running += 1;
+	pthread_mutex_unlock(&parsers.lock);
+
+	return share;
+}
+
+/*! \brief Return the threads after the load. */
+static void parsers_release(unsigned share)
+{
+	pthread_mutex_lock(&parsers.lock);
+	parsers.used -= share;
+	parsers.running -= 1;
+	if (parsers.expected > 0) {
+		parsers.expected -= 1;
+	}
+	pthread_mutex_unlock(&parsers.lock);
+}
 
 zone_contents_t *zone_load_contents(conf_t *conf, const knot_dname_t *zone_name)
 {
@@ -33,6 +88,9 @@ zone_contents_t *zone_load_contents(conf_t *conf, const knot_dname_t *zone_name)
 	char *zonefile = conf_zonefile(conf, zone_name);
 	conf_val_t val = conf_zone_get(conf, C_SEM_CHECKS, zone_name);
 	int ret = zonefile_open(&zl, zonefile, zone_name, conf_bool(&val));
+	struct stat st;
+	bool parallel = (ret == KNOT_EOK && stat(zonefile, &st) == 0 &&
+	                 st.st_size > zl.chunk_size);
 	free(zonefile);
 	if (ret != KNOT_EOK) {
 		return NULL;
@@ -43,7 +101,14 @@ zone_contents_t *zone_load_contents(conf_t *conf, const knot_dname_t *zone_name)
 	 */
 	zl.creator->master = !zone_load_can_bootstrap(conf, zone_name);
 
+	/* Files split into parts are parsed in parallel, the loading thread
+	 * merges the parts. */
+	unsigned share = parallel ? parsers_acquire() : 0;
+	zl.threads = (share > 2) ? share - 1 : 1;
 	zone_contents_t *zone_contents = zonefile_load(&zl);
+	if (parallel) {
+		parsers_release(share);
+	}
 	zonefile_close(&zl);
 	if (zone_contents == NULL) {
 		return NULL;
@@ -90,10 +155,8 @@ int zone_load_check(conf_t *conf, zone_contents_t *contents)
 int zone_load_journal(conf_t *conf, zone_t *zone, zone_contents_t *contents)
 {
 	/* Check if journal is used and zone is not empty. */
-	char *journal_name = conf_journalfile(conf, zone->name);
-	if (!journal_exists(journal_name) ||
+	if (!journal_exists(zone->journal_db, zone->name) ||
 	    zone_contents_is_empty(contents)) {
-		free(journal_name);
 		return KNOT_EOK;
 	}
 
@@ -105,10 +168,9 @@ int zone_load_journal(conf_t *conf, zone_t *zone, zone_contents_t *contents)
 	init_list(&chgs);
 
 	pthread_mutex_lock(&zone->journal_lock);
-	int ret = journal_load_changesets(journal_name, zone, &chgs, serial,
-	                                  serial - 1);
+	int ret = journal_load_changesets(zone->journal_db, zone->name, &chgs,
+	                                  serial, serial - 1);
 	pthread_mutex_unlock(&zone->journal_lock);
-	free(journal_name);
 
 	if ((ret != KNOT_EOK && ret != KNOT_ERANGE) || EMPTY_LIST(chgs)) {
 		changesets_free(&chgs);
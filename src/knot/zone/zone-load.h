@@ -30,6 +30,16 @@
  */
 zone_contents_t *zone_load_contents(conf_t *conf, const knot_dname_t *zone_name);
 
+/*!
+ * \brief Announce the number of zone files to be parsed in parallel.
+ *
+ * The CPUs are split fairly between the announced loads, so that a large
+ * zone loaded first doesn't leave the next ones a single thread.
+ *
+ * \param count Number of zone files larger than the parsed part size.
+ */
+void zone_load_announce(unsigned count);
+
 /*!
  * \brief Check loaded zone contents validity.
  *
@@ -19,6 +19,7 @@
 #include <stdio.h>
 
 #include "knot/zone/zone-tree.h"
+#include "knot/zone/arena.h"
 #include "knot/zone/node.h"
 #include "knot/common/debug.h"
 #include "libknot/internal/trie/hat-trie.h"
@@ -314,9 +315,9 @@ void zone_tree_free(zone_tree_t **tree)
 
 static int zone_tree_free_node(zone_node_t **node, void *data)
 {
-	UNUSED(data);
+	mm_ctx_t *mm = data;
 	if (node) {
-		node_free(node, NULL);
+		node_free(node, mm);
 	}
 	return KNOT_EOK;
 }
@@ -327,6 +328,7 @@ void zone_tree_deep_free(zone_tree_t **tree)
 		return;
 	}
 
-	zone_tree_apply(*tree, zone_tree_free_node, NULL);
+	/* Nodes may be allocated both from the heap and from an arena. */
+	zone_tree_apply(*tree, zone_tree_free_node, zone_arena_heap_mm());
 	zone_tree_free(tree);
 }
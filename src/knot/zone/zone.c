@@ -41,7 +41,13 @@
 #include "libknot/internal/mem.h"
 #include "libknot/rrtype/soa.h"
 
-#define JOURNAL_SUFFIX	".diff.db"
+/*! \brief Last assigned zone generation, unique across all zones. */
+static uint64_t last_generation = 0;
+
+static uint64_t next_generation(void)
+{
+	return __sync_add_and_fetch(&last_generation, 1);
+}
 
 static void free_ddns_queue(zone_t *z)
 {
@@ -69,6 +75,8 @@ zone_t* zone_new(const knot_dname_t *name)
 		return NULL;
 	}
 
+	zone->generation = next_generation();
+
 	// DDNS
 	pthread_mutex_init(&zone->ddns_lock, NULL);
 	zone->ddns_queue_size = 0;
@@ -125,23 +133,22 @@ int zone_change_store(zone_t *zone, changeset_t *change)
 
 	conf_val_t val = conf_zone_get(conf(), C_MAX_JOURNAL_SIZE, zone->name);
 	int64_t ixfr_fslimit = conf_int(&val);
-	char *journal_file = conf_journalfile(conf(), zone->name);
 
 	pthread_mutex_lock(&zone->journal_lock);
-	int ret = journal_store_changeset(change, journal_file, ixfr_fslimit);
+	int ret = journal_store_changeset(zone->journal_db, zone->name, change,
+	                                  ixfr_fslimit);
 	if (ret == KNOT_EBUSY) {
-		log_zone_notice(zone->name, "journal is full, flushing");
+		log_zone_notice(zone->name, "journal is full or discontinuous, flushing");
 
 		/* Transaction rolled back, journal released, we may flush. */
 		ret = zone_flush_journal(zone);
 		if (ret == KNOT_EOK) {
-			ret = journal_store_changeset(change, journal_file, ixfr_fslimit);
+			ret = journal_store_changeset(zone->journal_db, zone->name,
+			                              change, ixfr_fslimit);
 		}
 	}
 	pthread_mutex_unlock(&zone->journal_lock);
 
-	free(journal_file);
-
 	return ret;
 }
 
@@ -152,24 +159,23 @@ int zone_changes_store(zone_t *zone, list_t *chgs)
 
 	conf_val_t val = conf_zone_get(conf(), C_MAX_JOURNAL_SIZE, zone->name);
 	int64_t ixfr_fslimit = conf_int(&val);
-	char *journal_file = conf_journalfile(conf(), zone->name);
 
 	pthread_mutex_lock(&zone->journal_lock);
-	int ret = journal_store_changesets(chgs, journal_file, ixfr_fslimit);
+	int ret = journal_store_changesets(zone->journal_db, zone->name, chgs,
+	                                   ixfr_fslimit);
 	if (ret == KNOT_EBUSY) {
-		log_zone_notice(zone->name, "journal is full, flushing");
+		log_zone_notice(zone->name, "journal is full or discontinuous, flushing");
 
 		/* Transaction rolled back, journal released, we may flush. */
 		ret = zone_flush_journal(zone);
 		if (ret == KNOT_EOK) {
-			ret = journal_store_changesets(chgs, journal_file, ixfr_fslimit);
+			ret = journal_store_changesets(zone->journal_db, zone->name,
+			                               chgs, ixfr_fslimit);
 		}
 
 	}
 	pthread_mutex_unlock(&zone->journal_lock);
 
-	free(journal_file);
-
 	return ret;
 }
 
@@ -179,10 +185,23 @@ zone_contents_t *zone_switch_contents(zone_t *zone, zone_contents_t *new_content
 		return NULL;
 	}
 
+	/* Precompute wire format of the RRSets if configured. */
+	conf_val_t val = conf_zone_get(conf(), C_PRECOMPUTE_WIRE, zone->name);
+	if (new_contents != NULL && conf_bool(&val)) {
+		int ret = zone_contents_build_images(new_contents);
+		if (ret != KNOT_EOK) {
+			log_zone_warning(zone->name, "failed to precompute wire "
+			                 "format (%s)", knot_strerror(ret));
+		}
+	}
+
 	zone_contents_t *old_contents;
 	zone_contents_t **current_contents = &zone->contents;
 	old_contents = rcu_xchg_pointer(current_contents, new_contents);
 
+	/* Invalidate cached answers, set after the new contents is published. */
+	zone->generation = next_generation();
+
 	return old_contents;
 }
 
@@ -326,7 +345,9 @@ int zone_flush_journal(zone_t *zone)
 	zone_contents_t *contents = zone->contents;
 	uint32_t serial_to = zone_contents_serial(contents);
 	if (zone->zonefile_serial == serial_to) {
-		return KNOT_EOK; /* No differences. */
+		/* No differences, the journal history is in the zone file. */
+		journal_mark_synced(zone->journal_db, zone->name);
+		return KNOT_EOK;
 	}
 
 	char *zonefile = conf_zonefile(conf(), zone->name);
@@ -354,14 +375,10 @@ int zone_flush_journal(zone_t *zone)
 
 	free(zonefile);
 
-	char *journal_file = conf_journalfile(conf(), zone->name);
-
 	/* Update zone file serial and journal. */
 	zone->zonefile_mtime = st.st_mtime;
 	zone->zonefile_serial = serial_to;
-	journal_mark_synced(journal_file);
-
-	free(journal_file);
+	journal_mark_synced(zone->journal_db, zone->name);
 
 	/* Trim extra heap. */
 	mem_trim();
@@ -369,6 +386,35 @@ int zone_flush_journal(zone_t *zone)
 	return ret;
 }
 
+int zone_compact_journal(zone_t *zone)
+{
+	if (zone == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	/* Check for disabled compaction. */
+	conf_val_t val = conf_zone_get(conf(), C_JOURNAL_COMPACT_AGE, zone->name);
+	int64_t age = conf_int(&val);
+	if (age <= 0) {
+		return KNOT_EOK;
+	}
+
+	size_t merged = 0;
+	int ret = journal_compact(zone->journal_db, zone->name, age, &merged);
+	if (ret != KNOT_EOK) {
+		log_zone_warning(zone->name, "failed to compact journal (%s)",
+		                 knot_strerror(ret));
+		return ret;
+	}
+
+	if (merged > 0) {
+		log_zone_info(zone->name, "journal compacted, %zu changesets merged",
+		              merged);
+	}
+
+	return KNOT_EOK;
+}
+
 int zone_update_enqueue(zone_t *zone, knot_pkt_t *pkt, struct process_query_param *param)
 {
 
@@ -397,10 +443,19 @@ int zone_update_enqueue(zone_t *zone, knot_pkt_t *pkt, struct process_query_para
 	add_tail(&zone->ddns_queue, (node_t *)req);
 	++zone->ddns_queue_size;
 
+	/* Process immediately if the batch is full, otherwise wait for more
+	 * updates. The first update in the batch sets the deadline. */
+	const size_t batch_size = zone->cache.ddns_batch_size;
+	bool batch_full = (batch_size > 0 && zone->ddns_queue_size >= batch_size);
+
 	pthread_mutex_unlock(&zone->ddns_lock);
 
 	/* Schedule UPDATE event. */
-	zone_events_schedule(zone, ZONE_EVENT_UPDATE, ZONE_EVENT_NOW);
+	if (batch_full) {
+		zone_events_schedule(zone, ZONE_EVENT_UPDATE, ZONE_EVENT_NOW);
+	} else {
+		zone_events_schedule(zone, ZONE_EVENT_UPDATE, zone->cache.ddns_delay);
+	}
 
 	return KNOT_EOK;
 }
@@ -418,6 +473,20 @@ size_t zone_update_dequeue(zone_t *zone, list_t *updates)
 		return 0;
 	}
 
+	/* Take at most one batch, leave the rest queued. */
+	const size_t batch_size = zone->cache.ddns_batch_size;
+	if (batch_size > 0 && zone->ddns_queue_size > batch_size) {
+		init_list(updates);
+		for (size_t i = 0; i < batch_size; ++i) {
+			node_t *req = HEAD(zone->ddns_queue);
+			rem_node(req);
+			add_tail(updates, req);
+		}
+		zone->ddns_queue_size -= batch_size;
+		pthread_mutex_unlock(&zone->ddns_lock);
+		return batch_size;
+	}
+
 	*updates = zone->ddns_queue;
 	size_t update_count = zone->ddns_queue_size;
 	init_list(&zone->ddns_queue);
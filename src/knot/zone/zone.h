@@ -58,12 +58,16 @@ typedef struct zone
 	zone_contents_t *contents;
 	zone_flag_t flags;
 
+	/*! \brief Unique generation, changed with each contents switch. */
+	uint64_t generation;
+
 	/*! \brief DDNS queue and lock. */
 	pthread_mutex_t ddns_lock;
 	size_t ddns_queue_size;
 	list_t ddns_queue;
 
-	/*! \brief Journal access lock. */
+	/*! \brief Journal database and access lock. */
+	journal_db_t *journal_db;
 	pthread_mutex_t journal_lock;
 
 	/*! \brief Zone events. */
@@ -80,6 +84,13 @@ typedef struct zone
 	/*! \brief Query modules. */
 	list_t query_modules;
 	struct query_plan *query_plan;
+
+	/*! \brief Cached zone options (zone is recreated on config reload). */
+	struct {
+		bool disable_any;
+		uint32_t ddns_delay;      /*!< DDNS coalescing window (seconds). */
+		size_t ddns_batch_size;   /*!< Max. updates per batch (0 unlimited). */
+	} cache;
 } zone_t;
 
 /*----------------------------------------------------------------------------*/
@@ -139,10 +150,16 @@ int zone_master_try(zone_t *zone, zone_master_cb callback, void *callback_data,
 /*! \brief Synchronize zone file with journal. */
 int zone_flush_journal(zone_t *zone);
 
+/*! \brief Merge old synced changesets in journal if configured. */
+int zone_compact_journal(zone_t *zone);
+
 /*! \brief Enqueue UPDATE request for processing. */
 int zone_update_enqueue(zone_t *zone, knot_pkt_t *pkt, struct process_query_param *param);
 
-/*! \brief Dequeue UPDATE request. Returns number of queued updates. */
+/*!
+ * \brief Dequeue UPDATE requests, at most 'ddns-batch-size' of them.
+ *        Returns number of dequeued updates.
+ */
 size_t zone_update_dequeue(zone_t *zone, list_t *updates);
 
 /*! \brief Returns true if final SOA in transfer has newer serial than zone */
@@ -121,6 +121,8 @@ static zone_t *create_zone_from(const knot_dname_t *name, server_t *server)
 		return NULL;
 	}
 
+	zone->journal_db = server->journal_db;
+
 	int result = zone_events_setup(zone, server->workers, &server->sched,
 	                               server->timers_db);
 	if (result != KNOT_EOK) {
@@ -132,7 +134,8 @@ static zone_t *create_zone_from(const knot_dname_t *name, server_t *server)
 }
 
 static zone_t *create_zone_reload(conf_t *conf, const knot_dname_t *name,
-                                  server_t *server, zone_t *old_zone)
+                                  server_t *server, zone_t *old_zone,
+                                  bool *load)
 {
 	zone_t *zone = create_zone_from(name, server);
 	if (!zone) {
@@ -144,8 +147,7 @@ static zone_t *create_zone_reload(conf_t *conf, const knot_dname_t *name,
 
 	switch (zstatus) {
 	case ZONE_STATUS_FOUND_UPDATED:
-		/* Enqueueing makes the first zone load waitable. */
-		zone_events_enqueue(zone, ZONE_EVENT_RELOAD);
+		*load = true;
 		/* Replan DDNS processing if there are pending updates. */
 		zone_events_replan_ddns(zone, old_zone);
 		break;
@@ -192,7 +194,7 @@ static bool zone_expired(const time_t *timers)
 }
 
 static zone_t *create_zone_new(conf_t * conf, const knot_dname_t *name,
-                               server_t *server)
+                               server_t *server, bool *load)
 {
 	zone_t *zone = create_zone_from(name, server);
 	if (!zone) {
@@ -218,8 +220,7 @@ static zone_t *create_zone_new(conf_t * conf, const knot_dname_t *name,
 	switch (zstatus) {
 	case ZONE_STATUS_FOUND_NEW:
 		if (!zone_expired(timers)) {
-			/* Enqueueing makes the first zone load waitable. */
-			zone_events_enqueue(zone, ZONE_EVENT_RELOAD);
+			*load = true;
 		}
 		break;
 	case ZONE_STATUS_BOOSTRAP:
@@ -245,20 +246,101 @@ static zone_t *create_zone_new(conf_t * conf, const knot_dname_t *name,
  * \param conf       Configuration.
  * \param server     Server.
  * \param old_zone   Already loaded zone (can be NULL).
+ * \param load       Set if the zone file should be loaded.
  *
  * \return Error code, KNOT_EOK if successful.
  */
 static zone_t *create_zone(conf_t *conf, const knot_dname_t *name, server_t *server,
-                           zone_t *old_zone)
+                           zone_t *old_zone, bool *load)
 {
 	assert(conf);
 	assert(name);
 	assert(server);
 
 	if (old_zone) {
-		return create_zone_reload(conf, name, server, old_zone);
+		return create_zone_reload(conf, name, server, old_zone, load);
 	} else {
-		return create_zone_new(conf, name, server);
+		return create_zone_new(conf, name, server, load);
+	}
+}
+
+/*! \brief Zones to be loaded. */
+typedef struct {
+	zone_load_t *zones;
+	size_t count;
+	size_t capacity;
+} zone_loads_t;
+
+static int loads_add(zone_loads_t *loads, conf_t *conf, zone_t *zone)
+{
+	if (loads->count == loads->capacity) {
+		size_t capacity = loads->capacity ? 2 * loads->capacity : 64;
+		void *zones = realloc(loads->zones, capacity * sizeof(zone_load_t));
+		if (zones == NULL) {
+			return KNOT_ENOMEM;
+		}
+		loads->zones = zones;
+		loads->capacity = capacity;
+	}
+
+	char *zonefile = conf_zonefile(conf, zone->name);
+	struct stat st;
+	int ret = (zonefile != NULL) ? stat(zonefile, &st) : -1;
+	free(zonefile);
+
+	zone_load_t *load = &loads->zones[loads->count];
+	load->zone = zone;
+	load->size = (ret == 0) ? st.st_size : 0;
+	load->order = loads->count;
+	loads->count += 1;
+
+	return KNOT_EOK;
+}
+
+/*! \brief Order zones by zone file size, the largest first. */
+static int load_cmp(const void *a, const void *b)
+{
+	const zone_load_t *load_a = a;
+	const zone_load_t *load_b = b;
+
+	if (load_a->size != load_b->size) {
+		return (load_a->size > load_b->size) ? -1 : 1;
+	}
+
+	/* Keep the configuration order otherwise. */
+	return (load_a->order < load_b->order) ? -1 : 1;
+}
+
+void zonedb_load_order(zone_load_t *zones, size_t count)
+{
+	qsort(zones, count, sizeof(zone_load_t), load_cmp);
+}
+
+/*!
+ * \brief Enqueue loading of the zones.
+ *
+ * The zones are loaded in parallel by the zone loader pool, the largest
+ * zones go first so that they don't delay the completion.
+ */
+static void enqueue_loads(zone_loads_t *loads, server_t *server)
+{
+	zonedb_load_order(loads->zones, loads->count);
+
+	/* The loaders are drained, start counting the new batch. */
+	worker_pool_reset_completed(server->loaders);
+
+	unsigned parallel = 0;
+	for (size_t i = 0; i < loads->count; ++i) {
+		if (loads->zones[i].size > ZONEFILE_CHUNK_SIZE) {
+			parallel += 1;
+		}
+	}
+	zone_load_announce(parallel);
+
+	for (size_t i = 0; i < loads->count; ++i) {
+		/* Enqueueing makes the first zone load waitable. */
+		zone_events_enqueue_in(loads->zones[i].zone, ZONE_EVENT_RELOAD,
+		                       server->loaders);
 	}
 }
 
@@ -266,14 +348,16 @@ static zone_t *create_zone(conf_t *conf, const knot_dname_t *name, server_t *ser
  * \brief Create new zone database.
  *
  * Zones that should be retained are just added from the old database to the
- * new. New zones are loaded.
+ * new. New zones are added to the list of zones to be loaded.
  *
  * \param conf    New server configuration.
  * \param server  Server instance.
+ * \param loads   Zones to be loaded.
  *
  * \return New zone database.
  */
-static knot_zonedb_t *create_zonedb(conf_t *conf, server_t *server)
+static knot_zonedb_t *create_zonedb(conf_t *conf, server_t *server,
+                                    zone_loads_t *loads)
 {
 	assert(conf);
 	assert(server);
@@ -288,7 +372,8 @@ static knot_zonedb_t *create_zonedb(conf_t *conf, server_t *server)
 	while (iter.code == KNOT_EOK) {
 		conf_val_t id = conf_iter_id(conf, &iter);
 		zone_t *old_zone = knot_zonedb_find(db_old, conf_dname(&id));
-		zone_t *zone = create_zone(conf, conf_dname(&id), server, old_zone);
+		bool load = false;
+		zone_t *zone = create_zone(conf, conf_dname(&id), server, old_zone, &load);
 		if (!zone) {
 			log_zone_error(id.data, "zone cannot be created");
 			conf_iter_next(conf, &iter);
@@ -304,8 +389,22 @@ static knot_zonedb_t *create_zonedb(conf_t *conf, server_t *server)
 			continue;
 		}
 
+		/* Cache zone options used in query processing. */
+		conf_val_t val = conf_zone_get(conf, C_DISABLE_ANY, zone->name);
+		zone->cache.disable_any = conf_bool(&val);
+		val = conf_zone_get(conf, C_DDNS_DELAY, zone->name);
+		zone->cache.ddns_delay = conf_int(&val);
+		val = conf_zone_get(conf, C_DDNS_BATCH_SIZE, zone->name);
+		zone->cache.ddns_batch_size = conf_int(&val);
+
 		knot_zonedb_insert(db_new, zone);
 
+		if (load && loads_add(loads, conf, zone) != KNOT_EOK) {
+			/* Load without ordering. */
+			zone_events_enqueue_in(zone, ZONE_EVENT_RELOAD,
+			                       server->loaders);
+		}
+
 		conf_iter_next(conf, &iter);
 	}
 	conf_iter_finish(conf, &iter);
@@ -360,12 +459,18 @@ int zonedb_reload(conf_t *conf, struct server *server)
 	}
 
 	/* Insert all required zones to the new zone DB. */
-	knot_zonedb_t *db_new = create_zonedb(conf, server);
+	zone_loads_t loads = { NULL };
+	knot_zonedb_t *db_new = create_zonedb(conf, server, &loads);
 	if (db_new == NULL) {
 		log_error("failed to create new zone database");
+		free(loads.zones);
 		return KNOT_ENOMEM;
 	}
 
+	/* Load zone files, the loaders are suspended until the reload ends. */
+	enqueue_loads(&loads, server);
+	free(loads.zones);
+
 	/* Rebuild zone database search stack. */
 	knot_zonedb_build_index(db_new);
 
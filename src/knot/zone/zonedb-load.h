@@ -16,11 +16,30 @@
 
 #pragma once
 
+#include <sys/types.h>
+
 #include "knot/conf/conf.h"
 #include "knot/zone/zonedb.h"
 
 struct server;
 
+/*! \brief Zone waiting for loading of the zone file. */
+typedef struct {
+	zone_t *zone;
+	off_t size;    /*!< Zone file size. */
+	size_t order;  /*!< Position in the configuration. */
+} zone_load_t;
+
+/*!
+ * \brief Sort the zones by zone file size, the largest first.
+ *
+ * Zones of the same size keep the configuration order.
+ *
+ * \param zones Zones to be loaded.
+ * \param count Number of zones.
+ */
+void zonedb_load_order(zone_load_t *zones, size_t count);
+
 /*!
  * \brief Update zone database according to configuration.
  *
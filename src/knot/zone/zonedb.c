@@ -38,17 +38,14 @@
 /*! \brief Discard zone in zone database. */
 static void discard_zone(zone_t *zone)
 {
-	char *journal_file = conf_journalfile(conf(), zone->name);
-
 	/* Flush if bootstrapped or if the journal doesn't exist. */
-	if (zone->zonefile_mtime == 0 || !journal_exists(journal_file)) {
+	if (zone->zonefile_mtime == 0 ||
+	    !journal_exists(zone->journal_db, zone->name)) {
 		pthread_mutex_lock(&zone->journal_lock);
 		zone_flush_journal(zone);
 		pthread_mutex_unlock(&zone->journal_lock);
 	}
 
-	free(journal_file);
-
 	zone_free(&zone);
 }
 
@@ -22,9 +22,11 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <pthread.h>
 #include <time.h>
 #include <unistd.h>
 #include <inttypes.h>
+#include <sys/mman.h>
 
 #include "libknot/libknot.h"
 #include "libknot/internal/strlcat.h"
@@ -43,17 +45,20 @@
 #define WARNING(zone, fmt, ...) log_zone_warning(zone, "zone loader, " fmt, ##__VA_ARGS__)
 #define INFO(zone, fmt, ...) log_zone_info(zone, "zone loader, " fmt, ##__VA_ARGS__)
 
-void process_error(zs_scanner_t *s)
+static void log_scanner_error(const knot_dname_t *zname, const zs_scanner_t *s)
 {
-	zcreator_t *zc = s->data;
-	const knot_dname_t *zname = zc->z->apex->owner;
-
 	ERROR(zname, "%s in zone, file '%s', line %"PRIu64" (%s)",
 	      s->stop ? "fatal error" : "error",
 	      s->file.name, s->line_counter,
 	      zs_strerror(s->error_code));
 }
 
+void process_error(zs_scanner_t *s)
+{
+	zcreator_t *zc = s->data;
+	log_scanner_error(zc->z->apex->owner, s);
+}
+
 static int add_rdata_to_rr(knot_rrset_t *rrset, const zs_scanner_t *scanner)
 {
 	return knot_rrset_add_rdata(rrset, scanner->r_data, scanner->r_data_length,
@@ -106,7 +111,7 @@ void log_ttl_error(const zone_contents_t *zone, const zone_node_t *node,
 
 int zcreator_step(zcreator_t *zc, const knot_rrset_t *rr)
 {
-	if (zc == NULL || rr == NULL || rr->rrs.rr_count != 1) {
+	if (zc == NULL || knot_rrset_empty(rr)) {
 		return KNOT_EINVAL;
 	}
 
@@ -145,46 +150,394 @@ int zcreator_step(zcreator_t *zc, const knot_rrset_t *rr)
 	return sem_fatal_error ? KNOT_ESEMCHECK : KNOT_EOK;
 }
 
-/*! \brief Creates RR from parser input, passes it to handling function. */
-static void scanner_process(zs_scanner_t *scanner)
+/*! \brief Checks if the RR can be added to the pending RRSet. */
+static bool pending_accepts(const knot_rrset_t *pending, const knot_rrset_t *rr)
 {
-	zcreator_t *zc = scanner->data;
-	if (zc->ret != KNOT_EOK) {
-		scanner->stop = true;
-		return;
+	/* Extra SOA records are ignored one by one. */
+	return rr->type == pending->type && rr->type != KNOT_RRTYPE_SOA &&
+	       rr->rclass == pending->rclass &&
+	       knot_rrset_ttl(rr) == knot_rrset_ttl(pending) &&
+	       knot_dname_is_equal(rr->owner, pending->owner);
+}
+
+int zcreator_add(zcreator_t *zc, const knot_rrset_t *rr)
+{
+	if (zc == NULL || knot_rrset_empty(rr)) {
+		return KNOT_EINVAL;
 	}
 
+	if (!knot_rrset_empty(&zc->pending) && !pending_accepts(&zc->pending, rr)) {
+		int ret = zcreator_flush(zc);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
+	if (zc->pending.owner == NULL) {
+		knot_dname_t *owner = knot_dname_copy(rr->owner, NULL);
+		if (owner == NULL) {
+			return KNOT_ENOMEM;
+		}
+		knot_rrset_init(&zc->pending, owner, rr->type, rr->rclass);
+	}
+
+	return knot_rdataset_merge(&zc->pending.rrs, &rr->rrs, NULL);
+}
+
+int zcreator_flush(zcreator_t *zc)
+{
+	if (zc == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	int ret = KNOT_EOK;
+	if (!knot_rrset_empty(&zc->pending)) {
+		ret = zcreator_step(zc, &zc->pending);
+	}
+
+	knot_rrset_clear(&zc->pending, NULL);
+	knot_rrset_init_empty(&zc->pending);
+
+	return ret;
+}
+
+/*! \brief Creates RR from parser input. */
+static int scanner_rr(const zs_scanner_t *scanner, const knot_dname_t *zname,
+                      knot_rrset_t *rr)
+{
 	knot_dname_t *owner = knot_dname_copy(scanner->r_owner, NULL);
 	if (owner == NULL) {
-		zc->ret = KNOT_ENOMEM;
-		return;
+		return KNOT_ENOMEM;
 	}
 
-	knot_rrset_t rr;
-	knot_rrset_init(&rr, owner, scanner->r_type, scanner->r_class);
-	int ret = add_rdata_to_rr(&rr, scanner);
+	knot_rrset_init(rr, owner, scanner->r_type, scanner->r_class);
+	int ret = add_rdata_to_rr(rr, scanner);
 	if (ret != KNOT_EOK) {
-		char *rr_name = knot_dname_to_str_alloc(rr.owner);
-		const knot_dname_t *zname = zc->z->apex->owner;
+		char *rr_name = knot_dname_to_str_alloc(rr->owner);
 		ERROR(zname, "failed to add RDATA, file '%s', line %"PRIu64", owner '%s'",
 		      scanner->file.name, scanner->line_counter, rr_name);
 		free(rr_name);
-		knot_dname_free(&owner, NULL);
-		zc->ret = ret;
-		return;
+		knot_rrset_clear(rr, NULL);
+		return ret;
 	}
 
 	/* Convert RDATA dnames to lowercase before adding to zone. */
-	ret = knot_rrset_rr_to_canonical(&rr);
+	ret = knot_rrset_rr_to_canonical(rr);
 	if (ret != KNOT_EOK) {
-		knot_dname_free(&owner, NULL);
-		zc->ret = ret;
+		knot_rrset_clear(rr, NULL);
+		return ret;
+	}
+
+	return KNOT_EOK;
+}
+
+/*! \brief Creates RR from parser input, passes it to handling function. */
+static void scanner_process(zs_scanner_t *scanner)
+{
+	zcreator_t *zc = scanner->data;
+	if (zc->ret != KNOT_EOK) {
+		scanner->stop = true;
+		return;
+	}
+
+	knot_rrset_t rr;
+	zc->ret = scanner_rr(scanner, zc->z->apex->owner, &rr);
+	if (zc->ret != KNOT_EOK) {
 		return;
 	}
 
-	zc->ret = zcreator_step(zc, &rr);
-	knot_dname_free(&owner, NULL);
-	knot_rdataset_clear(&rr.rrs, NULL);
+	zc->ret = zcreator_add(zc, &rr);
+	knot_rrset_clear(&rr, NULL);
+}
+
+/*! \brief Zone file part parsed in parallel, RRs are kept until merged. */
+typedef struct {
+	const zs_chunk_t *chunk;
+	knot_rrset_t *rrs;   /*!< Parsed RRs, consecutive RRs of RRSet merged. */
+	size_t count;
+	size_t capacity;
+	int ret;             /*!< Processing error. */
+	bool done;           /*!< Part is parsed. */
+} zpart_t;
+
+/*! \brief Shared context of the parallel zone file parsing. */
+typedef struct {
+	const knot_dname_t *zname;
+	const char *data;    /*!< Mapped zone file. */
+	zpart_t *parts;
+	size_t count;
+	size_t next;         /*!< Next part to parse. */
+	size_t merged;       /*!< Number of parts added to the zone. */
+	size_t window;       /*!< Maximum number of parts parsed in advance. */
+	bool stop;           /*!< Parsing is interrupted. */
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+} zparse_t;
+
+/*! \brief Parsing thread context. */
+typedef struct {
+	zparse_t *ctx;
+	zpart_t *part;       /*!< Currently parsed part. */
+	zs_scanner_t *scanner;
+	pthread_t thread;
+} zworker_t;
+
+static int part_add(zpart_t *part, knot_rrset_t *rr)
+{
+	if (part->count > 0) {
+		knot_rrset_t *last = &part->rrs[part->count - 1];
+		if (pending_accepts(last, rr)) {
+			int ret = knot_rdataset_merge(&last->rrs, &rr->rrs, NULL);
+			knot_rrset_clear(rr, NULL);
+			return ret;
+		}
+	}
+
+	if (part->count == part->capacity) {
+		size_t capacity = (part->capacity > 0) ? 2 * part->capacity : 256;
+		knot_rrset_t *rrs = realloc(part->rrs, capacity * sizeof(knot_rrset_t));
+		if (rrs == NULL) {
+			knot_rrset_clear(rr, NULL);
+			return KNOT_ENOMEM;
+		}
+		part->rrs = rrs;
+		part->capacity = capacity;
+	}
+
+	part->rrs[part->count++] = *rr;
+
+	return KNOT_EOK;
+}
+
+/*! \brief Adds RRs of the part into zone and frees them. */
+static int part_merge(zcreator_t *zc, zpart_t *part)
+{
+	int ret = part->ret;
+	for (size_t i = 0; i < part->count; i++) {
+		if (ret == KNOT_EOK) {
+			ret = zcreator_add(zc, &part->rrs[i]);
+		}
+		knot_rrset_clear(&part->rrs[i], NULL);
+	}
+
+	free(part->rrs);
+	part->rrs = NULL;
+	part->count = 0;
+	part->capacity = 0;
+
+	return ret;
+}
+
+static void part_process(zs_scanner_t *scanner)
+{
+	zworker_t *worker = scanner->data;
+	zpart_t *part = worker->part;
+	if (part->ret != KNOT_EOK) {
+		scanner->stop = true;
+		return;
+	}
+
+	knot_rrset_t rr;
+	part->ret = scanner_rr(scanner, worker->ctx->zname, &rr);
+	if (part->ret != KNOT_EOK) {
+		return;
+	}
+
+	part->ret = part_add(part, &rr);
+}
+
+static void part_error(zs_scanner_t *scanner)
+{
+	zworker_t *worker = scanner->data;
+	log_scanner_error(worker->ctx->zname, scanner);
+}
+
+static void *parse_thread(void *data)
+{
+	zworker_t *worker = data;
+	zparse_t *ctx = worker->ctx;
+
+	pthread_mutex_lock(&ctx->lock);
+	while (!ctx->stop && ctx->next < ctx->count) {
+		/* Don't get too far ahead of the merging. */
+		if (ctx->next >= ctx->merged + ctx->window) {
+			pthread_cond_wait(&ctx->cond, &ctx->lock);
+			continue;
+		}
+
+		worker->part = &ctx->parts[ctx->next++];
+		pthread_mutex_unlock(&ctx->lock);
+
+		(void)zs_scanner_parse_chunk(worker->scanner, ctx->data,
+		                             worker->part->chunk);
+
+		pthread_mutex_lock(&ctx->lock);
+		worker->part->done = true;
+		if (worker->scanner->stop) {
+			ctx->stop = true;
+		}
+		pthread_cond_broadcast(&ctx->cond);
+	}
+	pthread_mutex_unlock(&ctx->lock);
+
+	return NULL;
+}
+
+/*! \brief Parses parts of the zone file in parallel, merges them in order. */
+static void parse_parts(zloader_t *loader, zparse_t *ctx,
+                        zworker_t *workers, unsigned threads)
+{
+	zcreator_t *zc = loader->creator;
+
+	unsigned running = 0;
+	for (unsigned i = 0; i < threads; i++) {
+		if (pthread_create(&workers[running].thread, NULL, parse_thread,
+		                   &workers[running]) == 0) {
+			running += 1;
+		}
+	}
+
+	if (running == 0) {
+		/* Parse the parts one by one. */
+		ctx->window = ctx->count;
+		parse_thread(&workers[0]);
+	}
+
+	for (size_t i = 0; i < ctx->count; i++) {
+		zpart_t *part = &ctx->parts[i];
+
+		/* Parts not started after an interruption are skipped. */
+		pthread_mutex_lock(&ctx->lock);
+		while (!part->done && (i < ctx->next || !ctx->stop)) {
+			pthread_cond_wait(&ctx->cond, &ctx->lock);
+		}
+		bool done = part->done;
+		pthread_mutex_unlock(&ctx->lock);
+
+		if (!done) {
+			break;
+		}
+
+		zc->ret = part_merge(zc, part);
+
+		pthread_mutex_lock(&ctx->lock);
+		ctx->merged = i + 1;
+		if (zc->ret != KNOT_EOK) {
+			ctx->stop = true;
+		}
+		pthread_cond_broadcast(&ctx->cond);
+		pthread_mutex_unlock(&ctx->lock);
+
+		if (zc->ret != KNOT_EOK) {
+			break;
+		}
+	}
+
+	for (unsigned i = 0; i < running; i++) {
+		pthread_join(workers[i].thread, NULL);
+	}
+
+	/* Release parts not merged due to an error. */
+	for (size_t i = 0; i < ctx->count; i++) {
+		(void)part_merge(zc, &ctx->parts[i]);
+	}
+
+	for (unsigned i = 0; i < threads; i++) {
+		loader->scanner->error_counter += workers[i].scanner->error_counter;
+	}
+}
+
+/*!
+ * \brief Parses large zone file in parallel.
+ *
+ * \retval true if the file was parsed, \a ret holds the scanner return value.
+ * \retval false if the file should be parsed sequentially.
+ */
+static bool parse_parallel(zloader_t *loader, int *ret)
+{
+	if (loader->threads < 2 || loader->chunk_size == 0) {
+		return false;
+	}
+
+	int fd = open(loader->source, O_RDONLY);
+	if (fd == -1) {
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) ||
+	    st.st_size <= loader->chunk_size) {
+		close(fd);
+		return false;
+	}
+
+	char *data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		return false;
+	}
+
+	zs_chunk_t *chunks = NULL;
+	uint64_t count = 0;
+	if (zs_scanner_split(loader->scanner, data, data + st.st_size,
+	                     loader->chunk_size, &chunks, &count) != 0 ||
+	    count < 2) {
+		free(chunks);
+		munmap(data, st.st_size);
+		return false;
+	}
+
+	unsigned threads = MIN(loader->threads, count);
+	zparse_t ctx = {
+		.zname = loader->creator->z->apex->owner,
+		.data = data,
+		.parts = calloc(count, sizeof(zpart_t)),
+		.count = count,
+		.window = 2 * threads
+	};
+	zworker_t *workers = calloc(threads, sizeof(zworker_t));
+
+	bool parsed = false;
+	unsigned created = 0;
+	if (ctx.parts != NULL && workers != NULL) {
+		for (created = 0; created < threads; created++) {
+			zworker_t *worker = &workers[created];
+			worker->ctx = &ctx;
+			worker->scanner = zs_scanner_create(loader->origin,
+			                                    KNOT_CLASS_IN, 3600,
+			                                    part_process, part_error,
+			                                    worker);
+			if (worker->scanner == NULL) {
+				break;
+			}
+			worker->scanner->file.name = loader->source;
+		}
+	}
+
+	if (created == threads) {
+		for (size_t i = 0; i < count; i++) {
+			ctx.parts[i].chunk = &chunks[i];
+		}
+
+		pthread_mutex_init(&ctx.lock, NULL);
+		pthread_cond_init(&ctx.cond, NULL);
+		parse_parts(loader, &ctx, workers, threads);
+		pthread_cond_destroy(&ctx.cond);
+		pthread_mutex_destroy(&ctx.lock);
+
+		*ret = (loader->scanner->error_counter > 0) ? -1 : 0;
+		parsed = true;
+	}
+
+	for (unsigned i = 0; i < created; i++) {
+		zs_scanner_free(workers[i].scanner);
+	}
+	free(workers);
+	free(ctx.parts);
+	free(chunks);
+	munmap(data, st.st_size);
+
+	return parsed;
 }
 
 int zonefile_open(zloader_t *loader, const char *source,
@@ -206,7 +559,7 @@ int zonefile_open(zloader_t *loader, const char *source,
 	}
 	memset(zc, 0, sizeof(zcreator_t));
 
-	zc->z = zone_contents_new(origin);
+	zc->z = zone_contents_new_arena(origin);
 	if (zc->z == NULL) {
 		free(zc);
 		return KNOT_ENOMEM;
@@ -234,6 +587,8 @@ int zonefile_open(zloader_t *loader, const char *source,
 	loader->origin = origin_str;
 	loader->creator = zc;
 	loader->semantic_checks = semantic_checks;
+	loader->threads = 1;
+	loader->chunk_size = ZONEFILE_CHUNK_SIZE;
 
 	return KNOT_EOK;
 }
@@ -250,7 +605,13 @@ zone_contents_t *zonefile_load(zloader_t *loader)
 	const knot_dname_t *zname = zc->z->apex->owner;
 
 	assert(zc);
-	int ret = zs_scanner_parse_file(loader->scanner, loader->source);
+	int ret = 0;
+	if (!parse_parallel(loader, &ret)) {
+		ret = zs_scanner_parse_file(loader->scanner, loader->source);
+	}
+	if (zc->ret == KNOT_EOK) {
+		zc->ret = zcreator_flush(zc);
+	}
 	if (ret != 0 && loader->scanner->error_counter == 0) {
 		ERROR(zname, "failed to load zone, file '%s' (%s)",
 		      loader->source, zs_strerror(loader->scanner->error_code));
@@ -408,6 +769,9 @@ void zonefile_close(zloader_t *loader)
 
 	free(loader->source);
 	free(loader->origin);
+	if (loader->creator != NULL) {
+		knot_rrset_clear(&loader->creator->pending, NULL);
+	}
 	free(loader->creator);
 }
 
@@ -32,6 +32,10 @@
 #include "knot/zone/zone.h"
 #include "knot/zone/semantic-check.h"
 #include "zscanner/scanner.h"
+
+/*! \brief Size of the zone file parts parsed in parallel. */
+#define ZONEFILE_CHUNK_SIZE (4 * 1024 * 1024)
+
 /*!
  * \brief Zone creator structure.
  */
@@ -40,6 +44,7 @@ typedef struct zcreator {
 	bool master;              /*!< Master flag. True if server is a primary
 	                               master for the zone. */
 	int ret;                  /*!< Return value. */
+	knot_rrset_t pending;     /*!< RRs not yet added to the zone. */
 } zcreator_t;
 
 /*!
@@ -52,6 +57,8 @@ typedef struct zloader {
 	err_handler_t *err_handler;  /*!< Semantic checks error handler. */
 	zs_scanner_t *scanner;       /*!< Zone scanner. */
 	zcreator_t *creator;         /*!< Loader context. */
+	unsigned threads;            /*!< Number of parsing threads (1 by default). */
+	size_t chunk_size;           /*!< Size of the parts parsed in parallel. */
 } zloader_t;
 
 /*!
@@ -71,6 +78,11 @@ int zonefile_open(zloader_t *loader, const char *source,
 /*!
  * \brief Loads zone from a zone file.
  *
+ * Zone files larger than the loader chunk size are split into parts which
+ * are parsed in parallel, the parsed records are added to the zone in
+ * the original order. Zone files with INCLUDE directive are parsed
+ * sequentially.
+ *
  * \param loader Zone loader instance.
  *
  * \retval Loaded zone contents on success.
@@ -94,15 +106,37 @@ int zonefile_write(const char *path, zone_contents_t *zone);
 void zonefile_close(zloader_t *loader);
 
 /*!
- * \brief Adds one RR into zone.
+ * \brief Adds RRs into zone.
  *
  * \param zl  Zone loader.
- * \param rr  RR to add.
+ * \param rr  RRs to add.
  *
  * \return KNOT_E*
  */
 int zcreator_step(zcreator_t *zl, const knot_rrset_t *rr);
 
+/*!
+ * \brief Adds RRs into zone, consecutive RRs of one RRSet are added at once.
+ *
+ * The RRs are kept aside until a RR of another RRSet comes, so that the
+ * RRSet is stored in the zone in one piece.
+ *
+ * \param zl  Zone loader.
+ * \param rr  RRs to add.
+ *
+ * \return KNOT_E*
+ */
+int zcreator_add(zcreator_t *zl, const knot_rrset_t *rr);
+
+/*!
+ * \brief Adds RRs kept aside by zcreator_add() into zone.
+ *
+ * \param zl  Zone loader.
+ *
+ * \return KNOT_E*
+ */
+int zcreator_flush(zcreator_t *zl);
+
 /*!
  * \brief Scanner error processing function.
  * \param scanner  Scanner to use.
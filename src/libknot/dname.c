@@ -464,16 +464,17 @@ int knot_dname_to_lower(knot_dname_t *name)
 	if (name == NULL)
 		return KNOT_EINVAL;
 
-	/*! \todo Faster with \xdfdf mask. */
-	while (*name != '\0') {
-		for (uint8_t i = 0; i < *name; ++i)
-			name[1 + i] = knot_tolower(name[1 + i]);
-		name = (uint8_t *)knot_wire_next_label(name, NULL);
-		if (name == NULL) { /* Must not be used on compressed names. */
+	const uint8_t *label = name;
+	while (*label != '\0') {
+		label = knot_wire_next_label(label, NULL);
+		if (label == NULL) { /* Must not be used on compressed names. */
 			return KNOT_EMALF;
 		}
 	}
 
+	/* Label lengths are never letters, convert the whole name at once. */
+	knot_memtolower(name, name, label - name);
+
 	return KNOT_EOK;
 }
 
@@ -693,16 +694,16 @@ int knot_dname_cmp_wire(const knot_dname_t *d1, const knot_dname_t *d2,
 _public_
 bool knot_dname_is_equal(const knot_dname_t *d1, const knot_dname_t *d2)
 {
-	while(*d1 != '\0' || *d2 != '\0') {
-		if (label_is_equal(d1, d2)) {
-			d1 = knot_wire_next_label(d1, NULL);
-			d2 = knot_wire_next_label(d2, NULL);
-		} else {
-			return false;
+	/* Label lengths of equal names are at the same positions. */
+	size_t pos = 0;
+	while (d1[pos] == d2[pos]) {
+		if (d1[pos] == '\0') {
+			return memcmp(d1, d2, pos) == 0;
 		}
+		pos += d1[pos] + 1;
 	}
 
-	return true;
+	return false;
 }
 
 /*----------------------------------------------------------------------------*/
@@ -803,14 +804,14 @@ int knot_dname_lf(uint8_t *dst, const knot_dname_t *src, const uint8_t *pkt)
 	while(sp != lstack) {          /* consume stack */
 		l = *--sp; /* fetch rightmost label */
 		memcpy(dst, l+1, *l);  /* write label */
-		for (int i = 0; i < *l; ++i) {   /* convert to lowercase */
-			dst[i] = knot_tolower(dst[i]);
-		}
 		dst += *l;
 		*dst++ = '\0';         /* label separator */
 		*len += *l + 1;
 	}
 
+	/* convert to lowercase, separators are left intact */
+	knot_memtolower(len + 1, len + 1, *len);
+
 	/* root label special case */
 	if (*len == 0)
 		*len = 1; /* \x00 */
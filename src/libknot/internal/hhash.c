@@ -136,8 +136,8 @@ static int hhelem_free(hhash_t* tbl, uint32_t id, unsigned dist, value_t *val)
 	/* Invalidate index. */
 	if (tbl->mm.free) {
 		tbl->mm.free(tbl->index);
-		tbl->index = NULL;
 	}
+	tbl->index = NULL;
 
 	/* Update table weight. */
 	--tbl->weight;
@@ -439,9 +439,9 @@ int hhash_find_next(hhash_t* tbl, const char* key, uint16_t len, value_t** dst)
 	}
 
 	int k = BIN_SEARCH_FIRST_GE_CMP(tbl, tbl->weight, CMP_LE, key, len);
-	/* Found prev or equal, we want next */
-	if (k + 1 < tbl->weight) {
-		hhelem_t *found = tbl->item + tbl->index[k + 1];
+	/* First item greater than the key. */
+	if (k < tbl->weight) {
+		hhelem_t *found = tbl->item + tbl->index[k];
 		*dst = (value_t *)KEY_VAL(found->d);
 		return 0;
 	} else {
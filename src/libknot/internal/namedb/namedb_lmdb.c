@@ -255,6 +255,25 @@ static int txn_begin(namedb_t *db, namedb_txn_t *txn, unsigned flags)
 	return KNOT_EOK;
 }
 
+int namedb_lmdb_txn_begin_nested(namedb_txn_t *parent, namedb_txn_t *txn)
+{
+	if (parent == NULL || txn == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	txn->db = parent->db;
+	txn->txn = NULL;
+
+	struct lmdb_env *env = parent->db;
+	int ret = mdb_txn_begin(env->env, (MDB_txn *)parent->txn, 0,
+	                        (MDB_txn **)&txn->txn);
+	if (ret != MDB_SUCCESS) {
+		return lmdb_error_to_knot(ret);
+	}
+
+	return KNOT_EOK;
+}
+
 static int txn_commit(namedb_txn_t *txn)
 {
 	int ret = mdb_txn_commit((MDB_txn *)txn->txn);
@@ -45,3 +45,17 @@ struct namedb_lmdb_opts {
 }
 
 const namedb_api_t *namedb_lmdb_api(void);
+
+/*!
+ * \brief Begin a write transaction nested in another write transaction.
+ *
+ * Commit of the nested transaction makes its changes part of the parent
+ * transaction, abort discards only the changes of the nested transaction.
+ * Use the API functions to commit or abort it.
+ *
+ * \param parent  Running write transaction.
+ * \param txn     Nested transaction.
+ *
+ * \return KNOT_E*
+ */
+int namedb_lmdb_txn_begin_nested(namedb_txn_t *parent, namedb_txn_t *txn);
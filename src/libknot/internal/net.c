@@ -141,6 +141,21 @@ int net_bound_socket(int type, const struct sockaddr_storage *ss,
 		enable_nonlocal(socket, ss->ss_family);
 	}
 
+	/* Allow multiple sockets bound to the same address. */
+	if (flags & NET_BIND_MULTIPLE) {
+#if defined(SO_REUSEPORT)
+		/* Old kernels define the option but refuse it. */
+		if (setsockopt(socket, SOL_SOCKET, SO_REUSEPORT,
+		               &flag, sizeof(flag)) != 0) {
+			close(socket);
+			return KNOT_ENOTSUP;
+		}
+#else
+		close(socket);
+		return KNOT_ENOTSUP;
+#endif
+	}
+
 	/* Bind to specified address. */
 	const struct sockaddr *sa = (const struct sockaddr *)ss;
 	int ret = bind(socket, sa, sockaddr_len(sa));
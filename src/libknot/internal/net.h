@@ -35,7 +35,8 @@
  * \brief Network interface flags.
  */
 enum net_flags {
-	NET_BIND_NONLOCAL = (1 << 0)
+	NET_BIND_NONLOCAL = (1 << 0),
+	NET_BIND_MULTIPLE = (1 << 1)
 };
 
 /*!
@@ -53,8 +54,11 @@ int net_unbound_socket(int type, const struct sockaddr_storage *ss);
  *
  * \param type   Socket transport type (SOCK_STREAM, SOCK_DGRAM).
  * \param ss     Socket address storage.
- * \param flags  Allow binding to non-local address with NET_BIND_NONLOCAL.
+ * \param flags  Allow binding to non-local address with NET_BIND_NONLOCAL,
+ *               allow multiple sockets bound to the same address with
+ *               NET_BIND_MULTIPLE (SO_REUSEPORT).
  *
+ * \retval KNOT_ENOTSUP if NET_BIND_MULTIPLE is not supported by the system.
  * \return socket or error code
  */
 int net_bound_socket(int type, const struct sockaddr_storage *ss,
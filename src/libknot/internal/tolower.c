@@ -14,9 +14,17 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <string.h>
+
 #include "libknot/internal/macros.h"
 #include "libknot/internal/tolower.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 const uint8_t knot_char_table[KNOT_CHAR_TABLE_SIZE] = {
 	'\x00',
 	'\x01',
@@ -275,3 +283,125 @@ const uint8_t knot_char_table[KNOT_CHAR_TABLE_SIZE] = {
 	'\xFE',
 	'\xFF',
 };
+
+/*
+ * Vector of characters converted at once. Only ASCII letters are converted,
+ * so the DNS label length octets (at most 63) are never changed.
+ */
+
+#if defined(__SSE2__)
+
+typedef __m128i chars_t;
+
+static inline chars_t chars_load(const uint8_t *src)
+{
+	return _mm_loadu_si128((const __m128i *)src);
+}
+
+static inline void chars_store(uint8_t *dst, chars_t v)
+{
+	_mm_storeu_si128((__m128i *)dst, v);
+}
+
+static inline chars_t chars_tolower(chars_t v)
+{
+	/* Signed comparison, octets above 0x7F are negative. */
+	chars_t upper = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('A' - 1)),
+	                              _mm_cmplt_epi8(v, _mm_set1_epi8('Z' + 1)));
+	return _mm_or_si128(v, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+}
+
+static inline bool chars_equal(chars_t a, chars_t b)
+{
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) == 0xFFFF;
+}
+
+#elif defined(__ARM_NEON)
+
+typedef uint8x16_t chars_t;
+
+static inline chars_t chars_load(const uint8_t *src)
+{
+	return vld1q_u8(src);
+}
+
+static inline void chars_store(uint8_t *dst, chars_t v)
+{
+	vst1q_u8(dst, v);
+}
+
+static inline chars_t chars_tolower(chars_t v)
+{
+	chars_t upper = vcleq_u8(vsubq_u8(v, vdupq_n_u8('A')), vdupq_n_u8('Z' - 'A'));
+	return vorrq_u8(v, vandq_u8(upper, vdupq_n_u8(0x20)));
+}
+
+static inline bool chars_equal(chars_t a, chars_t b)
+{
+	uint64x2_t eq = vreinterpretq_u64_u8(vceqq_u8(a, b));
+	return (vgetq_lane_u64(eq, 0) & vgetq_lane_u64(eq, 1)) == UINT64_MAX;
+}
+
+#else
+
+typedef uint64_t chars_t;
+
+#define CHARS_ONES 0x0101010101010101ULL
+
+static inline chars_t chars_load(const uint8_t *src)
+{
+	chars_t v;
+	memcpy(&v, src, sizeof(v));
+	return v;
+}
+
+static inline void chars_store(uint8_t *dst, chars_t v)
+{
+	memcpy(dst, &v, sizeof(v));
+}
+
+static inline chars_t chars_tolower(chars_t v)
+{
+	/* The top bit of each octet is set for 7-bit values 'A' to 'Z'. */
+	chars_t low = v & (0x7F * CHARS_ONES);
+	chars_t from_a = low + (0x80 - 'A') * CHARS_ONES;
+	chars_t past_z = low + (0x80 - 'Z' - 1) * CHARS_ONES;
+	chars_t upper = from_a & ~past_z & ~v & (0x80 * CHARS_ONES);
+	return v | (upper >> 2);
+}
+
+static inline bool chars_equal(chars_t a, chars_t b)
+{
+	return a == b;
+}
+
+#endif
+
+void knot_memtolower(uint8_t *dst, const uint8_t *src, size_t size)
+{
+	size_t i = 0;
+	for (; i + sizeof(chars_t) <= size; i += sizeof(chars_t)) {
+		chars_store(dst + i, chars_tolower(chars_load(src + i)));
+	}
+	for (; i < size; ++i) {
+		dst[i] = knot_tolower(src[i]);
+	}
+}
+
+bool knot_memcaseeq(const uint8_t *a, const uint8_t *b, size_t size)
+{
+	size_t i = 0;
+	for (; i + sizeof(chars_t) <= size; i += sizeof(chars_t)) {
+		if (!chars_equal(chars_tolower(chars_load(a + i)),
+		                 chars_tolower(chars_load(b + i)))) {
+			return false;
+		}
+	}
+	for (; i < size; ++i) {
+		if (knot_tolower(a[i]) != knot_tolower(b[i])) {
+			return false;
+		}
+	}
+
+	return true;
+}
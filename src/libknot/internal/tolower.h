@@ -26,6 +26,7 @@
 
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
 
@@ -67,4 +68,26 @@ static inline uint8_t *knot_strtolower(const uint8_t *data, size_t size)
 	return result;
 }
 
+/*!
+ * \brief Convert binary data to lowercase into a given buffer.
+ *
+ * Processes multiple characters at once (SSE2, NEON, or 64-bit words).
+ *
+ * \param dst   Output buffer (may be the same as \a src).
+ * \param src   Binary input string.
+ * \param size  Size of the input string.
+ */
+void knot_memtolower(uint8_t *dst, const uint8_t *src, size_t size);
+
+/*!
+ * \brief Compare binary data case-insensitively.
+ *
+ * \param a     First binary string.
+ * \param b     Second binary string.
+ * \param size  Size of the strings.
+ *
+ * \return True if the strings are equal after conversion to lowercase.
+ */
+bool knot_memcaseeq(const uint8_t *a, const uint8_t *b, size_t size);
+
 /*! @} */
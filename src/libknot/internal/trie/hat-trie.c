@@ -390,7 +390,8 @@ static void node_build_index(node_ptr node)
             if (node.t->xs[i].t) node_build_index(node.t->xs[i]);
         }
     }
-    else {
+    else if (node.b->index == NULL) {
+        /* insertions and deletions drop the index of the table */
         hhash_build_index(node.b);
     }
 }
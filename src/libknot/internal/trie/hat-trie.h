@@ -51,10 +51,16 @@ hattrie_t* hattrie_create_n (unsigned, const mm_ctx_t *);
 hattrie_t* hattrie_dup (const hattrie_t*, value_t (*nval)(value_t));
 
 /** Build order index on all ahtable nodes in trie.
+ *  Only the tables changed since the last build are indexed again.
  */
 void hattrie_build_index (hattrie_t*);
 
 int hattrie_apply_rev (hattrie_t*, int (*f)(value_t*,void*), void* d);
+
+/** Apply the function to all ahtable nodes (hhash_t) in trie.
+ *  The qp-trie has no ahtables and doesn't call the function, its nodes and
+ *  keys are allocated from the trie memory context instead.
+ */
 int hattrie_apply_rev_ahtable(hattrie_t* T, int (*f)(void*,void*), void* d);
 
 /** Find the given key in the trie, inserting it if it does not exist, and
@@ -0,0 +1,785 @@
+/*  Copyright (C) 2015 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Implementation of the hat-trie interface as a qp-trie.
+ *
+ * The qp-trie is a radix tree branching on 4-bit nibbles of the key, where
+ * each branch stores only the present twigs in a dense array indexed by the
+ * popcount of the branch bitmap. See Tony Finch's description at
+ * https://dotat.at/prog/qp/ for details.
+ *
+ * Both branches and leaves take two words. Unlike the hat-trie, keys are kept
+ * in order in all nodes, so that predecessor and successor searches are
+ * simple tree walks, and the trie can be copied without rehashing anything.
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "libknot/internal/macros.h"
+#include "libknot/internal/trie/hat-trie.h"
+
+/*! \brief Stored key, NUL-terminated for the convenience of the callers. */
+typedef struct {
+	uint32_t len;
+	char chars[];
+} tkey_t;
+
+/*!
+ * \brief Trie node, either a branch or a leaf.
+ *
+ * The branch flags contain (from the least significant bit):
+ * - 1 bit  branch flag (always zero in the leaf key pointer)
+ * - 17 bit bitmap of present twigs (end of key, nibble values 0 to 15)
+ * - rest   index of the nibble the branch is deciding on
+ */
+typedef union node node_t;
+union node {
+	struct {
+		uintptr_t flags;
+		node_t *twigs;
+	} branch;
+	struct {
+		tkey_t *key;
+		value_t val;
+	} leaf;
+};
+
+#define BRANCH_FLAG	((uintptr_t)1)
+#define BITMAP_SHIFT	1
+#define BITMAP_BITS	17
+#define BITMAP_MASK	((1U << BITMAP_BITS) - 1)
+#define INDEX_SHIFT	(BITMAP_SHIFT + BITMAP_BITS)
+#define KEY_MAXLEN	MIN(UINT32_MAX - 1, (UINTPTR_MAX >> INDEX_SHIFT) / 2)
+
+struct hattrie_t_ {
+	node_t root;      /*!< Root node, valid only if not empty. */
+	size_t weight;    /*!< Number of keys. */
+	mm_ctx_t mm;
+};
+
+/*! \brief Stack of nodes on the path from the root. */
+typedef struct {
+	node_t **nodes;
+	size_t len;
+	size_t size;
+	node_t *init[128];
+} nstack_t;
+
+static inline bool is_branch(const node_t *node)
+{
+	return node->branch.flags & BRANCH_FLAG;
+}
+
+static inline uint32_t branch_bitmap(const node_t *node)
+{
+	return (node->branch.flags >> BITMAP_SHIFT) & BITMAP_MASK;
+}
+
+static inline size_t branch_index(const node_t *node)
+{
+	return node->branch.flags >> INDEX_SHIFT;
+}
+
+static inline unsigned twig_count(const node_t *node)
+{
+	return __builtin_popcount(branch_bitmap(node));
+}
+
+/*! \brief Position of the twig for the given bit among the present twigs. */
+static inline unsigned twig_pos(const node_t *node, uint32_t bit)
+{
+	return __builtin_popcount(branch_bitmap(node) & (bit - 1));
+}
+
+/*! \brief Bitmap bit of the key nibble at the given index. */
+static inline uint32_t nibble_bit(const char *key, size_t len, size_t index)
+{
+	size_t i = index / 2;
+	if (i >= len) {
+		return 1; /* End of key sorts first. */
+	}
+
+	uint8_t c = key[i];
+	uint8_t nibble = (index % 2 == 0) ? (c >> 4) : (c & 0x0f);
+	return 1U << (nibble + 1);
+}
+
+/*! \brief Get twig for the given key, NULL if not present. */
+static inline node_t *twig_get(node_t *node, const char *key, size_t len)
+{
+	uint32_t bit = nibble_bit(key, len, branch_index(node));
+	if (!(branch_bitmap(node) & bit)) {
+		return NULL;
+	}
+
+	return &node->branch.twigs[twig_pos(node, bit)];
+}
+
+static tkey_t *key_new(hattrie_t *T, const char *key, size_t len)
+{
+	tkey_t *tkey = mm_alloc(&T->mm, sizeof(tkey_t) + len + 1);
+	if (tkey == NULL) {
+		return NULL;
+	}
+
+	tkey->len = len;
+	memcpy(tkey->chars, key, len);
+	tkey->chars[len] = '\0';
+
+	return tkey;
+}
+
+static inline bool key_equal(const tkey_t *tkey, const char *key, size_t len)
+{
+	return tkey->len == len && memcmp(tkey->chars, key, len) == 0;
+}
+
+/*! \brief Index of the first differing nibble, SIZE_MAX if the keys match. */
+static size_t key_diff(const tkey_t *tkey, const char *key, size_t len)
+{
+	size_t common = MIN(tkey->len, len);
+	for (size_t i = 0; i < common; ++i) {
+		uint8_t x = tkey->chars[i] ^ key[i];
+		if (x != 0) {
+			return 2 * i + ((x & 0xf0) ? 0 : 1);
+		}
+	}
+
+	return (tkey->len == len) ? SIZE_MAX : 2 * common;
+}
+
+/*!
+ * \brief Find a leaf sharing the longest prefix with the key.
+ *
+ * Where the key nibble is missing in a branch, any twig would do, as all
+ * leaves below the branch share the same prefix.
+ */
+static node_t *find_similar(node_t *node, const char *key, size_t len)
+{
+	while (is_branch(node)) {
+		node_t *twig = twig_get(node, key, len);
+		node = (twig != NULL) ? twig : node->branch.twigs;
+	}
+
+	return node;
+}
+
+static node_t *leftmost(node_t *node)
+{
+	while (is_branch(node)) {
+		node = node->branch.twigs;
+	}
+
+	return node;
+}
+
+static node_t *rightmost(node_t *node)
+{
+	while (is_branch(node)) {
+		node = &node->branch.twigs[twig_count(node) - 1];
+	}
+
+	return node;
+}
+
+static void ns_init(nstack_t *ns)
+{
+	ns->nodes = ns->init;
+	ns->len = 0;
+	ns->size = sizeof(ns->init) / sizeof(ns->init[0]);
+}
+
+static void ns_cleanup(nstack_t *ns)
+{
+	if (ns->nodes != ns->init) {
+		free(ns->nodes);
+	}
+}
+
+static bool ns_push(nstack_t *ns, node_t *node)
+{
+	if (ns->len == ns->size) {
+		node_t **nodes = malloc(2 * ns->size * sizeof(node_t *));
+		if (nodes == NULL) {
+			return false;
+		}
+		memcpy(nodes, ns->nodes, ns->len * sizeof(node_t *));
+		ns_cleanup(ns);
+		ns->nodes = nodes;
+		ns->size *= 2;
+	}
+
+	ns->nodes[ns->len++] = node;
+	return true;
+}
+
+/*! \brief Push nodes on the path to the leftmost leaf below the stack top. */
+static bool ns_leftmost(nstack_t *ns)
+{
+	node_t *node = ns->nodes[ns->len - 1];
+	while (is_branch(node)) {
+		node = node->branch.twigs;
+		if (!ns_push(ns, node)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*! \brief Rightmost leaf left of the stack top subtree, NULL if none. */
+static node_t *ns_prev(nstack_t *ns)
+{
+	while (ns->len > 1) {
+		node_t *node = ns->nodes[--ns->len];
+		node_t *parent = ns->nodes[ns->len - 1];
+		if (node != parent->branch.twigs) {
+			return rightmost(node - 1);
+		}
+	}
+
+	return NULL;
+}
+
+/*! \brief Leftmost leaf right of the stack top subtree, NULL if none. */
+static node_t *ns_next(nstack_t *ns)
+{
+	while (ns->len > 1) {
+		node_t *node = ns->nodes[--ns->len];
+		node_t *parent = ns->nodes[ns->len - 1];
+		if (node != &parent->branch.twigs[twig_count(parent) - 1]) {
+			return leftmost(node + 1);
+		}
+	}
+
+	return NULL;
+}
+
+/*!
+ * \brief Push the path to the node where the key diverges from the trie.
+ *
+ * The top of the stack is then the first node, all keys of which differ from
+ * the key at the nibble \a diff or sooner.
+ */
+static bool ns_find_diff(nstack_t *ns, hattrie_t *T, const char *key,
+                         size_t len, size_t diff)
+{
+	node_t *node = &T->root;
+	if (!ns_push(ns, node)) {
+		return false;
+	}
+
+	while (is_branch(node) && branch_index(node) < diff) {
+		node = twig_get(node, key, len);
+		assert(node);
+		if (!ns_push(ns, node)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void node_free(hattrie_t *T, node_t *node)
+{
+	if (is_branch(node)) {
+		unsigned count = twig_count(node);
+		for (unsigned i = 0; i < count; ++i) {
+			node_free(T, &node->branch.twigs[i]);
+		}
+		mm_free(&T->mm, node->branch.twigs);
+	} else {
+		mm_free(&T->mm, node->leaf.key);
+	}
+}
+
+hattrie_t* hattrie_create(void)
+{
+	mm_ctx_t mm;
+	mm_ctx_init(&mm);
+	return hattrie_create_n(TRIE_BUCKET_SIZE, &mm);
+}
+
+hattrie_t* hattrie_create_n(unsigned bucket_size, const mm_ctx_t *mm)
+{
+	UNUSED(bucket_size);
+
+	hattrie_t *T = mm_alloc((mm_ctx_t *)mm, sizeof(hattrie_t));
+	if (T == NULL) {
+		return NULL;
+	}
+
+	memset(T, 0, sizeof(hattrie_t));
+	memcpy(&T->mm, mm, sizeof(mm_ctx_t));
+
+	return T;
+}
+
+void hattrie_free(hattrie_t* T)
+{
+	if (T == NULL) {
+		return;
+	}
+
+	hattrie_clear(T);
+	if (T->mm.free) {
+		T->mm.free(T);
+	}
+}
+
+void hattrie_clear(hattrie_t* T)
+{
+	if (T == NULL) {
+		return;
+	}
+
+	if (T->weight > 0) {
+		node_free(T, &T->root);
+	}
+	memset(&T->root, 0, sizeof(node_t));
+	T->weight = 0;
+}
+
+size_t hattrie_weight(const hattrie_t* T)
+{
+	if (T == NULL) {
+		return 0;
+	}
+
+	return T->weight;
+}
+
+/*! \brief Copy the subtree, keeping zeroed nodes on failure. */
+static int node_dup(hattrie_t *N, node_t *dst, const node_t *src,
+                    value_t (*nval)(value_t))
+{
+	if (!is_branch(src)) {
+		dst->leaf.key = key_new(N, src->leaf.key->chars, src->leaf.key->len);
+		if (dst->leaf.key == NULL) {
+			return KNOT_ENOMEM;
+		}
+		dst->leaf.val = nval(src->leaf.val);
+		return KNOT_EOK;
+	}
+
+	unsigned count = twig_count(src);
+	node_t *twigs = mm_alloc(&N->mm, count * sizeof(node_t));
+	if (twigs == NULL) {
+		return KNOT_ENOMEM;
+	}
+	memset(twigs, 0, count * sizeof(node_t));
+
+	dst->branch.flags = src->branch.flags;
+	dst->branch.twigs = twigs;
+
+	for (unsigned i = 0; i < count; ++i) {
+		int ret = node_dup(N, &twigs[i], &src->branch.twigs[i], nval);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
+	return KNOT_EOK;
+}
+
+hattrie_t* hattrie_dup(const hattrie_t* T, value_t (*nval)(value_t))
+{
+	hattrie_t *N = hattrie_create_n(0, &T->mm);
+	if (N == NULL || nval == NULL || T->weight == 0) {
+		return N;
+	}
+
+	N->weight = T->weight;
+	if (node_dup(N, &N->root, &T->root, nval) != KNOT_EOK) {
+		hattrie_free(N);
+		return NULL;
+	}
+
+	return N;
+}
+
+void hattrie_build_index(hattrie_t* T)
+{
+	/* Keys are always ordered. */
+	UNUSED(T);
+}
+
+static int node_apply_rev(node_t *node, int (*f)(value_t*,void*), void* d)
+{
+	if (!is_branch(node)) {
+		return f(&node->leaf.val, d);
+	}
+
+	for (int i = twig_count(node) - 1; i >= 0; --i) {
+		int ret = node_apply_rev(&node->branch.twigs[i], f, d);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+
+	return KNOT_EOK;
+}
+
+int hattrie_apply_rev(hattrie_t* T, int (*f)(value_t*,void*), void* d)
+{
+	if (T->weight == 0) {
+		return KNOT_EOK;
+	}
+
+	return node_apply_rev(&T->root, f, d);
+}
+
+int hattrie_apply_rev_ahtable(hattrie_t* T, int (*f)(void*,void*), void* d)
+{
+	/* There are no hash tables in the qp-trie, all the memory is allocated
+	 * from the trie memory context. */
+	UNUSED(T);
+	UNUSED(f);
+	UNUSED(d);
+	return TRIE_EOK;
+}
+
+value_t* hattrie_tryget(hattrie_t* T, const char* key, size_t len)
+{
+	if (T->weight == 0) {
+		return NULL;
+	}
+
+	node_t *node = &T->root;
+	while (is_branch(node)) {
+		node = twig_get(node, key, len);
+		if (node == NULL) {
+			return NULL;
+		}
+	}
+
+	return key_equal(node->leaf.key, key, len) ? &node->leaf.val : NULL;
+}
+
+value_t* hattrie_get(hattrie_t* T, const char* key, size_t len)
+{
+	if (len > KEY_MAXLEN) {
+		return NULL;
+	}
+
+	if (T->weight == 0) {
+		T->root.leaf.key = key_new(T, key, len);
+		if (T->root.leaf.key == NULL) {
+			return NULL;
+		}
+		T->root.leaf.val = NULL;
+		T->weight = 1;
+		return &T->root.leaf.val;
+	}
+
+	node_t *similar = find_similar(&T->root, key, len);
+	size_t diff = key_diff(similar->leaf.key, key, len);
+	if (diff == SIZE_MAX) {
+		return &similar->leaf.val;
+	}
+
+	uint32_t new_bit = nibble_bit(key, len, diff);
+	uint32_t old_bit = nibble_bit(similar->leaf.key->chars,
+	                              similar->leaf.key->len, diff);
+
+	/* Find the node to be split or extended. */
+	node_t *node = &T->root;
+	while (is_branch(node) && branch_index(node) < diff) {
+		node = twig_get(node, key, len);
+	}
+
+	node_t leaf = { .leaf = { key_new(T, key, len), NULL } };
+	if (leaf.leaf.key == NULL) {
+		return NULL;
+	}
+
+	node_t *twigs = NULL;
+	unsigned pos = 0;
+
+	if (is_branch(node) && branch_index(node) == diff) {
+		/* Add a twig to the existing branch. */
+		unsigned count = twig_count(node);
+		twigs = mm_alloc(&T->mm, (count + 1) * sizeof(node_t));
+		if (twigs == NULL) {
+			mm_free(&T->mm, leaf.leaf.key);
+			return NULL;
+		}
+		pos = twig_pos(node, new_bit);
+		memcpy(twigs, node->branch.twigs, pos * sizeof(node_t));
+		memcpy(twigs + pos + 1, node->branch.twigs + pos,
+		       (count - pos) * sizeof(node_t));
+		mm_free(&T->mm, node->branch.twigs);
+		node->branch.flags |= (uintptr_t)new_bit << BITMAP_SHIFT;
+	} else {
+		/* Split the node with a new branch. */
+		twigs = mm_alloc(&T->mm, 2 * sizeof(node_t));
+		if (twigs == NULL) {
+			mm_free(&T->mm, leaf.leaf.key);
+			return NULL;
+		}
+		pos = (new_bit < old_bit) ? 0 : 1;
+		twigs[1 - pos] = *node;
+		node->branch.flags = BRANCH_FLAG |
+		                     (uintptr_t)(new_bit | old_bit) << BITMAP_SHIFT |
+		                     (uintptr_t)diff << INDEX_SHIFT;
+	}
+
+	twigs[pos] = leaf;
+	node->branch.twigs = twigs;
+	T->weight += 1;
+
+	return &twigs[pos].leaf.val;
+}
+
+int hattrie_del(hattrie_t* T, const char* key, size_t len)
+{
+	if (T->weight == 0) {
+		return -1;
+	}
+
+	node_t *parent = NULL;
+	node_t *node = &T->root;
+	while (is_branch(node)) {
+		parent = node;
+		node = twig_get(node, key, len);
+		if (node == NULL) {
+			return -1;
+		}
+	}
+
+	if (!key_equal(node->leaf.key, key, len)) {
+		return -1;
+	}
+
+	mm_free(&T->mm, node->leaf.key);
+	T->weight -= 1;
+
+	if (parent == NULL) {
+		memset(&T->root, 0, sizeof(node_t));
+		return 0;
+	}
+
+	node_t *twigs = parent->branch.twigs;
+	unsigned count = twig_count(parent);
+	unsigned pos = node - twigs;
+
+	if (count == 2) {
+		/* Replace the branch with the remaining twig. */
+		*parent = twigs[1 - pos];
+		mm_free(&T->mm, twigs);
+		return 0;
+	}
+
+	uint32_t bit = nibble_bit(key, len, branch_index(parent));
+	parent->branch.flags &= ~((uintptr_t)bit << BITMAP_SHIFT);
+
+	/* Shrink the twigs, or just close the gap if out of memory. */
+	node_t *shrunk = mm_alloc(&T->mm, (count - 1) * sizeof(node_t));
+	if (shrunk != NULL) {
+		memcpy(shrunk, twigs, pos * sizeof(node_t));
+		memcpy(shrunk + pos, twigs + pos + 1,
+		       (count - pos - 1) * sizeof(node_t));
+		mm_free(&T->mm, twigs);
+		parent->branch.twigs = shrunk;
+	} else {
+		memmove(twigs + pos, twigs + pos + 1,
+		        (count - pos - 1) * sizeof(node_t));
+	}
+
+	return 0;
+}
+
+int hattrie_find_leq(hattrie_t* T, const char* key, size_t len, value_t** dst)
+{
+	*dst = NULL;
+	if (T->weight == 0) {
+		return 1;
+	}
+
+	node_t *similar = find_similar(&T->root, key, len);
+	size_t diff = key_diff(similar->leaf.key, key, len);
+	if (diff == SIZE_MAX) {
+		*dst = &similar->leaf.val;
+		return 0; /* Exact match. */
+	}
+
+	nstack_t ns;
+	ns_init(&ns);
+	if (!ns_find_diff(&ns, T, key, len, diff)) {
+		ns_cleanup(&ns);
+		return 1;
+	}
+
+	node_t *node = ns.nodes[ns.len - 1];
+	uint32_t new_bit = nibble_bit(key, len, diff);
+	node_t *found = NULL;
+
+	if (is_branch(node) && branch_index(node) == diff) {
+		/* Twigs before the missing key nibble are lesser. */
+		unsigned pos = twig_pos(node, new_bit);
+		found = (pos > 0) ? rightmost(&node->branch.twigs[pos - 1])
+		                  : ns_prev(&ns);
+	} else {
+		/* The whole subtree is either lesser or greater. */
+		uint32_t old_bit = nibble_bit(similar->leaf.key->chars,
+		                              similar->leaf.key->len, diff);
+		found = (old_bit < new_bit) ? rightmost(node) : ns_prev(&ns);
+	}
+
+	ns_cleanup(&ns);
+
+	if (found == NULL) {
+		return 1; /* No predecessor. */
+	}
+
+	*dst = &found->leaf.val;
+	return -1; /* Predecessor. */
+}
+
+int hattrie_find_next(hattrie_t* T, const char* key, size_t len, value_t **dst)
+{
+	*dst = NULL;
+	if (T->weight == 0) {
+		return 1;
+	}
+
+	node_t *similar = find_similar(&T->root, key, len);
+	size_t diff = key_diff(similar->leaf.key, key, len);
+
+	nstack_t ns;
+	ns_init(&ns);
+	if (!ns_find_diff(&ns, T, key, len, diff)) {
+		ns_cleanup(&ns);
+		return 1;
+	}
+
+	node_t *node = ns.nodes[ns.len - 1];
+	node_t *found = NULL;
+
+	if (diff == SIZE_MAX) {
+		/* Exact match, the path leads to the leaf itself. */
+		found = ns_next(&ns);
+	} else if (is_branch(node) && branch_index(node) == diff) {
+		/* Twigs after the missing key nibble are greater. */
+		uint32_t new_bit = nibble_bit(key, len, diff);
+		unsigned pos = twig_pos(node, new_bit);
+		found = (pos < twig_count(node)) ? leftmost(&node->branch.twigs[pos])
+		                                 : ns_next(&ns);
+	} else {
+		/* The whole subtree is either lesser or greater. */
+		uint32_t new_bit = nibble_bit(key, len, diff);
+		uint32_t old_bit = nibble_bit(similar->leaf.key->chars,
+		                              similar->leaf.key->len, diff);
+		found = (old_bit > new_bit) ? leftmost(node) : ns_next(&ns);
+	}
+
+	ns_cleanup(&ns);
+
+	if (found == NULL) {
+		return 1; /* No next key. */
+	}
+
+	*dst = &found->leaf.val;
+	return 0;
+}
+
+struct hattrie_iter_t_ {
+	nstack_t ns;   /*!< Path to the current leaf, empty when finished. */
+};
+
+hattrie_iter_t* hattrie_iter_begin(const hattrie_t* T, bool sorted)
+{
+	/* The iteration is always sorted. */
+	UNUSED(sorted);
+
+	if (T == NULL) {
+		return NULL;
+	}
+
+	hattrie_iter_t *it = malloc(sizeof(hattrie_iter_t));
+	if (it == NULL) {
+		return NULL;
+	}
+
+	ns_init(&it->ns);
+
+	if (T->weight > 0) {
+		node_t *root = (node_t *)&T->root;
+		if (!ns_push(&it->ns, root) || !ns_leftmost(&it->ns)) {
+			it->ns.len = 0;
+		}
+	}
+
+	return it;
+}
+
+void hattrie_iter_next(hattrie_iter_t* it)
+{
+	nstack_t *ns = &it->ns;
+	while (ns->len > 1) {
+		node_t *node = ns->nodes[--ns->len];
+		node_t *parent = ns->nodes[ns->len - 1];
+		if (node != &parent->branch.twigs[twig_count(parent) - 1]) {
+			if (!ns_push(ns, node + 1) || !ns_leftmost(ns)) {
+				break;
+			}
+			return;
+		}
+	}
+
+	ns->len = 0;
+}
+
+bool hattrie_iter_finished(hattrie_iter_t* it)
+{
+	return it->ns.len == 0;
+}
+
+void hattrie_iter_free(hattrie_iter_t* it)
+{
+	if (it == NULL) {
+		return;
+	}
+
+	ns_cleanup(&it->ns);
+	free(it);
+}
+
+const char* hattrie_iter_key(hattrie_iter_t* it, size_t* len)
+{
+	if (hattrie_iter_finished(it)) {
+		return NULL;
+	}
+
+	const tkey_t *key = it->ns.nodes[it->ns.len - 1]->leaf.key;
+	if (len) {
+		*len = key->len;
+	}
+
+	return key->chars;
+}
+
+value_t* hattrie_iter_val(hattrie_iter_t* it)
+{
+	if (hattrie_iter_finished(it)) {
+		return NULL;
+	}
+
+	return &it->ns.nodes[it->ns.len - 1]->leaf.val;
+}
@@ -32,16 +32,207 @@ static bool compr_label_match(const uint8_t *n, const uint8_t *p)
 		return false;
 	}
 
-	uint8_t len = *n;
-	for (uint8_t i = 0; i < len; ++i) {
-		if (knot_tolower(n[1 + i]) != knot_tolower(p[1 + i])) {
+	return knot_memcaseeq(n + 1, p + 1, *n);
+}
+
+/*- Compression table -------------------------------------------------------*/
+
+/*! \brief Maximal number of labels in a name. */
+#define COMPR_LABELS_MAX (KNOT_DNAME_MAXLEN / 2)
+
+/*! \brief Number of slots searched for a suffix. */
+#define COMPR_PROBE_LEN 8
+
+/*! \brief Maximal number of stored suffixes. */
+#define COMPR_TABLE_FILL (KNOT_COMPR_TABLE_SIZE / 4 * 3)
+
+/*! \brief Hash of a label followed by a suffix with given hash (FNV-1a). */
+static uint32_t compr_label_hash(const uint8_t *label, uint32_t suffix_hash)
+{
+	uint32_t h = suffix_hash ^ 2166136261u;
+	for (uint8_t i = 0; i <= *label; ++i) {
+		h = (h ^ knot_tolower(label[i])) * 16777619u;
+	}
+
+	return h;
+}
+
+/*! \brief Get label positions and suffix hashes of an uncompressed name. */
+static int compr_suffixes(const knot_dname_t *dname,
+                          const uint8_t *labels[COMPR_LABELS_MAX],
+                          uint32_t hashes[COMPR_LABELS_MAX])
+{
+	int count = 0;
+	while (*dname != '\0') {
+		if (count == COMPR_LABELS_MAX) {
+			return KNOT_EMALF;
+		}
+		labels[count++] = dname;
+		dname = knot_wire_next_label(dname, NULL);
+	}
+
+	uint32_t h = 0;
+	for (int i = count - 1; i >= 0; --i) {
+		h = compr_label_hash(labels[i], h);
+		hashes[i] = h;
+	}
+
+	return count;
+}
+
+/*! \brief Check if the name equals the suffix written in the packet. */
+static bool compr_suffix_match(const knot_dname_t *dname, const uint8_t *wire,
+                               uint16_t pos)
+{
+	const uint8_t *suffix = knot_wire_seek_label(wire + pos, wire);
+	while (*dname != '\0') {
+		if (!compr_label_match(dname, suffix)) {
 			return false;
 		}
+		dname = knot_wire_next_label(dname, NULL);
+		suffix = knot_wire_next_label(suffix, wire);
+	}
+
+	return *suffix == '\0';
+}
+
+/*! \brief Find position of the name suffix in the packet, 0 if not found. */
+static uint16_t compr_table_find(const knot_compr_table_t *table, const uint8_t *wire,
+                                 const knot_dname_t *suffix, uint32_t hash)
+{
+	uint16_t tag = hash >> 16;
+	for (unsigned i = 0; i < COMPR_PROBE_LEN; ++i) {
+		const knot_compr_slot_t *slot =
+			&table->slots[(hash + i) % KNOT_COMPR_TABLE_SIZE];
+		if (slot->gen == table->gen && slot->tag == tag &&
+		    compr_suffix_match(suffix, wire, slot->pos)) {
+			return slot->pos;
+		}
+	}
+
+	return 0;
+}
+
+/*! \brief Store position of the name suffix. */
+static void compr_table_insert(knot_compr_table_t *table, uint16_t pos,
+                               uint32_t hash)
+{
+	if (table->count >= COMPR_TABLE_FILL || pos >= KNOT_WIRE_PTR_MAX) {
+		return;
+	}
+
+	for (unsigned i = 0; i < COMPR_PROBE_LEN; ++i) {
+		knot_compr_slot_t *slot =
+			&table->slots[(hash + i) % KNOT_COMPR_TABLE_SIZE];
+		if (slot->gen != table->gen) {
+			slot->pos = pos;
+			slot->tag = hash >> 16;
+			slot->gen = table->gen;
+			table->count += 1;
+			return;
+		}
+	}
+}
+
+_public_
+void knot_compr_table_clear(knot_compr_table_t *table)
+{
+	if (table == NULL) {
+		return;
+	}
+
+	/* Slots are emptied by changing the generation. */
+	table->gen += 1;
+	if (table->gen == 0) {
+		memset(table->slots, 0, sizeof(table->slots));
+		table->gen = 1;
+	}
+	table->count = 0;
+}
+
+_public_
+void knot_compr_table_add(knot_compr_table_t *table, const uint8_t *wire,
+                          uint16_t pos)
+{
+	if (table == NULL || wire == NULL) {
+		return;
+	}
+
+	const uint8_t *labels[COMPR_LABELS_MAX];
+	uint32_t hashes[COMPR_LABELS_MAX];
+	int count = compr_suffixes(wire + pos, labels, hashes);
+	for (int i = 0; i < count; ++i) {
+		uint16_t label_pos = labels[i] - wire;
+		if (compr_table_find(table, wire, labels[i], hashes[i]) == 0) {
+			compr_table_insert(table, label_pos, hashes[i]);
+		}
+	}
+}
+
+_public_
+void knot_compr_table_trim(knot_compr_table_t *table, uint16_t size)
+{
+	if (table == NULL) {
+		return;
+	}
+
+	for (unsigned i = 0; i < KNOT_COMPR_TABLE_SIZE; ++i) {
+		knot_compr_slot_t *slot = &table->slots[i];
+		if (slot->gen == table->gen && slot->pos >= size) {
+			slot->gen = table->gen - 1;
+			table->count -= 1;
+		}
+	}
+}
+
+/*! \brief Write name compressed against the longest suffix in the table. */
+static int compr_put_table(const knot_dname_t *dname, uint8_t *dst, uint16_t max,
+                           knot_compr_t *compr)
+{
+	const uint8_t *labels[COMPR_LABELS_MAX];
+	uint32_t hashes[COMPR_LABELS_MAX];
+	int count = compr_suffixes(dname, labels, hashes);
+	if (count < 0) {
+		return count;
+	}
+
+	/* Find the longest written suffix. */
+	int match = count;
+	uint16_t match_pos = 0;
+	for (int i = 0; i < count; ++i) {
+		match_pos = compr_table_find(compr->table, compr->wire,
+		                             labels[i], hashes[i]);
+		if (match_pos > 0) {
+			match = i;
+			break;
+		}
 	}
 
-	return true;
+	/* Write unmatched labels followed by a pointer or the root label. */
+	uint16_t prefix = (match < count) ? labels[match] - dname :
+	                                    knot_dname_size(dname);
+	uint16_t written = prefix + ((match < count) ? sizeof(uint16_t) : 0);
+	if (written > max) {
+		return KNOT_ESPACE;
+	}
+	memcpy(dst, dname, prefix);
+	if (match < count) {
+		knot_wire_put_pointer(dst + prefix, match_pos);
+	}
+
+	/* Remember the new suffixes. */
+	assert(dst >= compr->wire);
+	size_t wire_pos = dst - compr->wire;
+	for (int i = 0; i < match; ++i) {
+		compr_table_insert(compr->table, wire_pos + (labels[i] - dname),
+		                   hashes[i]);
+	}
+
+	return written;
 }
 
+/*- Name compression --------------------------------------------------------*/
+
 /*! \brief Helper for \fn knot_compr_put_dname, writes label(s) with size checks. */
 #define WRITE_LABEL(dst, written, label, max, len) \
 	if ((written) + (len) > (max)) { \
@@ -62,6 +253,9 @@ int knot_compr_put_dname(const knot_dname_t *dname, uint8_t *dst, uint16_t max,
 	if (compr == NULL || *dname == '\0') {
 		return knot_dname_to_wire(dst, dname, max);
 	}
+	if (compr->table != NULL) {
+		return compr_put_table(dname, dst, max, compr);
+	}
 
 	int name_labels = knot_dname_labels(dname, NULL);
 	if (name_labels < 0) {
@@ -64,6 +64,30 @@ typedef struct {
 	uint16_t compress_ptr[KNOT_COMPR_HINT_COUNT]; /* Array of compr. ptr hints. */
 } knot_rrinfo_t;
 
+/*! \brief Number of slots in the name compression table. */
+#define KNOT_COMPR_TABLE_SIZE 2048
+
+/*! \brief Name compression table slot. */
+typedef struct {
+	uint16_t pos; /* Position of the name suffix in the packet. */
+	uint16_t tag; /* Upper bits of the suffix hash. */
+	uint16_t gen; /* Table generation the slot belongs to. */
+} knot_compr_slot_t;
+
+/*!
+ * \brief Name compression table.
+ *
+ * Remembers positions of all name suffixes written to the packet, so names
+ * are compressed against any previously written name, not only against the
+ * QNAME and the last written name. The table has a fixed size, suffixes are
+ * no longer stored when it's filled up.
+ */
+typedef struct knot_compr_table {
+	uint16_t gen;   /* Current generation, slots of other ones are empty. */
+	uint16_t count; /* Number of stored suffixes. */
+	knot_compr_slot_t slots[KNOT_COMPR_TABLE_SIZE];
+} knot_compr_table_t;
+
 /*!
  * \brief Name compression context.
  */
@@ -74,11 +98,41 @@ typedef struct knot_compr {
 		uint16_t pos;   /* Position of current suffix. */
 		uint8_t labels; /* Label count of the suffix. */
 	} suffix;
+	knot_compr_table_t *table; /* Compression table (optional). */
 } knot_compr_t;
 
+/*!
+ * \brief Remove all names from the compression table.
+ *
+ * \param table Compression table.
+ */
+void knot_compr_table_clear(knot_compr_table_t *table);
+
+/*!
+ * \brief Store all suffixes of a name written in the packet.
+ *
+ * \param table Compression table.
+ * \param wire Packet wireformat.
+ * \param pos Position of the uncompressed name in the packet.
+ */
+void knot_compr_table_add(knot_compr_table_t *table, const uint8_t *wire,
+                          uint16_t pos);
+
+/*!
+ * \brief Remove names written at or after the given packet position.
+ *
+ * \param table Compression table.
+ * \param size Packet size to keep.
+ */
+void knot_compr_table_trim(knot_compr_table_t *table, uint16_t size);
+
 /*!
  * \brief Write compressed domain name to the destination wire.
  *
+ * If the context has a compression table, the longest suffix of the name
+ * written anywhere in the packet is used. Otherwise only the suffix of the
+ * last written name is tried.
+ *
  * \param dname Name to be written.
  * \param dst Destination wire.
  * \param max Maximum number of bytes available.
@@ -193,6 +193,22 @@ static int pkt_reset_sections(knot_pkt_t *pkt)
 	return knot_pkt_begin(pkt, KNOT_ANSWER);
 }
 
+/*! \brief Reset compression table to contain QNAME only. */
+static void pkt_compr_reset(knot_pkt_t *pkt)
+{
+	assert(pkt);
+
+	if (pkt->compr_table == NULL) {
+		return;
+	}
+
+	knot_compr_table_clear(pkt->compr_table);
+	if (pkt->qname_size > 0) {
+		knot_compr_table_add(pkt->compr_table, pkt->wire,
+		                     KNOT_WIRE_HEADER_SIZE);
+	}
+}
+
 /*! \brief Clear packet payload and free allocated data. */
 static void pkt_clear_payload(knot_pkt_t *pkt)
 {
@@ -208,6 +224,9 @@ static void pkt_clear_payload(knot_pkt_t *pkt)
 	/* Free RRSets if applicable. */
 	pkt_free_data(pkt);
 
+	/* Forget written names except QNAME. */
+	pkt_compr_reset(pkt);
+
 	/* Reset sections. */
 	pkt_reset_sections(pkt);
 }
@@ -272,6 +291,9 @@ int knot_pkt_copy(knot_pkt_t *dst, const knot_pkt_t *src)
 	dst->rrset_count = 0;
 	dst->rrset_allocd = 0;
 
+	/* Names from the source packet aren't stored in the table. */
+	knot_compr_table_clear(dst->compr_table);
+
 	/* @note This could be done more effectively if needed. */
 	return knot_pkt_parse(dst, 0);
 }
@@ -318,6 +340,7 @@ void knot_pkt_clear(knot_pkt_t *pkt)
 	/* Reset to header size. */
 	pkt->size = KNOT_WIRE_HEADER_SIZE;
 	memset(pkt->wire, 0, pkt->size);
+	knot_compr_table_clear(pkt->compr_table);
 }
 
 _public_
@@ -333,6 +356,7 @@ void knot_pkt_free(knot_pkt_t **pkt)
 	/* Free RR/RR info arrays. */
 	mm_free(&(*pkt)->mm, (*pkt)->rr);
 	mm_free(&(*pkt)->mm, (*pkt)->rr_info);
+	mm_free(&(*pkt)->mm, (*pkt)->compr_table);
 
 	// free the space for wireformat
 	if ((*pkt)->flags & KNOT_PF_FREE) {
@@ -343,6 +367,31 @@ void knot_pkt_free(knot_pkt_t **pkt)
 	*pkt = NULL;
 }
 
+_public_
+int knot_pkt_use_compr_table(knot_pkt_t *pkt)
+{
+	if (pkt == NULL) {
+		return KNOT_EINVAL;
+	}
+
+	if (pkt->compr_table == NULL) {
+		pkt->compr_table = mm_alloc(&pkt->mm, sizeof(knot_compr_table_t));
+		if (pkt->compr_table == NULL) {
+			return KNOT_ENOMEM;
+		}
+		memset(pkt->compr_table, 0, sizeof(knot_compr_table_t));
+	}
+
+	/* Only QNAME may be written at this point. */
+	if (pkt->rrset_count == 0) {
+		pkt_compr_reset(pkt);
+	} else {
+		knot_compr_table_clear(pkt->compr_table);
+	}
+
+	return KNOT_EOK;
+}
+
 _public_
 int knot_pkt_reserve(knot_pkt_t *pkt, uint16_t size)
 {
@@ -505,6 +554,7 @@ int knot_pkt_put_question(knot_pkt_t *pkt, const knot_dname_t *qname, uint16_t q
 	knot_wire_set_qdcount(pkt->wire, 1);
 	pkt->size += question_len;
 	pkt->qname_size = qname_len;
+	pkt_compr_reset(pkt);
 
 	/* Start writing ANSWER. */
 	return knot_pkt_begin(pkt, KNOT_ANSWER);
@@ -547,10 +597,14 @@ int knot_pkt_put(knot_pkt_t *pkt, uint16_t compr_hint, const knot_rrset_t *rr,
 	compr.suffix.pos = KNOT_WIRE_HEADER_SIZE;
 	compr.suffix.labels = knot_dname_labels(compr.wire + compr.suffix.pos,
 	                                        compr.wire);
+	compr.table = pkt->compr_table;
 
 	/* Write RRSet to wireformat. */
 	ret = knot_rrset_to_wire(rr, pos, maxlen, &compr);
 	if (ret < 0) {
+		/* Forget names from the partially written RRSet. */
+		knot_compr_table_trim(compr.table, pkt->size);
+
 		/* Truncate packet if required. */
 		if (ret == KNOT_ESPACE && !(flags & KNOT_PF_NOTRUNC)) {
 				knot_wire_set_tc(pkt->wire);
@@ -597,6 +651,82 @@ const knot_rrset_t *knot_pkt_rr(const knot_pktsection_t *section, uint16_t i)
 	return section->pkt->rr + section->pos + i;
 }
 
+/*! \brief Check if only QUESTION, OPT and TSIG are needed to process the packet. */
+static bool pkt_lazy_enough(const knot_pkt_t *pkt)
+{
+	return knot_wire_get_qr(pkt->wire) == 0 &&
+	       knot_wire_get_opcode(pkt->wire) == KNOT_OPCODE_QUERY &&
+	       pkt->qname_size > 0 &&
+	       knot_pkt_qtype(pkt) != KNOT_RRTYPE_IXFR;
+}
+
+/*! \brief Get type of the next RR without parsing it. */
+static int pkt_peek_type(const knot_pkt_t *pkt, uint16_t *type)
+{
+	const uint8_t *rr = pkt->wire + pkt->parsed;
+	const uint8_t *end = pkt->wire + pkt->size;
+
+	int owner_size = knot_dname_wire_check(rr, end, pkt->wire);
+	if (owner_size <= 0 || end - (rr + owner_size) < sizeof(uint16_t)) {
+		return KNOT_EMALF;
+	}
+
+	*type = wire_read_u16(rr + owner_size);
+
+	return KNOT_EOK;
+}
+
+/*!
+ * \brief Parse packet payload, create RRSets only for OPT and TSIG.
+ *
+ * Other records are checked to be well-formed as when parsed, but no RRSets
+ * are created for them.
+ */
+static int pkt_parse_lazy(knot_pkt_t *pkt, unsigned flags)
+{
+	for (knot_section_t i = KNOT_ANSWER; i <= KNOT_ADDITIONAL; ++i) {
+		int ret = knot_pkt_begin(pkt, i);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+
+		uint16_t rr_count = pkt_rr_wirecount(pkt, i);
+		for (uint16_t j = 0; j < rr_count; ++j) {
+			uint16_t type = 0;
+			ret = pkt_peek_type(pkt, &type);
+			if (ret != KNOT_EOK) {
+				return ret;
+			}
+
+			if (type != KNOT_RRTYPE_OPT && type != KNOT_RRTYPE_TSIG) {
+				ret = knot_rrset_rr_skip_wire(pkt->wire, &pkt->parsed,
+				                              pkt->size);
+				if (ret != KNOT_EOK) {
+					return ret;
+				}
+				continue;
+			}
+
+			/* TSIG must be last record of AR if present. */
+			if (type == KNOT_RRTYPE_TSIG && j + 1 < rr_count) {
+				return KNOT_EMALF;
+			}
+
+			ret = knot_pkt_parse_rr(pkt, flags);
+			if (ret != KNOT_EOK) {
+				return ret;
+			}
+		}
+	}
+
+	/* Check for trailing garbage. */
+	if (pkt->parsed < pkt->size) {
+		return KNOT_EMALF;
+	}
+
+	return KNOT_EOK;
+}
+
 _public_
 int knot_pkt_parse(knot_pkt_t *pkt, unsigned flags)
 {
@@ -608,11 +738,15 @@ int knot_pkt_parse(knot_pkt_t *pkt, unsigned flags)
 	pkt_reset_sections(pkt);
 
 	int ret = knot_pkt_parse_question(pkt);
-	if (ret == KNOT_EOK) {
-		ret = knot_pkt_parse_payload(pkt, flags);
+	if (ret != KNOT_EOK) {
+		return ret;
 	}
 
-	return ret;
+	if ((flags & KNOT_PF_LAZY) && pkt_lazy_enough(pkt)) {
+		return pkt_parse_lazy(pkt, flags);
+	} else {
+		return knot_pkt_parse_payload(pkt, flags);
+	}
 }
 
 _public_
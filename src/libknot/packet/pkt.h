@@ -71,7 +71,8 @@ enum {
 	KNOT_PF_FREE      = 1 << 1, /*!< Free with packet. */
 	KNOT_PF_NOTRUNC   = 1 << 2, /*!< Don't truncate. */
 	KNOT_PF_CHECKDUP  = 1 << 3, /*!< Check for duplicates. */
-	KNOT_PF_KEEPWIRE  = 1 << 4  /*!< Keep wireformat untouched when parsing. */
+	KNOT_PF_KEEPWIRE  = 1 << 4, /*!< Keep wireformat untouched when parsing. */
+	KNOT_PF_LAZY      = 1 << 5  /*!< Parse only records needed for a query. */
 };
 
 /*!
@@ -111,6 +112,8 @@ typedef struct knot_pkt {
 	knot_rrinfo_t *rr_info;
 	knot_rrset_t *rr;
 
+	knot_compr_table_t *compr_table; /*!< Name compression table (optional). */
+
 	mm_ctx_t mm; /*!< Memory allocation context. */
 } knot_pkt_t;
 
@@ -156,6 +159,21 @@ void knot_pkt_clear(knot_pkt_t *pkt);
 /*! \brief Begone you foul creature of the underworld. */
 void knot_pkt_free(knot_pkt_t **pkt);
 
+/*!
+ * \brief Compress names in the packet against all previously written names.
+ *
+ * The compression table is allocated from the packet memory context and kept
+ * until the packet is freed. It's emptied whenever the packet is cleared,
+ * so it's enough to enable it once for a reused packet.
+ *
+ * \note It pays off for larger packets with many distinct names, e.g. zone
+ *       transfers, small answers are compressed well enough without it.
+ *
+ * \param pkt Packet.
+ * \return KNOT_EOK, KNOT_EINVAL, KNOT_ENOMEM
+ */
+int knot_pkt_use_compr_table(knot_pkt_t *pkt);
+
 /*!
  * \brief Reserve an arbitrary amount of space in the packet.
  *
@@ -257,8 +275,13 @@ const knot_rrset_t *knot_pkt_rr(const knot_pktsection_t *section, uint16_t i);
  *
  * \note For KNOT_PF_KEEPWIRE see note for \fn knot_pkt_parse_rr
  *
+ * \note With KNOT_PF_LAZY, only OPT and TSIG RRSets are created for queries
+ *       other than IXFR, remaining records are checked to be well-formed,
+ *       skipped and not accessible in the packet sections. Other packets
+ *       are parsed completely.
+ *
  * \param pkt Given packet.
- * \param flags Parsing flags (allowed KNOT_PF_KEEPWIRE)
+ * \param flags Parsing flags (allowed KNOT_PF_KEEPWIRE, KNOT_PF_LAZY)
  * \return KNOT_EOK, KNOT_EMALF and other errors
  */
 int knot_pkt_parse(knot_pkt_t *pkt, unsigned flags);
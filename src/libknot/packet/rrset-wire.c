@@ -137,6 +137,8 @@ struct dname_config {
 	knot_compr_t *compr;
 	uint16_t hint;
 	const uint8_t *pkt_wire;
+	const uint8_t *rdata;   /*!< RDATA start in the wire image. */
+	uint8_t *names;         /*!< Name offsets in the wire image. */
 };
 
 typedef struct dname_config dname_config_t;
@@ -493,6 +495,305 @@ static int write_rr(const knot_rrset_t *rrset, uint16_t rrset_index,
 	return write_rdata(rrset, rrset_index, dst, dst_avail, compr);
 }
 
+/*- RRSet wire image ------------------------------------------------------*/
+
+/*! \brief Flag of a compressible name in the image name offsets. */
+#define IMAGE_NAME_COMPR 0x8000
+
+/*!
+ * \brief Precomputed wire format of the RRSet RRs.
+ *
+ * Each RR is stored as: length of the RR wire without owner (2B), count
+ * of names in RDATA (1B), offsets of the names in RDATA (2B each, highest
+ * bit set if compressible), RR wire without owner (TYPE, CLASS, TTL,
+ * RDLENGTH and uncompressed RDATA).
+ */
+struct knot_rrset_image {
+	uint32_t refcount;         /*!< Number of RRSets sharing the image. */
+	const knot_rdata_t *data;  /*!< RDATA the image was created from. */
+	uint16_t type;             /*!< RR type. */
+	uint16_t rr_count;         /*!< Number of RRs. */
+	uint8_t wire[];            /*!< RR wire images. */
+};
+
+/*! \brief Check if the image was created from the RRSet data. */
+static bool image_valid(const struct knot_rrset_image *image,
+                        const knot_rrset_t *rrset)
+{
+	return image->data == rrset->rrs.data && image->type == rrset->type &&
+	       image->rr_count == rrset->rrs.rr_count;
+}
+
+/*! \brief Count names in RDATA blocks of given type. */
+static uint8_t image_name_count(const knot_rdata_descriptor_t *desc)
+{
+	uint8_t count = 0;
+	for (int i = 0; desc->block_types[i] != KNOT_RDATA_WF_END; i++) {
+		switch (desc->block_types[i]) {
+		case KNOT_RDATA_WF_COMPRESSIBLE_DNAME:
+		case KNOT_RDATA_WF_DECOMPRESSIBLE_DNAME:
+		case KNOT_RDATA_WF_FIXED_DNAME:
+			count += 1;
+			break;
+		default:
+			break;
+		}
+	}
+
+	return count;
+}
+
+/*!
+ * \brief Copy RDATA name into the wire image and record its offset.
+ */
+static int image_rdata_dname(const uint8_t **src, size_t *src_avail,
+                             uint8_t **dst, size_t *dst_avail,
+                             int dname_type, dname_config_t *dname_cfg)
+{
+	assert(src && *src);
+	assert(src_avail);
+	assert(dst && *dst);
+	assert(dst_avail);
+	assert(dname_cfg);
+
+	size_t offset = *dst - dname_cfg->rdata;
+	if (offset >= IMAGE_NAME_COMPR) {
+		return KNOT_ESPACE;
+	}
+	if (dname_type == KNOT_RDATA_WF_COMPRESSIBLE_DNAME) {
+		offset |= IMAGE_NAME_COMPR;
+	}
+	wire_write_u16(dname_cfg->names, offset);
+	dname_cfg->names += sizeof(uint16_t);
+
+	int size = knot_dname_size(*src);
+	if (size < 0) {
+		return size;
+	}
+
+	return write_rdata_fixed(src, src_avail, dst, dst_avail, size);
+}
+
+/*!
+ * \brief Write one RR wire image.
+ */
+static int image_write_rr(const knot_rrset_t *rrset, uint16_t rrset_index,
+                          const knot_rdata_descriptor_t *desc,
+                          uint8_t **dst, size_t *dst_avail)
+{
+	const knot_rdata_t *rdata = knot_rdataset_at(&rrset->rrs, rrset_index);
+	uint16_t rdlen = knot_rdata_rdlen(rdata);
+	uint8_t names = (rdlen > 0) ? image_name_count(desc) : 0;
+
+	/* Image header. */
+	uint8_t *write = *dst;
+	wire_write_u16(write, RR_HEADER_SIZE + rdlen);
+	write += sizeof(uint16_t);
+	*write = names;
+	write += sizeof(uint8_t);
+	uint8_t *offsets = write;
+	write += names * sizeof(uint16_t);
+
+	size_t avail = *dst_avail - (write - *dst);
+	int ret = write_fixed_header(rrset, rrset_index, &write, &avail);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+	if (avail < sizeof(uint16_t) + rdlen) {
+		return KNOT_ESPACE;
+	}
+	wire_write_u16(write, rdlen);
+	write += sizeof(uint16_t);
+	avail -= sizeof(uint16_t);
+
+	/* Uncompressed RDATA with recorded names. */
+	dname_config_t dname_cfg = {
+		.write_cb = image_rdata_dname,
+		.rdata = write,
+		.names = offsets
+	};
+
+	const uint8_t *src = knot_rdata_data(rdata);
+	size_t src_avail = rdlen;
+	if (src_avail > 0) {
+		ret = rdata_traverse(&src, &src_avail, &write, &avail, desc,
+		                     &dname_cfg);
+		if (ret != KNOT_EOK) {
+			return ret;
+		}
+	}
+	if (src_avail > 0 || dname_cfg.names != offsets + names * sizeof(uint16_t)) {
+		return KNOT_EMALF;
+	}
+
+	*dst_avail -= write - *dst;
+	*dst = write;
+
+	return KNOT_EOK;
+}
+
+/*!
+ * \brief Write one RR from the RRSet wire image.
+ *
+ * Only the owner and compressible names are written with compression,
+ * the rest is copied.
+ */
+static int write_rr_image(const knot_rrset_t *rrset, uint16_t rrset_index,
+                          const uint8_t **src, uint8_t **dst, size_t *dst_avail,
+                          knot_compr_t *compr)
+{
+	int ret = write_owner(rrset, dst, dst_avail, compr);
+	if (ret != KNOT_EOK) {
+		return ret;
+	}
+
+	/* Image header. */
+	const uint8_t *read = *src;
+	uint16_t len = wire_read_u16(read);
+	read += sizeof(uint16_t);
+	uint8_t names = *read;
+	read += sizeof(uint8_t);
+	const uint8_t *offsets = read;
+	read += names * sizeof(uint16_t);
+	*src = read + len;
+
+	/* Copy the RR if there are no names. */
+	if (names == 0) {
+		if (len > *dst_avail) {
+			return KNOT_ESPACE;
+		}
+		memcpy(*dst, read, len);
+		*dst += len;
+		*dst_avail -= len;
+		return KNOT_EOK;
+	}
+
+	/* Copy TYPE, CLASS and TTL, RDLENGTH is written at the end. */
+	if (RR_HEADER_SIZE > *dst_avail) {
+		return KNOT_ESPACE;
+	}
+	memcpy(*dst, read, RR_HEADER_SIZE - sizeof(uint16_t));
+	uint8_t *wire_rdlength = *dst + RR_HEADER_SIZE - sizeof(uint16_t);
+	uint8_t *write = *dst + RR_HEADER_SIZE;
+	size_t avail = *dst_avail - RR_HEADER_SIZE;
+
+	const uint8_t *rdata = read + RR_HEADER_SIZE;
+	size_t rdlen = len - RR_HEADER_SIZE;
+	uint16_t hint = KNOT_COMPR_HINT_RDATA + rrset_index;
+	size_t pos = 0;
+	for (uint8_t i = 0; i < names; i++) {
+		uint16_t offset = wire_read_u16(offsets + i * sizeof(uint16_t));
+		knot_compr_t *put_compr = (offset & IMAGE_NAME_COMPR) ? compr : NULL;
+		offset &= ~IMAGE_NAME_COMPR;
+
+		/* Data preceding the name. */
+		size_t size = offset - pos;
+		if (size > avail) {
+			return KNOT_ESPACE;
+		}
+		memcpy(write, rdata + pos, size);
+		write += size;
+		avail -= size;
+
+		/* The name itself. */
+		const knot_dname_t *dname = rdata + offset;
+		int written = knot_compr_put_dname(dname, write, dname_max(avail),
+		                                   put_compr);
+		if (written < 0) {
+			return written;
+		}
+		if (compr_get_ptr(compr, hint) == 0) {
+			compr_set_ptr(compr, hint, write, written);
+		}
+		write += written;
+		avail -= written;
+		pos = offset + knot_dname_size(dname);
+	}
+
+	/* Data following the last name. */
+	size_t size = rdlen - pos;
+	if (size > avail) {
+		return KNOT_ESPACE;
+	}
+	memcpy(write, rdata + pos, size);
+	write += size;
+	avail -= size;
+
+	wire_write_u16(wire_rdlength, write - wire_rdlength - sizeof(uint16_t));
+
+	*dst = write;
+	*dst_avail = avail;
+
+	return KNOT_EOK;
+}
+
+_public_
+struct knot_rrset_image *knot_rrset_image_new(const knot_rrset_t *rrset,
+                                              mm_ctx_t *mm)
+{
+	if (rrset == NULL || rrset->rrs.rr_count == 0) {
+		return NULL;
+	}
+
+	const knot_rdata_descriptor_t *desc = knot_get_rdata_descriptor(rrset->type);
+
+	/* Compute the image size. */
+	size_t size = 0;
+	for (uint16_t i = 0; i < rrset->rrs.rr_count; i++) {
+		const knot_rdata_t *rdata = knot_rdataset_at(&rrset->rrs, i);
+		uint16_t rdlen = knot_rdata_rdlen(rdata);
+		uint8_t names = (rdlen > 0) ? image_name_count(desc) : 0;
+		size += sizeof(uint16_t) + sizeof(uint8_t) +
+		        names * sizeof(uint16_t) + RR_HEADER_SIZE + rdlen;
+	}
+
+	struct knot_rrset_image *image = mm_alloc(mm, sizeof(*image) + size);
+	if (image == NULL) {
+		return NULL;
+	}
+
+	image->refcount = 1;
+	image->data = rrset->rrs.data;
+	image->type = rrset->type;
+	image->rr_count = rrset->rrs.rr_count;
+
+	uint8_t *write = image->wire;
+	size_t avail = size;
+	for (uint16_t i = 0; i < rrset->rrs.rr_count; i++) {
+		int ret = image_write_rr(rrset, i, desc, &write, &avail);
+		if (ret != KNOT_EOK) {
+			mm_free(mm, image);
+			return NULL;
+		}
+	}
+	assert(avail == 0);
+
+	return image;
+}
+
+_public_
+struct knot_rrset_image *knot_rrset_image_ref(struct knot_rrset_image *image)
+{
+	if (image != NULL) {
+		__sync_add_and_fetch(&image->refcount, 1);
+	}
+
+	return image;
+}
+
+_public_
+void knot_rrset_image_free(struct knot_rrset_image **image, mm_ctx_t *mm)
+{
+	if (image == NULL || *image == NULL) {
+		return;
+	}
+
+	if (__sync_sub_and_fetch(&(*image)->refcount, 1) == 0) {
+		mm_free(mm, *image);
+	}
+	*image = NULL;
+}
+
 /*!
  * \brief Write RR Set content to a wire.
  */
@@ -507,6 +808,21 @@ int knot_rrset_to_wire(const knot_rrset_t *rrset, uint8_t *wire, uint16_t max_si
 	uint8_t *write = wire;
 	size_t capacity = max_size;
 
+	/* Copy precomputed wire format if available. */
+	const struct knot_rrset_image *image = rrset->image;
+	if (image != NULL && image_valid(image, rrset)) {
+		const uint8_t *src = image->wire;
+		for (uint16_t i = 0; i < rrset->rrs.rr_count; i++) {
+			int ret = write_rr_image(rrset, i, &src, &write, &capacity,
+			                         compr);
+			if (ret != KNOT_EOK) {
+				return ret;
+			}
+		}
+
+		return write - wire;
+	}
+
 	for (uint16_t i = 0; i < rrset->rrs.rr_count; i++) {
 		int ret = write_rr(rrset, i, &write, &capacity, compr);
 		if (ret != KNOT_EOK) {
@@ -687,6 +1003,64 @@ static int parse_rdata(const uint8_t *pkt_wire, size_t *pos, size_t pkt_size,
 	return KNOT_EOK;
 }
 
+_public_
+int knot_rrset_rr_skip_wire(const uint8_t *pkt_wire, size_t *pos,
+                            size_t pkt_size)
+{
+	if (!pkt_wire || !pos || *pos > pkt_size) {
+		return KNOT_EINVAL;
+	}
+
+	size_t rr_pos = *pos;
+	int owner_size = knot_dname_wire_check(pkt_wire + rr_pos,
+	                                       pkt_wire + pkt_size, pkt_wire);
+	if (owner_size <= 0) {
+		return KNOT_EMALF;
+	}
+	rr_pos += owner_size;
+
+	if (pkt_size - rr_pos < RR_HEADER_SIZE) {
+		return KNOT_EMALF;
+	}
+
+	knot_rrset_t rrset;
+	knot_rrset_init(&rrset, NULL, wire_read_u16(pkt_wire + rr_pos),
+	                wire_read_u16(pkt_wire + rr_pos + sizeof(uint16_t)));
+	uint16_t rdlength = wire_read_u16(pkt_wire + rr_pos + RR_HEADER_SIZE -
+	                                  sizeof(uint16_t));
+	rr_pos += RR_HEADER_SIZE;
+
+	if (pkt_size - rr_pos < rdlength) {
+		return KNOT_EMALF;
+	}
+
+	/* Same RDATA checks as in parse_rdata(), without the copy. */
+	const knot_rdata_descriptor_t *desc = knot_get_rdata_descriptor(rrset.type);
+	if (desc->type_name == NULL) {
+		desc = knot_get_obsolete_rdata_descriptor(rrset.type);
+	}
+
+	if (rdlength == 0) {
+		if (!allow_zero_rdata(&rrset, desc)) {
+			return KNOT_EMALF;
+		}
+	} else {
+		const uint8_t *src = pkt_wire + rr_pos;
+		size_t src_avail = rdlength;
+		int buffer_size = rdata_len(&src, &src_avail, pkt_wire, desc);
+		if (buffer_size < 0) {
+			return buffer_size;
+		}
+		if (buffer_size > MAX_RDLENGTH) {
+			return KNOT_EMALF;
+		}
+	}
+
+	*pos = rr_pos + rdlength;
+
+	return KNOT_EOK;
+}
+
 _public_
 int knot_rrset_rr_from_wire(const uint8_t *pkt_wire, size_t *pos,
                             size_t pkt_size, mm_ctx_t *mm,
@@ -35,6 +35,7 @@
 #include "libknot/internal/mempattern.h"
 
 struct knot_compr;
+struct knot_rrset_image;
 
 /*!
  * \brief Write RR Set content to a wire.
@@ -49,6 +50,39 @@ struct knot_compr;
 int knot_rrset_to_wire(const knot_rrset_t *rrset, uint8_t *wire, uint16_t max_size,
                        struct knot_compr *compr);
 
+/*!
+ * \brief Create precomputed wire format of the RRSet RRs.
+ *
+ * The image holds the RRs without owners and with uncompressed RDATA names,
+ * so that \ref knot_rrset_to_wire only copies the data and compresses the
+ * names. The image is used only for the RRSet with the same RDATA as it was
+ * created from (see \a knot_rrset_t.image).
+ *
+ * \param rrset  RRSet to create the image of.
+ * \param mm     Memory context.
+ *
+ * \return New image or NULL on error.
+ */
+struct knot_rrset_image *knot_rrset_image_new(const knot_rrset_t *rrset,
+                                              mm_ctx_t *mm);
+
+/*!
+ * \brief Share the RRSet wire image with another RRSet of the same RDATA.
+ *
+ * \param image  Image to be shared (may be NULL).
+ *
+ * \return The same image.
+ */
+struct knot_rrset_image *knot_rrset_image_ref(struct knot_rrset_image *image);
+
+/*!
+ * \brief Release the RRSet wire image, free it if not shared any more.
+ *
+ * \param image  Image to be released.
+ * \param mm     Memory context.
+ */
+void knot_rrset_image_free(struct knot_rrset_image **image, mm_ctx_t *mm);
+
 /*!
 * \brief Creates one RR from wire, stores it into \a rrset.
 *
@@ -63,4 +97,17 @@ int knot_rrset_to_wire(const knot_rrset_t *rrset, uint8_t *wire, uint16_t max_si
 int knot_rrset_rr_from_wire(const uint8_t *pkt_wire, size_t *pos,
                             size_t pkt_size, mm_ctx_t *mm, knot_rrset_t *rrset);
 
+/*!
+* \brief Checks one RR in wire format as when creating it, and skips it.
+*
+* \param pkt_wire    Source wire (the whole packet).
+* \param pos         Position in \a wire, moved past the RR on success.
+* \param pkt_size    Total size of data in \a wire (size of the packet).
+*
+* \retval KNOT_EOK if the RR is well-formed.
+* \retval KNOT_EMALF if the RR is malformed.
+*/
+int knot_rrset_rr_skip_wire(const uint8_t *pkt_wire, size_t *pos,
+                            size_t pkt_size);
+
 /*! @} */
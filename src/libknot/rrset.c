@@ -55,6 +55,7 @@ void knot_rrset_init(knot_rrset_t *rrset, knot_dname_t *owner, uint16_t type,
 	rrset->rclass = rclass;
 	knot_rdataset_init(&rrset->rrs);
 	rrset->additional = NULL;
+	rrset->image = NULL;
 }
 
 _public_
@@ -34,6 +34,8 @@
 #include "libknot/rdataset.h"
 #include "libknot/internal/mempattern.h"
 
+struct knot_rrset_image;
+
 /*!
  * \brief Structure for representing RRSet.
  *
@@ -46,6 +48,7 @@ struct knot_rrset {
 	knot_rdataset_t rrs;  /*!< RRSet's RRs */
 	/* Optional fields. */
 	struct zone_node **additional; /*!< Additional records. */
+	struct knot_rrset_image *image; /*!< Precomputed wire format. */
 };
 
 typedef struct knot_rrset knot_rrset_t;
@@ -226,6 +226,27 @@ struct scanner {
 	 */
 };
 
+/*!
+ * \brief Part of zone data which can be parsed independently.
+ *
+ * The part starts with a record with an explicit owner, the origin and
+ * the default TTL valid at its beginning are stored with it.
+ */
+typedef struct {
+	/*! Offset of the part in the zone data. */
+	uint64_t offset;
+	/*! Length of the part. */
+	uint64_t length;
+	/*! Number of the first line of the part. */
+	uint64_t line;
+	/*! Length of the origin. */
+	uint32_t zone_origin_length;
+	/*! Wire format of the origin. */
+	uint8_t  zone_origin[MAX_DNAME_LENGTH + MAX_LABEL_LENGTH];
+	/*! Value of the default ttl. */
+	uint32_t default_ttl;
+} zs_chunk_t;
+
 /*!
  * \brief Creates zone scanner structure.
  *
@@ -293,4 +314,50 @@ int zs_scanner_parse(zs_scanner_t *scanner,
  */
 int zs_scanner_parse_file(zs_scanner_t *scanner,
                           const char   *file_name);
+
+/*!
+ * \brief Splits zone data into parts of approximately given size.
+ *
+ * The data are pre-scanned for record boundaries with respect to comments,
+ * quoted strings and parentheses. Directives are evaluated to get the origin
+ * and the default TTL at the beginning of each part.
+ *
+ * \note If the data contain INCLUDE directive or a wrong directive, one part
+ *       covering all the data is returned, so that it is processed
+ *       sequentially with complete error reporting.
+ *
+ * \param scanner	Zone scanner with the initial origin and default TTL.
+ * 			The scanner itself is not modified.
+ * \param start		First byte of the zone data to split.
+ * \param end		Last byte of the zone data to split.
+ * \param chunk_size	Minimal size of one part.
+ * \param chunks		Output array of parts (free with free()).
+ * \param count		Output number of parts.
+ *
+ * \retval  0		if success.
+ * \retval -1		if error.
+ */
+int zs_scanner_split(const zs_scanner_t *scanner,
+                     const char         *start,
+                     const char         *end,
+                     const uint64_t     chunk_size,
+                     zs_chunk_t         **chunks,
+                     uint64_t           *count);
+
+/*!
+ * \brief Parses one part of zone data returned by zs_scanner_split().
+ *
+ * The scanner origin, default TTL and line counter are set from the part
+ * before parsing. The parts may be parsed by different scanners in parallel.
+ *
+ * \param scanner	Zone scanner.
+ * \param start		First byte of the whole zone data.
+ * \param chunk		Part of the zone data to parse.
+ *
+ * \retval  0		if success.
+ * \retval -1		if error.
+ */
+int zs_scanner_parse_chunk(zs_scanner_t     *scanner,
+                           const char       *start,
+                           const zs_chunk_t *chunk);
 /*! @} */
@@ -0,0 +1,234 @@
+/*  Copyright (C) 2015 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "zscanner/scanner.h"
+
+/*! \brief Initial capacity of the array of parts. */
+#define CHUNKS_INIT	16
+
+static void noop(zs_scanner_t *s)
+{
+	(void)s;
+}
+
+/*!
+ * \brief Checks if a part can start with the given character.
+ *
+ * Records starting with a blank character inherit the owner of the previous
+ * record, directives change the scanner state.
+ */
+static bool owner_start(const char c)
+{
+	switch (c) {
+	case ' ':
+	case '\t':
+	case '\r':
+	case '\n':
+	case ';':
+	case '$':
+	case '(':
+	case ')':
+	case '"':
+		return false;
+	default:
+		return true;
+	}
+}
+
+static int chunk_add(zs_chunk_t **chunks, uint64_t *count, uint64_t *capacity,
+                     const zs_scanner_t *state, const uint64_t offset,
+                     const uint64_t line)
+{
+	if (*count == *capacity) {
+		uint64_t new_capacity = (*capacity > 0) ? 2 * *capacity : CHUNKS_INIT;
+		zs_chunk_t *new_chunks = realloc(*chunks,
+		                                 new_capacity * sizeof(zs_chunk_t));
+		if (new_chunks == NULL) {
+			return -1;
+		}
+		*chunks = new_chunks;
+		*capacity = new_capacity;
+	}
+
+	zs_chunk_t *chunk = *chunks + *count;
+	memset(chunk, 0, sizeof(*chunk));
+	chunk->offset = offset;
+	chunk->line = line;
+	chunk->zone_origin_length = state->zone_origin_length;
+	memcpy(chunk->zone_origin, state->zone_origin,
+	       sizeof(chunk->zone_origin));
+	chunk->default_ttl = state->default_ttl;
+
+	// Close the previous part.
+	if (*count > 0) {
+		(chunk - 1)->length = offset - (chunk - 1)->offset;
+	}
+
+	*count += 1;
+
+	return 0;
+}
+
+__attribute__((visibility("default")))
+int zs_scanner_split(const zs_scanner_t *s,
+                     const char         *start,
+                     const char         *end,
+                     const uint64_t     chunk_size,
+                     zs_chunk_t         **chunks,
+                     uint64_t           *count)
+{
+	if (s == NULL || start == NULL || end == NULL || end < start ||
+	    chunks == NULL || count == NULL) {
+		return -1;
+	}
+
+	// Directives are evaluated by a copy of the scanner.
+	zs_scanner_t *state = malloc(sizeof(zs_scanner_t));
+	if (state == NULL) {
+		return -1;
+	}
+	memcpy(state, s, sizeof(zs_scanner_t));
+	state->process_record = &noop;
+	state->process_error = &noop;
+	state->data = NULL;
+	state->path = NULL;
+
+	zs_chunk_t *out = NULL;
+	uint64_t out_count = 0, out_capacity = 0;
+
+	uint64_t line = s->line_counter;
+	if (chunk_add(&out, &out_count, &out_capacity, state, 0, line) != 0) {
+		zs_scanner_free(state);
+		return -1;
+	}
+
+	const char *record = start; // Beginning of the current record.
+	const char *split = start + chunk_size;
+	bool multiline = false, quoted = false, directive = false;
+	bool sequential = false;
+
+	for (const char *p = start; p < end; p++) {
+		// Beginning of a record.
+		if (p == record) {
+			if (*p == '$') {
+				if (end - p >= 8 && strncasecmp(p, "$INCLUDE", 8) == 0) {
+					sequential = true;
+					break;
+				}
+				directive = true;
+			} else if (p >= split && owner_start(*p)) {
+				if (chunk_add(&out, &out_count, &out_capacity, state,
+				              p - start, line) != 0) {
+					free(out);
+					zs_scanner_free(state);
+					return -1;
+				}
+				split = p + chunk_size;
+			}
+		}
+
+		switch (*p) {
+		case '\\': // Escaped character.
+			if (p + 1 < end) {
+				p++;
+				if (*p == '\n') {
+					line++;
+				}
+			}
+			break;
+		case '"':
+			quoted = !quoted;
+			break;
+		case ';': // Comment till the end of the line.
+			if (!quoted) {
+				const char *eol = memchr(p, '\n', end - p);
+				p = (eol != NULL) ? eol - 1 : end - 1;
+			}
+			break;
+		case '(':
+			if (!quoted) {
+				multiline = true;
+			}
+			break;
+		case ')':
+			if (!quoted) {
+				multiline = false;
+			}
+			break;
+		case '\n':
+			line++;
+			if (multiline) {
+				break;
+			}
+			quoted = false;
+			if (directive) {
+				zs_scanner_parse(state, record, p + 1, false);
+				if (state->error_counter > s->error_counter ||
+				    state->stop) {
+					sequential = true;
+				}
+				directive = false;
+			}
+			record = p + 1;
+			break;
+		default:
+			break;
+		}
+
+		if (sequential) {
+			break;
+		}
+	}
+
+	zs_scanner_free(state);
+
+	// Fall back to one part.
+	if (sequential) {
+		out_count = 1;
+	}
+	out[out_count - 1].length = (end - start) - out[out_count - 1].offset;
+
+	*chunks = out;
+	*count = out_count;
+
+	return 0;
+}
+
+__attribute__((visibility("default")))
+int zs_scanner_parse_chunk(zs_scanner_t     *s,
+                           const char       *start,
+                           const zs_chunk_t *chunk)
+{
+	if (s == NULL || start == NULL || chunk == NULL) {
+		return -1;
+	}
+
+	s->zone_origin_length = chunk->zone_origin_length;
+	memcpy(s->zone_origin, chunk->zone_origin, sizeof(s->zone_origin));
+	s->default_ttl = chunk->default_ttl;
+	s->line_counter = chunk->line;
+	s->multiline = false;
+
+	const char *data = start + chunk->offset;
+
+	return zs_scanner_parse(s, data, data + chunk->length, true);
+}
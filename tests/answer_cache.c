@@ -0,0 +1,121 @@
+/*  Copyright (C) 2015 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <tap/basic.h>
+
+#include "knot/nameserver/answer_cache.h"
+#include "libknot/libknot.h"
+
+/*! \brief EDNS flags with the DO bit set. */
+#define FLAGS_DO 0x8000
+
+static bool cached(answer_cache_t *cache, const answer_cache_key_t *key,
+                   const uint8_t *wire, size_t size)
+{
+	size_t cached_size = 0;
+	const uint8_t *cached_wire = answer_cache_get(cache, key, &cached_size);
+	return cached_wire != NULL && cached_size == size &&
+	       memcmp(cached_wire, wire, size) == 0;
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	answer_cache_t *cache = answer_cache_new(1000);
+	ok(cache != NULL && answer_cache_size(cache) == 1024, "answer cache: create");
+
+	knot_dname_t *qname = knot_dname_from_str_alloc("www.example.");
+	answer_cache_key_t key = {
+		.zone_gen = 1,
+		.qname = qname,
+		.qtype = KNOT_RRTYPE_A,
+		.max_size = 1232,
+		.edns = true,
+		.edns_version = 0,
+		.edns_flags = FLAGS_DO
+	};
+	uint8_t wire[64] = "answer";
+	uint8_t other_wire[64] = "other answer";
+
+	size_t size = 0;
+	ok(answer_cache_get(cache, &key, &size) == NULL, "answer cache: empty");
+
+	answer_cache_put(cache, &key, wire, sizeof(wire));
+	ok(cached(cache, &key, wire, sizeof(wire)), "answer cache: hit");
+
+	/* QNAME is compared by value. */
+	knot_dname_t *qname_copy = knot_dname_copy(qname, NULL);
+	answer_cache_key_t same = key;
+	same.qname = qname_copy;
+	ok(cached(cache, &same, wire, sizeof(wire)), "answer cache: hit with QNAME copy");
+	knot_dname_free(&qname_copy, NULL);
+
+	answer_cache_key_t miss = key;
+	miss.zone_gen = 2;
+	ok(answer_cache_get(cache, &miss, &size) == NULL, "answer cache: miss by generation");
+
+	miss = key;
+	miss.qtype = KNOT_RRTYPE_AAAA;
+	ok(answer_cache_get(cache, &miss, &size) == NULL, "answer cache: miss by QTYPE");
+
+	miss = key;
+	miss.max_size = KNOT_WIRE_MIN_PKTSIZE;
+	ok(answer_cache_get(cache, &miss, &size) == NULL, "answer cache: miss by size limit");
+
+	miss = key;
+	miss.edns_flags = 0;
+	ok(answer_cache_get(cache, &miss, &size) == NULL, "answer cache: miss by DO bit");
+
+	miss = key;
+	miss.edns_version = 1;
+	ok(answer_cache_get(cache, &miss, &size) == NULL, "answer cache: miss by EDNS version");
+
+	/* Queries with and without EDNS with the same size limit. */
+	answer_cache_key_t edns = key;
+	edns.max_size = KNOT_WIRE_MIN_PKTSIZE;
+	edns.edns_flags = 0;
+	answer_cache_key_t no_edns = edns;
+	no_edns.edns = false;
+	answer_cache_put(cache, &edns, wire, sizeof(wire));
+	ok(answer_cache_get(cache, &no_edns, &size) == NULL,
+	   "answer cache: EDNS answer not used without EDNS");
+	answer_cache_put(cache, &no_edns, other_wire, sizeof(other_wire));
+	ok(cached(cache, &no_edns, other_wire, sizeof(other_wire)),
+	   "answer cache: answer without EDNS");
+	ok(!cached(cache, &edns, other_wire, sizeof(other_wire)),
+	   "answer cache: answer without EDNS not used with EDNS");
+
+	/* Replacing the entry. */
+	answer_cache_put(cache, &key, other_wire, sizeof(other_wire));
+	ok(cached(cache, &key, other_wire, sizeof(other_wire)), "answer cache: replace");
+
+	answer_cache_put(cache, &key, wire, ANSWER_CACHE_MAX_WIRE + 1);
+	ok(cached(cache, &key, other_wire, sizeof(other_wire)),
+	   "answer cache: too large answer not stored");
+
+	/* Resizing. */
+	ok(answer_cache_resize(cache, 1024) == cache, "answer cache: resize to same size");
+	cache = answer_cache_resize(cache, 10);
+	ok(cache != NULL && answer_cache_size(cache) == 16 &&
+	   answer_cache_get(cache, &key, &size) == NULL, "answer cache: resize");
+	ok(answer_cache_resize(cache, 0) == NULL, "answer cache: disable");
+
+	knot_dname_free(&qname, NULL);
+
+	return 0;
+}
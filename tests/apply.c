@@ -0,0 +1,392 @@
+/*  Copyright (C) 2015 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <tap/basic.h>
+
+#include "test_conf.h"
+#include "knot/dnssec/zone-nsec.h"
+#include "knot/updates/apply.h"
+#include "knot/zone/zone.h"
+#include "knot/zone/zonefile.h"
+#include "libknot/libknot.h"
+#include "libknot/rrtype/soa.h"
+#include "zscanner/scanner.h"
+
+#define ZONE	"example."
+#define NSEC3	"1 0 10 AABBCCDD"
+
+static char *write_zone(void)
+{
+	char *tmpdir = test_tmpdir();
+	char *path = malloc(strlen(tmpdir) + sizeof("/apply.zone"));
+	sprintf(path, "%s/apply.zone", tmpdir);
+	free(tmpdir);
+
+	FILE *f = fopen(path, "w");
+	if (f == NULL) {
+		free(path);
+		return NULL;
+	}
+
+	fputs("$TTL 600\n"
+	      "@ SOA ns admin 1 3600 900 604800 300\n"
+	      "@ NS ns\n"
+	      "@ NSEC3PARAM "NSEC3"\n"
+	      "ns A 192.0.2.1\n"
+	      "mail MX 10 new\n"
+	      "mail MX 20 a.wild\n"
+	      "mail MX 30 ns.deleg\n", f);
+	for (int i = 0; i < 100; i++) {
+		fprintf(f, "host%d A 192.0.2.%d\n", i, i + 10);
+		fprintf(f, "host%d MX 10 host%d\n", i, i + 1);
+	}
+	fclose(f);
+
+	return path;
+}
+
+/* Changes parsed from the zone file format. */
+
+typedef struct {
+	changeset_t *ch;
+	int (*add)(changeset_t *, const knot_rrset_t *);
+} parse_ctx_t;
+
+static void add_record(zs_scanner_t *s)
+{
+	parse_ctx_t *ctx = s->data;
+
+	knot_rrset_t rr;
+	knot_rrset_init(&rr, s->r_owner, s->r_type, s->r_class);
+	knot_rrset_add_rdata(&rr, s->r_data, s->r_data_length, s->r_ttl, NULL);
+	ctx->add(ctx->ch, &rr);
+	knot_rdataset_clear(&rr.rrs, NULL);
+}
+
+static void parse_records(changeset_t *ch, const char *text,
+                          int (*add)(changeset_t *, const knot_rrset_t *))
+{
+	parse_ctx_t ctx = { ch, add };
+	zs_scanner_t *s = zs_scanner_create(ZONE, KNOT_CLASS_IN, 600,
+	                                    add_record, NULL, &ctx);
+	zs_scanner_parse(s, text, text + strlen(text), true);
+	zs_scanner_free(s);
+}
+
+/*! \brief Returns the NSEC3 record of the name in the zone file format. */
+static char *nsec3_record(const zone_contents_t *zone, const char *name)
+{
+	knot_dname_t *owner = knot_dname_from_str_alloc(name);
+	knot_dname_t *hash = knot_create_nsec3_owner(owner, zone->apex->owner,
+	                                             zone_contents_nsec3params(zone));
+	char *hash_str = knot_dname_to_str_alloc(hash);
+	knot_dname_free(&owner, NULL);
+	knot_dname_free(&hash, NULL);
+
+	char *record = malloc(strlen(hash_str) * 2 + sizeof(NSEC3) + 16);
+	sprintf(record, "%s NSEC3 "NSEC3" %.32s A\n", hash_str, hash_str);
+	free(hash_str);
+
+	return record;
+}
+
+static char *nsec3_records(const zone_contents_t *zone, const char **names)
+{
+	char *records = calloc(1, 1);
+	for (; *names != NULL; names++) {
+		char *record = nsec3_record(zone, *names);
+		records = realloc(records, strlen(records) + strlen(record) + 1);
+		strcat(records, record);
+		free(record);
+	}
+
+	return records;
+}
+
+static changeset_t *new_changeset(const knot_rrset_t *soa_from,
+                                  const char *rem, const char *add)
+{
+	changeset_t *ch = changeset_new(soa_from->owner);
+	ch->soa_from = knot_rrset_copy(soa_from, NULL);
+	ch->soa_to = knot_rrset_copy(soa_from, NULL);
+	knot_soa_serial_set(&ch->soa_to->rrs, knot_soa_serial(&soa_from->rrs) + 1);
+	parse_records(ch, rem, changeset_rem_rrset);
+	parse_records(ch, add, changeset_add_rrset);
+
+	return ch;
+}
+
+/* Comparison of the adjusted zones. */
+
+static bool same_owner(const zone_node_t *a, const zone_node_t *b)
+{
+	if (a == NULL || b == NULL) {
+		return a == b;
+	}
+	return knot_dname_is_equal(a->owner, b->owner);
+}
+
+typedef struct {
+	zone_tree_t *other;
+	bool equal;
+} compare_ctx_t;
+
+static int compare_node(zone_node_t **tnode, void *data)
+{
+	compare_ctx_t *ctx = data;
+	zone_node_t *node = *tnode, *other = NULL;
+	zone_tree_get(ctx->other, node->owner, &other);
+	if (other == NULL || node->flags != other->flags ||
+	    !same_owner(node->prev, other->prev) ||
+	    !same_owner(node->nsec3_node, other->nsec3_node) ||
+	    node->rrset_count != other->rrset_count) {
+		ctx->equal = false;
+		return KNOT_EOK;
+	}
+
+	for (uint16_t i = 0; i < node->rrset_count; i++) {
+		zone_node_t **add = node->rrs[i].additional;
+		zone_node_t **other_add = other->rrs[i].additional;
+		if (add == NULL || other_add == NULL) {
+			ctx->equal = ctx->equal && add == other_add;
+			continue;
+		}
+		for (uint16_t j = 0; j < node->rrs[i].rrs.rr_count; j++) {
+			ctx->equal = ctx->equal && same_owner(add[j], other_add[j]);
+		}
+	}
+
+	return KNOT_EOK;
+}
+
+static bool trees_equal(zone_tree_t *a, zone_tree_t *b)
+{
+	compare_ctx_t ctx = { b, zone_tree_weight(a) == zone_tree_weight(b) };
+	zone_tree_apply(a, compare_node, &ctx);
+	return ctx.equal;
+}
+
+static bool indexes_equal(hattrie_t *a, hattrie_t *b)
+{
+	if (a == NULL || b == NULL || hattrie_weight(a) != hattrie_weight(b)) {
+		return false;
+	}
+
+	hattrie_build_index(a);
+	hattrie_build_index(b);
+
+	bool equal = true;
+	hattrie_iter_t *it_a = hattrie_iter_begin(a, true);
+	hattrie_iter_t *it_b = hattrie_iter_begin(b, true);
+	while (equal && !hattrie_iter_finished(it_a)) {
+		size_t len_a = 0, len_b = 0;
+		const char *key_a = hattrie_iter_key(it_a, &len_a);
+		const char *key_b = hattrie_iter_key(it_b, &len_b);
+		equal = len_a == len_b && memcmp(key_a, key_b, len_a) == 0;
+		hattrie_iter_next(it_a);
+		hattrie_iter_next(it_b);
+	}
+	hattrie_iter_free(it_a);
+	hattrie_iter_free(it_b);
+
+	return equal;
+}
+
+/*! \brief Compares the updated zone with its copy adjusted in full. */
+static bool adjusted_in_full(zone_contents_t *zone)
+{
+	zone_contents_t *full = NULL;
+	if (zone_contents_shallow_copy(zone, &full) != KNOT_EOK ||
+	    zone_contents_adjust_full(full, NULL, NULL) != KNOT_EOK) {
+		return false;
+	}
+
+	bool equal = trees_equal(zone->nodes, full->nodes) &&
+	             trees_equal(zone->nsec3_nodes, full->nsec3_nodes) &&
+	             indexes_equal(zone->referrers, full->referrers);
+	update_free_zone(&full);
+
+	return equal;
+}
+
+static knot_rrset_t apex_soa(const zone_t *zone)
+{
+	return node_rrset(zone->contents->apex, KNOT_RRTYPE_SOA);
+}
+
+static const struct knot_rrset_image *rrset_image(const zone_contents_t *zone,
+                                                  const char *name)
+{
+	knot_dname_t *owner = knot_dname_from_str_alloc(name);
+	const zone_node_t *node = zone_contents_find_node(zone, owner);
+	knot_dname_free(&owner, NULL);
+	for (uint16_t i = 0; node != NULL && i < node->rrset_count; i++) {
+		if (node->rrs[i].type == KNOT_RRTYPE_A) {
+			return node->rrs[i].image;
+		}
+	}
+
+	return NULL;
+}
+
+static void test_images(zone_t *zone)
+{
+	zone_contents_build_images(zone->contents);
+	const struct knot_rrset_image *image = rrset_image(zone->contents, "host2."ZONE);
+
+	knot_rrset_t soa = apex_soa(zone);
+	changeset_t *ch = new_changeset(&soa, "host1 A 192.0.2.11\n",
+	                                "host1 A 192.0.2.98\n");
+	zone_contents_t *new_contents = NULL;
+	int ret = apply_changeset(zone, ch, &new_contents);
+	ok(ret == KNOT_EOK && image != NULL &&
+	   rrset_image(new_contents, "host2."ZONE) == image &&
+	   rrset_image(new_contents, "host1."ZONE) == NULL,
+	   "apply: wire images of unchanged RRSets shared");
+	if (ret == KNOT_EOK) {
+		zone_contents_build_images(new_contents);
+		ok(rrset_image(new_contents, "host1."ZONE) != NULL &&
+		   rrset_image(new_contents, "host2."ZONE) == image,
+		   "apply: wire images of changed RRSets created");
+
+		zone_contents_t *old_contents = zone->contents;
+		zone->contents = new_contents;
+		update_free_zone(&old_contents);
+		update_cleanup(ch);
+	}
+	changeset_free(ch);
+}
+
+/*! \brief Applies the changesets and checks the result. */
+static void test_apply(zone_t *zone, list_t *chsets, const char *msg)
+{
+	zone_contents_t *new_contents = NULL;
+	int ret = apply_changesets(zone, chsets, &new_contents);
+	ok(ret == KNOT_EOK && adjusted_in_full(new_contents),
+	   "apply: %s", msg);
+	if (ret == KNOT_EOK) {
+		zone_contents_t *old_contents = zone->contents;
+		zone->contents = new_contents;
+		update_free_zone(&old_contents);
+		updates_cleanup(chsets);
+	}
+	changesets_free(chsets);
+}
+
+static void test_change(zone_t *zone, const char *rem, const char *add,
+                        const char *msg)
+{
+	knot_rrset_t soa = apex_soa(zone);
+	changeset_t *ch = new_changeset(&soa, rem, add);
+
+	list_t chsets;
+	init_list(&chsets);
+	add_tail(&chsets, &ch->n);
+	test_apply(zone, &chsets, msg);
+}
+
+static void test_nsec3_change(zone_t *zone, const char *rem, const char *add,
+                              const char **names, bool remove, const char *msg)
+{
+	char *nsec3 = nsec3_records(zone->contents, names);
+	char *records = malloc(strlen(remove ? rem : add) + strlen(nsec3) + 1);
+	sprintf(records, "%s%s", remove ? rem : add, nsec3);
+	test_change(zone, remove ? records : rem, remove ? add : records, msg);
+	free(records);
+	free(nsec3);
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	int ret = test_conf("zone:\n  - domain: "ZONE"\n", NULL);
+	ok(ret == KNOT_EOK, "apply: prepare configuration");
+
+	char *path = write_zone();
+	knot_dname_t *origin = knot_dname_from_str_alloc(ZONE);
+	zone_t *zone = zone_new(origin);
+	zloader_t loader;
+	if (path != NULL && zonefile_open(&loader, path, origin, false) == KNOT_EOK) {
+		zone->contents = zonefile_load(&loader);
+		zonefile_close(&loader);
+	}
+	ok(zone->contents != NULL, "apply: load zone");
+	if (zone->contents == NULL) {
+		goto cleanup;
+	}
+
+	/* NSEC3 chain for all names, large enough for a full adjust. */
+	const char *all[104] = { ZONE, "ns."ZONE, "mail."ZONE };
+	char names[100][16];
+	for (int i = 0; i < 100; i++) {
+		sprintf(names[i], "host%d."ZONE, i);
+		all[i + 3] = names[i];
+	}
+	test_nsec3_change(zone, "", "", all, false, "NSEC3 chain added");
+
+	test_nsec3_change(zone, "", "new A 192.0.2.200\n",
+	                  (const char *[]){ "new."ZONE, NULL }, false,
+	                  "node added, additional referrer");
+	test_nsec3_change(zone, "host5 A 192.0.2.15\nhost5 MX 10 host6\n", "",
+	                  (const char *[]){ "host5."ZONE, NULL }, true,
+	                  "node removed, additional referrer");
+	test_nsec3_change(zone, "", "*.wild A 192.0.2.201\n",
+	                  (const char *[]){ "wild."ZONE, "*.wild."ZONE, NULL },
+	                  false, "wildcard added");
+	test_nsec3_change(zone, "*.wild A 192.0.2.201\n", "",
+	                  (const char *[]){ "wild."ZONE, "*.wild."ZONE, NULL },
+	                  true, "wildcard removed");
+	test_nsec3_change(zone, "", "deleg NS ns.deleg\nns.deleg A 192.0.2.202\n",
+	                  (const char *[]){ "deleg."ZONE, NULL }, false,
+	                  "opt-out delegation with glue added");
+	test_change(zone, "host7 A 192.0.2.17\n", "host7 A 192.0.2.99\n",
+	            "node modified");
+	test_change(zone, "", "a.b.ent A 192.0.2.203\n", "empty non-terminals added");
+	test_change(zone, "a.b.ent A 192.0.2.203\n", "", "empty non-terminals removed");
+	test_change(zone, "deleg NS ns.deleg\n", "", "delegation with glue removed");
+	test_change(zone, "", "host50 MX 20 later\n", "referrer of a missing name added");
+	test_change(zone, "", "later A 192.0.2.204\n", "name of an indexed referrer added");
+	test_change(zone, "host50 MX 20 later\n", "", "indexed referrer removed");
+	test_change(zone, "later A 192.0.2.204\n", "", "name of a removed referrer removed");
+
+	test_images(zone);
+
+	/* Node emptied by the first changeset and filled by the second one. */
+	knot_rrset_t soa = apex_soa(zone);
+	changeset_t *ch1 = new_changeset(&soa, "host9 A 192.0.2.19\nhost9 MX 10 host10\n", "");
+	changeset_t *ch2 = new_changeset(ch1->soa_to, "", "host9 A 192.0.2.99\n");
+	list_t chsets;
+	init_list(&chsets);
+	add_tail(&chsets, &ch1->n);
+	add_tail(&chsets, &ch2->n);
+	test_apply(zone, &chsets, "node removed and added again");
+
+cleanup:
+	zone_free(&zone);
+	knot_dname_free(&origin, NULL);
+	if (path != NULL) {
+		unlink(path);
+	}
+	free(path);
+	conf_free(conf(), false);
+
+	return 0;
+}
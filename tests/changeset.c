@@ -22,7 +22,7 @@
 
 int main(int argc, char *argv[])
 {
-	plan(23);
+	plan(25);
 
 	// Test with NULL changeset
 	ok(changeset_size(NULL) == 0, "changeset: NULL size");
@@ -138,6 +138,43 @@ int main(int argc, char *argv[])
 	ret = changeset_merge(ch, ch2);
 	ok(ret == KNOT_EOK && changeset_size(ch) == 6, "changeset: merge");
 
+	// Test merge cancelling out changes of the first changeset.
+	d = knot_dname_from_str_alloc("test.");
+	assert(d);
+	changeset_t *ch3 = changeset_new(d);
+	assert(ch3);
+	knot_dname_free(&d, NULL);
+	d = knot_dname_from_str_alloc("non.terminals.test.");
+	assert(d);
+	knot_rrset_t *readd_rr = knot_rrset_new(d, KNOT_RRTYPE_TXT, KNOT_CLASS_IN, NULL);
+	assert(readd_rr);
+	knot_rrset_add_rdata(readd_rr, data, sizeof(data), 3600, NULL);
+	ret = changeset_rem_rrset(ch3, other_rr);
+	assert(ret == KNOT_EOK);
+	ret = changeset_add_rrset(ch3, readd_rr);
+	assert(ret == KNOT_EOK);
+	ret = changeset_merge(ch, ch3);
+	ok(ret == KNOT_EOK && changeset_size(ch) == 4, "changeset: merge cancel out");
+	changeset_free(ch3);
+
+	// Re-added RR with different TTL doesn't cancel the removal.
+	knot_dname_free(&d, NULL);
+	d = knot_dname_from_str_alloc("test.");
+	assert(d);
+	ch3 = changeset_new(d);
+	assert(ch3);
+	knot_rrset_free(&readd_rr, NULL);
+	readd_rr = knot_rrset_new(apex_txt_rr->owner, KNOT_RRTYPE_TXT, KNOT_CLASS_IN, NULL);
+	assert(readd_rr);
+	knot_rrset_add_rdata(readd_rr, data, sizeof(data), 7200, NULL);
+	ret = changeset_add_rrset(ch3, readd_rr);
+	assert(ret == KNOT_EOK);
+	ret = changeset_merge(ch, ch3);
+	ok(ret == KNOT_EOK && changeset_size(ch) == 5, "changeset: merge TTL change");
+	changeset_free(ch3);
+	knot_rrset_free(&readd_rr, NULL);
+	knot_dname_free(&d, NULL);
+
 	// Test cleanup.
 	changeset_clear(ch);
 	ok(changeset_empty(ch), "changeset: clear");
@@ -83,11 +83,42 @@ static void test_conf_zonefile(void)
 	knot_dname_free(&zone3, NULL);
 }
 
+static void test_conf_cache(void)
+{
+	const char *conf_str =
+		"server:\n"
+		"  max-udp-payload: 1232\n"
+		"  rate-limit-slip: 2\n"
+		"  tcp-workers: 4\n"
+		"  nsid: \"ns1\"\n";
+
+	conf_t *conf;
+	int ret = conf_new(&conf, conf_scheme, NULL);
+	ok(ret == KNOT_EOK, "Create configuration");
+	ret = conf_import(conf, conf_str, false);
+	ok(ret == KNOT_EOK, "Import configuration");
+	ret = conf_post_open(conf);
+	ok(ret == KNOT_EOK, "Post-open configuration");
+
+	ok(conf->cache.srv_max_udp_payload == 1232 &&
+	   conf->cache.srv_rate_limit_slip == 2 &&
+	   conf->cache.srv_tcp_threads == 4,
+	   "Cached server values");
+	ok(conf->cache.srv_tcp_idle_timeout == 20,
+	   "Cached default value");
+	ok(conf->cache.srv_nsid_len == 3 &&
+	   memcmp(conf->cache.srv_nsid_data, "ns1", 3) == 0,
+	   "Cached NSID value");
+
+	conf_free(conf, false);
+}
+
 int main(int argc, char *argv[])
 {
 	plan_lazy();
 
 	test_conf_zonefile();
+	test_conf_cache();
 
 	return 0;
 }
@@ -0,0 +1,379 @@
+/*  Copyright (C) 2015 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <dirent.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <tap/basic.h>
+
+#include "test_conf.h"
+#include "knot/common/evsched.h"
+#include "knot/nameserver/process_query.h"
+#include "knot/nameserver/update.h"
+#include "knot/server/journal.h"
+#include "knot/worker/pool.h"
+#include "knot/zone/events/events.h"
+#include "knot/zone/zone.h"
+#include "knot/zone/zonefile.h"
+#include "libknot/internal/mem.h"
+#include "libknot/internal/net.h"
+#include "libknot/internal/sockaddr.h"
+#include "libknot/libknot.h"
+
+#define ZONE	"example."
+#define DELAY	2
+#define BATCH	3
+#define CLIENTS	6
+
+static const char *ddns_conf =
+	"acl:\n"
+	"  - id: update\n"
+	"    address: [ 127.0.0.1 ]\n"
+	"    action: [ update ]\n"
+	"\n"
+	"zone:\n"
+	"  - domain: "ZONE"\n"
+	"    acl: [ update ]\n"
+	"    zonefile-sync: -1\n"
+	"    ddns-delay: 2\n"
+	"    ddns-batch-size: 3\n";
+
+/*! \brief Writes a minimal zone file into the temporary directory. */
+static char *write_zone(const char *dir)
+{
+	char *path = sprintf_alloc("%s/ddns.zone", dir);
+	FILE *f = fopen(path, "w");
+	if (f == NULL) {
+		free(path);
+		return NULL;
+	}
+
+	fputs("$TTL 600\n"
+	      "@ SOA ns admin 1 3600 900 604800 300\n"
+	      "@ NS ns\n"
+	      "ns A 192.0.2.1\n", f);
+	fclose(f);
+
+	return path;
+}
+
+/*! \brief Remove the temporary directory with the journal. */
+static void remove_dir(const char *dir, const char *zone_path)
+{
+	char *journal_dir = sprintf_alloc("%s/journal", dir);
+	DIR *d = opendir(journal_dir);
+	struct dirent *dp;
+	while (d != NULL && (dp = readdir(d)) != NULL) {
+		if (dp->d_name[0] == '.') {
+			continue;
+		}
+		char *file = sprintf_alloc("%s/%s", journal_dir, dp->d_name);
+		remove(file);
+		free(file);
+	}
+	if (d != NULL) {
+		closedir(d);
+	}
+	remove(journal_dir);
+	free(journal_dir);
+	if (zone_path != NULL) {
+		remove(zone_path);
+	}
+	remove(dir);
+}
+
+/*! \brief Creates an UPDATE adding 'hostN A 192.0.2.N' with message ID N. */
+static knot_pkt_t *update_new(uint16_t id)
+{
+	knot_pkt_t *pkt = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, NULL);
+	if (pkt == NULL) {
+		return NULL;
+	}
+
+	knot_dname_t *apex = knot_dname_from_str_alloc(ZONE);
+	char owner_str[32];
+	snprintf(owner_str, sizeof(owner_str), "host%u."ZONE, id);
+	knot_dname_t *owner = knot_dname_from_str_alloc(owner_str);
+
+	knot_wire_set_id(pkt->wire, id);
+	knot_wire_set_opcode(pkt->wire, KNOT_OPCODE_UPDATE);
+	int ret = knot_pkt_put_question(pkt, apex, KNOT_CLASS_IN, KNOT_RRTYPE_SOA);
+	if (ret == KNOT_EOK) {
+		ret = knot_pkt_begin(pkt, KNOT_AUTHORITY);
+	}
+
+	/* Owner and RDATA are freed with the packet. */
+	knot_rrset_t rr;
+	knot_rrset_init(&rr, owner, KNOT_RRTYPE_A, KNOT_CLASS_IN);
+	const uint8_t addr[4] = { 192, 0, 2, id };
+	if (ret == KNOT_EOK) {
+		ret = knot_rrset_add_rdata(&rr, addr, sizeof(addr), 600, NULL);
+	}
+	if (ret == KNOT_EOK) {
+		ret = knot_pkt_put(pkt, 0, &rr, KNOT_PF_FREE);
+	}
+
+	knot_dname_free(&apex, NULL);
+	if (ret != KNOT_EOK) {
+		knot_rrset_clear(&rr, NULL);
+		knot_pkt_free(&pkt);
+	}
+
+	return pkt;
+}
+
+/*! \brief Enqueues UPDATE with message ID 'id' from the client socket. */
+static int enqueue(zone_t *zone, int fd, uint16_t id)
+{
+	knot_pkt_t *query = update_new(id);
+	if (query == NULL) {
+		return KNOT_ENOMEM;
+	}
+
+	struct sockaddr_storage remote;
+	sockaddr_set(&remote, AF_INET, "127.0.0.1", 53);
+
+	struct process_query_param param = { 0 };
+	param.socket = fd;
+	param.remote = &remote;
+
+	int ret = zone_update_enqueue(zone, query, &param);
+	knot_pkt_free(&query);
+
+	return ret;
+}
+
+/*! \brief Checks if the client received a successful answer to the UPDATE. */
+static bool answered(int fd, uint16_t id, int timeout_ms)
+{
+	struct pollfd pfd = { .fd = fd, .events = POLLIN };
+	if (poll(&pfd, 1, timeout_ms) != 1) {
+		return false;
+	}
+
+	uint8_t buf[KNOT_WIRE_MAX_PKTSIZE];
+	struct timeval tv = { 1, 0 };
+	int len = tcp_recv_msg(fd, buf, sizeof(buf), &tv);
+
+	return len >= KNOT_WIRE_HEADER_SIZE && knot_wire_get_id(buf) == id &&
+	       knot_wire_get_qr(buf) &&
+	       knot_wire_get_rcode(buf) == KNOT_RCODE_NOERROR;
+}
+
+static bool has_host(const zone_t *zone, uint16_t id)
+{
+	char owner_str[32];
+	snprintf(owner_str, sizeof(owner_str), "host%u."ZONE, id);
+	knot_dname_t *owner = knot_dname_from_str_alloc(owner_str);
+	const zone_node_t *node = zone_contents_find_node(zone->contents, owner);
+	knot_dname_free(&owner, NULL);
+
+	return node != NULL && node_rdataset(node, KNOT_RRTYPE_A) != NULL;
+}
+
+/*! \brief Queued updates are coalesced and applied in batches. */
+static void test_batch(zone_t *zone, int clients[][2])
+{
+	/* Events aren't set up, the scheduled times are only recorded. */
+	time_t start = time(NULL);
+	ok(enqueue(zone, clients[1][0], 1) == KNOT_EOK, "ddns: enqueue first update");
+	time_t planned = zone_events_get_time(zone, ZONE_EVENT_UPDATE);
+	ok(planned >= start + DELAY && planned <= time(NULL) + DELAY,
+	   "ddns: first update waits for the delay");
+
+	/* Later updates join the batch without postponing it. */
+	sleep(1);
+	ok(enqueue(zone, clients[2][0], 2) == KNOT_EOK &&
+	   zone_events_get_time(zone, ZONE_EVENT_UPDATE) == planned,
+	   "ddns: later update doesn't postpone the batch");
+
+	/* Full batch is processed immediately. */
+	ok(enqueue(zone, clients[3][0], 3) == KNOT_EOK &&
+	   zone_events_get_time(zone, ZONE_EVENT_UPDATE) <= time(NULL),
+	   "ddns: full batch planned immediately");
+
+	/* Updates over the batch size wait for the next round. */
+	ok(enqueue(zone, clients[4][0], 4) == KNOT_EOK &&
+	   enqueue(zone, clients[5][0], 5) == KNOT_EOK &&
+	   zone->ddns_queue_size == 5, "ddns: updates over batch size queued");
+
+	const uint32_t serial = zone_contents_serial(zone->contents);
+	ok(updates_execute(zone) == KNOT_EOK, "ddns: execute first batch");
+	ok(zone_contents_serial(zone->contents) == serial + 1 &&
+	   has_host(zone, 1) && has_host(zone, 2) && has_host(zone, 3) &&
+	   !has_host(zone, 4) && !has_host(zone, 5),
+	   "ddns: first batch applied with a single serial increment");
+	ok(answered(clients[1][1], 1, 0) && answered(clients[2][1], 2, 0) &&
+	   answered(clients[3][1], 3, 0) && !answered(clients[4][1], 4, 0) &&
+	   !answered(clients[5][1], 5, 0), "ddns: first batch answered");
+	ok(zone->ddns_queue_size == 2, "ddns: rest of the updates still queued");
+
+	list_t changes;
+	init_list(&changes);
+	int ret = journal_load_changesets(zone->journal_db, zone->name, &changes,
+	                                  serial, serial + 1);
+	ok(ret == KNOT_EOK && list_size(&changes) == 1,
+	   "ddns: first batch stored as one changeset");
+	changesets_free(&changes);
+
+	ok(updates_execute(zone) == KNOT_EOK, "ddns: execute second batch");
+	ok(zone_contents_serial(zone->contents) == serial + 2 &&
+	   has_host(zone, 4) && has_host(zone, 5) &&
+	   answered(clients[4][1], 4, 0) && answered(clients[5][1], 5, 0) &&
+	   zone->ddns_queue_size == 0, "ddns: second batch applied and answered");
+}
+
+/*! \brief Event scheduler loop, terminated by an event without callback. */
+static void *sched_run(void *data)
+{
+	evsched_t *sched = data;
+
+	event_t *ev = NULL;
+	while ((ev = evsched_begin_process(sched)) != NULL) {
+		if (ev->cb == NULL) {
+			evsched_end_process(sched);
+			evsched_event_free(ev);
+			break;
+		}
+		ev->cb(ev);
+		evsched_end_process(sched);
+	}
+
+	return NULL;
+}
+
+/*! \brief The update event respects the coalescing delay. */
+static void test_delay(zone_t *zone, int clients[][2], evsched_t *sched,
+                       worker_pool_t *pool)
+{
+	/* Drop events planned by the previous updates. */
+	for (int i = 0; i < ZONE_EVENT_COUNT; i++) {
+		zone_events_cancel(zone, i);
+	}
+
+	pthread_t thread;
+	int ret = zone_events_setup(zone, pool, sched, NULL);
+	if (ret != KNOT_EOK || pthread_create(&thread, NULL, sched_run, sched) != 0) {
+		skip_block(3, "failed to set up zone events");
+		return;
+	}
+	worker_pool_start(pool);
+
+	const uint32_t serial = zone_contents_serial(zone->contents);
+	ok(enqueue(zone, clients[0][0], 6) == KNOT_EOK, "ddns: enqueue delayed update");
+	ok(!answered(clients[0][1], 6, 900), "ddns: update not applied before the delay");
+	ok(answered(clients[0][1], 6, (DELAY + 2) * 1000) &&
+	   zone_contents_serial(zone->contents) == serial + 1 && has_host(zone, 6),
+	   "ddns: update applied after the delay");
+
+	/* Stop processing events before the zone is freed. */
+	zone_events_freeze(zone);
+	event_t *term = evsched_event_create(sched, NULL, NULL);
+	evsched_schedule(term, 0);
+	pthread_join(thread, NULL);
+	worker_pool_stop(pool);
+	worker_pool_join(pool);
+}
+
+static void interrupt_handle(int s)
+{
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	struct sigaction sa;
+	sa.sa_handler = interrupt_handle;
+	sigemptyset(&sa.sa_mask);
+	sa.sa_flags = 0;
+	sigaction(SIGALRM, &sa, NULL); // Interrupt
+
+	int ret = test_conf(ddns_conf, NULL);
+	ok(ret == KNOT_EOK, "ddns: prepare configuration");
+
+	char *tmpdir = test_tmpdir();
+	char *dir = sprintf_alloc("%s/ddns.XXXXXX", tmpdir);
+	free(tmpdir);
+	ok(mkdtemp(dir) != NULL, "ddns: create temporary directory");
+
+	char *path = write_zone(dir);
+	knot_dname_t *origin = knot_dname_from_str_alloc(ZONE);
+	zone_t *zone = zone_new(origin);
+	zloader_t loader;
+	if (path != NULL && zonefile_open(&loader, path, origin, false) == KNOT_EOK) {
+		zone->contents = zonefile_load(&loader);
+		zonefile_close(&loader);
+	}
+	ret = journal_db_open(dir, 16 * 1024 * 1024, &zone->journal_db);
+	ok(zone->contents != NULL && ret == KNOT_EOK, "ddns: load zone");
+	if (zone->contents == NULL || ret != KNOT_EOK) {
+		goto cleanup;
+	}
+
+	/* Zone options as cached by the zone database load. */
+	conf_val_t val = conf_zone_get(conf(), C_DDNS_DELAY, zone->name);
+	zone->cache.ddns_delay = conf_int(&val);
+	val = conf_zone_get(conf(), C_DDNS_BATCH_SIZE, zone->name);
+	zone->cache.ddns_batch_size = conf_int(&val);
+	ok(zone->cache.ddns_delay == DELAY && zone->cache.ddns_batch_size == BATCH,
+	   "ddns: zone options");
+
+	evsched_t sched;
+	evsched_init(&sched, NULL);
+	worker_pool_t *pool = worker_pool_create(1);
+	assert(pool);
+
+	int clients[CLIENTS][2];
+	for (int i = 0; i < CLIENTS; i++) {
+		ret = socketpair(AF_UNIX, SOCK_STREAM, 0, clients[i]);
+		assert(ret == 0);
+	}
+
+	test_batch(zone, clients);
+	test_delay(zone, clients, &sched, pool);
+
+	for (int i = 0; i < CLIENTS; i++) {
+		close(clients[i][0]);
+		close(clients[i][1]);
+	}
+
+	/* Zone events are bound to the scheduler, free the zone first. */
+	journal_db_close(zone->journal_db);
+	zone_free(&zone);
+	worker_pool_destroy(pool);
+	evsched_deinit(&sched);
+
+cleanup:
+	if (zone != NULL) {
+		journal_db_close(zone->journal_db);
+		zone_free(&zone);
+	}
+	knot_dname_free(&origin, NULL);
+	remove_dir(dir, path);
+	free(path);
+	free(dir);
+	conf_free(conf(), false);
+
+	return 0;
+}
@@ -15,9 +15,13 @@
  */
 
 #include <stdlib.h>
+#include <time.h>
 #include <tap/basic.h>
 
 #include "libknot/dname.h"
+#include "libknot/internal/tolower.h"
+
+#define BENCH_ROUNDS 200000
 
 /* Test dname_parse_from_wire */
 static int test_fw(size_t l, const char *w) {
@@ -102,6 +106,109 @@ static void test_str(const char *in_str, const char *in_bin, size_t bin_len) {
 	free(s2);
 }
 
+/* Test case conversion of all characters, unaligned and with tails. */
+static void test_case(void)
+{
+	uint8_t src[2 * UINT8_MAX + 2], dst[sizeof(src)], ref[sizeof(src)];
+	for (size_t i = 0; i < sizeof(src); ++i) {
+		src[i] = i;
+		ref[i] = knot_tolower(i);
+	}
+
+	bool lower_ok = true, caseeq_ok = true;
+	for (size_t off = 0; off < 16; ++off) {
+		for (size_t len = 0; len + off <= sizeof(src); len += 7) {
+			memset(dst, 0xAA, sizeof(dst));
+			knot_memtolower(dst + off, src + off, len);
+			lower_ok &= memcmp(dst + off, ref + off, len) == 0 &&
+			            (off == 0 || dst[off - 1] == 0xAA) &&
+			            (off + len == sizeof(dst) || dst[off + len] == 0xAA);
+			caseeq_ok &= knot_memcaseeq(src + off, ref + off, len);
+			if (len > 0) {
+				dst[off + len - 1] ^= 0x01;
+				caseeq_ok &= !knot_memcaseeq(dst + off, ref + off, len);
+			}
+		}
+	}
+	ok(lower_ok, "memtolower: all characters");
+	ok(caseeq_ok, "memcaseeq: all characters");
+
+	knot_dname_t *d = knot_dname_from_str_alloc("WwW.Example.CoM.");
+	knot_dname_t *d2 = knot_dname_from_str_alloc("www.example.com.");
+	ok(knot_dname_cmp(d, d2) == 0, "dname_cmp: case insensitive");
+	ok(!knot_dname_is_equal(d, d2), "dname_is_equal: case sensitive");
+	knot_dname_to_lower(d);
+	ok(knot_dname_is_equal(d, d2), "dname_to_lower: converted");
+
+	uint8_t lf[KNOT_DNAME_MAXLEN];
+	d[1] = 'W';
+	knot_dname_lf(lf, d, NULL);
+	ok(memcmp(lf, "\x10" "com\0example\0www\0", lf[0] + 1) == 0,
+	   "dname_lf: lowercase lookup format");
+
+	knot_dname_free(&d, NULL);
+	knot_dname_free(&d2, NULL);
+}
+
+static double bench_elapsed(const struct timespec *begin)
+{
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	return (end.tv_sec - begin->tv_sec) * 1e3 +
+	       (end.tv_nsec - begin->tv_nsec) / 1e6;
+}
+
+/* Microbenchmark of the primitives used on every lookup. */
+static void bench(void)
+{
+	const char *names[] = {
+		"www.example.com.", "A.ROOT-SERVERS.NET.", "_sip._tcp.Example.Org.",
+		"very-long-label-with-many-characters.subdomain.example.co.uk."
+	};
+	const size_t count = sizeof(names) / sizeof(names[0]);
+
+	knot_dname_t *dnames[count];
+	for (size_t i = 0; i < count; ++i) {
+		dnames[i] = knot_dname_from_str_alloc(names[i]);
+	}
+
+	uint8_t buf[KNOT_DNAME_MAXLEN];
+	volatile int sink = 0;
+	struct timespec begin;
+
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	for (unsigned r = 0; r < BENCH_ROUNDS; ++r) {
+		const knot_dname_t *d = dnames[r % count];
+		memcpy(buf, d, knot_dname_size(d));
+		sink += knot_dname_to_lower(buf);
+	}
+	diag("bench: dname_to_lower %.1f ms", bench_elapsed(&begin));
+
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	for (unsigned r = 0; r < BENCH_ROUNDS; ++r) {
+		sink += knot_dname_lf(buf, dnames[r % count], NULL);
+	}
+	diag("bench: dname_lf %.1f ms", bench_elapsed(&begin));
+
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	for (unsigned r = 0; r < BENCH_ROUNDS; ++r) {
+		sink += knot_dname_cmp(dnames[r % count], dnames[(r + 1) % count]);
+	}
+	diag("bench: dname_cmp %.1f ms", bench_elapsed(&begin));
+
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	for (unsigned r = 0; r < BENCH_ROUNDS; ++r) {
+		const knot_dname_t *d = dnames[r % count];
+		sink += knot_dname_is_equal(d, d);
+	}
+	diag("bench: dname_is_equal %.1f ms", bench_elapsed(&begin));
+
+	(void)sink;
+	for (size_t i = 0; i < count; ++i) {
+		knot_dname_free(&dnames[i], NULL);
+	}
+}
+
 int main(int argc, char *argv[])
 {
 	plan_lazy();
@@ -542,5 +649,10 @@ int main(int argc, char *argv[])
 
 	knot_dname_free(&d, NULL);
 
+	/* DNAME CASE CONVERSION */
+
+	test_case();
+	bench();
+
 	return 0;
 }
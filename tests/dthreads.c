@@ -50,6 +50,70 @@ int runnable(struct dthread *thread)
 	return 0;
 }
 
+/* Affinity data. */
+static volatile int _affinity_ok = 0;
+static unsigned _affinity_cpu = 0;
+
+/*! \brief Pick a CPU the process is allowed to run on. */
+static unsigned affinity_cpu(void)
+{
+#if defined(HAVE_PTHREAD_SETAFFINITY_NP) && defined(HAVE_CPUSET_LINUX)
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+		for (unsigned i = 0; i < CPU_SETSIZE; ++i) {
+			if (CPU_ISSET(i, &set)) {
+				return i;
+			}
+		}
+	}
+#endif
+	return 0;
+}
+
+/*! \brief Check that the CPU topology follows the process affinity. */
+static bool topology_allowed(void)
+{
+#if defined(__linux__) && defined(HAVE_CPUSET_LINUX)
+	cpu_set_t orig, set;
+	if (sched_getaffinity(0, sizeof(orig), &orig) != 0) {
+		return false;
+	}
+
+	/* Restricted to a single CPU like with taskset. */
+	unsigned cpu = affinity_cpu();
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+		return false;
+	}
+	unsigned cpus[1024];
+	size_t count = dt_cpu_topology(cpus, 1024, -1);
+	sched_setaffinity(0, sizeof(orig), &orig);
+
+	/* Empty if the topology is unavailable, no pinning then. */
+	return count == 0 || (count == 1 && cpus[0] == cpu);
+#else
+	return true;
+#endif
+}
+
+/*! \brief Check that the thread is placed on the selected CPU only. */
+int affinity_check(struct dthread *thread)
+{
+#if defined(HAVE_PTHREAD_SETAFFINITY_NP) && defined(HAVE_CPUSET_LINUX)
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) == 0 &&
+	    CPU_COUNT(&set) == 1 && CPU_ISSET(_affinity_cpu, &set)) {
+		_affinity_ok = 1;
+	}
+#else
+	_affinity_ok = 1;
+#endif
+	return 0;
+}
+
 /* Destructor data. */
 static volatile int _destructor_data = 0;
 static pthread_mutex_t _destructor_mx;
@@ -72,7 +136,7 @@ static void interrupt_handle(int s)
 /*! API: run tests. */
 int main(int argc, char *argv[])
 {
-	plan(8);
+	plan(11);
 
 	// Register service and signal handler
 	struct sigaction sa;
@@ -91,7 +155,7 @@ int main(int argc, char *argv[])
 	dt_unit_t *unit = dt_create(size, &runnable, NULL, NULL);
 	ok(unit != NULL, "dthreads: create unit (size %d)", size);
 	if (unit == NULL) {
-		skip_block(7, "No dthreads unit");
+		skip_block(10, "No dthreads unit");
 		goto skip_all;
 	}
 
@@ -138,6 +202,31 @@ int main(int argc, char *argv[])
 	is_int(2, _destructor_data, "dthreads: destructor with dt_create_coherent()");
 	dt_delete(&unit);
 
+	/* Test 9: CPU topology ordering. */
+	unsigned cpus[1024];
+	size_t count = dt_cpu_topology(cpus, 1024, -1);
+	bool unique = true;
+	for (size_t i = 0; i < count; ++i) {
+		for (size_t j = i + 1; j < count; ++j) {
+			unique = unique && (cpus[i] != cpus[j]);
+		}
+	}
+	ok(count <= (size_t)dt_online_cpus() && unique,
+	   "dthreads: CPU topology lists unique online CPUs");
+
+	/* Test 10: CPU topology limited to the allowed CPUs. */
+	ok(topology_allowed(), "dthreads: CPU topology lists allowed CPUs only");
+
+	/* Test 11: Unit placement applied before runnable. */
+	_affinity_cpu = affinity_cpu();
+	unsigned cpu = _affinity_cpu;
+	unit = dt_create(1, affinity_check, NULL, NULL);
+	dt_unit_setaffinity(unit, &cpu, 1, true);
+	dt_start(unit);
+	dt_join(unit);
+	ok(_affinity_ok, "dthreads: unit affinity");
+	dt_delete(&unit);
+
 skip_all:
 
 	pthread_mutex_destroy(&_runnable_mx);
@@ -15,11 +15,13 @@
  */
 
 #include <stdlib.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <sys/time.h>
 #include <pthread.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <sys/socket.h>
 #include <tap/basic.h>
 
 #include "knot/common/fdset.h"
@@ -80,9 +82,134 @@ void* thr_action(void *arg)
 	return NULL;
 }
 
+/*! \brief Socket pair with pending input on the first socket. */
+static void readable_pair(int fds[2])
+{
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0 ||
+	    write(fds[1], "x", 1) != 1) {
+		fds[0] = fds[1] = -1;
+	}
+}
+
+static void close_pair(int fds[2])
+{
+	close(fds[0]);
+	close(fds[1]);
+}
+
+static void test_set_events(void)
+{
+	fdset_t set;
+	fdset_init(&set, 4);
+
+	int fds[2];
+	ok(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0, "fdset: socketpair() works");
+	int i = fdset_add(&set, fds[0], POLLIN, NULL);
+
+	unsigned events = 0;
+	ok(fdset_wait(&set, 0) == 0 && fdset_next(&set, &events) < 0,
+	   "fdset: no input pending");
+
+	fdset_set_events(&set, i, POLLIN | POLLOUT);
+	ok(fdset_wait(&set, 0) == 1 && fdset_next(&set, &events) == i &&
+	   events == POLLOUT, "fdset: output delivered after watching it");
+
+	fdset_set_events(&set, i, POLLIN);
+	ok(write(fds[1], "x", 1) == 1 && fdset_wait(&set, 0) == 1 &&
+	   fdset_next(&set, &events) == i && events == POLLIN &&
+	   fdset_next(&set, &events) < 0,
+	   "fdset: only input delivered after unwatching output");
+
+	fdset_set_events(&set, i, 0);
+	ok(fdset_wait(&set, 0) == 0, "fdset: nothing delivered if not watched");
+
+	close_pair(fds);
+	fdset_clear(&set);
+}
+
+static void test_remove_next(void)
+{
+	fdset_t set;
+	fdset_init(&set, 4);
+
+	int fds[3][2];
+	for (intptr_t k = 0; k < 3; k++) {
+		readable_pair(fds[k]);
+		fdset_add(&set, fds[k][0], POLLIN, (void *)(k + 1));
+	}
+	ok(fdset_wait(&set, 0) == 3, "fdset: three descriptors ready");
+
+	/* Remove the current entry, the last one is moved to its index. */
+	unsigned events = 0;
+	int i = fdset_next(&set, &events);
+	void *current = (i >= 0) ? set.ctx[i] : NULL;
+	fdset_remove(&set, i);
+
+	/* Remove another entry with pending events. */
+	void *other = set.ctx[0];
+	fdset_remove(&set, 0);
+	void *rest = set.ctx[0];
+
+	int delivered = 0;
+	bool valid = true;
+	while ((i = fdset_next(&set, &events)) >= 0) {
+		delivered += 1;
+		valid = valid && set.ctx[i] == rest && events == POLLIN;
+	}
+	ok(current != NULL && current != other && current != rest &&
+	   other != rest && set.n == 1 && delivered == 1 && valid,
+	   "fdset: removed entries skipped, the remaining one delivered once");
+
+	for (int k = 0; k < 3; k++) {
+		close_pair(fds[k]);
+	}
+	fdset_clear(&set);
+}
+
+static enum fdset_sweep_state sweep_count(fdset_t *set, int i, void *data)
+{
+	int *swept = data;
+	*swept += 1;
+	return FDSET_SWEEP;
+}
+
+static void test_watchdog(void)
+{
+	fdset_t set;
+	fdset_init(&set, 4);
+
+	int fds[3][2];
+	for (int k = 0; k < 3; k++) {
+		readable_pair(fds[k]);
+		fdset_add(&set, fds[k][0], POLLIN, NULL);
+	}
+
+	/* Expired, running and no watchdog. */
+	fdset_set_watchdog(&set, 0, 0);
+	fdset_set_watchdog(&set, 1, 1);
+	fdset_set_watchdog(&set, 2, -1);
+
+	int swept = 0;
+	fdset_sweep(&set, sweep_count, &swept);
+	ok(swept == 1 && set.n == 2 && set.pfd[0].fd == fds[2][0],
+	   "fdset: only the expired watchdog swept");
+
+	/* Wait for the running watchdog to expire. */
+	sleep(2);
+	swept = 0;
+	fdset_sweep(&set, sweep_count, &swept);
+	ok(swept == 1 && set.n == 1 && set.pfd[0].fd == fds[2][0],
+	   "fdset: watchdog swept after expiration");
+
+	for (int k = 0; k < 3; k++) {
+		close_pair(fds[k]);
+	}
+	fdset_clear(&set);
+}
+
 int main(int argc, char *argv[])
 {
-	plan(12);
+	plan(21);
 
 	/* 1. Create fdset. */
 	fdset_t set;
@@ -149,5 +276,10 @@ int main(int argc, char *argv[])
 	/* Cleanup. */
 	pthread_join(t, 0);
 
+	/* 12. Watched events, removal during iteration, watchdog. */
+	test_set_events();
+	test_remove_next();
+	test_watchdog();
+
 	return 0;
 }
@@ -93,6 +93,105 @@ static bool str_key_find_leq(hattrie_t *trie, char **keys, size_t i, size_t size
 
 }
 
+/*! \brief Keys sharing prefixes, in the trie order. */
+static const char *prefix_keys[] = {
+	"a", "ab", "abc", "abd", "b", "ba", "bz"
+};
+
+#define PREFIX_KEY_COUNT (sizeof(prefix_keys) / sizeof(prefix_keys[0]))
+
+static value_t value_copy(value_t val)
+{
+	return val;
+}
+
+/*! \brief Check value found for the key, NULL expected value means none. */
+static bool check_found(int ret, value_t *val, const char *expected)
+{
+	if (expected == NULL) {
+		return ret == 1 && val == NULL;
+	}
+
+	return ret <= 0 && val != NULL && strcmp(*val, expected) == 0;
+}
+
+static void test_prefix_keys(void)
+{
+	hattrie_t *trie = hattrie_create();
+	for (unsigned i = 0; i < PREFIX_KEY_COUNT; ++i) {
+		value_t *val = hattrie_get(trie, prefix_keys[i], strlen(prefix_keys[i]));
+		*val = (void *)prefix_keys[i];
+	}
+	hattrie_build_index(trie);
+
+	/* Keys shorter than other keys come first. */
+	bool passed = true;
+	unsigned iterated = 0;
+	hattrie_iter_t *it = hattrie_iter_begin(trie, true);
+	for (; !hattrie_iter_finished(it) && passed; hattrie_iter_next(it)) {
+		size_t len = 0;
+		const char *key = hattrie_iter_key(it, &len);
+		passed = iterated < PREFIX_KEY_COUNT &&
+		         len == strlen(prefix_keys[iterated]) &&
+		         memcmp(key, prefix_keys[iterated], len) == 0;
+		iterated += 1;
+	}
+	hattrie_iter_free(it);
+	ok(passed && iterated == PREFIX_KEY_COUNT, "hattrie: prefix keys order");
+
+	/* Lookups of missing keys. */
+	struct {
+		const char *key;
+		const char *leq;
+		const char *next;
+	} lookups[] = {
+		{ "0",   NULL,  "a" },
+		{ "aa",  "a",   "ab" },
+		{ "ab",  "ab",  "abc" },
+		{ "abe", "abd", "b" },
+		{ "bb",  "ba",  "bz" },
+		{ "c",   "bz",  NULL },
+	};
+	passed = true;
+	for (unsigned i = 0; i < sizeof(lookups) / sizeof(lookups[0]); ++i) {
+		value_t *val = NULL;
+		const char *key = lookups[i].key;
+		int ret = hattrie_find_leq(trie, key, strlen(key), &val);
+		if (!check_found(ret, val, lookups[i].leq)) {
+			diag("hattrie: leq for '%s' ret = %d", key, ret);
+			passed = false;
+		}
+		ret = hattrie_find_next(trie, key, strlen(key), &val);
+		if (!check_found(ret, val, lookups[i].next)) {
+			diag("hattrie: next for '%s' ret = %d", key, ret);
+			passed = false;
+		}
+	}
+	ok(passed, "hattrie: prefix keys neighbours");
+
+	/* Delete a key in the middle of other keys. */
+	passed = hattrie_del(trie, "ab", 2) == 0 && hattrie_del(trie, "ab", 2) != 0 &&
+	         hattrie_tryget(trie, "ab", 2) == NULL &&
+	         hattrie_tryget(trie, "a", 1) != NULL &&
+	         hattrie_tryget(trie, "abc", 3) != NULL &&
+	         hattrie_weight(trie) == PREFIX_KEY_COUNT - 1;
+	ok(passed, "hattrie: prefix keys delete");
+	hattrie_build_index(trie);
+
+	/* Copy the trie. */
+	hattrie_t *copy = hattrie_dup(trie, value_copy);
+	value_t *val = hattrie_tryget(copy, "abd", 3);
+	passed = hattrie_weight(copy) == hattrie_weight(trie) &&
+	         val != NULL && *val == (void *)prefix_keys[3];
+	hattrie_free(copy);
+	copy = hattrie_dup(trie, NULL);
+	passed = passed && hattrie_weight(copy) == 0;
+	hattrie_free(copy);
+	ok(passed, "hattrie: prefix keys copy");
+
+	hattrie_free(trie);
+}
+
 /* UCW array sorting defines. */
 #define ASORT_PREFIX(X) str_key_##X
 #define ASORT_KEY_TYPE char*
@@ -101,7 +200,7 @@ static bool str_key_find_leq(hattrie_t *trie, char **keys, size_t i, size_t size
 
 int main(int argc, char *argv[])
 {
-	plan(8);
+	plan(12);
 
 	/* Random keys. */
 	srand(time(NULL));
@@ -176,7 +275,7 @@ int main(int argc, char *argv[])
 	passed = true;
 	for (unsigned i = 0; i < key_count - 1 && passed; ++i) {
 		value_t *val;
-		hattrie_find_next(trie, keys[i], strlen(keys[i]), &val);
+		hattrie_find_next(trie, keys[i], strlen(keys[i]) + 1, &val);
 		passed = val && *val == (void *)keys[(i + 1)];
 	}
 	ok(passed, "hattrie: find next for all keys");
@@ -217,5 +316,8 @@ int main(int argc, char *argv[])
 	}
 	free(keys);
 	hattrie_free(trie);
+
+	test_prefix_keys();
+
 	return 0;
 }
@@ -19,12 +19,14 @@
 #include <stdio.h>
 #include <limits.h>
 #include <unistd.h>
-#include <sys/stat.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <assert.h>
 #include <tap/basic.h>
 
 #include "libknot/libknot.h"
+#include "libknot/internal/mem.h"
 #include "knot/server/journal.h"
-#include "knot/zone/zone-diff.h"
 
 #define RAND_RR_LABEL 16
 #define RAND_RR_PAYLOAD 64
@@ -141,88 +143,23 @@ static bool changesets_eq(const changeset_t *ch1, changeset_t *ch2)
 	return ret;
 }
 
-/*! \brief Journal fillup test with size check. */
-static void test_fillup(journal_t *journal, size_t fsize, unsigned iter, size_t chunk_size)
-{
-	int ret = KNOT_EOK;
-	char *mptr = NULL;
-	char *large_entry = malloc(chunk_size);
-	randstr(large_entry, chunk_size);
-	assert(large_entry);
-
-	unsigned i = 0;
-	bool read_passed = true;
-	for (; i < 2 * JOURNAL_NCOUNT; ++i) {
-		uint64_t chk_key = 0xBEBE + i;
-		size_t entry_len = chunk_size/2 + rand() % (chunk_size/2);
-
-		/* Write */
-		ret = journal_map(journal, chk_key, &mptr, entry_len, false);
-		if (ret != KNOT_EOK) {
-			break;
-		}
-		memcpy(mptr, large_entry, entry_len);
-		ret = journal_unmap(journal, chk_key, mptr, 1);
-		if (ret != KNOT_EOK) {
-			diag("journal_unmap = %s", knot_strerror(ret));
-			read_passed = true;
-			break;
-		}
-
-		/* Read */
-		ret = journal_map(journal, chk_key, &mptr, entry_len, true);
-		if (ret == KNOT_EOK) {
-			ret = memcmp(large_entry, mptr, entry_len);
-			if (ret != 0) {
-				diag("integrity check failed");
-				read_passed = false;
-			} else {
-				ret = journal_unmap(journal, chk_key, mptr, 0);
-				if (ret != KNOT_EOK) {
-					diag("journal_unmap(rdonly) = %s", knot_strerror(ret));
-					read_passed = false;
-				}
-			}
-		} else {
-			diag("journal_map(rdonly) = %s", knot_strerror(ret));
-			read_passed = false;
-		}
-
-		if (!read_passed) {
-			break;
-		}
-	}
-	ok(read_passed, "journal: fillup #%u, reading written entries", iter);
-	ok(ret != KNOT_EOK, "journal: fillup #%u (%d entries)", iter, i);
-	free(large_entry);
-
-	/* Check file size. */
-	struct stat st;
-	fstat(journal->fd, &st);
-	ok(st.st_size < fsize + chunk_size, "journal: fillup / size check #%u", iter);
-	if (st.st_size > fsize + chunk_size) {
-		diag("journal: fillup / size check #%u fsize(%zu) > max(%zu)",
-		     iter, (size_t)st.st_size, fsize + chunk_size);
-	}
-}
-
 /*! \brief Test behavior with real changesets. */
-static void test_store_load(const char *jfilename)
+static void test_store_load(journal_db_t *db)
 {
 	const size_t filesize = 100 * 1024;
 	uint8_t *apex = (uint8_t *)"\4test";
 
-	/* Create fake zone. */
-	zone_t z = { .name = apex };
+	ok(!journal_exists(db, apex), "journal: no journal before store");
 
 	/* Save and load changeset. */
 	changeset_t ch;
 	init_random_changeset(&ch, 0, 1, 128, apex);
-	int ret = journal_store_changeset(&ch, jfilename, filesize);
+	int ret = journal_store_changeset(db, apex, &ch, filesize);
 	ok(ret == KNOT_EOK, "journal: store changeset");
+	ok(journal_exists(db, apex), "journal: exists after store");
 	list_t l;
 	init_list(&l);
-	ret = journal_load_changesets(jfilename, &z, &l, 0, 1);
+	ret = journal_load_changesets(db, apex, &l, 0, 1);
 	ok(ret == KNOT_EOK && changesets_eq(TAIL(l), &ch), "journal: load changeset");
 	changeset_clear(&ch);
 	changesets_free(&l);
@@ -233,38 +170,151 @@ static void test_store_load(const char *jfilename)
 	uint32_t serial = 1;
 	for (; ret == KNOT_EOK; ++serial) {
 		init_random_changeset(&ch, serial, serial + 1, 128, apex);
-		ret = journal_store_changeset(&ch, jfilename, filesize);
+		ret = journal_store_changeset(db, apex, &ch, filesize);
 		changeset_clear(&ch);
 	}
 	ok(ret == KNOT_EBUSY, "journal: overfill with changesets");
 
 	/* Load all changesets stored until now. */
 	serial--;
-	ret = journal_load_changesets(jfilename, &z, &l, 0, serial);
+	ret = journal_load_changesets(db, apex, &l, 0, serial);
 	changesets_free(&l);
 	ok(ret == KNOT_EOK, "journal: load changesets");
 
+	/* Missing history. */
+	init_list(&l);
+	ret = journal_load_changesets(db, apex, &l, 0, serial + 1);
+	changesets_free(&l);
+	ok(ret == KNOT_ERANGE, "journal: load beyond the history");
+	init_list(&l);
+	ret = journal_load_changesets(db, apex, &l, serial + 1, serial + 2);
+	changesets_free(&l);
+	ok(ret == KNOT_ENOENT, "journal: load unknown serial");
+
 	/* Flush the journal. */
-	ret = journal_mark_synced(jfilename);
+	ret = journal_mark_synced(db, apex);
 	ok(ret == KNOT_EOK, "journal: flush");
 
 	/* Store next changeset. */
 	init_random_changeset(&ch, serial, serial + 1, 128, apex);
-	ret = journal_store_changeset(&ch, jfilename, filesize);
-		changeset_clear(&ch);
+	ret = journal_store_changeset(db, apex, &ch, filesize);
+	changeset_clear(&ch);
 	ok(ret == KNOT_EOK, "journal: store after flush");
 
 	/* Load all changesets, except the first one that got evicted. */
 	init_list(&l);
-	ret = journal_load_changesets(jfilename, &z, &l, 1, serial + 1);
+	ret = journal_load_changesets(db, apex, &l, 1, serial + 1);
 	changesets_free(&l);
 	ok(ret == KNOT_EOK, "journal: load changesets after flush");
+	init_list(&l);
+	ret = journal_load_changesets(db, apex, &l, 0, serial + 1);
+	changesets_free(&l);
+	ok(ret == KNOT_ENOENT, "journal: evicted changeset not loaded");
+}
+
+/*! \brief Test that a batch of changesets is stored all or nothing. */
+static void test_batch(journal_db_t *db)
+{
+	const size_t filesize = 100 * 1024;
+	uint8_t *apex = (uint8_t *)"\5batch";
+
+	/* Store a batch fitting the journal. */
+	list_t chgs;
+	init_list(&chgs);
+	uint32_t serial = 0;
+	for (; serial < 4; ++serial) {
+		changeset_t *ch = malloc(sizeof(changeset_t));
+		assert(ch);
+		init_random_changeset(ch, serial, serial + 1, 32, apex);
+		add_tail(&chgs, &ch->n);
+	}
+	int ret = journal_store_changesets(db, apex, &chgs, filesize);
+	ok(ret == KNOT_EOK, "journal: store batch");
+	changesets_free(&chgs);
+
+	/* Store an oversized batch, the journal contains dirty entries. */
+	init_list(&chgs);
+	for (uint32_t i = 0; i < 16; ++i) {
+		changeset_t *ch = malloc(sizeof(changeset_t));
+		assert(ch);
+		init_random_changeset(ch, serial + i, serial + i + 1, 128, apex);
+		add_tail(&chgs, &ch->n);
+	}
+	ret = journal_store_changesets(db, apex, &chgs, filesize);
+	ok(ret == KNOT_EBUSY, "journal: store oversized batch");
+	changesets_free(&chgs);
+
+	/* Nothing from the failed batch is stored. */
+	list_t l;
+	init_list(&l);
+	ret = journal_load_changesets(db, apex, &l, 0, serial + 1);
+	changesets_free(&l);
+	ok(ret == KNOT_ERANGE, "journal: failed batch not stored");
+	init_list(&l);
+	ret = journal_load_changesets(db, apex, &l, 0, serial);
+	ok(ret == KNOT_EOK && list_size(&l) == serial, "journal: batch loaded");
+	changesets_free(&l);
+}
+
+/*! \brief Test that zones don't share history. */
+static void test_zones(journal_db_t *db)
+{
+	const size_t filesize = 100 * 1024;
+	uint8_t *apex1 = (uint8_t *)"\4zone\3one";
+	uint8_t *apex2 = (uint8_t *)"\4zone\3two";
+
+	changeset_t ch1, ch2;
+	init_random_changeset(&ch1, 5, 6, 16, apex1);
+	init_random_changeset(&ch2, 5, 7, 16, apex2);
+	int ret1 = journal_store_changeset(db, apex1, &ch1, filesize);
+	int ret2 = journal_store_changeset(db, apex2, &ch2, filesize);
+	ok(ret1 == KNOT_EOK && ret2 == KNOT_EOK, "journal: store into two zones");
+
+	list_t l1, l2;
+	init_list(&l1);
+	init_list(&l2);
+	ret1 = journal_load_changesets(db, apex1, &l1, 5, 6);
+	ret2 = journal_load_changesets(db, apex2, &l2, 5, 7);
+	ok(ret1 == KNOT_EOK && changesets_eq(TAIL(l1), &ch1) &&
+	   ret2 == KNOT_EOK && changesets_eq(TAIL(l2), &ch2),
+	   "journal: load from two zones");
+	changesets_free(&l1);
+	changesets_free(&l2);
+	changeset_clear(&ch1);
+	changeset_clear(&ch2);
+
+	/* Changeset not following the history replaces it once synced. */
+	init_random_changeset(&ch1, 10, 11, 16, apex1);
+	ret1 = journal_store_changeset(db, apex1, &ch1, filesize);
+	init_list(&l1);
+	ret2 = journal_load_changesets(db, apex1, &l1, 5, 6);
+	changesets_free(&l1);
+	ok(ret1 == KNOT_EBUSY && ret2 == KNOT_EOK,
+	   "journal: unsynced history not dropped");
+
+	journal_mark_synced(db, apex1);
+	ret1 = journal_store_changeset(db, apex1, &ch1, filesize);
+	changeset_clear(&ch1);
+	init_list(&l1);
+	ret2 = journal_load_changesets(db, apex1, &l1, 5, 6);
+	changesets_free(&l1);
+	init_list(&l1);
+	int ret3 = journal_load_changesets(db, apex1, &l1, 10, 11);
+	changesets_free(&l1);
+	ok(ret1 == KNOT_EOK && ret2 == KNOT_ENOENT && ret3 == KNOT_EOK,
+	   "journal: discontinuous changeset starts new history");
+
+	/* The other zone is untouched. */
+	init_list(&l2);
+	ret2 = journal_load_changesets(db, apex2, &l2, 5, 7);
+	changesets_free(&l2);
+	ok(ret2 == KNOT_EOK, "journal: other zone history kept");
 }
 
 /*! \brief Test behavior when writing to jurnal and flushing it. */
-static void test_stress(const char *jfilename)
+static void test_stress(journal_db_t *db)
 {
-	uint8_t *apex = (uint8_t *)"\4test";
+	uint8_t *apex = (uint8_t *)"\6stress";
 	const size_t filesize = 100 * 1024;
 	int ret = KNOT_EOK;
 	uint32_t serial = 0;
@@ -273,126 +323,202 @@ static void test_stress(const char *jfilename)
 		changeset_t ch;
 		init_random_changeset(&ch, serial, serial + 1, update_size, apex);
 		update_size *= 1.5;
-		ret = journal_store_changeset(&ch, jfilename, filesize);
+		ret = journal_store_changeset(db, apex, &ch, filesize);
 		changeset_clear(&ch);
-		journal_mark_synced(jfilename);
+		journal_mark_synced(db, apex);
 	}
 	ok(ret == KNOT_ESPACE, "journal: does not overfill under load");
 }
 
-int main(int argc, char *argv[])
-{
-	plan_lazy();
+#define GROUP_ZONES 8
+#define GROUP_STORES 16
 
-	/* Create tmpdir */
-	size_t fsize = 10 * 1024 * 1024;
-	char *tmpdir = test_tmpdir();
-	char jfilename[256];
-	snprintf(jfilename, sizeof(jfilename), "%s/%s", tmpdir, "journal.XXXXXX");
+struct group_ctx {
+	journal_db_t *db;
+	knot_dname_t apex[16];
+	int ret;
+};
 
-	/* Create tmpfile. */
-	int tmp_fd = mkstemp(jfilename);
-	ok(tmp_fd >= 0, "journal: create temporary file");
-	if (tmp_fd < 0) {
-		goto skip_all;
+static void *group_store(void *data)
+{
+	struct group_ctx *ctx = data;
+	ctx->ret = KNOT_EOK;
+	for (uint32_t serial = 0; serial < GROUP_STORES; ++serial) {
+		changeset_t ch;
+		init_random_changeset(&ch, serial, serial + 1, 4, ctx->apex);
+		int ret = journal_store_changeset(ctx->db, ctx->apex, &ch, 0);
+		changeset_clear(&ch);
+		if (ret != KNOT_EOK) {
+			ctx->ret = ret;
+			break;
+		}
 	}
-	close(tmp_fd);
-	remove(jfilename);
 
-	/* Try to open journal with too small fsize. */
-	journal_t *journal = journal_open(jfilename, 1024);
-	ok(journal == NULL, "journal: open too small");
+	return NULL;
+}
 
-	/* Open/create new journal. */
-	journal = journal_open(jfilename, fsize);
-	ok(journal != NULL, "journal: open journal '%s'", jfilename);
-	if (journal == NULL) {
-		goto skip_all;
+/*! \brief Test concurrent stores of several zones sharing commits. */
+static void test_group_commit(journal_db_t *db)
+{
+	journal_db_set_delay(db, 1);
+
+	struct group_ctx ctx[GROUP_ZONES];
+	pthread_t threads[GROUP_ZONES];
+	for (int i = 0; i < GROUP_ZONES; ++i) {
+		ctx[i].db = db;
+		memcpy(ctx[i].apex, "\5group\1x", 9);
+		ctx[i].apex[7] = 'a' + i;
+		pthread_create(&threads[i], NULL, group_store, &ctx[i]);
 	}
 
-	/* Write entry and check integrity. */
-	char *mptr = NULL;
-	uint64_t chk_key = 0;
-	char chk_buf[64] = {'\0'};
-	randstr(chk_buf, sizeof(chk_buf));
-	int ret = journal_map(journal, chk_key, &mptr, sizeof(chk_buf), false);
-	is_int(KNOT_EOK, ret, "journal: write data (map)");
-	if (ret == KNOT_EOK) {
-		memcpy(mptr, chk_buf, sizeof(chk_buf));
-		ret = journal_unmap(journal, chk_key, mptr, 1);
-		is_int(KNOT_EOK, ret, "journal: write data (unmap)");
+	bool stored = true;
+	for (int i = 0; i < GROUP_ZONES; ++i) {
+		pthread_join(threads[i], NULL);
+		stored = stored && ctx[i].ret == KNOT_EOK;
 	}
-
-	ret = journal_map(journal, chk_key, &mptr, sizeof(chk_buf), true);
-	is_int(KNOT_EOK, ret, "journal: data integrity check (map)");
-	if (ret == KNOT_EOK) {
-		ret = memcmp(chk_buf, mptr, sizeof(chk_buf));
-		is_int(0, ret, "journal: data integrity check (cmp)");
-		ret = journal_unmap(journal, chk_key, mptr, 0);
-		is_int(KNOT_EOK, ret, "journal: data integrity check (unmap)");
+	ok(stored, "journal: concurrent stores");
+
+	bool loaded = true;
+	for (int i = 0; i < GROUP_ZONES; ++i) {
+		list_t l;
+		init_list(&l);
+		int ret = journal_load_changesets(db, ctx[i].apex, &l, 0, GROUP_STORES);
+		loaded = loaded && ret == KNOT_EOK && list_size(&l) == GROUP_STORES;
+		changesets_free(&l);
 	}
+	ok(loaded, "journal: load after concurrent stores");
 
-	/* Reopen log and re-read value. */
-	journal_close(journal);
-	journal = journal_open(jfilename, fsize);
-	ok(journal != NULL, "journal: open journal '%s'", jfilename);
+	journal_db_set_delay(db, 0);
+}
 
-	ret = journal_map(journal, chk_key, &mptr, sizeof(chk_buf), true);
-	if (ret == KNOT_EOK) {
-		ret = memcmp(chk_buf, mptr, sizeof(chk_buf));
-		journal_unmap(journal, chk_key, mptr, 0);
-	}
-	is_int(KNOT_EOK, ret, "journal: data integrity check after close/open");
+/*! \brief Test merging of old changesets. */
+static void test_compact(journal_db_t *db)
+{
+	const size_t filesize = 1024 * 1024;
+	uint8_t *apex = (uint8_t *)"\7compact\1x";
+
+	/* The second changeset removes an RR added by the first one. */
+	changeset_t ch1, ch2, ch3, ch4;
+	init_random_changeset(&ch1, 1, 2, 4, apex);
+	init_random_changeset(&ch2, 2, 3, 4, apex);
+	init_random_changeset(&ch3, 3, 4, 4, apex);
+	changeset_iter_t itt;
+	changeset_iter_add(&itt, &ch1, false);
+	knot_rrset_t rr = changeset_iter_next(&itt);
+	int ret = changeset_rem_rrset(&ch2, &rr);
+	assert(ret == KNOT_EOK);
+	changeset_iter_clear(&itt);
 
-	/*  Write random data. */
-	ret = KNOT_EOK;
-	for (int i = 0; i < 512; ++i) {
-		chk_key = 0xDEAD0000 + i;
-		ret = journal_map(journal, chk_key, &mptr, sizeof(chk_buf), false);
-		if (ret != KNOT_EOK) {
-			diag("journal_map failed: %s", knot_strerror(ret));
-			break;
-		}
-		randstr(mptr, sizeof(chk_buf));
-		if ((ret = journal_unmap(journal, chk_key, mptr, 1)) != KNOT_EOK) {
-			diag("journal_unmap failed: %s", knot_strerror(ret));
-			break;
+	list_t l;
+	init_list(&l);
+	add_tail(&l, &ch1.n);
+	add_tail(&l, &ch2.n);
+	add_tail(&l, &ch3.n);
+	ret = journal_store_changesets(db, apex, &l, filesize);
+	ok(ret == KNOT_EOK, "journal: store changesets to compact");
+
+	/* Dirty changesets are kept. */
+	size_t merged = 0;
+	ret = journal_compact(db, apex, 0, &merged);
+	ok(ret == KNOT_EOK && merged == 0, "journal: dirty changesets not compacted");
+
+	ret = journal_mark_synced(db, apex);
+	assert(ret == KNOT_EOK);
+	init_random_changeset(&ch4, 4, 5, 4, apex);
+	ret = journal_store_changeset(db, apex, &ch4, filesize);
+	assert(ret == KNOT_EOK);
+
+	/* Recent changesets are kept. */
+	ret = journal_compact(db, apex, 3600, &merged);
+	ok(ret == KNOT_EOK && merged == 0, "journal: recent changesets not compacted");
+
+	ret = journal_compact(db, apex, 0, &merged);
+	ok(ret == KNOT_EOK && merged == 3, "journal: compact synced changesets");
+
+	list_t loaded;
+	init_list(&loaded);
+	ret = journal_load_changesets(db, apex, &loaded, 1, 5);
+	changeset_t *first = HEAD(loaded);
+	ok(ret == KNOT_EOK && list_size(&loaded) == 2 &&
+	   knot_soa_serial(&first->soa_from->rrs) == 1 &&
+	   knot_soa_serial(&first->soa_to->rrs) == 4 &&
+	   changeset_size(first) == 13 && changesets_eq(TAIL(loaded), &ch4),
+	   "journal: load compacted changesets");
+	changesets_free(&loaded);
+
+	init_list(&loaded);
+	ret = journal_load_changesets(db, apex, &loaded, 2, 5);
+	changesets_free(&loaded);
+	ok(ret == KNOT_ENOENT, "journal: merged history not available");
+
+	changeset_clear(&ch1);
+	changeset_clear(&ch2);
+	changeset_clear(&ch3);
+	changeset_clear(&ch4);
+}
+
+/*! \brief Remove the temporary database. */
+static void remove_db(const char *dbid)
+{
+	char *journal_dir = sprintf_alloc("%s/journal", dbid);
+	DIR *dir = opendir(journal_dir);
+	struct dirent *dp;
+	while (dir != NULL && (dp = readdir(dir)) != NULL) {
+		if (dp->d_name[0] == '.') {
+			continue;
 		}
+		char *file = sprintf_alloc("%s/%s", journal_dir, dp->d_name);
+		remove(file);
+		free(file);
 	}
-	is_int(KNOT_EOK, ret, "journal: sustained mmap r/w");
-
-	/* Overfill (yields ESPACE/EBUSY) */
-	ret = journal_map(journal, chk_key, &mptr, fsize, false);
-	ok(ret != KNOT_EOK, "journal: overfill");
-
-	/* Fillup */
-	size_t sizes[] = {16, 64, 1024, 4096, 512 * 1024, 1024 * 1024 };
-	const int num_sizes = sizeof(sizes)/sizeof(size_t);
-	for (unsigned i = 0; i < 2 * num_sizes; ++i) {
-		/* Journal flush. */
-		journal_close(journal);
-		ret = journal_mark_synced(jfilename);
-		is_int(KNOT_EOK, ret, "journal: flush after fillup #%u", i);
-		journal = journal_open(jfilename, fsize);
-		ok(journal != NULL, "journal: reopen after flush #%u", i);
-		/* Journal fillup. */
-		test_fillup(journal, fsize, i, sizes[i % num_sizes]);
+	if (dir != NULL) {
+		closedir(dir);
 	}
+	remove(journal_dir);
+	free(journal_dir);
+	remove(dbid);
+}
 
-	/* Close journal. */
-	journal_close(journal);
+int main(int argc, char *argv[])
+{
+	plan_lazy();
 
-	/* Delete journal. */
-	remove(jfilename);
+	/* Temporary DB identifier. */
+	char *tmpdir = test_tmpdir();
+	char dbid[256];
+	snprintf(dbid, sizeof(dbid), "%s/%s", tmpdir, "journal.XXXXXX");
+	free(tmpdir);
+	ok(mkdtemp(dbid) != NULL, "journal: create temporary directory");
 
-	test_store_load(jfilename);
-	remove(jfilename);
+	/* Open the database. */
+	journal_db_t *db = NULL;
+	int ret = journal_db_open(dbid, 64 * 1024 * 1024, &db);
+	ok(ret == KNOT_EOK && db != NULL, "journal: open database");
+	if (ret != KNOT_EOK) {
+		goto skip_all;
+	}
 
-	test_stress(jfilename);
-	remove(jfilename);
+	test_store_load(db);
+	test_batch(db);
+	test_zones(db);
+	test_stress(db);
+	test_group_commit(db);
+	test_compact(db);
+
+	/* Reopen the database and re-read the history. */
+	journal_db_close(db);
+	db = NULL;
+	ret = journal_db_open(dbid, 64 * 1024 * 1024, &db);
+	ok(ret == KNOT_EOK, "journal: reopen database");
+	list_t l;
+	init_list(&l);
+	ret = journal_load_changesets(db, (uint8_t *)"\4zone\3two", &l, 5, 7);
+	changesets_free(&l);
+	ok(ret == KNOT_EOK, "journal: load after reopen");
 
-	free(tmpdir);
+	journal_db_close(db);
 
 skip_all:
+	remove_db(dbid);
 	return 0;
 }
@@ -0,0 +1,259 @@
+/*  Copyright (C) 2015 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <tap/basic.h>
+
+#include "test_conf.h"
+#include "knot/dnssec/nsec3-chain.h"
+#include "knot/updates/apply.h"
+#include "knot/zone/zone.h"
+#include "knot/zone/zonefile.h"
+#include "libknot/libknot.h"
+#include "libknot/rrtype/soa.h"
+#include "zscanner/scanner.h"
+
+#define ZONE	"example."
+#define TTL	300
+
+static char *write_zone(void)
+{
+	char *tmpdir = test_tmpdir();
+	char *path = malloc(strlen(tmpdir) + sizeof("/nsec3_chain.zone"));
+	sprintf(path, "%s/nsec3_chain.zone", tmpdir);
+	free(tmpdir);
+
+	FILE *f = fopen(path, "w");
+	if (f == NULL) {
+		free(path);
+		return NULL;
+	}
+
+	fputs("$TTL 600\n"
+	      "@ SOA ns admin 1 3600 900 604800 300\n"
+	      "@ NS ns\n"
+	      "@ NSEC3PARAM 1 0 10 AABBCCDD\n"
+	      "ns A 192.0.2.1\n"
+	      "deleg NS ns.deleg\n"
+	      "ns.deleg A 192.0.2.2\n"
+	      "a.b.c A 192.0.2.3\n", f);
+	for (int i = 0; i < 20; i++) {
+		fprintf(f, "host%d A 192.0.2.%d\n", i, i + 10);
+	}
+	fclose(f);
+
+	return path;
+}
+
+/* Changes parsed from the zone file format. */
+
+typedef struct {
+	changeset_t *ch;
+	int (*add)(changeset_t *, const knot_rrset_t *);
+} parse_ctx_t;
+
+static void add_record(zs_scanner_t *s)
+{
+	parse_ctx_t *ctx = s->data;
+
+	knot_rrset_t rr;
+	knot_rrset_init(&rr, s->r_owner, s->r_type, s->r_class);
+	knot_rrset_add_rdata(&rr, s->r_data, s->r_data_length, s->r_ttl, NULL);
+	ctx->add(ctx->ch, &rr);
+	knot_rdataset_clear(&rr.rrs, NULL);
+}
+
+static void parse_records(changeset_t *ch, const char *text,
+                          int (*add)(changeset_t *, const knot_rrset_t *))
+{
+	parse_ctx_t ctx = { ch, add };
+	zs_scanner_t *s = zs_scanner_create(ZONE, KNOT_CLASS_IN, 600,
+	                                    add_record, NULL, &ctx);
+	zs_scanner_parse(s, text, text + strlen(text), true);
+	zs_scanner_free(s);
+}
+
+/*! \brief Creates changeset keeping the serial unless \a next is set. */
+static changeset_t *new_changeset(const zone_t *zone, bool next)
+{
+	knot_rrset_t soa = node_rrset(zone->contents->apex, KNOT_RRTYPE_SOA);
+	changeset_t *ch = changeset_new(soa.owner);
+	ch->soa_from = knot_rrset_copy(&soa, NULL);
+	ch->soa_to = knot_rrset_copy(&soa, NULL);
+	if (next) {
+		knot_soa_serial_set(&ch->soa_to->rrs, knot_soa_serial(&soa.rrs) + 1);
+	}
+
+	return ch;
+}
+
+/*! \brief Applies the changeset, the zone takes the new contents. */
+static int apply(zone_t *zone, changeset_t *ch)
+{
+	zone_contents_t *new_contents = NULL;
+	int ret = apply_changeset(zone, ch, &new_contents);
+	if (ret == KNOT_EOK) {
+		zone_contents_t *old_contents = zone->contents;
+		zone->contents = new_contents;
+		update_free_zone(&old_contents);
+		update_cleanup(ch);
+	}
+	changeset_free(ch);
+
+	return ret;
+}
+
+/* Comparison of the NSEC3 chains. */
+
+typedef struct {
+	zone_tree_t *other;
+	bool equal;
+} compare_ctx_t;
+
+static int compare_nsec3(zone_node_t **tnode, void *data)
+{
+	compare_ctx_t *ctx = data;
+	zone_node_t *other = NULL;
+	zone_tree_get(ctx->other, (*tnode)->owner, &other);
+
+	knot_rrset_t nsec3 = node_rrset(*tnode, KNOT_RRTYPE_NSEC3);
+	knot_rrset_t other_nsec3 = node_rrset(other, KNOT_RRTYPE_NSEC3);
+	if (!knot_rrset_equal(&nsec3, &other_nsec3, KNOT_RRSET_COMPARE_WHOLE)) {
+		ctx->equal = false;
+	}
+
+	return KNOT_EOK;
+}
+
+static bool chains_equal(const zone_contents_t *a, const zone_contents_t *b)
+{
+	compare_ctx_t ctx = { b->nsec3_nodes, true };
+	zone_tree_apply(a->nsec3_nodes, compare_nsec3, &ctx);
+	ctx.other = a->nsec3_nodes;
+	zone_tree_apply(b->nsec3_nodes, compare_nsec3, &ctx);
+	return ctx.equal && zone_tree_weight(a->nsec3_nodes) > 0;
+}
+
+/*!
+ * \brief Applies the change and checks that the fixed NSEC3 chain is equal
+ *        to the rebuilt one.
+ */
+static void test_fix(zone_t *zone, const char *rem, const char *add,
+                     const char *msg)
+{
+	changeset_t *in_ch = new_changeset(zone, true);
+	parse_records(in_ch, rem, changeset_rem_rrset);
+	parse_records(in_ch, add, changeset_add_rrset);
+
+	/* Incoming changeset is kept for fixing the chain. */
+	zone_contents_t *updated = NULL;
+	int ret = apply_changeset(zone, in_ch, &updated);
+	if (ret != KNOT_EOK) {
+		ok(false, "nsec3 chain: %s", msg);
+		changeset_free(in_ch);
+		return;
+	}
+	zone_contents_t *old_contents = zone->contents;
+	zone->contents = updated;
+	update_free_zone(&old_contents);
+	update_cleanup(in_ch);
+
+	changeset_t *fix_ch = new_changeset(zone, false);
+	changeset_t *full_ch = new_changeset(zone, false);
+	ret = knot_nsec3_fix_chain(updated, in_ch, TTL, fix_ch);
+	if (ret == KNOT_EOK) {
+		ret = knot_nsec3_create_chain(updated, TTL, full_ch);
+	}
+
+	zone_contents_t *fixed = NULL, *rebuilt = NULL;
+	if (ret == KNOT_EOK) {
+		ret = apply_changeset(zone, fix_ch, &fixed);
+	}
+	if (ret == KNOT_EOK) {
+		ret = apply_changeset(zone, full_ch, &rebuilt);
+	}
+	ok(ret == KNOT_EOK && chains_equal(fixed, rebuilt),
+	   "nsec3 chain: %s", msg);
+
+	/* Continue with the fixed chain. */
+	if (rebuilt != NULL) {
+		update_free_zone(&rebuilt);
+		update_rollback(full_ch);
+	}
+	if (fixed != NULL) {
+		zone->contents = fixed;
+		update_free_zone(&updated);
+		update_cleanup(fix_ch);
+	}
+	changeset_free(fix_ch);
+	changeset_free(full_ch);
+	changeset_free(in_ch);
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	int ret = test_conf("zone:\n  - domain: "ZONE"\n", NULL);
+	ok(ret == KNOT_EOK, "nsec3 chain: prepare configuration");
+
+	char *path = write_zone();
+	knot_dname_t *origin = knot_dname_from_str_alloc(ZONE);
+	zone_t *zone = zone_new(origin);
+	zloader_t loader;
+	if (path != NULL && zonefile_open(&loader, path, origin, false) == KNOT_EOK) {
+		zone->contents = zonefile_load(&loader);
+		zonefile_close(&loader);
+	}
+	ok(zone->contents != NULL, "nsec3 chain: load zone");
+	if (zone->contents == NULL) {
+		goto cleanup;
+	}
+
+	changeset_t *ch = new_changeset(zone, false);
+	ret = knot_nsec3_create_chain(zone->contents, TTL, ch);
+	ok(ret == KNOT_EOK && apply(zone, ch) == KNOT_EOK,
+	   "nsec3 chain: create chain");
+
+	test_fix(zone, "", "new A 192.0.2.100\n", "node added");
+	test_fix(zone, "host5 A 192.0.2.15\n", "", "node removed");
+	test_fix(zone, "host6 A 192.0.2.16\n", "host6 A 192.0.2.99\n",
+	         "node modified");
+	test_fix(zone, "", "x.y.z A 192.0.2.101\n", "empty non-terminals added");
+	test_fix(zone, "x.y.z A 192.0.2.101\n", "", "empty non-terminals removed");
+	test_fix(zone, "a.b.c A 192.0.2.3\n", "b.c A 192.0.2.3\n",
+	         "empty non-terminal filled");
+	test_fix(zone, "", "glue.deleg A 192.0.2.102\n",
+	         "glue added below insecure delegation");
+	test_fix(zone, "", "other NS ns.other\nns.other A 192.0.2.103\n",
+	         "insecure delegation added");
+	test_fix(zone, "other NS ns.other\nns.other A 192.0.2.103\n", "",
+	         "insecure delegation removed");
+
+cleanup:
+	zone_free(&zone);
+	knot_dname_free(&origin, NULL);
+	if (path != NULL) {
+		unlink(path);
+	}
+	free(path);
+	conf_free(conf(), false);
+
+	return 0;
+}
@@ -64,9 +64,130 @@ static void packet_match(knot_pkt_t *in, knot_pkt_t *out)
 	is_int(NAMECOUNT, rr_matched, "pkt: RR content match");
 }
 
+/*! \brief Write NS RRSet with names sharing distant suffixes. */
+static knot_pkt_t *compr_pkt(knot_rrset_t *rr, bool table, mm_ctx_t *mm)
+{
+	knot_pkt_t *pkt = knot_pkt_new(NULL, MM_DEFAULT_BLKSIZE, mm);
+	if (pkt == NULL) {
+		return NULL;
+	}
+
+	if ((table && knot_pkt_use_compr_table(pkt) != KNOT_EOK) ||
+	    knot_pkt_put_question(pkt, rr->owner, KNOT_CLASS_IN,
+	                          KNOT_RRTYPE_NS) != KNOT_EOK ||
+	    knot_pkt_put(pkt, KNOT_COMPR_HINT_QNAME, rr, 0) != KNOT_EOK) {
+		knot_pkt_free(&pkt);
+	}
+
+	return pkt;
+}
+
+/* @note Compression table test, 4 checks. */
+static void test_compr_table(mm_ctx_t *mm)
+{
+	const char *names[] = {
+		"ns.one.example.net", "ns.two.example.org", "ns2.one.example.net",
+		"ns3.one.example.net", "ns.two.example.net"
+	};
+
+	knot_dname_t *owner = knot_dname_from_str_alloc("example.com");
+	knot_rrset_t *rr = knot_rrset_new(owner, KNOT_RRTYPE_NS, KNOT_CLASS_IN, NULL);
+	knot_dname_free(&owner, NULL);
+	for (unsigned i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+		knot_dname_t *name = knot_dname_from_str_alloc(names[i]);
+		knot_rrset_add_rdata(rr, name, knot_dname_size(name), TTL, NULL);
+		knot_dname_free(&name, NULL);
+	}
+
+	knot_pkt_t *plain = compr_pkt(rr, false, mm);
+	knot_pkt_t *table = compr_pkt(rr, true, mm);
+	ok(plain != NULL && table != NULL, "pkt: write with compression table");
+	if (plain == NULL || table == NULL) {
+		skip_block(3, "no packets");
+		goto cleanup;
+	}
+
+	ok(table->size < plain->size, "pkt: compression table saves space");
+
+	knot_pkt_t *in = knot_pkt_new(table->wire, table->size, mm);
+	int ret = knot_pkt_parse(in, 0);
+	ok(ret == KNOT_EOK, "pkt: parse packet compressed with table");
+
+	/* Parsed RRs are stored separately. */
+	const knot_pktsection_t *answer = knot_pkt_section(in, KNOT_ANSWER);
+	bool match = answer->count == rr->rrs.rr_count;
+	for (uint16_t i = 0; match && i < answer->count; ++i) {
+		const knot_rrset_t *parsed = knot_pkt_rr(answer, i);
+		match = knot_rdata_cmp(knot_rdataset_at(&parsed->rrs, 0),
+		                       knot_rdataset_at(&rr->rrs, i)) == 0;
+	}
+	ok(match, "pkt: names compressed with table match");
+	knot_pkt_free(&in);
+
+cleanup:
+	knot_pkt_free(&plain);
+	knot_pkt_free(&table);
+	knot_rrset_free(&rr, NULL);
+}
+
+/* @note Lazy parsing test, 5 checks. */
+static void test_parse_lazy(knot_rrset_t *additional, knot_rrset_t *opt_rr,
+                            mm_ctx_t *mm)
+{
+	/* Query with an extra record before OPT in ADDITIONAL. */
+	knot_pkt_t *out = knot_pkt_new(NULL, MM_DEFAULT_BLKSIZE, mm);
+	knot_pkt_put_question(out, additional->owner, KNOT_CLASS_IN, KNOT_RRTYPE_A);
+	knot_pkt_begin(out, KNOT_ADDITIONAL);
+	knot_pkt_put(out, KNOT_COMPR_HINT_NONE, additional, 0);
+	knot_pkt_put(out, KNOT_COMPR_HINT_NONE, opt_rr, 0);
+
+	knot_pkt_t *in = knot_pkt_new(out->wire, out->size, mm);
+	int ret = knot_pkt_parse(in, KNOT_PF_LAZY);
+	ok(ret == KNOT_EOK && in->opt_rr != NULL, "pkt: lazy parse of query");
+
+	const knot_pktsection_t *ar = knot_pkt_section(in, KNOT_ADDITIONAL);
+	ok(ar->count == 1 && in->parsed == in->size, "pkt: lazy parse skips records");
+	knot_pkt_free(&in);
+
+	/* Records of other messages are always needed. */
+	knot_wire_set_opcode(out->wire, KNOT_OPCODE_NOTIFY);
+	in = knot_pkt_new(out->wire, out->size, mm);
+	ret = knot_pkt_parse(in, KNOT_PF_LAZY);
+	ar = knot_pkt_section(in, KNOT_ADDITIONAL);
+	ok(ret == KNOT_EOK && ar->count == 2, "pkt: lazy parse of NOTIFY is complete");
+	knot_pkt_free(&in);
+
+	knot_pkt_free(&out);
+
+	/* Malformed records are refused even if skipped. */
+	const struct {
+		const char *msg;
+		uint8_t rr[14];
+		size_t size;
+	} malformed[] = {
+		{ "A with short RDATA",
+		  { 0x00, 0x00, 0x01, 0x00, 0x01, 0, 0, 0, 0, 0x00, 0x03, 1, 2, 3 }, 14 },
+		{ "NS with invalid name pointer",
+		  { 0x00, 0x00, 0x02, 0x00, 0x01, 0, 0, 0, 0, 0x00, 0x02, 0xc0, 0xff }, 13 }
+	};
+	for (unsigned i = 0; i < sizeof(malformed) / sizeof(malformed[0]); ++i) {
+		out = knot_pkt_new(NULL, MM_DEFAULT_BLKSIZE, mm);
+		knot_pkt_put_question(out, additional->owner, KNOT_CLASS_IN, KNOT_RRTYPE_A);
+		memcpy(out->wire + out->size, malformed[i].rr, malformed[i].size);
+		out->size += malformed[i].size;
+		knot_wire_set_arcount(out->wire, 1);
+
+		in = knot_pkt_new(out->wire, out->size, mm);
+		ret = knot_pkt_parse(in, KNOT_PF_LAZY);
+		ok(ret == KNOT_EMALF, "pkt: lazy parse of %s", malformed[i].msg);
+		knot_pkt_free(&in);
+		knot_pkt_free(&out);
+	}
+}
+
 int main(int argc, char *argv[])
 {
-	plan(25);
+	plan(34);
 
 	/* Create memory pool context. */
 	int ret = 0;
@@ -85,7 +206,7 @@ int main(int argc, char *argv[])
 	knot_rrset_t opt_rr;
 	ret = knot_edns_init(&opt_rr, 1024, 0, 0, &mm);
 	if (ret != KNOT_EOK) {
-		skip_block(25, "Failed to initialize OPT RR.");
+		skip_block(34, "Failed to initialize OPT RR.");
 		return 0;
 	}
 	/* Add NSID */
@@ -93,7 +214,7 @@ int main(int argc, char *argv[])
 	                           strlen((char *)edns_str), edns_str, &mm);
 	if (ret != KNOT_EOK) {
 		knot_rrset_clear(&opt_rr, &mm);
-		skip_block(25, "Failed to add NSID to OPT RR.");
+		skip_block(34, "Failed to add NSID to OPT RR.");
 		return 0;
 	}
 
@@ -194,6 +315,9 @@ int main(int argc, char *argv[])
 	knot_pkt_free(&in);
 	ok(in == NULL && out == NULL && copy == NULL, "pkt: free");
 
+	test_compr_table(&mm);
+	test_parse_lazy(rrsets[1], &opt_rr, &mm);
+
 	/* Free extra data. */
 	for (unsigned i = 0; i < NAMECOUNT; ++i) {
 		knot_rrset_free(&rrsets[i], NULL);
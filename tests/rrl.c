@@ -14,8 +14,10 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <pthread.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <time.h>
 #include <tap/basic.h>
 
 #include "dnssec/crypto.h"
@@ -31,7 +33,8 @@
 #define RRL_SIZE 196613
 #define RRL_THREADS 8
 #define RRL_INSERTS (RRL_SIZE/(5*RRL_THREADS)) /* lf = 1/5 */
-#define RRL_LOCKS 64
+#define RRL_BENCH_QUERIES 200000
+#define RRL_BENCH_SOURCES 1024
 
 /* Disabled as default as it depends on random input.
  * Table may be consistent even if some collision occur (and they may occur).
@@ -58,21 +61,18 @@ static void* rrl_runnable(void *arg)
 	struct runnable_data* d = (struct runnable_data*)arg;
 	struct sockaddr_storage addr;
 	memcpy(&addr, d->addr, sizeof(struct sockaddr_storage));
-	int lock = -1;
 	uint32_t now = time(NULL);
 	struct bucketmap *m = malloc(RRL_INSERTS * sizeof(struct bucketmap));
 	for (unsigned i = 0; i < RRL_INSERTS; ++i) {
 		m[i].i = dnssec_random_uint32_t();
 		((struct sockaddr_in *) &addr)->sin_addr.s_addr = m[i].i;
-		rrl_item_t *b = rrl_hash(d->rrl, &addr, d->rq, d->zone, now, &lock);
-		rrl_unlock(d->rrl, lock);
-		m[i].x = b->netblk;
+		rrl_item_t *b = rrl_hash(d->rrl, &addr, d->rq, d->zone, now);
+		m[i].x = b->key;
 	}
 	for (unsigned i = 0; i < RRL_INSERTS; ++i) {
 		((struct sockaddr_in *) &addr)->sin_addr.s_addr = m[i].i;
-		rrl_item_t *b = rrl_hash(d->rrl, &addr, d->rq, d->zone, now, &lock);
-		rrl_unlock(d->rrl, lock);
-		if (b->netblk != m[i].x) {
+		rrl_item_t *b = rrl_hash(d->rrl, &addr, d->rq, d->zone, now);
+		if (b->key != m[i].x) {
 			d->passed = 0;
 		}
 	}
@@ -80,7 +80,7 @@ static void* rrl_runnable(void *arg)
 	return NULL;
 }
 
-static void rrl_hopscotch(struct runnable_data* rd)
+static void rrl_lookup(struct runnable_data* rd)
 {
 	rd->passed = 1;
 	pthread_t thr[RRL_THREADS];
@@ -93,12 +93,106 @@ static void rrl_hopscotch(struct runnable_data* rd)
 }
 #endif
 
+/*! \brief Concurrent queries data. */
+struct query_data {
+	rrl_table_t *rrl;
+	rrl_req_t *rq;
+	zone_t *zone;
+	unsigned sources;     /* Number of distinct source addresses. */
+	unsigned queries;     /* Number of queries per thread. */
+	uint32_t stamp;       /* Time of the queries. */
+	unsigned passed;      /* Number of not limited queries. */
+	unsigned failed;      /* Number of failed queries. */
+};
+
+static void *rrl_query_runnable(void *arg)
+{
+	struct query_data *d = arg;
+	struct sockaddr_storage addr;
+	sockaddr_set(&addr, AF_INET, "0.0.0.0", 0);
+	struct sockaddr_in *addr4 = (struct sockaddr_in *)&addr;
+
+	for (unsigned i = 0; i < d->queries; ++i) {
+		addr4->sin_addr.s_addr = htonl((i % d->sources) << 8);
+		int ret = rrl_query_at(d->rrl, &addr, d->rq, d->zone, d->stamp);
+		if (ret == KNOT_EOK) {
+			d->passed += 1;
+		} else if (ret != KNOT_ELIMIT) {
+			d->failed += 1;
+		}
+	}
+
+	return NULL;
+}
+
+/*! \brief Run concurrent queries, return elapsed time in seconds. */
+static double rrl_query_parallel(struct query_data *d, unsigned threads)
+{
+	pthread_t thr[RRL_THREADS];
+	struct query_data data[RRL_THREADS];
+
+	struct timespec begin, end;
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	for (unsigned i = 0; i < threads; ++i) {
+		data[i] = *d;
+		pthread_create(thr + i, NULL, &rrl_query_runnable, data + i);
+	}
+	for (unsigned i = 0; i < threads; ++i) {
+		pthread_join(thr[i], NULL);
+		d->passed += data[i].passed;
+		d->failed += data[i].failed;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	return (end.tv_sec - begin.tv_sec) + (end.tv_nsec - begin.tv_nsec) / 1e9;
+}
+
+/*! \brief Tokens of a single source are not lost or duplicated under contention. */
+static void rrl_concurrent(rrl_req_t *rq, zone_t *zone)
+{
+	const uint32_t rate = 1000;
+	rrl_table_t *rrl = rrl_create(RRL_SIZE);
+	rrl_setrate(rrl, rate);
+
+	/* All queries within the same second, exactly the rate passes. */
+	struct query_data d = { rrl, rq, zone, 1, 10 * rate, time(NULL) };
+	rrl_query_parallel(&d, RRL_THREADS);
+
+	ok(d.failed == 0 && d.passed == rate,
+	   "rrl: concurrent queries of a single source (%u passed)", d.passed);
+
+	rrl_destroy(rrl);
+}
+
+/*! \brief Query throughput with increasing number of threads. */
+static void rrl_benchmark(rrl_req_t *rq, zone_t *zone)
+{
+	bool valid = true;
+	for (unsigned threads = 1; threads <= RRL_THREADS; threads *= 2) {
+		rrl_table_t *rrl = rrl_create(RRL_SIZE);
+		rrl_setrate(rrl, 10);
+
+		struct query_data d = {
+			rrl, rq, zone, RRL_BENCH_SOURCES, RRL_BENCH_QUERIES,
+			time(NULL)
+		};
+		double elapsed = rrl_query_parallel(&d, threads);
+		diag("rrl: %u thread(s), %.0f queries/s", threads,
+		     threads * RRL_BENCH_QUERIES / elapsed);
+		valid = valid && d.failed == 0;
+
+		rrl_destroy(rrl);
+	}
+
+	ok(valid, "rrl: benchmark");
+}
+
 int main(int argc, char *argv[])
 {
 #ifdef ENABLE_TIMED_TESTS
-	plan(10);
+	plan(11);
 #else
-	plan(5);
+	plan(6);
 #endif
 
 	dnssec_crypto_init();
@@ -138,11 +232,7 @@ int main(int argc, char *argv[])
 	rrl_setrate(rrl, rate);
 	is_int(rate, rrl_rate(rrl), "rrl: setrate");
 
-	/* 3. setlocks */
-	ret = rrl_setlocks(rrl, RRL_LOCKS);
-	is_int(KNOT_EOK, ret, "rrl: setlocks");
-
-	/* 4. N unlimited requests. */
+	/* 3. N unlimited requests. */
 	knot_dname_t *zone_name = knot_dname_from_str_alloc("rrl.");
 	zone_t *zone = zone_new(zone_name);
 	knot_dname_free(&zone_name, NULL);
@@ -162,40 +252,45 @@ int main(int argc, char *argv[])
 	is_int(0, ret, "rrl: unlimited IPv4/v6 requests");
 
 #ifdef ENABLE_TIMED_TESTS
-	/* 5. limited request */
+	/* 4. limited request */
 	ret = rrl_query(rrl, &addr, &rq, zone);
 	is_int(KNOT_ELIMIT, ret, "rrl: throttled IPv4 request");
 
-	/* 6. limited IPv6 request */
+	/* 5. limited IPv6 request */
 	ret = rrl_query(rrl, &addr6, &rq, zone);
 	is_int(KNOT_ELIMIT, ret, "rrl: throttled IPv6 request");
 #endif
 
-	/* 7. invalid values. */
+	/* 6. invalid values. */
 	ret = 0;
 	rrl_create(0);            // NULL
 	ret += rrl_setrate(0, 0); // 0
 	ret += rrl_rate(0);       // 0
-	ret += rrl_setlocks(0,0); // -1
 	ret += rrl_query(0, 0, 0, 0); // -1
 	ret += rrl_query(rrl, 0, 0, 0); // -1
 	ret += rrl_query(rrl, (void*)0x1, 0, 0); // -1
 	ret += rrl_destroy(0); // -1
-	is_int(-88, ret, "rrl: not crashed while executing functions on NULL context");
+	is_int(-66, ret, "rrl: not crashed while executing functions on NULL context");
+
+	/* 7. concurrent queries */
+	rrl_concurrent(&rq, zone);
+
+	/* 8. throughput */
+	rrl_benchmark(&rq, zone);
 
 #ifdef ENABLE_TIMED_TESTS
-	/* 8. hopscotch test */
+	/* 9. bucket lookup test */
 	struct runnable_data rd = {
 		1, rrl, &addr, &rq, zone
 	};
-	rrl_hopscotch(&rd);
+	rrl_lookup(&rd);
 	ok(rd.passed, "rrl: hashtable is ~ consistent");
 
-	/* 9. reseed */
+	/* 10. reseed */
 	is_int(0, rrl_reseed(rrl), "rrl: reseed");
 
-	/* 10. hopscotch after reseed. */
-	rrl_hopscotch(&rd);
+	/* 11. bucket lookup after reseed. */
+	rrl_lookup(&rd);
 	ok(rd.passed, "rrl: hashtable is ~ consistent");
 #endif
 
@@ -18,6 +18,7 @@
 #include <tap/basic.h>
 
 #include <libknot/packet/rrset-wire.h>
+#include <libknot/packet/pkt.h>
 #include <libknot/descriptor.h>
 #include <libknot/errcode.h>
 
@@ -194,9 +195,102 @@ static const struct wire_data FROM_CASES[FROM_CASE_COUNT] = {
 	ok(knot_rrset_rr_from_wire(FROM_CASES[i].wire, &_pos##i, FROM_CASES[i].size, \
 	NULL, rrset) == FROM_CASES[i].code, "rrset wire: %s", FROM_CASES[i].msg)
 
+#define IMAGE_CASE_COUNT 5
+
+static const struct {
+	uint16_t type;
+	uint8_t rdata[2][64];
+	uint16_t rdlen[2];
+	uint16_t count;
+} IMAGE_CASES[IMAGE_CASE_COUNT] = {
+{ KNOT_RRTYPE_A, { { 192, 0, 2, 1 }, { 192, 0, 2, 2 } }, { 4, 4 }, 2 },
+{ KNOT_RRTYPE_NS, { { 3, 'n', 's', '1', QNAME }, { 3, 'n', 's', '2', 2, 'c', 'z', 0 } },
+  { 4 + QNAME_SIZE, 8 }, 2 },
+{ KNOT_RRTYPE_MX, { { 0, 10, 4, 'm', 'a', 'i', 'l', QNAME } }, { 7 + QNAME_SIZE }, 1 },
+{ KNOT_RRTYPE_SRV, { { 0, 0, 0, 0, 0, 53, 3, 's', 'r', 'v', QNAME } },
+  { 10 + QNAME_SIZE }, 1 },
+{ KNOT_RRTYPE_SOA, { { 2, 'n', 's', QNAME, 4, 'm', 'a', 'i', 'l', QNAME,
+                       0, 0, 0, 1, 0, 0, 0, 2, 0, 0, 0, 3, 0, 0, 0, 4, 0, 0, 0, 5 } },
+  { 3 + QNAME_SIZE + 5 + QNAME_SIZE + 20 }, 1 },
+};
+
+/*! \brief Write all image cases into the packet, with or without images. */
+static int image_pkt_put(knot_pkt_t *pkt, knot_rrset_t *rrsets, bool use_image)
+{
+	static const uint8_t qname[] = { QNAME };
+	int ret = knot_pkt_put_question(pkt, qname, KNOT_CLASS_IN, KNOT_RRTYPE_ANY);
+	for (int i = 0; i < IMAGE_CASE_COUNT && ret == KNOT_EOK; ++i) {
+		knot_rrset_t rrset = rrsets[i];
+		if (!use_image) {
+			rrset.image = NULL;
+		}
+		ret = knot_pkt_put(pkt, KNOT_COMPR_HINT_QNAME, &rrset, 0);
+	}
+
+	return ret;
+}
+
+static void test_image(void)
+{
+	static uint8_t owner[] = { QNAME };
+	knot_rrset_t rrsets[IMAGE_CASE_COUNT];
+	bool created = true;
+	for (int i = 0; i < IMAGE_CASE_COUNT; ++i) {
+		knot_rrset_init(&rrsets[i], owner, IMAGE_CASES[i].type, KNOT_CLASS_IN);
+		for (int j = 0; j < IMAGE_CASES[i].count; ++j) {
+			knot_rrset_add_rdata(&rrsets[i], IMAGE_CASES[i].rdata[j],
+			                     IMAGE_CASES[i].rdlen[j], 3600, NULL);
+		}
+		rrsets[i].image = knot_rrset_image_new(&rrsets[i], NULL);
+		created = created && rrsets[i].image != NULL;
+	}
+	ok(created, "rrset image: create");
+
+	/* Same answer and compression hints with and without the images. */
+	knot_pkt_t *plain = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, NULL);
+	knot_pkt_t *image = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, NULL);
+	int ret_plain = image_pkt_put(plain, rrsets, false);
+	int ret_image = image_pkt_put(image, rrsets, true);
+	ok(ret_plain == KNOT_EOK && ret_image == KNOT_EOK &&
+	   plain->size == image->size &&
+	   memcmp(plain->wire, image->wire, plain->size) == 0,
+	   "rrset image: same wire format");
+	bool hints_equal = plain->rrset_count == image->rrset_count;
+	for (int i = 0; hints_equal && i < plain->rrset_count; ++i) {
+		hints_equal = memcmp(&plain->rr_info[i], &image->rr_info[i],
+		                     sizeof(knot_rrinfo_t)) == 0;
+	}
+	ok(hints_equal, "rrset image: same compression hints");
+
+	/* Truncation. */
+	knot_pkt_clear(plain);
+	knot_pkt_clear(image);
+	plain->max_size = image->max_size = plain->size + 64;
+	ret_plain = image_pkt_put(plain, rrsets, false);
+	ret_image = image_pkt_put(image, rrsets, true);
+	ok(ret_plain == KNOT_ESPACE && ret_image == KNOT_ESPACE &&
+	   plain->size == image->size &&
+	   memcmp(plain->wire, image->wire, plain->size) == 0,
+	   "rrset image: truncated");
+
+	/* Image of different data is not used. */
+	uint8_t wire[128];
+	knot_rrset_t stale = rrsets[0];
+	stale.image = rrsets[1].image;
+	int ret = knot_rrset_to_wire(&stale, wire, sizeof(wire), NULL);
+	ok(ret == 2 * (QNAME_SIZE + RR_HEADER_SIZE + 4), "rrset image: stale image");
+
+	knot_pkt_free(&plain);
+	knot_pkt_free(&image);
+	for (int i = 0; i < IMAGE_CASE_COUNT; ++i) {
+		knot_rrset_image_free(&rrsets[i].image, NULL);
+		knot_rdataset_clear(&rrsets[i].rrs, NULL);
+	}
+}
+
 int main(int argc, char *argv[])
 {
-	plan(1 + FROM_CASE_COUNT);
+	plan(1 + FROM_CASE_COUNT + 5);
 
 	// Test NULL params.
 	int ret = knot_rrset_rr_from_wire(NULL, NULL, 0, NULL, NULL);
@@ -210,5 +304,7 @@ int main(int argc, char *argv[])
 		knot_rrset_clear(&rrset, NULL);
 	}
 
+	test_image();
+
 	return EXIT_SUCCESS;
 }
@@ -0,0 +1,272 @@
+/*  Copyright (C) 2015 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <tap/basic.h>
+
+#include "test_conf.h"
+#include "knot/ctl/remote.h"
+#include "knot/modules/stats.h"
+#include "knot/nameserver/process_query.h"
+#include "knot/server/server.h"
+#include "knot/zone/zone.h"
+#include "knot/zone/zonedb.h"
+#include "libknot/internal/net.h"
+#include "libknot/internal/sockaddr.h"
+#include "libknot/libknot.h"
+
+#define ZONE "example."
+
+/*! \brief Three server threads, server-wide and zone statistics. */
+static const char *stats_conf =
+	"server:\n"
+	"  udp-workers: 2\n"
+	"  tcp-workers: 1\n"
+	"mod-stats:\n"
+	"  - id: test\n"
+	"template:\n"
+	"  - id: default\n"
+	"    module: mod-stats/test\n"
+	"zone:\n"
+	"  - domain: "ZONE"\n";
+
+/*! \brief Printed counters of the server-wide module. */
+static const char *server_stats =
+	"\tqueries=4 | edns=2 | dnssec-ok=1 | udp4=1 | udp6=1 | tcp4=1 | tcp6=1\n"
+	"\tqtype: A=2 AAAA=1 other=1\n"
+	"\trcode: NOERROR=1 NXDOMAIN=1 RCODE12=1 other=1\n"
+	"\tresponse-size: 0-127=1 128-255=1 256-511=0 512-1023=0 1024-1231=0"
+	" 1232-1499=1 1500-4095=0 4096-65535=1\n";
+
+/*! \brief Printed counters of the zone module. */
+static const char *zone_stats =
+	"\tqueries=1 | edns=0 | dnssec-ok=0 | udp4=1 | udp6=0 | tcp4=0 | tcp6=0\n"
+	"\tqtype: MX=1\n"
+	"\trcode: REFUSED=1\n"
+	"\tresponse-size: 0-127=0 128-255=0 256-511=1 512-1023=0 1024-1231=0"
+	" 1232-1499=0 1500-4095=0 4096-65535=0\n";
+
+/*! \brief Query counted by the module. */
+typedef struct {
+	uint16_t qtype;
+	bool edns;
+	bool dnssec_ok;
+	bool tcp;
+	int family;
+	unsigned thread_id;
+	uint16_t rcode;
+	size_t resp_size;
+} query_t;
+
+static void count_query(const struct query_plan *plan, const query_t *q)
+{
+	knot_pkt_t *query = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, NULL);
+	knot_pkt_t *resp = knot_pkt_new(NULL, KNOT_WIRE_MAX_PKTSIZE, NULL);
+	knot_dname_t *qname = knot_dname_from_str_alloc(ZONE);
+	knot_pkt_put_question(query, qname, KNOT_CLASS_IN, q->qtype);
+	knot_dname_free(&qname, NULL);
+
+	knot_rrset_t opt_rr;
+	knot_edns_init(&opt_rr, 4096, 0, 0, NULL);
+	if (q->dnssec_ok) {
+		knot_edns_set_do(&opt_rr);
+	}
+	if (q->edns) {
+		query->opt_rr = &opt_rr;
+	}
+	resp->size = q->resp_size;
+
+	struct sockaddr_storage remote;
+	sockaddr_set(&remote, q->family, q->family == AF_INET6 ? "::1" : "127.0.0.1", 53);
+	struct process_query_param param = {
+		.proc_flags = q->tcp ? 0 : NS_QUERY_LIMIT_SIZE,
+		.remote = &remote,
+		.thread_id = q->thread_id
+	};
+	struct query_data qdata = {
+		.rcode = q->rcode,
+		.query = query,
+		.param = &param
+	};
+
+	struct query_step *step = NULL;
+	WALK_LIST(step, plan->stage[QPLAN_END]) {
+		step->process(KNOT_STATE_DONE, resp, &qdata, step->ctx);
+	}
+
+	query->opt_rr = NULL;
+	knot_rrset_clear(&opt_rr, NULL);
+	knot_pkt_free(&query);
+	knot_pkt_free(&resp);
+}
+
+static bool printed(const struct query_module *module, const char *expected)
+{
+	char buf[4096];
+	size_t len = sizeof(buf);
+	int ret = stats_print(module, buf, &len);
+	return ret == KNOT_EOK && len == strlen(expected) &&
+	       memcmp(buf, expected, len) == 0;
+}
+
+static void test_counters(const struct query_module *module,
+                          const struct query_plan *plan,
+                          const struct query_module *zone_module,
+                          const struct query_plan *zone_plan)
+{
+	/* Threads are counted separately, the fourth shares the counters. */
+	const query_t queries[] = {
+		{ KNOT_RRTYPE_A,    false, false, false, AF_INET,  0, KNOT_RCODE_NOERROR,  127 },
+		{ KNOT_RRTYPE_AAAA, true,  true,  false, AF_INET6, 1, KNOT_RCODE_NXDOMAIN, 128 },
+		{ KNOT_RRTYPE_A,    true,  false, true,  AF_INET,  2, 12,                  1232 },
+		{ 300,              false, false, true,  AF_INET6, 3, 40,                  65535 },
+	};
+	for (size_t i = 0; i < sizeof(queries) / sizeof(queries[0]); ++i) {
+		count_query(plan, &queries[i]);
+	}
+
+	const query_t zone_query = {
+		KNOT_RRTYPE_MX, false, false, false, AF_INET, 1, KNOT_RCODE_REFUSED, 300
+	};
+	count_query(zone_plan, &zone_query);
+
+	ok(printed(module, server_stats), "stats: server counters");
+	ok(printed(zone_module, zone_stats), "stats: zone counters");
+
+	char buf[64];
+	size_t len = sizeof(buf);
+	ok(stats_print(module, buf, &len) == KNOT_ESPACE,
+	   "stats: print to small buffer");
+	len = sizeof(buf);
+	ok(stats_print(NULL, buf, &len) == KNOT_EINVAL,
+	   "stats: print without module");
+}
+
+/*! \brief Executes the control command, returns the text printed by knotc. */
+static char *control(server_t *server, const char *zone)
+{
+	knot_pkt_t *query = remote_query("stats", NULL);
+	knot_pkt_begin(query, KNOT_AUTHORITY);
+	if (zone != NULL) {
+		knot_rrset_t rr;
+		remote_build_rr(&rr, "data.", KNOT_RRTYPE_NS);
+		remote_create_ns(&rr, zone);
+		knot_pkt_put(query, 0, &rr, KNOT_PF_FREE);
+	}
+
+	/* Parsed as received by the server. */
+	knot_pkt_t *pkt = knot_pkt_new(query->wire, query->size, NULL);
+	int fds[2];
+	if (remote_parse(pkt) != KNOT_EOK ||
+	    socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+		knot_pkt_free(&pkt);
+		knot_pkt_free(&query);
+		return NULL;
+	}
+	int ret = remote_answer(fds[0], server, pkt);
+	close(fds[0]);
+	knot_pkt_free(&pkt);
+	knot_pkt_free(&query);
+
+	/* Concatenated TXT strings of the responses. */
+	char *text = calloc(1, 1);
+	size_t len = 0;
+	uint8_t buf[KNOT_WIRE_MAX_PKTSIZE];
+	struct timeval timeout = { 1, 0 };
+	int n = 0;
+	while (ret == KNOT_EOK &&
+	       (n = tcp_recv_msg(fds[1], buf, sizeof(buf), &timeout)) > 0) {
+		knot_pkt_t *resp = knot_pkt_new(buf, n, NULL);
+		knot_pkt_parse(resp, 0);
+		const knot_pktsection_t *authority = knot_pkt_section(resp, KNOT_AUTHORITY);
+		const knot_rrset_t *rr = knot_pkt_rr(authority, 0);
+		const knot_rdata_t *rdata = knot_rdataset_at(&rr->rrs, 0);
+		const uint8_t *p = knot_rdata_data(rdata);
+		const uint8_t *end = p + knot_rdata_rdlen(rdata);
+		for (; p < end; p += *p + 1) {
+			text = realloc(text, len + *p + 1);
+			memcpy(text + len, p + 1, *p);
+			len += *p;
+			text[len] = '\0';
+		}
+		knot_pkt_free(&resp);
+	}
+	close(fds[1]);
+
+	return text;
+}
+
+static void test_control(server_t *server)
+{
+	size_t len = strlen("server\tmod-stats/test\n") + strlen(server_stats) +
+	             strlen(ZONE"\tmod-stats/test\n") + strlen(zone_stats) + 1;
+	char *expected = malloc(len);
+	snprintf(expected, len, "server\tmod-stats/test\n%s"
+	         ZONE"\tmod-stats/test\n%s", server_stats, zone_stats);
+
+	char *text = control(server, NULL);
+	ok(text != NULL && strcmp(text, expected) == 0,
+	   "stats: control command output");
+	free(text);
+
+	snprintf(expected, len, ZONE"\tmod-stats/test\n%s", zone_stats);
+	text = control(server, ZONE);
+	ok(text != NULL && strcmp(text, expected) == 0,
+	   "stats: control command output for zone");
+	free(text);
+
+	free(expected);
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	int ret = test_conf(stats_conf, NULL);
+	ok(ret == KNOT_EOK && !EMPTY_LIST(conf()->query_modules),
+	   "stats: server-wide module");
+	if (ret != KNOT_EOK) {
+		return 1;
+	}
+
+	knot_dname_t *origin = knot_dname_from_str_alloc(ZONE);
+	zone_t *zone = zone_new(origin);
+	knot_dname_free(&origin, NULL);
+	ret = conf_activate_modules(conf(), zone->name, &zone->query_modules,
+	                            &zone->query_plan);
+	ok(ret == KNOT_EOK && stats_is_module(HEAD(zone->query_modules)),
+	   "stats: zone module");
+
+	server_t server;
+	memset(&server, 0, sizeof(server));
+	server.zone_db = knot_zonedb_new(1);
+	knot_zonedb_insert(server.zone_db, zone);
+	knot_zonedb_build_index(server.zone_db);
+
+	const struct query_module *module = HEAD(conf()->query_modules);
+	ok(stats_is_module(module), "stats: is statistics module");
+
+	test_counters(module, conf()->query_plan,
+	              HEAD(zone->query_modules), zone->query_plan);
+	test_control(&server);
+
+	knot_zonedb_deep_free(&server.zone_db);
+	conf_free(conf(), false);
+
+	return 0;
+}
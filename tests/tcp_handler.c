@@ -0,0 +1,449 @@
+/*  Copyright (C) 2015 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <tap/basic.h>
+
+#include "test_conf.h"
+#include "knot/zone/zonefile.h"
+#include "libknot/internal/mem.h"
+
+/* Connection internals are tested directly. */
+#include "knot/server/tcp-handler.c"
+
+#define ZONE	"example."
+#define RECORDS	4000  /* Transfer takes more than TCP_ROUNDS_MAX messages. */
+#define IDS	64
+#define SNDBUF	(1024 * 1024)
+
+static const char *tcp_conf =
+	"acl:\n"
+	"  - id: xfr\n"
+	"    address: [ 127.0.0.1 ]\n"
+	"    action: [ transfer ]\n"
+	"\n"
+	"zone:\n"
+	"  - domain: "ZONE"\n"
+	"    acl: [ xfr ]\n";
+
+/*! \brief Client side of a connection. */
+typedef struct {
+	int fd;                /*!< Client socket. */
+	tcp_conn_t *conn;      /*!< Server side of the connection. */
+	uint8_t *rx;           /*!< Received data. */
+	size_t rx_len;         /*!< Received data length. */
+	size_t rx_size;        /*!< Receive buffer size. */
+	bool eof;              /*!< Server closed the connection. */
+	uint16_t qtype[IDS];   /*!< Query type sent with the message ID. */
+	unsigned soa[IDS];     /*!< SOA records received for the message ID. */
+	unsigned txt[IDS];     /*!< TXT records received for the message ID. */
+	unsigned bad;          /*!< Unexpected or failed answers. */
+} client_t;
+
+static char *write_zone(void)
+{
+	char *tmpdir = test_tmpdir();
+	char *path = sprintf_alloc("%s/tcp_handler.zone", tmpdir);
+	free(tmpdir);
+
+	FILE *f = fopen(path, "w");
+	if (f == NULL) {
+		free(path);
+		return NULL;
+	}
+
+	char text[201] = { 0 };
+	memset(text, 'x', sizeof(text) - 1);
+
+	fputs("$TTL 600\n"
+	      "@ SOA ns admin 1 3600 900 604800 300\n"
+	      "@ NS ns\n"
+	      "ns A 192.0.2.1\n", f);
+	for (int i = 0; i < RECORDS; i++) {
+		fprintf(f, "host%d TXT \"%s\"\n", i, text);
+	}
+	fclose(f);
+
+	return path;
+}
+
+static int load_zone(server_t *server, const char *path)
+{
+	knot_dname_t *origin = knot_dname_from_str_alloc(ZONE);
+	zone_t *zone = zone_new(origin);
+	zloader_t loader;
+	if (path != NULL && zonefile_open(&loader, path, origin, false) == KNOT_EOK) {
+		zone->contents = zonefile_load(&loader);
+		zonefile_close(&loader);
+	}
+	knot_dname_free(&origin, NULL);
+	if (zone->contents == NULL) {
+		zone_free(&zone);
+		return KNOT_ERROR;
+	}
+
+	knot_zonedb_free(&server->zone_db);
+	server->zone_db = knot_zonedb_new(1);
+	knot_zonedb_insert(server->zone_db, zone);
+	knot_zonedb_build_index(server->zone_db);
+
+	return KNOT_EOK;
+}
+
+/*! \brief Connect a new client to the TCP handler context. */
+static client_t *client_new(tcp_context_t *tcp)
+{
+	int fds[2];
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+		return NULL;
+	}
+	fcntl(fds[0], F_SETFL, O_NONBLOCK);
+	fcntl(fds[1], F_SETFL, O_NONBLOCK);
+
+	/* Room for more than TCP_ROUNDS_MAX transfer messages if allowed. */
+	int sndbuf = SNDBUF;
+	(void)setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+
+	struct sockaddr_storage addr;
+	sockaddr_set(&addr, AF_INET, "127.0.0.1", 53);
+	tcp_conn_t *conn = tcp_conn_new(tcp, fds[0], &addr);
+	if (conn == NULL || fdset_add(&tcp->set, fds[0], POLLIN, conn) < 0) {
+		tcp_conn_free(conn);
+		close(fds[0]);
+		close(fds[1]);
+		return NULL;
+	}
+
+	client_t *client = calloc(1, sizeof(client_t));
+	client->fd = fds[1];
+	client->conn = conn;
+
+	return client;
+}
+
+static void client_free(client_t *client)
+{
+	if (client != NULL) {
+		close(client->fd);
+		free(client->rx);
+		free(client);
+	}
+}
+
+/*! \brief Index of the client connection in the handler set, -1 if closed. */
+static int client_index(const tcp_context_t *tcp, const client_t *client)
+{
+	for (int i = 0; i < tcp->set.n; i++) {
+		if (tcp->set.ctx[i] == client->conn) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+/*! \brief Send queries for the message IDs in one segment. */
+static bool client_send(client_t *client, uint16_t first, uint16_t count,
+                        uint16_t qtype)
+{
+	knot_dname_t *qname = knot_dname_from_str_alloc(ZONE);
+	knot_pkt_t *query = knot_pkt_new(NULL, KNOT_WIRE_MIN_PKTSIZE, NULL);
+	uint8_t *buf = malloc(count * (sizeof(uint16_t) + KNOT_WIRE_MIN_PKTSIZE));
+	size_t len = 0;
+
+	for (uint16_t id = first; id < first + count; id++) {
+		knot_pkt_clear(query);
+		knot_wire_set_id(query->wire, id);
+		knot_pkt_put_question(query, qname, KNOT_CLASS_IN, qtype);
+		wire_write_u16(buf + len, query->size);
+		memcpy(buf + len + sizeof(uint16_t), query->wire, query->size);
+		len += sizeof(uint16_t) + query->size;
+		client->qtype[id] = qtype;
+	}
+
+	bool sent = (send(client->fd, buf, len, 0) == len);
+
+	free(buf);
+	knot_pkt_free(&query);
+	knot_dname_free(&qname, NULL);
+
+	return sent;
+}
+
+/*! \brief Account the records of a received answer. */
+static void client_answer(client_t *client, uint8_t *wire, size_t len)
+{
+	knot_pkt_t *pkt = knot_pkt_new(wire, len, NULL);
+	if (pkt == NULL || knot_pkt_parse(pkt, 0) != KNOT_EOK) {
+		client->bad += 1;
+		knot_pkt_free(&pkt);
+		return;
+	}
+
+	uint16_t id = knot_wire_get_id(wire);
+	if (id >= IDS || client->qtype[id] != knot_pkt_qtype(pkt) ||
+	    knot_wire_get_rcode(wire) != KNOT_RCODE_NOERROR) {
+		client->bad += 1;
+		knot_pkt_free(&pkt);
+		return;
+	}
+
+	const knot_pktsection_t *answer = knot_pkt_section(pkt, KNOT_ANSWER);
+	for (uint16_t i = 0; i < answer->count; i++) {
+		const knot_rrset_t *rr = knot_pkt_rr(answer, i);
+		if (rr->type == KNOT_RRTYPE_SOA) {
+			client->soa[id] += rr->rrs.rr_count;
+		} else if (rr->type == KNOT_RRTYPE_TXT) {
+			client->txt[id] += rr->rrs.rr_count;
+		}
+	}
+
+	knot_pkt_free(&pkt);
+}
+
+/*! \brief Receive available answers. */
+static void client_recv(client_t *client)
+{
+	while (!client->eof) {
+		if (client->rx_size - client->rx_len < KNOT_WIRE_MAX_PKTSIZE) {
+			client->rx_size = client->rx_len + 2 * KNOT_WIRE_MAX_PKTSIZE;
+			client->rx = realloc(client->rx, client->rx_size);
+		}
+		ssize_t ret = recv(client->fd, client->rx + client->rx_len,
+		                   client->rx_size - client->rx_len, 0);
+		if (ret == 0) {
+			client->eof = true;
+		} else if (ret < 0) {
+			break;
+		} else {
+			client->rx_len += ret;
+		}
+	}
+
+	size_t off = 0;
+	while (client->rx_len - off >= sizeof(uint16_t)) {
+		size_t msglen = wire_read_u16(client->rx + off);
+		if (client->rx_len - off < sizeof(uint16_t) + msglen) {
+			break;
+		}
+		client_answer(client, client->rx + off + sizeof(uint16_t), msglen);
+		off += sizeof(uint16_t) + msglen;
+	}
+	client->rx_len -= off;
+	memmove(client->rx, client->rx + off, client->rx_len);
+}
+
+/*! \brief Check if all the queries were completely answered. */
+static bool client_done(const client_t *client)
+{
+	for (int id = 0; id < IDS; id++) {
+		unsigned soa = 0;
+		if (client->qtype[id] == KNOT_RRTYPE_SOA) {
+			soa = 1;
+		} else if (client->qtype[id] == KNOT_RRTYPE_AXFR) {
+			soa = 2; /* Transfer starts and ends with SOA. */
+		}
+		if (client->soa[id] < soa) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*! \brief Check that each query got exactly the expected answer. */
+static bool client_answered(const client_t *client)
+{
+	if (client->bad > 0) {
+		return false;
+	}
+
+	for (int id = 0; id < IDS; id++) {
+		switch (client->qtype[id]) {
+		case KNOT_RRTYPE_SOA:
+			if (client->soa[id] != 1 || client->txt[id] != 0) {
+				return false;
+			}
+			break;
+		case KNOT_RRTYPE_AXFR:
+			if (client->soa[id] != 2 || client->txt[id] != RECORDS) {
+				return false;
+			}
+			break;
+		default:
+			if (client->soa[id] != 0 || client->txt[id] != 0) {
+				return false;
+			}
+			break;
+		}
+	}
+
+	return true;
+}
+
+/*! \brief Run the handler until the clients are answered (or closed). */
+static bool serve(tcp_context_t *tcp, client_t **clients, unsigned count,
+                  bool until_eof)
+{
+	for (;;) {
+		bool done = true;
+		for (unsigned i = 0; i < count; i++) {
+			client_recv(clients[i]);
+			done = done && (until_eof ? clients[i]->eof : client_done(clients[i]));
+		}
+		if (done) {
+			return true;
+		}
+
+		/* Stuck if no event occurs. */
+		if (tcp_wait_for_events(tcp) <= 0) {
+			return false;
+		}
+	}
+}
+
+static void test_pipelining(tcp_context_t *tcp)
+{
+	/* More than pipeline limit of queries in one segment. */
+	client_t *client = client_new(tcp);
+	ok(client != NULL && client_send(client, 0, 3 * TCP_PIPELINE_MAX,
+	                                 KNOT_RRTYPE_SOA),
+	   "tcp: send pipelined queries in one segment");
+	ok(serve(tcp, &client, 1, false) && client_answered(client),
+	   "tcp: pipelined queries answered with matching message IDs");
+	client_free(client);
+}
+
+static void test_backpressure(tcp_context_t *tcp)
+{
+	client_t *client = client_new(tcp);
+	ok(client != NULL && client_send(client, 0, TCP_PIPELINE_MAX + 4,
+	                                 KNOT_RRTYPE_AXFR),
+	   "tcp: send transfers over the pipeline limit");
+
+	/* The client doesn't read, the socket buffer gets full. */
+	tcp_conn_t *conn = client->conn;
+	for (int events = 0; events < TCP_PIPELINE_MAX && conn->tx_len == 0; events++) {
+		tcp_wait_for_events(tcp);
+	}
+	int i = client_index(tcp, client);
+	ok(i >= 0 && conn->nqueries == TCP_PIPELINE_MAX && conn->rx_len > 0 &&
+	   conn->tx_len > 0 && !(tcp->set.pfd[i].events & POLLIN),
+	   "tcp: receiving stopped at the pipeline limit");
+
+	ok(serve(tcp, &client, 1, false) && client_answered(client),
+	   "tcp: all transfers over the pipeline limit answered");
+	client_free(client);
+}
+
+static void test_binding(tcp_context_t *tcp)
+{
+	/* Same message IDs on two connections answered in parallel. */
+	client_t *clients[2] = { client_new(tcp), client_new(tcp) };
+	ok(clients[0] != NULL && clients[1] != NULL &&
+	   client_send(clients[0], 0, 4, KNOT_RRTYPE_AXFR) &&
+	   client_send(clients[1], 0, 4, KNOT_RRTYPE_SOA),
+	   "tcp: send queries with the same IDs on two connections");
+	ok(serve(tcp, clients, 2, false) &&
+	   client_answered(clients[0]) && client_answered(clients[1]),
+	   "tcp: queries answered on their own connections");
+
+	/* Reused processing contexts stay bound to the connection. */
+	ok(client_send(clients[1], 4, 2, KNOT_RRTYPE_AXFR) &&
+	   client_send(clients[0], 4, 2, KNOT_RRTYPE_SOA) &&
+	   serve(tcp, clients, 2, false) &&
+	   client_answered(clients[0]) && client_answered(clients[1]),
+	   "tcp: reused contexts answer on their own connections");
+
+	client_free(clients[0]);
+	client_free(clients[1]);
+}
+
+static void test_half_close(tcp_context_t *tcp)
+{
+	client_t *client = client_new(tcp);
+
+	/* Client stops sending right after the queries. */
+	ok(client != NULL && client_send(client, 0, 1, KNOT_RRTYPE_SOA) &&
+	   client_send(client, 1, 1, KNOT_RRTYPE_AXFR) &&
+	   client_send(client, 2, 1, KNOT_RRTYPE_SOA) &&
+	   shutdown(client->fd, SHUT_WR) == 0,
+	   "tcp: send queries and half-close");
+	ok(serve(tcp, &client, 1, true) && client_answered(client),
+	   "tcp: half-closed connection answered completely");
+	ok(client_index(tcp, client) < 0, "tcp: half-closed connection closed");
+	client_free(client);
+}
+
+static void interrupt_handle(int s)
+{
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	struct sigaction sa;
+	sa.sa_handler = interrupt_handle;
+	sigemptyset(&sa.sa_mask);
+	sa.sa_flags = 0;
+	sigaction(SIGALRM, &sa, NULL); // Interrupt
+
+	server_t server;
+	int ret = server_init(&server, 1);
+	ok(ret == KNOT_EOK, "tcp: server initialization");
+	if (ret != KNOT_EOK) {
+		return 1;
+	}
+
+	ret = test_conf(tcp_conf, NULL);
+	ok(ret == KNOT_EOK, "tcp: prepare configuration");
+
+	char *path = write_zone();
+	ret = load_zone(&server, path);
+	ok(ret == KNOT_EOK, "tcp: load zone");
+
+	tcp_context_t tcp;
+	memset(&tcp, 0, sizeof(tcp));
+	tcp.server = &server;
+	tcp.max_per_set = 16;
+	tcp.hshake_timeout = 10;
+	tcp.idle_timeout = 10;
+	tcp.reply_timeout = 10;
+	fdset_init(&tcp.set, 8);
+
+	if (ret == KNOT_EOK) {
+		test_pipelining(&tcp);
+		test_backpressure(&tcp);
+		test_binding(&tcp);
+		test_half_close(&tcp);
+	}
+
+	tcp_close_clients(&tcp);
+	fdset_clear(&tcp.set);
+	if (path != NULL) {
+		remove(path);
+	}
+	free(path);
+	server_deinit(&server);
+	conf_free(conf(), false);
+
+	return 0;
+}
@@ -97,12 +97,26 @@ int main(void)
 	sched_yield();
 	ok(executed_reset(&log) == 0, "executed count before start");
 
+	int running = -1, queued = -1;
+	size_t completed = -1;
+	worker_pool_status(pool, &running, &queued, &completed);
+	ok(running == 0 && queued == TASKS_BATCH && completed == 0,
+	   "status before start");
+
 	// start and wait for finish
 
 	worker_pool_start(pool);
 	worker_pool_wait(pool);
 	ok(executed_reset(&log) == TASKS_BATCH, "executed count after start");
 
+	worker_pool_status(pool, &running, &queued, &completed);
+	ok(running == 0 && queued == 0 && completed == TASKS_BATCH,
+	   "status after finish");
+
+	worker_pool_reset_completed(pool);
+	worker_pool_status(pool, &running, &queued, &completed);
+	ok(completed == 0, "status after reset");
+
 	// add additional jobs while pool is running
 
 	for (int i = 0; i < TASKS_BATCH; i++) {
@@ -0,0 +1,116 @@
+/*  Copyright (C) 2014 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <tap/basic.h>
+
+#include "knot/zone/arena.h"
+#include "knot/zone/contents.h"
+#include "knot/updates/apply.h"
+#include "libknot/libknot.h"
+
+static void test_arena(void)
+{
+	zone_arena_t *arena = zone_arena_new();
+	ok(arena != NULL && zone_arena_size(arena) == 0, "arena: new");
+
+	mm_ctx_t mm;
+	zone_arena_mm(arena, &mm);
+
+	uint8_t *small1 = mm_alloc(&mm, 3);
+	uint8_t *small2 = mm_alloc(&mm, 10);
+	ok(small1 && small2 && small2 - small1 == 8 &&
+	   ((uintptr_t)small2 % 8) == 0, "arena: aligned bump allocation");
+
+	uint8_t *large = mm_alloc(&mm, 2 * ZONE_ARENA_CHUNK);
+	uint8_t *small3 = mm_alloc(&mm, 16);
+	ok(large && small3 == small2 + 16 &&
+	   zone_arena_size(arena) > 3 * ZONE_ARENA_CHUNK, "arena: large allocation");
+	memset(large, 0xff, 2 * ZONE_ARENA_CHUNK);
+
+	/* Arena blocks are released with the arena, heap blocks at once. */
+	mm_free(&mm, small1);
+	mm_free(&mm, large);
+	mm_free(&mm, malloc(16));
+	small1[0] = 1;
+	ok(small3 != NULL, "arena: free of mixed blocks");
+
+	zone_arena_t *ref = zone_arena_ref(arena);
+	zone_arena_unref(arena);
+	small2[0] = 1;
+	ok(ref == arena, "arena: reference");
+	zone_arena_unref(ref);
+}
+
+static void add_rr(zone_contents_t *zone, const char *owner_str,
+                   uint16_t type, const uint8_t *rdata, uint16_t rdlen)
+{
+	knot_dname_t *owner = knot_dname_from_str_alloc(owner_str);
+	knot_rrset_t rr;
+	knot_rrset_init(&rr, owner, type, KNOT_CLASS_IN);
+	knot_rrset_add_rdata(&rr, rdata, rdlen, 3600, NULL);
+
+	zone_node_t *node = NULL;
+	zone_contents_add_rr(zone, &rr, &node);
+	knot_rrset_clear(&rr, NULL);
+}
+
+static void test_contents(void)
+{
+	knot_dname_t *apex = knot_dname_from_str_alloc("test.");
+	zone_contents_t *zone = zone_contents_new_arena(apex);
+	ok(zone != NULL && zone->arena != NULL, "contents: new with arena");
+
+	const uint8_t a1[] = { 192, 0, 2, 1 };
+	const uint8_t a2[] = { 192, 0, 2, 2 };
+	add_rr(zone, "a.b.test.", KNOT_RRTYPE_A, a1, sizeof(a1));
+	add_rr(zone, "a.b.test.", KNOT_RRTYPE_A, a2, sizeof(a2));
+	add_rr(zone, "a.b.test.", KNOT_RRTYPE_TXT, a1, sizeof(a1));
+
+	knot_dname_t *owner = knot_dname_from_str_alloc("a.b.test.");
+	const zone_node_t *node = zone_contents_find_node(zone, owner);
+	ok(node != NULL && node->rrset_count == 2 &&
+	   node_rdataset(node, KNOT_RRTYPE_A)->rr_count == 2 &&
+	   zone_contents_find_node(zone, knot_wire_next_label(owner, NULL)),
+	   "contents: nodes in arena");
+
+	/* Copy shares RDATA from the arena, which outlives the original. */
+	zone_contents_t *copy = NULL;
+	int ret = zone_contents_adjust_full(zone, NULL, NULL);
+	ret += zone_contents_shallow_copy(zone, &copy);
+	ok(ret == KNOT_EOK && copy->arena == zone->arena, "contents: shallow copy");
+	add_rr(copy, "c.test.", KNOT_RRTYPE_A, a1, sizeof(a1));
+	update_free_zone(&zone);
+
+	node = zone_contents_find_node(copy, owner);
+	const knot_rdataset_t *rrs = node ? node_rdataset(node, KNOT_RRTYPE_A) : NULL;
+	ok(rrs != NULL && rrs->rr_count == 2 &&
+	   memcmp(knot_rdata_data(knot_rdataset_at(rrs, 1)), a2, sizeof(a2)) == 0,
+	   "contents: data shared with copy");
+
+	zone_contents_deep_free(&copy);
+	knot_dname_free(&owner, NULL);
+	knot_dname_free(&apex, NULL);
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	test_arena();
+	test_contents();
+
+	return 0;
+}
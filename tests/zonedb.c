@@ -20,6 +20,7 @@
 #include "libknot/internal/strlcpy.h"
 #include "knot/zone/zone.h"
 #include "knot/zone/zonedb.h"
+#include "knot/zone/zonedb-load.h"
 
 #define ZONE_COUNT 10
 static const char *zone_list[ZONE_COUNT] = {
@@ -35,9 +36,35 @@ static const char *zone_list[ZONE_COUNT] = {
         "b.b.b.b.net",
 };
 
+/*! \brief Zone file sizes in the configuration order. */
+#define LOAD_COUNT 6
+static const off_t load_sizes[LOAD_COUNT] = { 10, 500, 0, 500, 20000, 10 };
+static const size_t load_order[LOAD_COUNT] = { 4, 1, 3, 0, 5, 2 };
+
+static void test_load_order(void)
+{
+	zone_load_t loads[LOAD_COUNT] = {{ 0 }};
+	for (size_t i = 0; i < LOAD_COUNT; ++i) {
+		loads[i].size = load_sizes[i];
+		loads[i].order = i;
+	}
+
+	zonedb_load_order(loads, LOAD_COUNT);
+
+	bool sorted = true;
+	for (size_t i = 0; i < LOAD_COUNT; ++i) {
+		if (loads[i].order != load_order[i]) {
+			sorted = false;
+		}
+	}
+	ok(sorted, "zonedb: load order, largest first and configuration order");
+}
+
 int main(int argc, char *argv[])
 {
-	plan(6);
+	plan(7);
+
+	test_load_order();
 
 	/* Create database. */
 	char buf[KNOT_DNAME_MAXLEN];
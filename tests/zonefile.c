@@ -0,0 +1,233 @@
+/*  Copyright (C) 2015 CZ.NIC, z.s.p.o. <knot-dns@labs.nic.cz>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <tap/basic.h>
+
+#include "knot/zone/zonefile.h"
+#include "libknot/libknot.h"
+#include "zscanner/scanner.h"
+
+/*! \brief Part size small enough to split the test zone. */
+#define TEST_CHUNK_SIZE 256
+
+static const char *zone_head =
+	"$TTL 600\n"
+	"@ IN SOA ns admin (\n"
+	"\t1 ; serial (with parentheses in comment\n"
+	"\t3600 900 604800 300 )\n"
+	"\tNS ns\n"
+	"ns A 192.0.2.1\n"
+	"txt TXT \"quoted ; not a comment (\" \"escaped \\\" quote\"\n"
+	"\tTXT ( \"multi\"\n"
+	"\t      \"line\" )\n";
+
+static const char *zone_tail =
+	"$ORIGIN sub.example.\n"
+	"a A 192.0.2.2\n"
+	"$TTL 60\n"
+	"b A 192.0.2.3\n"
+	"\tAAAA 2001:db8::1\n"
+	"$ORIGIN example.\n"
+	"c A 192.0.2.4\n";
+
+static char *write_zone(const char *name, const char *extra)
+{
+	char *tmpdir = test_tmpdir();
+	char *path = malloc(strlen(tmpdir) + strlen(name) + 2);
+	sprintf(path, "%s/%s", tmpdir, name);
+	free(tmpdir);
+
+	FILE *f = fopen(path, "w");
+	if (f == NULL) {
+		free(path);
+		return NULL;
+	}
+
+	fputs(zone_head, f);
+	for (int i = 0; i < 100; i++) {
+		fprintf(f, "host%d A 192.0.2.%d\n", i, i + 10);
+		fprintf(f, "\tMX 10 mx%d ; comment\n", i);
+		fprintf(f, "\n; separator\n");
+		if (i == 50) {
+			fputs(zone_tail, f);
+		}
+	}
+	if (extra != NULL) {
+		fputs(extra, f);
+	}
+	fclose(f);
+
+	return path;
+}
+
+static zone_contents_t *load_zone(const char *path, unsigned threads)
+{
+	knot_dname_t *origin = knot_dname_from_str_alloc("example.");
+	zloader_t loader;
+	zone_contents_t *contents = NULL;
+	if (zonefile_open(&loader, path, origin, false) == KNOT_EOK) {
+		loader.threads = threads;
+		loader.chunk_size = TEST_CHUNK_SIZE;
+		contents = zonefile_load(&loader);
+		zonefile_close(&loader);
+	}
+	knot_dname_free(&origin, NULL);
+
+	return contents;
+}
+
+typedef struct {
+	zone_contents_t *other;
+	size_t nodes;
+	bool equal;
+} compare_ctx_t;
+
+static int compare_node(zone_node_t *node, void *data)
+{
+	compare_ctx_t *ctx = data;
+	ctx->nodes += 1;
+
+	const zone_node_t *other = zone_contents_find_node(ctx->other, node->owner);
+	if (other == NULL || other->rrset_count != node->rrset_count) {
+		ctx->equal = false;
+		return KNOT_EOK;
+	}
+
+	for (uint16_t i = 0; i < node->rrset_count; i++) {
+		knot_rrset_t rrset = node_rrset_at(node, i);
+		knot_rrset_t other_rrset = node_rrset(other, rrset.type);
+		if (!knot_rrset_equal(&rrset, &other_rrset, KNOT_RRSET_COMPARE_WHOLE)) {
+			ctx->equal = false;
+		}
+	}
+
+	return KNOT_EOK;
+}
+
+static size_t count_nodes(zone_contents_t *zone)
+{
+	compare_ctx_t ctx = { zone, 0, true };
+	zone_contents_tree_apply_inorder(zone, compare_node, &ctx);
+	return ctx.nodes;
+}
+
+static bool zones_equal(zone_contents_t *z1, zone_contents_t *z2)
+{
+	compare_ctx_t ctx = { z2, 0, true };
+	zone_contents_tree_apply_inorder(z1, compare_node, &ctx);
+	return ctx.equal && ctx.nodes == count_nodes(z2);
+}
+
+static void test_split(const char *path)
+{
+	FILE *f = fopen(path, "r");
+	fseek(f, 0, SEEK_END);
+	long size = ftell(f);
+	rewind(f);
+	char *data = calloc(1, size + 1);
+	ok(fread(data, 1, size, f) == size, "split: read zone file");
+	fclose(f);
+
+	zs_scanner_t *s = zs_scanner_create("example.", KNOT_CLASS_IN, 3600,
+	                                    NULL, NULL, NULL);
+	zs_chunk_t *chunks = NULL;
+	uint64_t count = 0;
+	int ret = zs_scanner_split(s, data, data + size, TEST_CHUNK_SIZE,
+	                           &chunks, &count);
+	ok(ret == 0 && count > 1, "split: zone split into parts");
+
+	bool valid = true;
+	uint64_t length = 0;
+	for (uint64_t i = 0; i < count; i++) {
+		const char *start = data + chunks[i].offset;
+		if (chunks[i].offset != length ||
+		    (i > 0 && (start[-1] != '\n' || *start == '\t' || *start == '$'))) {
+			valid = false;
+		}
+		length += chunks[i].length;
+	}
+	ok(valid && length == size, "split: parts start with owner");
+
+	/* Parts before, inside, and after the directives block. */
+	uint64_t sub = strstr(data, "$ORIGIN sub") - data;
+	uint64_t ttl = strstr(data, "$TTL 60\n") - data;
+	uint64_t tail = strstr(data, "$ORIGIN example.") - data;
+	bool state = chunks[count - 1].offset > tail;
+	for (uint64_t i = 1; i < count; i++) {
+		uint64_t offset = chunks[i].offset;
+		if (chunks[i].default_ttl != (offset < ttl ? 600 : 60) ||
+		    chunks[i].zone_origin_length != (offset > sub && offset < tail ? 13 : 9)) {
+			state = false;
+		}
+	}
+	ok(state, "split: directives evaluated");
+	free(chunks);
+
+	/* Include directive prevents splitting. */
+	const char *incl = "$INCLUDE other.zone\n";
+	char *data_incl = malloc(size + strlen(incl));
+	memcpy(data_incl, data, size);
+	memcpy(data_incl + size, incl, strlen(incl));
+	ret = zs_scanner_split(s, data_incl, data_incl + size + strlen(incl),
+	                       TEST_CHUNK_SIZE, &chunks, &count);
+	ok(ret == 0 && count == 1 && chunks[0].length == size + strlen(incl),
+	   "split: include not split");
+	free(chunks);
+	free(data_incl);
+
+	zs_scanner_free(s);
+	free(data);
+}
+
+int main(int argc, char *argv[])
+{
+	plan_lazy();
+
+	char *path = write_zone("zonefile.zone", NULL);
+	ok(path != NULL, "zonefile: create zone file");
+
+	test_split(path);
+
+	zone_contents_t *seq = load_zone(path, 1);
+	zone_contents_t *par = load_zone(path, 3);
+	ok(seq != NULL && par != NULL, "zonefile: load sequential and parallel");
+	ok(seq && par && zones_equal(seq, par) && count_nodes(seq) > 100,
+	   "zonefile: parallel load equal to sequential");
+
+	knot_dname_t *name = knot_dname_from_str_alloc("b.sub.example.");
+	const zone_node_t *node = seq ? zone_contents_find_node(par, name) : NULL;
+	knot_dname_free(&name, NULL);
+	knot_rrset_t aaaa = node ? node_rrset(node, KNOT_RRTYPE_AAAA) : (knot_rrset_t){ 0 };
+	ok(!knot_rrset_empty(&aaaa) && knot_rrset_ttl(&aaaa) == 60,
+	   "zonefile: parallel load owner and TTL");
+
+	zone_contents_deep_free(&seq);
+	zone_contents_deep_free(&par);
+	unlink(path);
+	free(path);
+
+	/* Error in a later part fails the load. */
+	path = write_zone("zonefile-err.zone", "bad A 192.0.2.256\n");
+	ok(load_zone(path, 3) == NULL, "zonefile: parallel load with error");
+	unlink(path);
+	free(path);
+
+	return 0;
+}